@@ -0,0 +1,335 @@
+#include "Barriers.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    PFN_vkCmdPipelineBarrier2KHR CmdPipelineBarrier2 = nullptr;    // Null when synchronization2 isn't enabled
+    bool bDebugLogging = false;
+    bool bTessellationEnabled = false;                              // Legacy stage masks may only name stages the device enables
+    bool bGeometryEnabled = false;
+
+    struct FlagName
+    {
+        uint64_t Bit;
+        const char* Name;
+    };
+
+    const FlagName STAGE_NAMES[] = {
+        { VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT_KHR, "TOP_OF_PIPE" },
+        { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR, "DRAW_INDIRECT" },
+        { VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT_KHR, "VERTEX_INPUT" },
+        { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR, "VERTEX_SHADER" },
+        { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, "FRAGMENT_SHADER" },
+        { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR, "EARLY_FRAGMENT_TESTS" },
+        { VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR, "LATE_FRAGMENT_TESTS" },
+        { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, "COLOR_ATTACHMENT_OUTPUT" },
+        { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, "COMPUTE_SHADER" },
+        { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT_KHR, "ALL_TRANSFER" },
+        { VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT_KHR, "BOTTOM_OF_PIPE" },
+        { VK_PIPELINE_STAGE_2_HOST_BIT_KHR, "HOST" },
+        { VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT_KHR, "ALL_GRAPHICS" },
+        { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, "ALL_COMMANDS" },
+        { VK_PIPELINE_STAGE_2_COPY_BIT_KHR, "COPY" },
+        { VK_PIPELINE_STAGE_2_RESOLVE_BIT_KHR, "RESOLVE" },
+        { VK_PIPELINE_STAGE_2_BLIT_BIT_KHR, "BLIT" },
+        { VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR, "CLEAR" },
+        { VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT_KHR, "INDEX_INPUT" },
+        { VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR, "VERTEX_ATTRIBUTE_INPUT" },
+        { VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT_KHR, "PRE_RASTERIZATION_SHADERS" }
+    };
+
+    const FlagName ACCESS_NAMES[] = {
+        { VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR, "INDIRECT_COMMAND_READ" },
+        { VK_ACCESS_2_INDEX_READ_BIT_KHR, "INDEX_READ" },
+        { VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR, "VERTEX_ATTRIBUTE_READ" },
+        { VK_ACCESS_2_UNIFORM_READ_BIT_KHR, "UNIFORM_READ" },
+        { VK_ACCESS_2_INPUT_ATTACHMENT_READ_BIT_KHR, "INPUT_ATTACHMENT_READ" },
+        { VK_ACCESS_2_SHADER_READ_BIT_KHR, "SHADER_READ" },
+        { VK_ACCESS_2_SHADER_WRITE_BIT_KHR, "SHADER_WRITE" },
+        { VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR, "COLOR_ATTACHMENT_READ" },
+        { VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR, "COLOR_ATTACHMENT_WRITE" },
+        { VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR, "DEPTH_STENCIL_ATTACHMENT_READ" },
+        { VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR, "DEPTH_STENCIL_ATTACHMENT_WRITE" },
+        { VK_ACCESS_2_TRANSFER_READ_BIT_KHR, "TRANSFER_READ" },
+        { VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, "TRANSFER_WRITE" },
+        { VK_ACCESS_2_HOST_READ_BIT_KHR, "HOST_READ" },
+        { VK_ACCESS_2_HOST_WRITE_BIT_KHR, "HOST_WRITE" },
+        { VK_ACCESS_2_MEMORY_READ_BIT_KHR, "MEMORY_READ" },
+        { VK_ACCESS_2_MEMORY_WRITE_BIT_KHR, "MEMORY_WRITE" },
+        { VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR, "SHADER_SAMPLED_READ" },
+        { VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR, "SHADER_STORAGE_READ" },
+        { VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR, "SHADER_STORAGE_WRITE" }
+    };
+
+    const VkPipelineStageFlags2KHR DRAIN_STAGES = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR | VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT_KHR;
+    const VkAccessFlags2KHR DRAIN_ACCESS = VK_ACCESS_2_MEMORY_READ_BIT_KHR | VK_ACCESS_2_MEMORY_WRITE_BIT_KHR;
+
+    // Synchronization2 stages to the ones vkCmdPipelineBarrier knows. The lower 32 bits are shared,
+    // the finer grained upper bits widen to the legacy stage containing them
+    VkPipelineStageFlags ToLegacyStages(VkPipelineStageFlags2KHR Stages)
+    {
+        VkPipelineStageFlags Legacy = static_cast<VkPipelineStageFlags>(Stages & 0xFFFFFFFFull);
+        if (Stages & (VK_PIPELINE_STAGE_2_COPY_BIT_KHR | VK_PIPELINE_STAGE_2_RESOLVE_BIT_KHR | VK_PIPELINE_STAGE_2_BLIT_BIT_KHR | VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR))
+        {
+            Legacy |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+        }
+        if (Stages & (VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT_KHR | VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR))
+        {
+            Legacy |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        }
+        if (Stages & VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT_KHR)
+        {
+            Legacy |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+            if (bTessellationEnabled) Legacy |= VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT;
+            if (bGeometryEnabled) Legacy |= VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT;
+        }
+        return Legacy;
+    }
+
+    VkAccessFlags ToLegacyAccess(VkAccessFlags2KHR Access)
+    {
+        VkAccessFlags Legacy = static_cast<VkAccessFlags>(Access & 0xFFFFFFFFull);
+        if (Access & (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR)) Legacy |= VK_ACCESS_SHADER_READ_BIT;
+        if (Access & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR) Legacy |= VK_ACCESS_SHADER_WRITE_BIT;
+        return Legacy;
+    }
+
+    std::string GetFlagNames(uint64_t Flags, const FlagName* Names, size_t NameCount)
+    {
+        if (Flags == 0) return "NONE";
+
+        std::string Result;
+        for (size_t i = 0; i < NameCount; i++)
+        {
+            if ((Flags & Names[i].Bit) == 0) continue;
+            if (!Result.empty()) Result += "|";
+            Result += Names[i].Name;
+        }
+        return Result;
+    }
+
+    void LogScope(VkPipelineStageFlags2KHR SrcStages, VkAccessFlags2KHR SrcAccess, VkPipelineStageFlags2KHR DstStages, VkAccessFlags2KHR DstAccess)
+    {
+        const size_t StageNameCount = sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]);
+        const size_t AccessNameCount = sizeof(ACCESS_NAMES) / sizeof(ACCESS_NAMES[0]);
+
+        std::cout << "    " << GetFlagNames(SrcStages, STAGE_NAMES, StageNameCount) << " (" << GetFlagNames(SrcAccess, ACCESS_NAMES, AccessNameCount) << ")"
+                  << " -> " << GetFlagNames(DstStages, STAGE_NAMES, StageNameCount) << " (" << GetFlagNames(DstAccess, ACCESS_NAMES, AccessNameCount) << ")";
+
+        if (((SrcStages | DstStages) & DRAIN_STAGES) != 0 || ((SrcAccess | DstAccess) & DRAIN_ACCESS) != 0)
+        {
+            std::cout << "  <-- full pipeline drain";
+        }
+        std::cout << std::endl;
+    }
+}
+
+BarrierBatch::BarrierBatch()
+{
+}
+
+BarrierBatch::~BarrierBatch()
+{
+}
+
+void BarrierBatch::Initialise(VkDevice Device, bool bSynchronization2Enabled, const VkPhysicalDeviceFeatures& EnabledFeatures)
+{
+    bTessellationEnabled = EnabledFeatures.tessellationShader == VK_TRUE;
+    bGeometryEnabled = EnabledFeatures.geometryShader == VK_TRUE;
+
+    CmdPipelineBarrier2 = nullptr;
+    if (bSynchronization2Enabled)
+    {
+        CmdPipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(Device, "vkCmdPipelineBarrier2KHR"));
+        if (CmdPipelineBarrier2 == nullptr) throw std::runtime_error("Failed to load vkCmdPipelineBarrier2KHR");
+    }
+}
+
+bool BarrierBatch::IsSynchronization2Enabled()
+{
+    return CmdPipelineBarrier2 != nullptr;
+}
+
+void BarrierBatch::SetDebugLogging(bool bEnabled)
+{
+    bDebugLogging = bEnabled;
+}
+
+void BarrierBatch::AddMemoryBarrier(VkPipelineStageFlags2KHR SrcStages, VkAccessFlags2KHR SrcAccess,
+                                    VkPipelineStageFlags2KHR DstStages, VkAccessFlags2KHR DstAccess)
+{
+    VkMemoryBarrier2KHR Barrier = {};
+    Barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR;
+    Barrier.srcStageMask = SrcStages;
+    Barrier.srcAccessMask = SrcAccess;
+    Barrier.dstStageMask = DstStages;
+    Barrier.dstAccessMask = DstAccess;
+    MemoryBarriers.push_back(Barrier);
+}
+
+void BarrierBatch::AddBufferBarrier(VkBuffer Buffer, VkDeviceSize Offset, VkDeviceSize Size,
+                                    VkPipelineStageFlags2KHR SrcStages, VkAccessFlags2KHR SrcAccess,
+                                    VkPipelineStageFlags2KHR DstStages, VkAccessFlags2KHR DstAccess)
+{
+    VkBufferMemoryBarrier2KHR Barrier = {};
+    Barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR;
+    Barrier.srcStageMask = SrcStages;
+    Barrier.srcAccessMask = SrcAccess;
+    Barrier.dstStageMask = DstStages;
+    Barrier.dstAccessMask = DstAccess;
+    Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    Barrier.buffer = Buffer;
+    Barrier.offset = Offset;
+    Barrier.size = Size;
+    BufferBarriers.push_back(Barrier);
+}
+
+void BarrierBatch::AddImageBarrier(VkImage Image, const VkImageSubresourceRange& Range, VkImageLayout OldLayout, VkImageLayout NewLayout,
+                                   VkPipelineStageFlags2KHR SrcStages, VkAccessFlags2KHR SrcAccess,
+                                   VkPipelineStageFlags2KHR DstStages, VkAccessFlags2KHR DstAccess)
+{
+    VkImageMemoryBarrier2KHR Barrier = {};
+    Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+    Barrier.srcStageMask = SrcStages;
+    Barrier.srcAccessMask = SrcAccess;
+    Barrier.dstStageMask = DstStages;
+    Barrier.dstAccessMask = DstAccess;
+    Barrier.oldLayout = OldLayout;
+    Barrier.newLayout = NewLayout;
+    Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    Barrier.image = Image;
+    Barrier.subresourceRange = Range;
+    ImageBarriers.push_back(Barrier);
+}
+
+bool BarrierBatch::IsEmpty() const
+{
+    return MemoryBarriers.empty() && BufferBarriers.empty() && ImageBarriers.empty();
+}
+
+void BarrierBatch::Flush(VkCommandBuffer CommandBuffer, const char* Label)
+{
+    if (IsEmpty()) return;
+
+    if (bDebugLogging) LogBarriers(Label);
+
+    if (CmdPipelineBarrier2 != nullptr)
+    {
+        VkDependencyInfoKHR DependencyInfo = {};
+        DependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+        DependencyInfo.memoryBarrierCount = static_cast<uint32_t>(MemoryBarriers.size());
+        DependencyInfo.pMemoryBarriers = MemoryBarriers.data();
+        DependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(BufferBarriers.size());
+        DependencyInfo.pBufferMemoryBarriers = BufferBarriers.data();
+        DependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(ImageBarriers.size());
+        DependencyInfo.pImageMemoryBarriers = ImageBarriers.data();
+        CmdPipelineBarrier2(CommandBuffer, &DependencyInfo);
+    }
+    else
+    {
+        FlushLegacy(CommandBuffer);
+    }
+
+    MemoryBarriers.clear();
+    BufferBarriers.clear();
+    ImageBarriers.clear();
+}
+
+void BarrierBatch::FlushLegacy(VkCommandBuffer CommandBuffer)
+{
+    // One stage pair for the whole call, the union of every barrier's
+    VkPipelineStageFlags2KHR SrcStages = 0;
+    VkPipelineStageFlags2KHR DstStages = 0;
+
+    std::vector<VkMemoryBarrier> LegacyMemoryBarriers;
+    LegacyMemoryBarriers.reserve(MemoryBarriers.size());
+    for (const VkMemoryBarrier2KHR& Barrier : MemoryBarriers)
+    {
+        SrcStages |= Barrier.srcStageMask;
+        DstStages |= Barrier.dstStageMask;
+
+        VkMemoryBarrier Legacy = {};
+        Legacy.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        Legacy.srcAccessMask = ToLegacyAccess(Barrier.srcAccessMask);
+        Legacy.dstAccessMask = ToLegacyAccess(Barrier.dstAccessMask);
+        LegacyMemoryBarriers.push_back(Legacy);
+    }
+
+    std::vector<VkBufferMemoryBarrier> LegacyBufferBarriers;
+    LegacyBufferBarriers.reserve(BufferBarriers.size());
+    for (const VkBufferMemoryBarrier2KHR& Barrier : BufferBarriers)
+    {
+        SrcStages |= Barrier.srcStageMask;
+        DstStages |= Barrier.dstStageMask;
+
+        VkBufferMemoryBarrier Legacy = {};
+        Legacy.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        Legacy.srcAccessMask = ToLegacyAccess(Barrier.srcAccessMask);
+        Legacy.dstAccessMask = ToLegacyAccess(Barrier.dstAccessMask);
+        Legacy.srcQueueFamilyIndex = Barrier.srcQueueFamilyIndex;
+        Legacy.dstQueueFamilyIndex = Barrier.dstQueueFamilyIndex;
+        Legacy.buffer = Barrier.buffer;
+        Legacy.offset = Barrier.offset;
+        Legacy.size = Barrier.size;
+        LegacyBufferBarriers.push_back(Legacy);
+    }
+
+    std::vector<VkImageMemoryBarrier> LegacyImageBarriers;
+    LegacyImageBarriers.reserve(ImageBarriers.size());
+    for (const VkImageMemoryBarrier2KHR& Barrier : ImageBarriers)
+    {
+        SrcStages |= Barrier.srcStageMask;
+        DstStages |= Barrier.dstStageMask;
+
+        VkImageMemoryBarrier Legacy = {};
+        Legacy.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        Legacy.srcAccessMask = ToLegacyAccess(Barrier.srcAccessMask);
+        Legacy.dstAccessMask = ToLegacyAccess(Barrier.dstAccessMask);
+        Legacy.oldLayout = Barrier.oldLayout;
+        Legacy.newLayout = Barrier.newLayout;
+        Legacy.srcQueueFamilyIndex = Barrier.srcQueueFamilyIndex;
+        Legacy.dstQueueFamilyIndex = Barrier.dstQueueFamilyIndex;
+        Legacy.image = Barrier.image;
+        Legacy.subresourceRange = Barrier.subresourceRange;
+        LegacyImageBarriers.push_back(Legacy);
+    }
+
+    // The old call can't take an empty stage mask: nothing to wait for is TOP_OF_PIPE, nothing waiting is BOTTOM_OF_PIPE
+    VkPipelineStageFlags LegacySrcStages = ToLegacyStages(SrcStages);
+    VkPipelineStageFlags LegacyDstStages = ToLegacyStages(DstStages);
+    if (LegacySrcStages == 0) LegacySrcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if (LegacyDstStages == 0) LegacyDstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+    vkCmdPipelineBarrier(CommandBuffer, LegacySrcStages, LegacyDstStages, 0,
+                         static_cast<uint32_t>(LegacyMemoryBarriers.size()), LegacyMemoryBarriers.data(),
+                         static_cast<uint32_t>(LegacyBufferBarriers.size()), LegacyBufferBarriers.data(),
+                         static_cast<uint32_t>(LegacyImageBarriers.size()), LegacyImageBarriers.data());
+}
+
+void BarrierBatch::LogBarriers(const char* Label) const
+{
+    std::cout << "Barrier batch '" << Label << "': " << MemoryBarriers.size() << " memory, " << BufferBarriers.size() << " buffer, "
+              << ImageBarriers.size() << " image" << (CmdPipelineBarrier2 != nullptr ? "" : " (legacy, stages merged)") << std::endl;
+
+    for (const VkMemoryBarrier2KHR& Barrier : MemoryBarriers)
+    {
+        std::cout << "  memory" << std::endl;
+        LogScope(Barrier.srcStageMask, Barrier.srcAccessMask, Barrier.dstStageMask, Barrier.dstAccessMask);
+    }
+    for (const VkBufferMemoryBarrier2KHR& Barrier : BufferBarriers)
+    {
+        std::cout << "  buffer " << Barrier.buffer << " [" << Barrier.offset << ", +" << Barrier.size << "]" << std::endl;
+        LogScope(Barrier.srcStageMask, Barrier.srcAccessMask, Barrier.dstStageMask, Barrier.dstAccessMask);
+    }
+    for (const VkImageMemoryBarrier2KHR& Barrier : ImageBarriers)
+    {
+        std::cout << "  image " << Barrier.image << " mips " << Barrier.subresourceRange.baseMipLevel << "+" << Barrier.subresourceRange.levelCount
+                  << ", layout " << Barrier.oldLayout << " -> " << Barrier.newLayout << std::endl;
+        LogScope(Barrier.srcStageMask, Barrier.srcAccessMask, Barrier.dstStageMask, Barrier.dstAccessMask);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <cstdint>
+
+// Memory, buffer and image barriers of one point in a command buffer, issued together by Flush as a single
+// vkCmdPipelineBarrier2 where every barrier keeps its own stage and access scope (VK_KHR_synchronization2).
+// Masks always use the synchronization2 bits; without the extension Flush falls back to vkCmdPipelineBarrier,
+// translating the bits and merging the stages of every barrier into the one pair the old call takes
+class BarrierBatch
+{
+public:
+    BarrierBatch();
+    ~BarrierBatch();
+
+    // Once per device, after it is created with (or without) the synchronization2 feature enabled.
+    // EnabledFeatures are the ones the device was created with, the fallback only names shader stages it has
+    static void Initialise(VkDevice Device, bool bSynchronization2Enabled, const VkPhysicalDeviceFeatures& EnabledFeatures);
+    static bool IsSynchronization2Enabled();
+
+    // Print every barrier as it is flushed: label, resource, layouts and both stage/access scopes.
+    // Scopes covering every stage (ALL_COMMANDS, ALL_GRAPHICS) or every access (MEMORY_READ/WRITE) are flagged, they drain the pipeline
+    static void SetDebugLogging(bool bEnabled);
+
+    void AddMemoryBarrier(VkPipelineStageFlags2KHR SrcStages, VkAccessFlags2KHR SrcAccess,
+                          VkPipelineStageFlags2KHR DstStages, VkAccessFlags2KHR DstAccess);
+    void AddBufferBarrier(VkBuffer Buffer, VkDeviceSize Offset, VkDeviceSize Size,
+                          VkPipelineStageFlags2KHR SrcStages, VkAccessFlags2KHR SrcAccess,
+                          VkPipelineStageFlags2KHR DstStages, VkAccessFlags2KHR DstAccess);
+    void AddImageBarrier(VkImage Image, const VkImageSubresourceRange& Range, VkImageLayout OldLayout, VkImageLayout NewLayout,
+                         VkPipelineStageFlags2KHR SrcStages, VkAccessFlags2KHR SrcAccess,
+                         VkPipelineStageFlags2KHR DstStages, VkAccessFlags2KHR DstAccess);
+
+    bool IsEmpty() const;
+
+    // Record everything added so far as one barrier command and empty the batch (its storage is kept for reuse).
+    // Label only shows up in the debug log
+    void Flush(VkCommandBuffer CommandBuffer, const char* Label = "");
+
+private:
+    std::vector<VkMemoryBarrier2KHR> MemoryBarriers;
+    std::vector<VkBufferMemoryBarrier2KHR> BufferBarriers;
+    std::vector<VkImageMemoryBarrier2KHR> ImageBarriers;
+
+    void FlushLegacy(VkCommandBuffer CommandBuffer);
+    void LogBarriers(const char* Label) const;
+};
@@ -0,0 +1,279 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GLM/gtc/matrix_transform.hpp"
+#include "DrawSortKey.h"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include "TransformKernels.h"
+
+namespace
+{
+    const size_t BENCHMARK_OBJECT_COUNTS[] = { 1024, 16384, 262144, 1048576 };
+    const size_t SCALING_OBJECT_COUNT = 1048576;        // Objects every case of the job scaling benchmark works on
+    const size_t SCALING_PARALLEL_GRAIN = 4096;
+    const uint32_t BENCHMARK_SEED = 42;
+    const float KERNEL_TOLERANCE = 1e-4f;               // Relative, SIMD paths reorder (and fuse) the same GLM arithmetic
+
+    const SimdLevel BENCHMARK_LEVELS[] = { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2, SimdLevel::Avx512 };
+
+    // Seconds per run of Function, over as many runs as fit in BENCHMARK_MIN_SECONDS (at least one after a warm up)
+    double TimeRuns(const std::function<void()>& Function)
+    {
+        Function();                                     // Warm up caches and page in the outputs
+
+        uint64_t Runs = 0;
+        auto Start = std::chrono::high_resolution_clock::now();
+        double Elapsed = 0.0;
+        do
+        {
+            Function();
+            Runs++;
+            Elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+        } while (Elapsed < BENCHMARK_MIN_SECONDS);
+
+        return Elapsed / static_cast<double>(Runs);
+    }
+
+    void PrintResult(const std::string& Name, size_t Count, double Seconds, double BaselineSeconds)
+    {
+        std::cout << std::left << std::setw(52) << Name + "/" + std::to_string(Count) << std::right << std::fixed
+                  << std::setw(12) << std::setprecision(3) << Seconds * 1e3 << " ms"
+                  << std::setw(10) << std::setprecision(2) << Seconds * 1e9 / static_cast<double>(Count) << " ns/object"
+                  << std::setw(8) << std::setprecision(2) << BaselineSeconds / Seconds << "x" << std::endl;
+    }
+
+    bool IsClose(const float* Values, const float* Expected, size_t FloatCount)
+    {
+        for (size_t i = 0; i < FloatCount; i++)
+        {
+            if (std::abs(Values[i] - Expected[i]) > KERNEL_TOLERANCE * std::max(1.0f, std::abs(Expected[i]))) return false;
+        }
+        return true;
+    }
+
+    // Rotation, non uniform scale and translation, like real object transforms (and always invertible)
+    std::vector<glm::mat4> MakeTransforms(size_t Count, std::mt19937& Random)
+    {
+        std::uniform_real_distribution<float> Position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> Angle(0.0f, 6.2831853f);
+        std::uniform_real_distribution<float> Scale(0.5f, 2.0f);
+
+        std::vector<glm::mat4> Transforms(Count);
+        for (glm::mat4& Transform : Transforms)
+        {
+            Transform = glm::translate(glm::mat4(1.0f), glm::vec3(Position(Random), Position(Random), Position(Random)));
+            Transform = glm::rotate(Transform, Angle(Random), glm::normalize(glm::vec3(Scale(Random), Scale(Random) - 1.0f, 1.0f)));
+            Transform = glm::scale(Transform, glm::vec3(Scale(Random), Scale(Random), Scale(Random)));
+        }
+        return Transforms;
+    }
+
+    // Times Kernel at every supported SIMD level against the plain GLM loop, after checking its output matches.
+    // Output is reset between levels so a level that writes nothing can't pass on the previous level's results
+    template<typename OutputType>
+    bool BenchmarkKernel(const std::string& Name, size_t Count, const std::function<void()>& Reference, const std::vector<OutputType>& Expected,
+                         const std::function<void()>& Kernel, std::vector<OutputType>& Output)
+    {
+        bool bPassed = true;
+        double GlmSeconds = TimeRuns(Reference);
+        PrintResult(Name + "/GLM", Count, GlmSeconds, GlmSeconds);
+
+        for (SimdLevel Level : BENCHMARK_LEVELS)
+        {
+            if (Level > GetSupportedSimdLevel()) continue;
+            SetSimdLevel(Level);
+
+            std::fill(Output.begin(), Output.end(), OutputType());
+            Kernel();
+            if (!IsClose(reinterpret_cast<const float*>(Output.data()), reinterpret_cast<const float*>(Expected.data()), Count * sizeof(OutputType) / sizeof(float)))
+            {
+                std::cout << "FAILED " << Name << "/" << GetSimdLevelName(Level) << "/" << Count << ": results differ from GLM" << std::endl;
+                bPassed = false;
+                continue;
+            }
+
+            PrintResult(Name + "/" + GetSimdLevelName(Level), Count, TimeRuns(Kernel), GlmSeconds);
+        }
+        return bPassed;
+    }
+
+    // The TransformKernels batches against one glm operation per object, the speedup column is relative to that loop
+    bool BenchmarkTransformKernels()
+    {
+        bool bPassed = true;
+        std::mt19937 Random(BENCHMARK_SEED);
+
+        for (size_t Count : BENCHMARK_OBJECT_COUNTS)
+        {
+            std::vector<glm::mat4> Transforms = MakeTransforms(Count, Random);
+            glm::mat4 ViewProjection = glm::perspectiveRH_ZO(glm::radians(60.0f), 1.5f, 0.1f, 500.0f)
+                                     * glm::lookAt(glm::vec3(0.0f, 50.0f, 150.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+            std::vector<BoundingBox> Bounds(Count);
+            std::uniform_real_distribution<float> Size(0.1f, 4.0f);
+            for (BoundingBox& Box : Bounds)
+            {
+                glm::vec3 Extent = glm::vec3(Size(Random), Size(Random), Size(Random));
+                Box.Min = -Extent;
+                Box.Max = Extent;
+            }
+
+            // -- MultiplyMatrices --
+            std::vector<glm::mat4> ExpectedMatrices(Count);
+            std::vector<glm::mat4> Matrices(Count);
+            auto MultiplyReference = [&]()
+            {
+                for (size_t i = 0; i < Count; i++) ExpectedMatrices[i] = ViewProjection * Transforms[i];
+            };
+            MultiplyReference();
+            bPassed &= BenchmarkKernel("MultiplyMatrices", Count, MultiplyReference, ExpectedMatrices,
+                                       [&]() { MultiplyMatrices(ViewProjection, Transforms.data(), Matrices.data(), Count); }, Matrices);
+
+            // -- TransformBoundingBoxes --
+            std::vector<BoundingBox> ExpectedBoxes(Count);
+            std::vector<BoundingBox> Boxes(Count);
+            auto BoxReference = [&]()
+            {
+                for (size_t i = 0; i < Count; i++)
+                {
+                    // Arvo: centre moved by the whole transform, extent by the absolute 3x3
+                    glm::vec3 Centre = (Bounds[i].Min + Bounds[i].Max) * 0.5f;
+                    glm::vec3 Extent = (Bounds[i].Max - Bounds[i].Min) * 0.5f;
+                    glm::vec3 NewCentre = glm::vec3(Transforms[i] * glm::vec4(Centre, 1.0f));
+                    glm::mat3 AbsoluteRotation = glm::mat3(glm::abs(glm::vec3(Transforms[i][0])), glm::abs(glm::vec3(Transforms[i][1])), glm::abs(glm::vec3(Transforms[i][2])));
+                    glm::vec3 NewExtent = AbsoluteRotation * Extent;
+                    ExpectedBoxes[i].Min = NewCentre - NewExtent;
+                    ExpectedBoxes[i].Max = NewCentre + NewExtent;
+                }
+            };
+            BoxReference();
+            bPassed &= BenchmarkKernel("TransformBoundingBoxes", Count, BoxReference, ExpectedBoxes,
+                                       [&]() { TransformBoundingBoxes(Transforms.data(), Bounds.data(), Boxes.data(), Count); }, Boxes);
+
+            // -- ComputeNormalMatrices --
+            std::vector<glm::mat3> ExpectedNormals(Count);
+            std::vector<glm::mat3> Normals(Count);
+            auto NormalReference = [&]()
+            {
+                for (size_t i = 0; i < Count; i++) ExpectedNormals[i] = glm::transpose(glm::inverse(glm::mat3(Transforms[i])));
+            };
+            NormalReference();
+            bPassed &= BenchmarkKernel("ComputeNormalMatrices", Count, NormalReference, ExpectedNormals,
+                                       [&]() { ComputeNormalMatrices(Transforms.data(), Normals.data(), Count); }, Normals);
+        }
+        return bPassed;
+    }
+
+    // ParallelFor, SortDrawItems and Cull on the same 1M objects with 1 .. hardware_concurrency workers.
+    // Speedup is against one worker (everything on the calling thread), results must match the one worker ones
+    bool BenchmarkJobScaling()
+    {
+        bool bPassed = true;
+        std::mt19937 Random(BENCHMARK_SEED);
+        const size_t Count = SCALING_OBJECT_COUNT;
+
+        std::vector<glm::mat4> Transforms = MakeTransforms(Count, Random);
+        glm::mat4 ViewProjection = glm::perspectiveRH_ZO(glm::radians(60.0f), 1.5f, 0.1f, 500.0f)
+                                 * glm::lookAt(glm::vec3(0.0f, 50.0f, 150.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        std::vector<glm::mat4> Matrices(Count);
+
+        std::uniform_int_distribution<uint64_t> Key;
+        std::vector<DrawItem> UnsortedItems(Count);
+        for (size_t i = 0; i < Count; i++)
+        {
+            UnsortedItems[i] = { Key(Random), static_cast<uint32_t>(i) };
+        }
+        std::vector<DrawItem> Items;
+        std::vector<DrawItem> Scratch;
+        std::vector<DrawItem> FirstSorted;
+
+        std::vector<BoundingBox> Boxes(Count);
+        std::uniform_real_distribution<float> Position(-200.0f, 200.0f);
+        std::uniform_real_distribution<float> Size(0.1f, 4.0f);
+        for (BoundingBox& Box : Boxes)
+        {
+            glm::vec3 Centre = glm::vec3(Position(Random), Position(Random), Position(Random));
+            glm::vec3 Extent = glm::vec3(Size(Random), Size(Random), Size(Random));
+            Box.Min = Centre - Extent;
+            Box.Max = Centre + Extent;
+        }
+        FrustumCuller Culler;
+        Culler.SetFrustum(ViewProjection);
+        Culler.SetBoxes(Boxes.data(), Count);
+        std::vector<uint32_t> Visible;
+        std::vector<uint32_t> FirstVisible;
+
+        // Sorting works in place, so every run starts from a copy. The copy is timed on its own and taken off
+        double CopySeconds = TimeRuns([&]() { Items = UnsortedItems; });
+
+        double BaselineParallelFor = 0.0;
+        double BaselineSort = 0.0;
+        double BaselineCull = 0.0;
+        uint32_t MaxWorkers = std::max(1u, std::thread::hardware_concurrency());
+        for (uint32_t WorkerCount = 1; WorkerCount <= MaxWorkers; WorkerCount++)
+        {
+            JobSystem Jobs;
+            Jobs.Create(WorkerCount);
+            std::string Workers = "/workers:" + std::to_string(WorkerCount);
+
+            double ParallelForSeconds = TimeRuns([&]()
+            {
+                Jobs.ParallelFor(Count, SCALING_PARALLEL_GRAIN, [&](size_t Begin, size_t End)
+                {
+                    MultiplyMatrices(ViewProjection, Transforms.data() + Begin, Matrices.data() + Begin, End - Begin);
+                });
+            });
+
+            double SortSeconds = std::max(TimeRuns([&]() { Items = UnsortedItems; SortDrawItems(Items, Scratch, &Jobs); }) - CopySeconds, 1e-9);
+            double CullSeconds = TimeRuns([&]() { Culler.Cull(Visible, &Jobs); });
+
+            if (WorkerCount == 1)
+            {
+                BaselineParallelFor = ParallelForSeconds;
+                BaselineSort = SortSeconds;
+                BaselineCull = CullSeconds;
+                FirstSorted = Items;
+                FirstVisible = Visible;
+            }
+            else
+            {
+                bool bSortMatches = std::equal(Items.begin(), Items.end(), FirstSorted.begin(), FirstSorted.end(),
+                                               [](const DrawItem& A, const DrawItem& B) { return A.Key == B.Key && A.ObjectIndex == B.ObjectIndex; });
+                if (!bSortMatches) std::cout << "FAILED SortDrawItems" << Workers << ": order differs from one worker" << std::endl;
+                if (Visible != FirstVisible) std::cout << "FAILED Cull" << Workers << ": visible set differs from one worker" << std::endl;
+                bPassed &= bSortMatches && Visible == FirstVisible;
+            }
+
+            PrintResult("ParallelFor(MultiplyMatrices)" + Workers, Count, ParallelForSeconds, BaselineParallelFor);
+            PrintResult("SortDrawItems" + Workers, Count, SortSeconds, BaselineSort);
+            PrintResult("Cull" + Workers, Count, CullSeconds, BaselineCull);
+
+            Jobs.Destroy();
+        }
+        return bPassed;
+    }
+}
+
+int RunBenchmarks()
+{
+    SimdLevel StartLevel = GetSimdLevel();
+    std::cout << "Benchmarks, SIMD paths up to " << GetSimdLevelName(GetSupportedSimdLevel()) << ", at least " << BENCHMARK_MIN_SECONDS << " s per case" << std::endl;
+
+    bool bPassed = BenchmarkTransformKernels();
+    bPassed &= BenchmarkJobScaling();
+
+    SetSimdLevel(StartLevel);
+    return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+const double BENCHMARK_MIN_SECONDS = 0.25;              // Each case repeats until it has run this long
+
+// CPU benchmarks that don't need a window or a device, run with the --benchmark argument.
+// Each case is repeated until it has run for at least BENCHMARK_MIN_SECONDS (Google Benchmark style) and reported per
+// object, so runs on different machines and sizes compare. Results are checked too, returns EXIT_FAILURE on a mismatch
+int RunBenchmarks();
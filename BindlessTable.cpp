@@ -0,0 +1,206 @@
+#include "BindlessTable.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+BindlessTable::BindlessTable()
+{
+}
+
+BindlessTable::~BindlessTable()
+{
+}
+
+void BindlessTable::Create(VkPhysicalDevice PhysicalDevice, VkDevice NewDevice, uint32_t MaxTextures, uint32_t MaxBuffers)
+{
+    Device = NewDevice;
+
+    // Clamp array sizes to what the device allows for update-after-bind descriptors
+    VkPhysicalDeviceDescriptorIndexingProperties IndexingProperties = {};
+    IndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 DeviceProperties = {};
+    DeviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    DeviceProperties.pNext = &IndexingProperties;
+    vkGetPhysicalDeviceProperties2(PhysicalDevice, &DeviceProperties);
+
+    TextureSlots.Capacity = std::min({ MaxTextures,
+                                       IndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                       IndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages });
+    BufferSlots.Capacity = std::min({ MaxBuffers,
+                                      IndexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                                      IndexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+    // -- LAYOUT --
+    VkDescriptorSetLayoutBinding TextureBinding = {};
+    TextureBinding.binding = 0;
+    TextureBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    TextureBinding.descriptorCount = TextureSlots.Capacity;                     // Size of the array in the shader
+    TextureBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutBinding BufferBinding = {};
+    BufferBinding.binding = 1;
+    BufferBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    BufferBinding.descriptorCount = BufferSlots.Capacity;
+    BufferBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    LayoutBindings = { TextureBinding, BufferBinding };
+
+    // PARTIALLY_BOUND: unused slots may hold no descriptor at all
+    // UPDATE_AFTER_BIND + UPDATE_UNUSED_WHILE_PENDING: slots can be written while the set is in use by the GPU
+    VkDescriptorBindingFlags BindingFlag = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+                                         | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+                                         | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    std::array<VkDescriptorBindingFlags, 2> BindingFlags = { BindingFlag, BindingFlag };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo BindingFlagsCreateInfo = {};
+    BindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    BindingFlagsCreateInfo.bindingCount = static_cast<uint32_t>(BindingFlags.size());
+    BindingFlagsCreateInfo.pBindingFlags = BindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo LayoutCreateInfo = {};
+    LayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    LayoutCreateInfo.pNext = &BindingFlagsCreateInfo;
+    LayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    LayoutCreateInfo.bindingCount = static_cast<uint32_t>(LayoutBindings.size());
+    LayoutCreateInfo.pBindings = LayoutBindings.data();
+
+    VkResult Result = vkCreateDescriptorSetLayout(Device, &LayoutCreateInfo, nullptr, &DescriptorSetLayout);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create Bindless Descriptor Set Layout");
+
+    // -- POOL --
+    std::array<VkDescriptorPoolSize, 2> PoolSizes = {};
+    PoolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    PoolSizes[0].descriptorCount = TextureSlots.Capacity;
+    PoolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    PoolSizes[1].descriptorCount = BufferSlots.Capacity;
+
+    VkDescriptorPoolCreateInfo PoolCreateInfo = {};
+    PoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    PoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    PoolCreateInfo.maxSets = 1;
+    PoolCreateInfo.poolSizeCount = static_cast<uint32_t>(PoolSizes.size());
+    PoolCreateInfo.pPoolSizes = PoolSizes.data();
+
+    Result = vkCreateDescriptorPool(Device, &PoolCreateInfo, nullptr, &DescriptorPool);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create Bindless Descriptor Pool");
+
+    // -- SET --
+    VkDescriptorSetAllocateInfo SetAllocateInfo = {};
+    SetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    SetAllocateInfo.descriptorPool = DescriptorPool;
+    SetAllocateInfo.descriptorSetCount = 1;
+    SetAllocateInfo.pSetLayouts = &DescriptorSetLayout;
+
+    Result = vkAllocateDescriptorSets(Device, &SetAllocateInfo, &DescriptorSet);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to allocate Bindless Descriptor Set");
+}
+
+void BindlessTable::Destroy()
+{
+    vkDestroyDescriptorPool(Device, DescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(Device, DescriptorSetLayout, nullptr);
+}
+
+void BindlessTable::BeginFrame(uint32_t FrameIndex)
+{
+    CurrentFrame = FrameIndex % MAX_FRAME_DRAWS;
+
+    // Anything released the last time this frame index was recorded is no longer referenced by the GPU
+    for (SlotAllocator* Slots : { &TextureSlots, &BufferSlots })
+    {
+        std::vector<uint32_t>& Pending = Slots->PendingFrees[CurrentFrame];
+        Slots->FreeSlots.insert(Slots->FreeSlots.end(), Pending.begin(), Pending.end());
+        Pending.clear();
+    }
+}
+
+uint32_t BindlessTable::AddTexture(VkImageView ImageView, VkSampler Sampler)
+{
+    uint32_t Slot = TextureSlots.Allocate();
+    UpdateTexture(Slot, ImageView, Sampler);
+    return Slot;
+}
+
+void BindlessTable::UpdateTexture(uint32_t Slot, VkImageView ImageView, VkSampler Sampler)
+{
+    VkDescriptorImageInfo ImageInfo = {};
+    ImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;          // Layout the image will be in when sampled
+    ImageInfo.imageView = ImageView;
+    ImageInfo.sampler = Sampler;
+
+    VkWriteDescriptorSet SetWrite = {};
+    SetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    SetWrite.dstSet = DescriptorSet;
+    SetWrite.dstBinding = 0;
+    SetWrite.dstArrayElement = Slot;                                            // Slot in the texture array
+    SetWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    SetWrite.descriptorCount = 1;
+    SetWrite.pImageInfo = &ImageInfo;
+
+    vkUpdateDescriptorSets(Device, 1, &SetWrite, 0, nullptr);
+}
+
+void BindlessTable::RemoveTexture(uint32_t Slot)
+{
+    TextureSlots.PendingFrees[CurrentFrame].push_back(Slot);
+}
+
+uint32_t BindlessTable::AddStorageBuffer(VkBuffer Buffer, VkDeviceSize Offset, VkDeviceSize Range)
+{
+    uint32_t Slot = BufferSlots.Allocate();
+
+    VkDescriptorBufferInfo BufferInfo = {};
+    BufferInfo.buffer = Buffer;
+    BufferInfo.offset = Offset;
+    BufferInfo.range = Range;
+
+    VkWriteDescriptorSet SetWrite = {};
+    SetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    SetWrite.dstSet = DescriptorSet;
+    SetWrite.dstBinding = 1;
+    SetWrite.dstArrayElement = Slot;                                            // Slot in the buffer array
+    SetWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    SetWrite.descriptorCount = 1;
+    SetWrite.pBufferInfo = &BufferInfo;
+
+    vkUpdateDescriptorSets(Device, 1, &SetWrite, 0, nullptr);
+
+    return Slot;
+}
+
+void BindlessTable::RemoveStorageBuffer(uint32_t Slot)
+{
+    BufferSlots.PendingFrees[CurrentFrame].push_back(Slot);
+}
+
+VkDescriptorSetLayout BindlessTable::GetDescriptorSetLayout() const
+{
+    return DescriptorSetLayout;
+}
+
+const std::vector<VkDescriptorSetLayoutBinding>& BindlessTable::GetLayoutBindings() const
+{
+    return LayoutBindings;
+}
+
+VkDescriptorSet BindlessTable::GetDescriptorSet() const
+{
+    return DescriptorSet;
+}
+
+uint32_t BindlessTable::SlotAllocator::Allocate()
+{
+    // Prefer recycled slots so the used part of the array stays compact
+    if (!FreeSlots.empty())
+    {
+        uint32_t Slot = FreeSlots.back();
+        FreeSlots.pop_back();
+        return Slot;
+    }
+
+    if (NextUnused >= Capacity) throw std::runtime_error("Bindless table is full");
+
+    return NextUnused++;
+}
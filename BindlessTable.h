@@ -0,0 +1,63 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "Utilities.h"
+
+// Slot value meaning "no resource" (matches INVALID_SLOT in shaders)
+const uint32_t INVALID_BINDLESS_SLOT = UINT32_MAX;
+
+// One big descriptor set holding every sampled image and storage buffer the renderer uses.
+// Shaders index the arrays directly (e.g. by material id), so nothing has to be rebound between draws.
+// Built on descriptor indexing (core in Vulkan 1.2): bindings are partially bound and update-after-bind,
+// so slots can be written while the set is bound in command buffers that don't use them.
+//   binding 0 : sampler2D textures[]
+//   binding 1 : buffer    buffers[]
+class BindlessTable
+{
+public:
+    BindlessTable();
+    ~BindlessTable();
+
+    void Create(VkPhysicalDevice PhysicalDevice, VkDevice Device, uint32_t MaxTextures, uint32_t MaxBuffers);
+    void Destroy();
+
+    void BeginFrame(uint32_t FrameIndex);                   // Recycle slots released MAX_FRAME_DRAWS frames ago, FrameIndex's fence must be signalled
+
+    uint32_t AddTexture(VkImageView ImageView, VkSampler Sampler);
+    void UpdateTexture(uint32_t Slot, VkImageView ImageView, VkSampler Sampler);
+    void RemoveTexture(uint32_t Slot);
+
+    uint32_t AddStorageBuffer(VkBuffer Buffer, VkDeviceSize Offset, VkDeviceSize Range);
+    void RemoveStorageBuffer(uint32_t Slot);
+
+    VkDescriptorSetLayout GetDescriptorSetLayout() const;
+    const std::vector<VkDescriptorSetLayoutBinding>& GetLayoutBindings() const;     // Array sizes are the slot capacities, to check shaders against
+    VkDescriptorSet GetDescriptorSet() const;
+
+private:
+    // Free list of slots for one descriptor array. Released slots wait a full frame cycle before reuse
+    struct SlotAllocator
+    {
+        uint32_t Capacity = 0;
+        uint32_t NextUnused = 0;                            // Slots at and above this have never been handed out
+        std::vector<uint32_t> FreeSlots;
+        std::vector<uint32_t> PendingFrees[MAX_FRAME_DRAWS];
+
+        uint32_t Allocate();
+    };
+
+    VkDevice Device = VK_NULL_HANDLE;
+    VkDescriptorSetLayout DescriptorSetLayout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSetLayoutBinding> LayoutBindings;
+    VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+
+    uint32_t CurrentFrame = 0;
+    SlotAllocator TextureSlots;
+    SlotAllocator BufferSlots;
+};
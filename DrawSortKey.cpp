@@ -0,0 +1,183 @@
+#include "DrawSortKey.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace
+{
+    const uint32_t RADIX_BITS = 8;
+    const uint32_t RADIX_BUCKETS = 1 << RADIX_BITS;
+    const uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+
+    using Histogram = std::array<size_t, RADIX_BUCKETS>;
+
+    uint64_t PackField(uint32_t Value, uint32_t Bits, uint32_t Shift)
+    {
+        return (static_cast<uint64_t>(Value) & ((1ull << Bits) - 1)) << Shift;
+    }
+
+    uint32_t GetDigit(uint64_t Key, uint32_t Pass)
+    {
+        return static_cast<uint32_t>(Key >> (Pass * RADIX_BITS)) & (RADIX_BUCKETS - 1);
+    }
+
+    // Digits where at least two keys differ, the others would only copy the list in the same order
+    std::vector<uint32_t> GetActivePasses(const std::vector<DrawItem>& Items)
+    {
+        uint64_t DifferingBits = 0;
+        for (const DrawItem& Item : Items)
+        {
+            DifferingBits |= Item.Key ^ Items[0].Key;
+        }
+
+        std::vector<uint32_t> Passes;
+        for (uint32_t Pass = 0; Pass < RADIX_PASSES; Pass++)
+        {
+            if (GetDigit(DifferingBits, Pass) != 0) Passes.push_back(Pass);
+        }
+        return Passes;
+    }
+
+    void SortSerial(std::vector<DrawItem>& Items, std::vector<DrawItem>& Scratch, const std::vector<uint32_t>& Passes)
+    {
+        DrawItem* Source = Items.data();
+        DrawItem* Destination = Scratch.data();
+
+        for (uint32_t Pass : Passes)
+        {
+            Histogram Offsets = {};
+            for (size_t i = 0; i < Items.size(); i++)
+            {
+                Offsets[GetDigit(Source[i].Key, Pass)]++;
+            }
+
+            // Counts to first position of each bucket
+            size_t Offset = 0;
+            for (size_t& Bucket : Offsets)
+            {
+                size_t Count = Bucket;
+                Bucket = Offset;
+                Offset += Count;
+            }
+
+            for (size_t i = 0; i < Items.size(); i++)
+            {
+                Destination[Offsets[GetDigit(Source[i].Key, Pass)]++] = Source[i];
+            }
+
+            std::swap(Source, Destination);
+        }
+
+        if (Source != Items.data()) std::copy(Source, Source + Items.size(), Items.data());
+    }
+
+    // Each chunk is counted and scattered by one job. Offsets are laid out bucket major, chunk minor,
+    // so every chunk writes a disjoint range and the sort stays stable
+    void SortParallel(std::vector<DrawItem>& Items, std::vector<DrawItem>& Scratch, const std::vector<uint32_t>& Passes, JobSystem* Jobs)
+    {
+        size_t ChunkCount = Jobs->GetWorkerCount();
+        std::vector<Histogram> Offsets(ChunkCount);
+        DrawItem* Source = Items.data();
+        DrawItem* Destination = Scratch.data();
+
+        auto GetChunkBegin = [&](size_t Chunk) { return Items.size() * Chunk / ChunkCount; };
+
+        for (uint32_t Pass : Passes)
+        {
+            Jobs->ParallelFor(ChunkCount, 1, [&](size_t FirstChunk, size_t LastChunk)
+            {
+                for (size_t Chunk = FirstChunk; Chunk < LastChunk; Chunk++)
+                {
+                    Histogram& ChunkOffsets = Offsets[Chunk];
+                    ChunkOffsets.fill(0);
+                    for (size_t i = GetChunkBegin(Chunk); i < GetChunkBegin(Chunk + 1); i++)
+                    {
+                        ChunkOffsets[GetDigit(Source[i].Key, Pass)]++;
+                    }
+                }
+            });
+
+            // Counts to first position of each chunk's run of each bucket
+            size_t Offset = 0;
+            for (uint32_t Bucket = 0; Bucket < RADIX_BUCKETS; Bucket++)
+            {
+                for (Histogram& ChunkOffsets : Offsets)
+                {
+                    size_t Count = ChunkOffsets[Bucket];
+                    ChunkOffsets[Bucket] = Offset;
+                    Offset += Count;
+                }
+            }
+
+            Jobs->ParallelFor(ChunkCount, 1, [&](size_t FirstChunk, size_t LastChunk)
+            {
+                for (size_t Chunk = FirstChunk; Chunk < LastChunk; Chunk++)
+                {
+                    Histogram& ChunkOffsets = Offsets[Chunk];
+                    for (size_t i = GetChunkBegin(Chunk); i < GetChunkBegin(Chunk + 1); i++)
+                    {
+                        Destination[ChunkOffsets[GetDigit(Source[i].Key, Pass)]++] = Source[i];
+                    }
+                }
+            });
+
+            std::swap(Source, Destination);
+        }
+
+        if (Source != Items.data()) std::copy(Source, Source + Items.size(), Items.data());
+    }
+}
+
+uint64_t MakeDrawSortKey(uint32_t Pass, uint32_t Pipeline, uint32_t Material, uint32_t Mesh, float Depth)
+{
+    // Positive floats order the same as their bit patterns, so the top bits of the pattern are an ordered depth.
+    // Anything at or behind the camera (and NaN) sorts first
+    uint32_t DepthBits = 0;
+    if (Depth > 0.0f)
+    {
+        memcpy(&DepthBits, &Depth, sizeof(float));
+        DepthBits >>= 31 - DRAW_KEY_DEPTH_BITS;
+    }
+
+    return PackField(Pass, DRAW_KEY_PASS_BITS, DRAW_KEY_PASS_SHIFT)
+         | PackField(Pipeline, DRAW_KEY_PIPELINE_BITS, DRAW_KEY_PIPELINE_SHIFT)
+         | PackField(Material, DRAW_KEY_MATERIAL_BITS, DRAW_KEY_MATERIAL_SHIFT)
+         | PackField(Mesh, DRAW_KEY_MESH_BITS, DRAW_KEY_MESH_SHIFT)
+         | PackField(DepthBits, DRAW_KEY_DEPTH_BITS, DRAW_KEY_DEPTH_SHIFT);
+}
+
+uint32_t GetDrawKeyPass(uint64_t Key)
+{
+    return static_cast<uint32_t>(Key >> DRAW_KEY_PASS_SHIFT) & ((1u << DRAW_KEY_PASS_BITS) - 1);
+}
+
+uint32_t GetDrawKeyPipeline(uint64_t Key)
+{
+    return static_cast<uint32_t>(Key >> DRAW_KEY_PIPELINE_SHIFT) & ((1u << DRAW_KEY_PIPELINE_BITS) - 1);
+}
+
+uint32_t HashDrawKeyMesh(uint64_t Handle)
+{
+    // Fibonacci hashing, the top bits of the product mix in every bit of the handle
+    return static_cast<uint32_t>((Handle * 0x9E3779B97F4A7C15ull) >> (64 - DRAW_KEY_MESH_BITS));
+}
+
+void SortDrawItems(std::vector<DrawItem>& Items, std::vector<DrawItem>& Scratch, JobSystem* Jobs)
+{
+    if (Items.size() < 2) return;
+
+    std::vector<uint32_t> Passes = GetActivePasses(Items);
+    if (Passes.empty()) return;
+
+    Scratch.resize(Items.size());
+
+    if (!Jobs || Jobs->GetWorkerCount() < 2 || Items.size() < DRAW_SORT_PARALLEL_THRESHOLD)
+    {
+        SortSerial(Items, Scratch, Passes);
+    }
+    else
+    {
+        SortParallel(Items, Scratch, Passes, Jobs);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "JobSystem.h"
+
+// 64 bit draw sort key, most significant field first:
+//   | Pass (4) | Pipeline (8) | Material (16) | Mesh (16) | Depth (20) |
+// Sorting the keys groups draws by subpass, then by the state that is expensive to change,
+// and orders draws that share all of it front to back
+const uint32_t DRAW_KEY_PASS_BITS = 4;
+const uint32_t DRAW_KEY_PIPELINE_BITS = 8;
+const uint32_t DRAW_KEY_MATERIAL_BITS = 16;
+const uint32_t DRAW_KEY_MESH_BITS = 16;
+const uint32_t DRAW_KEY_DEPTH_BITS = 20;
+
+const uint32_t DRAW_KEY_DEPTH_SHIFT = 0;
+const uint32_t DRAW_KEY_MESH_SHIFT = DRAW_KEY_DEPTH_SHIFT + DRAW_KEY_DEPTH_BITS;
+const uint32_t DRAW_KEY_MATERIAL_SHIFT = DRAW_KEY_MESH_SHIFT + DRAW_KEY_MESH_BITS;
+const uint32_t DRAW_KEY_PIPELINE_SHIFT = DRAW_KEY_MATERIAL_SHIFT + DRAW_KEY_MATERIAL_BITS;
+const uint32_t DRAW_KEY_PASS_SHIFT = DRAW_KEY_PIPELINE_SHIFT + DRAW_KEY_PIPELINE_BITS;
+
+static_assert(DRAW_KEY_PASS_SHIFT + DRAW_KEY_PASS_BITS == 64, "Draw key fields must fill 64 bits");
+
+const size_t DRAW_SORT_PARALLEL_THRESHOLD = 16384;      // Fewer draws than this are sorted on the calling thread
+
+// One draw to record: its key and the render object it draws
+struct DrawItem
+{
+    uint64_t Key;
+    uint32_t ObjectIndex;
+};
+
+// Pack the fields of a draw into a key. Fields wider than their bits are truncated (Mesh is usually a hash),
+// Depth is the view space distance and only its ordering is kept
+uint64_t MakeDrawSortKey(uint32_t Pass, uint32_t Pipeline, uint32_t Material, uint32_t Mesh, float Depth);
+uint32_t GetDrawKeyPass(uint64_t Key);
+uint32_t GetDrawKeyPipeline(uint64_t Key);
+
+// Fold a handle or pointer into the mesh field, so draws sharing buffers end up next to each other
+uint32_t HashDrawKeyMesh(uint64_t Handle);
+
+// Stable LSD radix sort by Key, 8 bits per pass. Passes over bytes every key shares are skipped,
+// and large lists split counting and scattering across the workers of Jobs (if given). Scratch is resized as needed and can be kept between calls
+void SortDrawItems(std::vector<DrawItem>& Items, std::vector<DrawItem>& Scratch, JobSystem* Jobs = nullptr);
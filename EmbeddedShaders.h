@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// SPIR-V of the shaders in Shaders/, compiled (glslangValidator), optimised (spirv-opt) and written out as
+// constexpr arrays by the CompileShaders target in VulkanRenderer.vcxproj. The generated headers live in
+// $(IntDir)Shaders and are rebuilt whenever their source is newer
+#include "shader.vert.h"
+#include "shader.frag.h"
+#include "downsample.comp.h"
+
+// Embedded code in the byte form CreateShaderModule and ShaderReflection take (the same ReadFile gives for a .spv file)
+template<size_t WordCount>
+std::vector<char> GetEmbeddedShader(const uint32_t (&Code)[WordCount])
+{
+    const char* Bytes = reinterpret_cast<const char*>(Code);
+    return std::vector<char>(Bytes, Bytes + sizeof(Code));
+}
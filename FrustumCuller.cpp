@@ -0,0 +1,291 @@
+#include "FrustumCuller.h"
+#include "TransformKernels.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+// MSVC compiles any intrinsic anywhere, GCC and Clang need each function to say which instruction set it uses
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KERNEL_TARGET(InstructionSets)
+#else
+#define KERNEL_TARGET(InstructionSets) __attribute__((target(InstructionSets)))
+#endif
+
+namespace
+{
+    // The SoA arrays of one cull
+    struct CullVolumes
+    {
+        const float* CentreX;
+        const float* CentreY;
+        const float* CentreZ;
+        const float* ExtentX;
+        const float* ExtentY;
+        const float* ExtentZ;
+    };
+
+    // -- SCALAR --
+    // Distance of the centre from the plane, plus how far the volume reaches towards it (radius, or the box's
+    // extent projected on the normal). Negative means the whole volume is outside
+    template<bool bSpheres>
+    uint32_t* CullScalar(const CullVolumes& Volumes, const FrustumPlane* Planes, size_t Begin, size_t End, uint32_t* Write)
+    {
+        for (size_t i = Begin; i < End; i++)
+        {
+            bool bVisible = true;
+            for (uint32_t p = 0; p < 6 && bVisible; p++)
+            {
+                const FrustumPlane& Plane = Planes[p];
+                float Distance = Plane.Normal.x * Volumes.CentreX[i] + Plane.Normal.y * Volumes.CentreY[i] + Plane.Normal.z * Volumes.CentreZ[i] + Plane.Distance;
+                float Reach = bSpheres ? Volumes.ExtentX[i]
+                                       : std::abs(Plane.Normal.x) * Volumes.ExtentX[i] + std::abs(Plane.Normal.y) * Volumes.ExtentY[i] + std::abs(Plane.Normal.z) * Volumes.ExtentZ[i];
+                bVisible = Distance + Reach >= 0.0f;
+            }
+
+            if (bVisible) *Write++ = static_cast<uint32_t>(i);
+        }
+        return Write;
+    }
+
+    // -- AVX2 --
+    // For every 8 bit visibility mask, the lanes to keep in order. Permuting the lane indices by it packs
+    // the visible ones at the front of the register
+    struct CompactionTable
+    {
+        uint32_t Lanes[256][8] = {};
+
+        CompactionTable()
+        {
+            for (uint32_t Mask = 0; Mask < 256; Mask++)
+            {
+                uint32_t Count = 0;
+                for (uint32_t Lane = 0; Lane < 8; Lane++)
+                {
+                    if (Mask & (1 << Lane)) Lanes[Mask][Count++] = Lane;
+                }
+            }
+        }
+    };
+
+    const CompactionTable AVX2_COMPACTION;
+
+    // Writes 8 indices for every 8 volumes whatever their visibility, Write needs 8 spare elements past the last visible one
+    template<bool bSpheres>
+    KERNEL_TARGET("avx2,fma")
+    uint32_t* CullAvx2(const CullVolumes& Volumes, const FrustumPlane* Planes, size_t Begin, size_t End, uint32_t* Write)
+    {
+        __m256 NormalX[6], NormalY[6], NormalZ[6], Distance[6], AbsoluteX[6], AbsoluteY[6], AbsoluteZ[6];
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            NormalX[p] = _mm256_set1_ps(Planes[p].Normal.x);
+            NormalY[p] = _mm256_set1_ps(Planes[p].Normal.y);
+            NormalZ[p] = _mm256_set1_ps(Planes[p].Normal.z);
+            Distance[p] = _mm256_set1_ps(Planes[p].Distance);
+            AbsoluteX[p] = _mm256_set1_ps(std::abs(Planes[p].Normal.x));
+            AbsoluteY[p] = _mm256_set1_ps(std::abs(Planes[p].Normal.y));
+            AbsoluteZ[p] = _mm256_set1_ps(std::abs(Planes[p].Normal.z));
+        }
+
+        const __m256 Zero = _mm256_setzero_ps();
+        const __m256i LaneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+        size_t i = Begin;
+        for (; i + 8 <= End; i += 8)
+        {
+            __m256 CentreX = _mm256_loadu_ps(Volumes.CentreX + i);
+            __m256 CentreY = _mm256_loadu_ps(Volumes.CentreY + i);
+            __m256 CentreZ = _mm256_loadu_ps(Volumes.CentreZ + i);
+            __m256 ExtentX = _mm256_loadu_ps(Volumes.ExtentX + i);
+            __m256 ExtentY = bSpheres ? Zero : _mm256_loadu_ps(Volumes.ExtentY + i);
+            __m256 ExtentZ = bSpheres ? Zero : _mm256_loadu_ps(Volumes.ExtentZ + i);
+
+            __m256 Outside = Zero;
+            for (uint32_t p = 0; p < 6; p++)
+            {
+                __m256 PlaneDistance = _mm256_fmadd_ps(NormalX[p], CentreX, _mm256_fmadd_ps(NormalY[p], CentreY, _mm256_fmadd_ps(NormalZ[p], CentreZ, Distance[p])));
+                __m256 Reach = bSpheres ? ExtentX : _mm256_fmadd_ps(AbsoluteX[p], ExtentX, _mm256_fmadd_ps(AbsoluteY[p], ExtentY, _mm256_mul_ps(AbsoluteZ[p], ExtentZ)));
+                Outside = _mm256_or_ps(Outside, _mm256_cmp_ps(_mm256_add_ps(PlaneDistance, Reach), Zero, _CMP_LT_OQ));
+            }
+
+            uint32_t VisibleMask = ~static_cast<uint32_t>(_mm256_movemask_ps(Outside)) & 0xFF;
+            __m256i Indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), LaneOffsets);
+            __m256i Permutation = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(AVX2_COMPACTION.Lanes[VisibleMask]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(Write), _mm256_permutevar8x32_epi32(Indices, Permutation));
+            Write += std::popcount(VisibleMask);
+        }
+
+        return CullScalar<bSpheres>(Volumes, Planes, i, End, Write);
+    }
+
+    // -- AVX-512 --
+    // 16 volumes per register, the tail is handled with a lane mask and compress-store only writes visible indices
+    template<bool bSpheres>
+    KERNEL_TARGET("avx512f")
+    uint32_t* CullAvx512(const CullVolumes& Volumes, const FrustumPlane* Planes, size_t Begin, size_t End, uint32_t* Write)
+    {
+        __m512 NormalX[6], NormalY[6], NormalZ[6], Distance[6], AbsoluteX[6], AbsoluteY[6], AbsoluteZ[6];
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            NormalX[p] = _mm512_set1_ps(Planes[p].Normal.x);
+            NormalY[p] = _mm512_set1_ps(Planes[p].Normal.y);
+            NormalZ[p] = _mm512_set1_ps(Planes[p].Normal.z);
+            Distance[p] = _mm512_set1_ps(Planes[p].Distance);
+            AbsoluteX[p] = _mm512_set1_ps(std::abs(Planes[p].Normal.x));
+            AbsoluteY[p] = _mm512_set1_ps(std::abs(Planes[p].Normal.y));
+            AbsoluteZ[p] = _mm512_set1_ps(std::abs(Planes[p].Normal.z));
+        }
+
+        const __m512 Zero = _mm512_setzero_ps();
+        const __m512i LaneOffsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+        for (size_t i = Begin; i < End; i += 16)
+        {
+            __mmask16 Lanes = End - i >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << (End - i)) - 1);
+
+            __m512 CentreX = _mm512_maskz_loadu_ps(Lanes, Volumes.CentreX + i);
+            __m512 CentreY = _mm512_maskz_loadu_ps(Lanes, Volumes.CentreY + i);
+            __m512 CentreZ = _mm512_maskz_loadu_ps(Lanes, Volumes.CentreZ + i);
+            __m512 ExtentX = _mm512_maskz_loadu_ps(Lanes, Volumes.ExtentX + i);
+            __m512 ExtentY = bSpheres ? Zero : _mm512_maskz_loadu_ps(Lanes, Volumes.ExtentY + i);
+            __m512 ExtentZ = bSpheres ? Zero : _mm512_maskz_loadu_ps(Lanes, Volumes.ExtentZ + i);
+
+            __mmask16 Inside = Lanes;
+            for (uint32_t p = 0; p < 6; p++)
+            {
+                __m512 PlaneDistance = _mm512_fmadd_ps(NormalX[p], CentreX, _mm512_fmadd_ps(NormalY[p], CentreY, _mm512_fmadd_ps(NormalZ[p], CentreZ, Distance[p])));
+                __m512 Reach = bSpheres ? ExtentX : _mm512_fmadd_ps(AbsoluteX[p], ExtentX, _mm512_fmadd_ps(AbsoluteY[p], ExtentY, _mm512_mul_ps(AbsoluteZ[p], ExtentZ)));
+                Inside = _mm512_mask_cmp_ps_mask(Inside, _mm512_add_ps(PlaneDistance, Reach), Zero, _CMP_GE_OQ);
+            }
+
+            __m512i Indices = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(i)), LaneOffsets);
+            _mm512_mask_compressstoreu_epi32(Write, Inside, Indices);
+            Write += std::popcount(static_cast<uint32_t>(Inside));
+        }
+        return Write;
+    }
+
+    template<bool bSpheres>
+    uint32_t* CullVolumeRange(const CullVolumes& Volumes, const FrustumPlane* Planes, size_t Begin, size_t End, uint32_t* Write)
+    {
+        switch (GetSimdLevel())
+        {
+        case SimdLevel::Avx512: return CullAvx512<bSpheres>(Volumes, Planes, Begin, End, Write);
+        case SimdLevel::Avx2: return CullAvx2<bSpheres>(Volumes, Planes, Begin, End, Write);
+        default: return CullScalar<bSpheres>(Volumes, Planes, Begin, End, Write);
+        }
+    }
+}
+
+FrustumCuller::FrustumCuller()
+{
+}
+
+FrustumCuller::~FrustumCuller()
+{
+}
+
+void FrustumCuller::SetFrustum(const glm::mat4& ViewProjection)
+{
+    // Gribb-Hartmann: each plane is a sum or difference of rows of the matrix. Depth is 0 to 1, so near is row 2 alone
+    glm::vec4 Row0 = glm::vec4(ViewProjection[0][0], ViewProjection[1][0], ViewProjection[2][0], ViewProjection[3][0]);
+    glm::vec4 Row1 = glm::vec4(ViewProjection[0][1], ViewProjection[1][1], ViewProjection[2][1], ViewProjection[3][1]);
+    glm::vec4 Row2 = glm::vec4(ViewProjection[0][2], ViewProjection[1][2], ViewProjection[2][2], ViewProjection[3][2]);
+    glm::vec4 Row3 = glm::vec4(ViewProjection[0][3], ViewProjection[1][3], ViewProjection[2][3], ViewProjection[3][3]);
+
+    glm::vec4 Equations[6] = { Row3 + Row0, Row3 - Row0, Row3 + Row1, Row3 - Row1, Row2, Row3 - Row2 };
+    for (uint32_t p = 0; p < 6; p++)
+    {
+        float Length = glm::length(glm::vec3(Equations[p]));
+        Planes[p].Normal = glm::vec3(Equations[p]) / Length;
+        Planes[p].Distance = Equations[p].w / Length;
+    }
+}
+
+void FrustumCuller::SetBoxes(const BoundingBox* Boxes, size_t Count)
+{
+    bSpheres = false;
+    VolumeCount = Count;
+    CentreX.resize(Count);
+    CentreY.resize(Count);
+    CentreZ.resize(Count);
+    ExtentX.resize(Count);
+    ExtentY.resize(Count);
+    ExtentZ.resize(Count);
+
+    for (size_t i = 0; i < Count; i++)
+    {
+        // No bounds: an extent no plane can be further than (centre and extent computed from the sentinel would overflow)
+        glm::vec3 Centre = glm::vec3(0.0f);
+        glm::vec3 Extent = glm::vec3(std::numeric_limits<float>::max());
+        if (Boxes[i].Min.x != -std::numeric_limits<float>::max())
+        {
+            Centre = (Boxes[i].Min + Boxes[i].Max) * 0.5f;
+            Extent = (Boxes[i].Max - Boxes[i].Min) * 0.5f;
+        }
+
+        CentreX[i] = Centre.x;
+        CentreY[i] = Centre.y;
+        CentreZ[i] = Centre.z;
+        ExtentX[i] = Extent.x;
+        ExtentY[i] = Extent.y;
+        ExtentZ[i] = Extent.z;
+    }
+}
+
+void FrustumCuller::SetSpheres(const glm::vec4* Spheres, size_t Count)
+{
+    bSpheres = true;
+    VolumeCount = Count;
+    CentreX.resize(Count);
+    CentreY.resize(Count);
+    CentreZ.resize(Count);
+    ExtentX.resize(Count);
+
+    for (size_t i = 0; i < Count; i++)
+    {
+        CentreX[i] = Spheres[i].x;
+        CentreY[i] = Spheres[i].y;
+        CentreZ[i] = Spheres[i].z;
+        ExtentX[i] = Spheres[i].w;
+    }
+}
+
+void FrustumCuller::Cull(std::vector<uint32_t>& VisibleIndices, JobSystem* Jobs)
+{
+    if (!Jobs || Jobs->GetWorkerCount() < 2 || VolumeCount < CULL_PARALLEL_THRESHOLD)
+    {
+        CullRange(0, VolumeCount, VisibleIndices);
+        return;
+    }
+
+    // Each job compacts its own contiguous chunks, concatenating them keeps the indices ascending
+    size_t ChunkCount = static_cast<size_t>(Jobs->GetWorkerCount()) * JOB_CHUNKS_PER_WORKER;
+    ChunkVisible.resize(ChunkCount);
+    Jobs->ParallelFor(ChunkCount, 1, [this, ChunkCount](size_t FirstChunk, size_t LastChunk)
+    {
+        for (size_t Chunk = FirstChunk; Chunk < LastChunk; Chunk++)
+        {
+            CullRange(VolumeCount * Chunk / ChunkCount, VolumeCount * (Chunk + 1) / ChunkCount, ChunkVisible[Chunk]);
+        }
+    });
+
+    VisibleIndices.clear();
+    for (const std::vector<uint32_t>& Visible : ChunkVisible)
+    {
+        VisibleIndices.insert(VisibleIndices.end(), Visible.begin(), Visible.end());
+    }
+}
+
+void FrustumCuller::CullRange(size_t Begin, size_t End, std::vector<uint32_t>& VisibleIndices) const
+{
+    // Every volume could be visible, plus the spare lanes the AVX2 path stores past the last visible index
+    VisibleIndices.resize(End - Begin + 8);
+
+    CullVolumes Volumes = { CentreX.data(), CentreY.data(), CentreZ.data(), ExtentX.data(), ExtentY.data(), ExtentZ.data() };
+    uint32_t* Write = bSpheres ? CullVolumeRange<true>(Volumes, Planes, Begin, End, VisibleIndices.data())
+                               : CullVolumeRange<false>(Volumes, Planes, Begin, End, VisibleIndices.data());
+
+    VisibleIndices.resize(Write - VisibleIndices.data());
+}
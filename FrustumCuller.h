@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "Utilities.h"
+#include "JobSystem.h"
+
+const size_t CULL_PARALLEL_THRESHOLD = 16384;           // Fewer volumes than this are culled on the calling thread
+
+// Plane of a frustum, points with Dot(Normal, Point) + Distance >= 0 are on the inside
+struct FrustumPlane
+{
+    glm::vec3 Normal;                                       // Points into the frustum, unit length
+    float Distance;
+};
+
+// Tests bounding volumes against the 6 planes of a view-projection frustum and lists the ones that may be visible.
+// Volumes are kept structure-of-arrays (one array per centre/extent component), so the SIMD paths load 8 (AVX2)
+// or 16 (AVX-512) volumes per instruction and test them against a plane at once. The path follows GetSimdLevel().
+// The test is conservative: a volume is only culled when it is entirely behind one plane
+class FrustumCuller
+{
+public:
+    FrustumCuller();
+    ~FrustumCuller();
+
+    // Planes of the frustum ViewProjection maps to clip space (Vulkan depth range, 0 to 1)
+    void SetFrustum(const glm::mat4& ViewProjection);
+
+    // World space volumes, replacing the previous ones. Boxes without bounds (the BoundingBox default) are never culled
+    void SetBoxes(const BoundingBox* Boxes, size_t Count);
+    void SetSpheres(const glm::vec4* Spheres, size_t Count);       // xyz centre, w radius
+
+    // Indices (in the order volumes were given) of every volume intersecting the frustum, ascending.
+    // Large sets are split across the workers of Jobs (if given)
+    void Cull(std::vector<uint32_t>& VisibleIndices, JobSystem* Jobs = nullptr);
+
+private:
+    FrustumPlane Planes[6];                                 // Left, right, bottom, top, near, far
+
+    // -- VOLUMES (SOA) --
+    bool bSpheres = false;                                  // Spheres keep their radius in ExtentX, ExtentY/Z are unused
+    size_t VolumeCount = 0;
+    std::vector<float> CentreX;
+    std::vector<float> CentreY;
+    std::vector<float> CentreZ;
+    std::vector<float> ExtentX;
+    std::vector<float> ExtentY;
+    std::vector<float> ExtentZ;
+
+    std::vector<std::vector<uint32_t>> ChunkVisible;        // Per chunk results of a parallel cull, kept to avoid reallocating
+
+    void CullRange(size_t Begin, size_t End, std::vector<uint32_t>& VisibleIndices) const;
+};
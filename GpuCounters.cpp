@@ -0,0 +1,257 @@
+#include "GpuCounters.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const VkQueryPipelineStatisticFlags COUNTED_STATISTICS = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT
+                                                           | VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT
+                                                           | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+                                                           | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT
+                                                           | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+                                                           | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    static_assert(sizeof(PipelineStatistics) == 6 * sizeof(uint64_t), "PipelineStatistics must match the counted statistics");
+}
+
+void PipelineStatistics::Add(const PipelineStatistics& Other)
+{
+    InputVertices += Other.InputVertices;
+    InputPrimitives += Other.InputPrimitives;
+    VertexInvocations += Other.VertexInvocations;
+    ClippingInvocations += Other.ClippingInvocations;
+    ClippingPrimitives += Other.ClippingPrimitives;
+    FragmentInvocations += Other.FragmentInvocations;
+}
+
+GpuCounters::GpuCounters()
+{
+}
+
+GpuCounters::~GpuCounters()
+{
+}
+
+void GpuCounters::Create(VkPhysicalDevice PhysicalDevice, VkDevice NewDevice, uint32_t GraphicsFamily, uint32_t NewFrameCount,
+                         GpuCounterMode NewMode, bool bStatisticsEnabled, bool bInheritedQueriesEnabled)
+{
+    Device = NewDevice;
+    FrameCount = NewFrameCount;
+    Mode = bStatisticsEnabled ? NewMode : GpuCounterMode::Off;
+    bStatistics = Mode != GpuCounterMode::Off;
+    bInheritedQueries = bInheritedQueriesEnabled;
+
+    // Timestamps need valid bits on the queue they are written on
+    VkPhysicalDeviceProperties DeviceProperties;
+    vkGetPhysicalDeviceProperties(PhysicalDevice, &DeviceProperties);
+    uint32_t QueueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> QueueFamilyList(QueueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount, QueueFamilyList.data());
+
+    uint32_t ValidBits = QueueFamilyList[GraphicsFamily].timestampValidBits;
+    bTimestamps = ValidBits > 0;
+    TimestampPeriod = DeviceProperties.limits.timestampPeriod;
+    TimestampMask = ValidBits >= 64 ? ~0ull : (1ull << ValidBits) - 1;
+
+    if (bTimestamps)
+    {
+        VkQueryPoolCreateInfo QueryPoolCreateInfo = {};
+        QueryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        QueryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        QueryPoolCreateInfo.queryCount = FrameCount * GPU_COUNTER_MAX_PASSES * 2;
+
+        VkResult Result = vkCreateQueryPool(Device, &QueryPoolCreateInfo, nullptr, &TimestampPool);
+        if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create a timestamp Query Pool");
+    }
+
+    if (bStatistics)
+    {
+        StatisticsPerFrame = GPU_COUNTER_MAX_PASSES + (Mode == GpuCounterMode::PerDraw ? GPU_COUNTER_MAX_DRAWS : 0);
+
+        VkQueryPoolCreateInfo QueryPoolCreateInfo = {};
+        QueryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        QueryPoolCreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        QueryPoolCreateInfo.queryCount = FrameCount * StatisticsPerFrame;
+        QueryPoolCreateInfo.pipelineStatistics = COUNTED_STATISTICS;
+
+        VkResult Result = vkCreateQueryPool(Device, &QueryPoolCreateInfo, nullptr, &StatisticsPool);
+        if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create a pipeline statistics Query Pool");
+    }
+
+    Frames = std::vector<FrameRecord>(FrameCount);
+    for (FrameRecord& Record : Frames)
+    {
+        Record.PassNames.resize(GPU_COUNTER_MAX_PASSES);
+        Record.bPassStatistics.resize(GPU_COUNTER_MAX_PASSES);
+        if (Mode == GpuCounterMode::PerDraw) Record.DrawTags.resize(GPU_COUNTER_MAX_DRAWS);
+    }
+}
+
+void GpuCounters::Destroy()
+{
+    if (TimestampPool != VK_NULL_HANDLE) vkDestroyQueryPool(Device, TimestampPool, nullptr);
+    if (StatisticsPool != VK_NULL_HANDLE) vkDestroyQueryPool(Device, StatisticsPool, nullptr);
+    TimestampPool = VK_NULL_HANDLE;
+    StatisticsPool = VK_NULL_HANDLE;
+    Frames.clear();
+}
+
+void GpuCounters::BeginFrame(uint32_t Frame)
+{
+    FrameRecord& Record = Frames[Frame];
+    if (Record.bRecorded) ReadBack(Record, Frame);
+
+    RecordingFrame = Frame;
+    Record.FrameNumber = FrameNumber++;
+    Record.Passes.clear();
+    Record.DrawCount = 0;
+    Record.bRecorded = false;
+}
+
+void GpuCounters::ResetQueries(VkCommandBuffer CommandBuffer)
+{
+    if (bTimestamps) vkCmdResetQueryPool(CommandBuffer, TimestampPool, RecordingFrame * GPU_COUNTER_MAX_PASSES * 2, GPU_COUNTER_MAX_PASSES * 2);
+    if (bStatistics) vkCmdResetQueryPool(CommandBuffer, StatisticsPool, RecordingFrame * StatisticsPerFrame, StatisticsPerFrame);
+    Frames[RecordingFrame].bRecorded = true;
+}
+
+void GpuCounters::BeginPass(VkCommandBuffer CommandBuffer, uint32_t PassIndex, const std::string& Name, bool bSecondaryCommandBuffers)
+{
+    if (PassIndex >= GPU_COUNTER_MAX_PASSES) return;
+
+    FrameRecord& Record = Frames[RecordingFrame];
+    Record.Passes.push_back(PassIndex);
+    Record.PassNames[PassIndex] = Name;
+
+    if (bTimestamps)
+    {
+        vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, TimestampPool, (RecordingFrame * GPU_COUNTER_MAX_PASSES + PassIndex) * 2);
+    }
+
+    Record.bPassStatistics[PassIndex] = Mode == GpuCounterMode::PerPass && (!bSecondaryCommandBuffers || bInheritedQueries);
+    if (Record.bPassStatistics[PassIndex])
+    {
+        vkCmdBeginQuery(CommandBuffer, StatisticsPool, RecordingFrame * StatisticsPerFrame + PassIndex, 0);
+    }
+}
+
+void GpuCounters::EndPass(VkCommandBuffer CommandBuffer, uint32_t PassIndex)
+{
+    if (PassIndex >= GPU_COUNTER_MAX_PASSES) return;
+
+    const FrameRecord& Record = Frames[RecordingFrame];
+    if (Record.bPassStatistics[PassIndex])
+    {
+        vkCmdEndQuery(CommandBuffer, StatisticsPool, RecordingFrame * StatisticsPerFrame + PassIndex);
+    }
+
+    if (bTimestamps)
+    {
+        vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, TimestampPool, (RecordingFrame * GPU_COUNTER_MAX_PASSES + PassIndex) * 2 + 1);
+    }
+}
+
+uint32_t GpuCounters::BeginDraw(VkCommandBuffer CommandBuffer, uint32_t PassIndex, uint32_t ObjectIndex)
+{
+    if (Mode != GpuCounterMode::PerDraw) return UINT32_MAX;
+
+    FrameRecord& Record = Frames[RecordingFrame];
+    uint32_t Draw = Record.DrawCount.fetch_add(1, std::memory_order_relaxed);
+    if (Draw >= GPU_COUNTER_MAX_DRAWS) return UINT32_MAX;
+
+    Record.DrawTags[Draw].PassIndex = PassIndex;
+    Record.DrawTags[Draw].ObjectIndex = ObjectIndex;
+
+    uint32_t Query = RecordingFrame * StatisticsPerFrame + GPU_COUNTER_MAX_PASSES + Draw;
+    vkCmdBeginQuery(CommandBuffer, StatisticsPool, Query, 0);
+    return Query;
+}
+
+void GpuCounters::EndDraw(VkCommandBuffer CommandBuffer, uint32_t Query)
+{
+    if (Query != UINT32_MAX) vkCmdEndQuery(CommandBuffer, StatisticsPool, Query);
+}
+
+VkQueryPipelineStatisticFlags GpuCounters::GetInheritedStatistics() const
+{
+    return Mode == GpuCounterMode::PerPass && bInheritedQueries ? COUNTED_STATISTICS : 0;
+}
+
+GpuFrameCounters GpuCounters::GetLastFrame() const
+{
+    std::lock_guard<std::mutex> Lock(ResultMutex);
+    return LastFrame;
+}
+
+void GpuCounters::ReadBack(FrameRecord& Record, uint32_t Frame)
+{
+    GpuFrameCounters Counters;
+    Counters.FrameNumber = Record.FrameNumber;
+
+    // The frame's fence has signalled, so everything it wrote is available. Queries it never wrote (unused pass
+    // and draw slots) stay unavailable, vkGetQueryPoolResults leaves them at zero and returns VK_NOT_READY
+    std::vector<uint64_t> Timestamps(GPU_COUNTER_MAX_PASSES * 2, 0);
+    if (bTimestamps)
+    {
+        vkGetQueryPoolResults(Device, TimestampPool, Frame * GPU_COUNTER_MAX_PASSES * 2, GPU_COUNTER_MAX_PASSES * 2,
+                              Timestamps.size() * sizeof(uint64_t), Timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    }
+
+    std::vector<PipelineStatistics> Statistics;
+    if (bStatistics)
+    {
+        uint32_t DrawCount = std::min(Record.DrawCount.load(std::memory_order_relaxed), GPU_COUNTER_MAX_DRAWS);
+        Statistics.resize(GPU_COUNTER_MAX_PASSES + DrawCount);
+        vkGetQueryPoolResults(Device, StatisticsPool, Frame * StatisticsPerFrame, static_cast<uint32_t>(Statistics.size()),
+                              Statistics.size() * sizeof(PipelineStatistics), Statistics.data(), sizeof(PipelineStatistics), VK_QUERY_RESULT_64_BIT);
+
+        for (uint32_t Draw = 0; Draw < DrawCount; Draw++)
+        {
+            GpuDrawCounters DrawCounters = Record.DrawTags[Draw];
+            DrawCounters.Statistics = Statistics[GPU_COUNTER_MAX_PASSES + Draw];
+            Counters.Draws.push_back(DrawCounters);
+        }
+    }
+
+    uint64_t FirstTimestamp = UINT64_MAX;
+    uint64_t LastTimestamp = 0;
+    for (uint32_t PassIndex : Record.Passes)
+    {
+        GpuPassCounters Pass;
+        Pass.PassIndex = PassIndex;
+        Pass.Name = Record.PassNames[PassIndex];
+
+        if (bTimestamps)
+        {
+            uint64_t Begin = Timestamps[PassIndex * 2] & TimestampMask;
+            uint64_t End = Timestamps[PassIndex * 2 + 1] & TimestampMask;
+            Pass.GpuMilliseconds = End > Begin ? (End - Begin) * TimestampPeriod / 1e6 : 0.0;
+            FirstTimestamp = std::min(FirstTimestamp, Begin);
+            LastTimestamp = std::max(LastTimestamp, End);
+        }
+
+        if (Record.bPassStatistics[PassIndex])
+        {
+            Pass.bHasStatistics = true;
+            Pass.Statistics = Statistics[PassIndex];
+        }
+        Counters.Passes.push_back(Pass);
+    }
+
+    // Per draw mode: a pass's statistics are the sum of its draws
+    for (const GpuDrawCounters& Draw : Counters.Draws)
+    {
+        for (GpuPassCounters& Pass : Counters.Passes)
+        {
+            if (Pass.PassIndex != Draw.PassIndex) continue;
+            Pass.bHasStatistics = true;
+            Pass.Statistics.Add(Draw.Statistics);
+        }
+    }
+
+    if (LastTimestamp > FirstTimestamp) Counters.GpuMilliseconds = (LastTimestamp - FirstTimestamp) * TimestampPeriod / 1e6;
+
+    std::lock_guard<std::mutex> Lock(ResultMutex);
+    LastFrame = std::move(Counters);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+const uint32_t GPU_COUNTER_MAX_PASSES = 16;             // Passes timed and counted per frame, later ones aren't
+const uint32_t GPU_COUNTER_MAX_DRAWS = 4096;            // Draws counted per frame in PerDraw mode, later ones aren't
+
+// What pipeline statistics queries are recorded around. A statistics query can't be active while another of the same type
+// begins in the same command buffer, so per draw queries replace the pass ones (pass totals are then the sum of their draws)
+enum class GpuCounterMode
+{
+    Off,                                                // Pass timestamps only
+    PerPass,
+    PerDraw
+};
+
+// VK_QUERY_TYPE_PIPELINE_STATISTICS results, in the order of their flag bits
+struct PipelineStatistics
+{
+    uint64_t InputVertices = 0;
+    uint64_t InputPrimitives = 0;
+    uint64_t VertexInvocations = 0;
+    uint64_t ClippingInvocations = 0;
+    uint64_t ClippingPrimitives = 0;                    // Primitives that made it through clipping
+    uint64_t FragmentInvocations = 0;
+
+    void Add(const PipelineStatistics& Other);
+};
+
+struct GpuPassCounters
+{
+    uint32_t PassIndex;                                 // Render graph pass
+    std::string Name;
+    double GpuMilliseconds = 0.0;                       // 0 without timestamp support
+    bool bHasStatistics = false;
+    PipelineStatistics Statistics;
+};
+
+struct GpuDrawCounters
+{
+    uint32_t PassIndex;                                 // Render graph pass the draw is recorded in
+    uint32_t ObjectIndex;                               // Render object drawn
+    PipelineStatistics Statistics;
+};
+
+struct GpuFrameCounters
+{
+    uint64_t FrameNumber = 0;                           // Frame the counters were recorded in (results lag by the frames in flight)
+    double GpuMilliseconds = 0.0;                       // First pass start to last pass end
+    std::vector<GpuPassCounters> Passes;                // In execution order
+    std::vector<GpuDrawCounters> Draws;                 // PerDraw mode only
+};
+
+// Per pass GPU time (timestamps) and pipeline statistics, optionally per draw. Every frame in flight has its own range
+// of queries; a frame's results are read back when its slot comes round again, after its fence, so nothing ever waits
+// on the GPU. Draw queries can be recorded from several threads at once (parallel secondary command buffers)
+class GpuCounters
+{
+public:
+    GpuCounters();
+    ~GpuCounters();
+
+    // bStatisticsEnabled/bInheritedQueriesEnabled: the pipelineStatisticsQuery/inheritedQueries device features
+    void Create(VkPhysicalDevice PhysicalDevice, VkDevice NewDevice, uint32_t GraphicsFamily, uint32_t NewFrameCount,
+                GpuCounterMode NewMode, bool bStatisticsEnabled, bool bInheritedQueriesEnabled);
+    void Destroy();
+
+    // After the frame's fence: reads back what the slot recorded last time round, then frees it for recording
+    void BeginFrame(uint32_t Frame);
+    void ResetQueries(VkCommandBuffer CommandBuffer);   // Outside any render pass, before the first pass
+
+    // Around a pass, outside its render pass. Passes recorded in secondaries only get statistics with inheritedQueries
+    void BeginPass(VkCommandBuffer CommandBuffer, uint32_t PassIndex, const std::string& Name, bool bSecondaryCommandBuffers);
+    void EndPass(VkCommandBuffer CommandBuffer, uint32_t PassIndex);
+
+    // Around a draw (PerDraw mode), from any recording thread. UINT32_MAX when not counted, EndDraw ignores it
+    uint32_t BeginDraw(VkCommandBuffer CommandBuffer, uint32_t PassIndex, uint32_t ObjectIndex);
+    void EndDraw(VkCommandBuffer CommandBuffer, uint32_t Query);
+
+    VkQueryPipelineStatisticFlags GetInheritedStatistics() const;   // For secondary buffers recorded inside a counted pass
+    GpuFrameCounters GetLastFrame() const;              // Latest frame read back, from any thread
+
+private:
+    VkDevice Device = VK_NULL_HANDLE;
+    GpuCounterMode Mode = GpuCounterMode::Off;
+    uint32_t FrameCount = 0;
+    bool bStatistics = false;
+    bool bTimestamps = false;
+    bool bInheritedQueries = false;
+    double TimestampPeriod = 1.0;                       // Nanoseconds per tick
+    uint64_t TimestampMask = ~0ull;                     // Only the valid bits of a timestamp count
+
+    // Per frame: passes first, then draws. Timestamps: begin and end of each pass
+    VkQueryPool StatisticsPool = VK_NULL_HANDLE;
+    VkQueryPool TimestampPool = VK_NULL_HANDLE;
+    uint32_t StatisticsPerFrame = 0;
+
+    // What a frame slot recorded, to know which queries to read back
+    struct FrameRecord
+    {
+        uint64_t FrameNumber = 0;
+        std::vector<uint32_t> Passes;                   // In execution order
+        std::vector<std::string> PassNames;             // By pass index
+        std::vector<bool> bPassStatistics;              // By pass index
+        std::atomic<uint32_t> DrawCount = 0;
+        std::vector<GpuDrawCounters> DrawTags;          // Statistics filled on read back
+        bool bRecorded = false;
+    };
+    std::vector<FrameRecord> Frames;
+    uint32_t RecordingFrame = 0;
+    uint64_t FrameNumber = 0;
+
+    mutable std::mutex ResultMutex;
+    GpuFrameCounters LastFrame;
+
+    void ReadBack(FrameRecord& Record, uint32_t Frame);
+};
@@ -0,0 +1,323 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <exception>
+
+struct Job
+{
+    std::function<void()> Function;
+    JobCounter* Counter;
+};
+
+namespace
+{
+    // Which system and worker the current thread belongs to (worker threads only, see WorkerZeroThread)
+    thread_local const JobSystem* CurrentSystem = nullptr;
+    thread_local uint32_t CurrentWorker = UINT32_MAX;
+
+    const int64_t JOB_QUEUE_MASK = JOB_QUEUE_CAPACITY - 1;
+    static_assert((JOB_QUEUE_CAPACITY & (JOB_QUEUE_CAPACITY - 1)) == 0, "Job queue capacity must be a power of two");
+}
+
+JobSystem::JobSystem()
+{
+}
+
+JobSystem::~JobSystem()
+{
+}
+
+void JobSystem::Create(uint32_t WorkerCount)
+{
+    if (WorkerCount == 0) WorkerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    bStopping = false;
+    for (uint32_t i = 0; i < WorkerCount; i++)
+    {
+        Workers.push_back(std::make_unique<Worker>());
+    }
+
+    // Calling thread is worker 0, the others get threads once every queue exists
+    WorkerZeroThread = std::this_thread::get_id();
+    for (uint32_t i = 1; i < WorkerCount; i++)
+    {
+        Workers[i]->Thread = std::thread(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+void JobSystem::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> Lock(SleepMutex);
+        bStopping = true;
+    }
+    WakeUp.notify_all();
+
+    for (std::unique_ptr<Worker>& Worker : Workers)
+    {
+        if (Worker->Thread.joinable()) Worker->Thread.join();
+    }
+
+    // Nothing runs anymore, free whatever is left
+    for (std::unique_ptr<Worker>& Worker : Workers)
+    {
+        while (Job* Leftover = Worker->Queue.Pop()) delete Leftover;
+    }
+    for (Job* Leftover : SharedJobs)
+    {
+        delete Leftover;
+    }
+    SharedJobs.clear();
+    Workers.clear();
+    QueuedJobs = 0;
+    WorkerZeroThread = std::thread::id();
+}
+
+void JobSystem::AdoptCallingThread()
+{
+    WorkerZeroThread = std::this_thread::get_id();
+}
+
+uint32_t JobSystem::GetWorkerCount() const
+{
+    return static_cast<uint32_t>(Workers.size());
+}
+
+uint32_t JobSystem::GetWorkerIndex() const
+{
+    if (CurrentSystem == this) return CurrentWorker;
+    return std::this_thread::get_id() == WorkerZeroThread.load(std::memory_order_relaxed) ? 0 : UINT32_MAX;
+}
+
+void JobSystem::Run(std::function<void()> Function, JobCounter* Counter, JobCounter* Dependency)
+{
+    Job* NewJob = new Job{ std::move(Function), Counter };
+    if (Counter) Counter->Pending.fetch_add(1, std::memory_order_relaxed);
+
+    if (Dependency)
+    {
+        // Counters only reach zero under this lock, so the job is either queued now or released by the last Signal
+        std::lock_guard<std::mutex> Lock(Dependency->WaitingMutex);
+        if (Dependency->Pending.load(std::memory_order_acquire) > 0)
+        {
+            Dependency->Waiting.push_back(NewJob);
+            return;
+        }
+    }
+
+    Submit(NewJob);
+}
+
+void JobSystem::Wait(JobCounter& Counter)
+{
+    uint32_t WorkerIndex = GetWorkerIndex();
+
+    while (!Counter.IsDone())
+    {
+        // Threads outside the system have no queue and can't run jobs that expect a worker index, they just wait
+        Job* Ready = WorkerIndex != UINT32_MAX ? FindJob(WorkerIndex) : nullptr;
+        if (Ready) Execute(Ready);
+        else std::this_thread::yield();
+    }
+
+    // The last Signal may still hold the lock, the counter must outlive it (the caller usually destroys it next)
+    std::lock_guard<std::mutex> Lock(Counter.WaitingMutex);
+}
+
+void JobSystem::ParallelFor(size_t Count, size_t MinGrain, const std::function<void(size_t Begin, size_t End)>& Function)
+{
+    if (Count == 0) return;
+
+    // Enough chunks for stealing to balance uneven work, but none smaller than MinGrain so job overhead stays small
+    size_t MaxChunks = std::max<size_t>(1, Workers.size() * JOB_CHUNKS_PER_WORKER);
+    size_t ChunkCount = std::clamp<size_t>(Count / std::max<size_t>(1, MinGrain), 1, MaxChunks);
+    if (ChunkCount == 1 || Workers.size() < 2)
+    {
+        Function(0, Count);
+        return;
+    }
+
+    JobCounter Counter;
+    std::mutex ErrorMutex;
+    std::exception_ptr FirstError;
+
+    auto RunChunk = [&](size_t Chunk)
+    {
+        try
+        {
+            Function(Count * Chunk / ChunkCount, Count * (Chunk + 1) / ChunkCount);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> Lock(ErrorMutex);
+            if (!FirstError) FirstError = std::current_exception();
+        }
+    };
+
+    for (size_t Chunk = 1; Chunk < ChunkCount; Chunk++)
+    {
+        Run([&RunChunk, Chunk]() { RunChunk(Chunk); }, &Counter);
+    }
+    RunChunk(0);                                                // Calling thread takes the first chunk
+    Wait(Counter);
+
+    if (FirstError) std::rethrow_exception(FirstError);
+}
+
+void JobSystem::WorkerLoop(uint32_t WorkerIndex)
+{
+    CurrentSystem = this;
+    CurrentWorker = WorkerIndex;
+
+    uint32_t FailedAttempts = 0;
+    while (!bStopping.load(std::memory_order_relaxed))
+    {
+        Job* Ready = FindJob(WorkerIndex);
+        if (Ready)
+        {
+            Execute(Ready);
+            FailedAttempts = 0;
+            continue;
+        }
+
+        // Jobs usually come in bursts, spin a little before paying for a sleep and wake up
+        if (++FailedAttempts < JOB_SPINS_BEFORE_SLEEP)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> Lock(SleepMutex);
+        SleepingWorkers.fetch_add(1);
+        WakeUp.wait(Lock, [this]() { return QueuedJobs.load() > 0 || bStopping.load(); });
+        SleepingWorkers.fetch_sub(1);
+        FailedAttempts = 0;
+    }
+}
+
+void JobSystem::Submit(Job* NewJob)
+{
+    // Counted before it can be taken, so a worker that sees no queued jobs really has nothing to find
+    QueuedJobs.fetch_add(1);
+
+    uint32_t WorkerIndex = GetWorkerIndex();
+    if (WorkerIndex != UINT32_MAX)
+    {
+        if (!Workers[WorkerIndex]->Queue.Push(NewJob))
+        {
+            QueuedJobs.fetch_sub(1);
+            Execute(NewJob);
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> Lock(SharedMutex);
+        SharedJobs.push_back(NewJob);
+    }
+
+    // A worker going to sleep registers under SleepMutex before checking QueuedJobs, so taking the lock here means
+    // it either saw the job or is already waiting for this notification
+    if (SleepingWorkers.load() > 0)
+    {
+        std::lock_guard<std::mutex> Lock(SleepMutex);
+    }
+    WakeUp.notify_one();
+}
+
+Job* JobSystem::FindJob(uint32_t WorkerIndex)
+{
+    Job* Found = Workers[WorkerIndex]->Queue.Pop();
+
+    // Steal from the others, starting with the next worker so thieves spread over different victims
+    uint32_t WorkerCount = static_cast<uint32_t>(Workers.size());
+    for (uint32_t i = 1; i < WorkerCount && !Found; i++)
+    {
+        Found = Workers[(WorkerIndex + i) % WorkerCount]->Queue.Steal();
+    }
+
+    if (!Found)
+    {
+        std::lock_guard<std::mutex> Lock(SharedMutex);
+        if (!SharedJobs.empty())
+        {
+            Found = SharedJobs.front();
+            SharedJobs.pop_front();
+        }
+    }
+
+    if (Found) QueuedJobs.fetch_sub(1);
+    return Found;
+}
+
+void JobSystem::Execute(Job* Ready)
+{
+    Ready->Function();
+    if (Ready->Counter) Signal(Ready->Counter);
+    delete Ready;
+}
+
+void JobSystem::Signal(JobCounter* Counter)
+{
+    // Reaching zero under the lock means Run can't add a dependent after the waiting list was taken,
+    // and Wait (which takes the lock last) can't return while the counter is still being touched here
+    std::vector<Job*> Released;
+    {
+        std::lock_guard<std::mutex> Lock(Counter->WaitingMutex);
+        if (Counter->Pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        Released.swap(Counter->Waiting);                        // Last job of the counter, release everything that depended on it
+    }
+
+    for (Job* Dependent : Released)
+    {
+        Submit(Dependent);
+    }
+}
+
+bool JobSystem::WorkStealingQueue::Push(Job* NewJob)
+{
+    int64_t CurrentBottom = Bottom.load(std::memory_order_relaxed);
+    int64_t CurrentTop = Top.load(std::memory_order_acquire);
+    if (CurrentBottom - CurrentTop >= static_cast<int64_t>(JOB_QUEUE_CAPACITY)) return false;
+
+    Jobs[CurrentBottom & JOB_QUEUE_MASK].store(NewJob, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Bottom.store(CurrentBottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job* JobSystem::WorkStealingQueue::Pop()
+{
+    int64_t CurrentBottom = Bottom.load(std::memory_order_relaxed) - 1;
+    Bottom.store(CurrentBottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t CurrentTop = Top.load(std::memory_order_relaxed);
+
+    if (CurrentTop > CurrentBottom)
+    {
+        // Empty
+        Bottom.store(CurrentBottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* Popped = Jobs[CurrentBottom & JOB_QUEUE_MASK].load(std::memory_order_relaxed);
+    if (CurrentTop == CurrentBottom)
+    {
+        // Last job, race thieves for it
+        if (!Top.compare_exchange_strong(CurrentTop, CurrentTop + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) Popped = nullptr;
+        Bottom.store(CurrentBottom + 1, std::memory_order_relaxed);
+    }
+    return Popped;
+}
+
+Job* JobSystem::WorkStealingQueue::Steal()
+{
+    int64_t CurrentTop = Top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t CurrentBottom = Bottom.load(std::memory_order_acquire);
+    if (CurrentTop >= CurrentBottom) return nullptr;
+
+    Job* Stolen = Jobs[CurrentTop & JOB_QUEUE_MASK].load(std::memory_order_relaxed);
+    if (!Top.compare_exchange_strong(CurrentTop, CurrentTop + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+    return Stolen;
+}
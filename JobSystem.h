@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+const uint32_t JOB_QUEUE_CAPACITY = 4096;               // Jobs one worker can have queued, jobs pushed to a full queue run straight away
+const uint32_t JOB_CHUNKS_PER_WORKER = 4;               // ParallelFor splits work this much finer than the worker count, so stealing can even it out
+const uint32_t JOB_SPINS_BEFORE_SLEEP = 64;             // Failed attempts to find a job before a worker goes to sleep
+
+struct Job;
+
+// Number of unfinished jobs. Jobs given a counter signal it when they finish; Wait, and jobs depending on it,
+// wait for it to reach zero. A counter can be reused once it has reached zero
+class JobCounter
+{
+public:
+    bool IsDone() const { return Pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> Pending = 0;
+    std::mutex WaitingMutex;
+    std::vector<Job*> Waiting;                          // Jobs depending on this counter, queued once it reaches zero
+};
+
+// Work-stealing job scheduler. Every worker owns a Chase-Lev deque: it pushes and pops jobs at the bottom (newest first,
+// so nested work stays in cache) while idle workers steal from the top (oldest, usually the biggest pieces of work).
+// The thread calling Create (or AdoptCallingThread) is worker 0 and only runs jobs while it waits in Wait/ParallelFor;
+// the other workers are threads of their own that sleep when there is nothing to steal. Threads outside the system
+// can submit jobs too, those go through a shared locked queue
+class JobSystem
+{
+public:
+    JobSystem();
+    ~JobSystem();
+
+    void Create(uint32_t WorkerCount = 0);              // 0: one worker per hardware thread
+    void Destroy();                                     // Waits for the workers to stop, jobs still queued never run
+
+    // Calling thread becomes worker 0 instead of the previous one, which is outside the system from then on
+    // (e.g. frame work moving to a render thread). Worker 0 must not be waiting on jobs while it changes
+    void AdoptCallingThread();
+
+    uint32_t GetWorkerCount() const;                    // Including worker 0
+    uint32_t GetWorkerIndex() const;                    // Worker running the current thread, UINT32_MAX outside the system
+
+    // Queue a job. Counter (if any) is signalled when it finishes, and it only starts once Dependency (if any) reaches zero
+    void Run(std::function<void()> Function, JobCounter* Counter = nullptr, JobCounter* Dependency = nullptr);
+
+    // Returns once Counter reaches zero. Workers run other jobs meanwhile instead of blocking
+    void Wait(JobCounter& Counter);
+
+    // Function(Begin, End) over [0, Count) split in chunks of at least MinGrain elements, returns once every chunk is done.
+    // The first exception thrown by a chunk is rethrown here
+    void ParallelFor(size_t Count, size_t MinGrain, const std::function<void(size_t Begin, size_t End)>& Function);
+
+private:
+    // Chase-Lev deque (with the C11 memory orderings of Le et al.), fixed capacity.
+    // Push and Pop only from the owning worker, Steal from any thread
+    class WorkStealingQueue
+    {
+    public:
+        bool Push(Job* NewJob);
+        Job* Pop();
+        Job* Steal();
+
+    private:
+        alignas(64) std::atomic<int64_t> Top = 0;       // Thieves and owner on separate cache lines
+        alignas(64) std::atomic<int64_t> Bottom = 0;
+        std::atomic<Job*> Jobs[JOB_QUEUE_CAPACITY];
+    };
+
+    struct Worker
+    {
+        WorkStealingQueue Queue;
+        std::thread Thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> Workers;
+    std::atomic<std::thread::id> WorkerZeroThread;      // Worker 0 can change thread, so it isn't tracked thread locally
+
+    // Jobs from threads outside the system
+    std::mutex SharedMutex;
+    std::deque<Job*> SharedJobs;
+
+    // Sleeping workers wake when a job is queued
+    std::atomic<int32_t> QueuedJobs = 0;
+    std::atomic<uint32_t> SleepingWorkers = 0;
+    std::atomic<bool> bStopping = false;
+    std::mutex SleepMutex;
+    std::condition_variable WakeUp;
+
+    void WorkerLoop(uint32_t WorkerIndex);
+    void Submit(Job* NewJob);
+    Job* FindJob(uint32_t WorkerIndex);
+    void Execute(Job* FinishedJob);
+    void Signal(JobCounter* Counter);
+};
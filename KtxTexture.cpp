@@ -0,0 +1,253 @@
+#include "KtxTexture.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#ifdef VULKANRENDERER_BASISU
+#include <mutex>
+#include "basisu_transcoder.h"
+#include "zstd.h"
+#endif
+
+namespace
+{
+    const std::array<uint8_t, 12> KTX2_IDENTIFIER = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    // Supercompression schemes (KTX2 spec, section 3.1.9)
+    const uint32_t KTX2_SUPERCOMPRESSION_NONE = 0;
+    const uint32_t KTX2_SUPERCOMPRESSION_BASISLZ = 1;
+    const uint32_t KTX2_SUPERCOMPRESSION_ZSTD = 2;
+
+    // Data Format Descriptor values used to tell universal textures apart
+    const uint8_t KHR_DF_MODEL_ETC1S = 163;
+    const uint8_t KHR_DF_MODEL_UASTC = 166;
+    const uint8_t KHR_DF_TRANSFER_SRGB = 2;
+
+    // Fixed part of the file, right after the identifier (packed, the 64 bit fields sit at a 4 byte offset in it)
+#pragma pack(push, 4)
+    struct Ktx2Header
+    {
+        uint32_t VkFormat;
+        uint32_t TypeSize;
+        uint32_t PixelWidth;
+        uint32_t PixelHeight;
+        uint32_t PixelDepth;
+        uint32_t LayerCount;
+        uint32_t FaceCount;
+        uint32_t LevelCount;
+        uint32_t SupercompressionScheme;
+        uint32_t DfdByteOffset;
+        uint32_t DfdByteLength;
+        uint32_t KvdByteOffset;
+        uint32_t KvdByteLength;
+        uint64_t SgdByteOffset;
+        uint64_t SgdByteLength;
+    };
+#pragma pack(pop)
+    static_assert(sizeof(Ktx2Header) == 68, "KTX2 header must match the file layout");
+
+    struct Ktx2Level
+    {
+        uint64_t ByteOffset;
+        uint64_t ByteLength;
+        uint64_t UncompressedByteLength;
+    };
+
+    // Everything needed to read levels later, shared by the TextureSource's LoadMip
+    struct KtxFile
+    {
+        std::string FilePath;
+        VkFormat Format;                        // Format the levels are handed to the GPU in
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t Supercompression;
+        bool bTranscode;
+        KtxTranscodeTarget Target;
+        std::vector<Ktx2Level> Levels;
+
+#ifdef VULKANRENDERER_BASISU
+        std::vector<uint8_t> FileData;          // The transcoder works on the whole file in memory
+        basist::ktx2_transcoder Transcoder;
+#endif
+    };
+
+    bool IsFormatSampleable(VkPhysicalDevice PhysicalDevice, VkFormat Format)
+    {
+        VkFormatProperties FormatProperties;
+        vkGetPhysicalDeviceFormatProperties(PhysicalDevice, Format, &FormatProperties);
+
+        VkFormatFeatureFlags Needed = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (FormatProperties.optimalTilingFeatures & Needed) == Needed;
+    }
+
+    VkFormat GetTranscodeFormat(KtxTranscodeTarget Target, bool bSrgb)
+    {
+        switch (Target)
+        {
+        case KtxTranscodeTarget::BC7:       return bSrgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+        case KtxTranscodeTarget::ASTC4x4:   return bSrgb ? VK_FORMAT_ASTC_4x4_SRGB_BLOCK : VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+        case KtxTranscodeTarget::ETC2:      return bSrgb ? VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+        default:                            return bSrgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        }
+    }
+
+    std::vector<uint8_t> LoadKtxLevel(KtxFile& File, uint32_t Level)
+    {
+        uint32_t LevelWidth = std::max(1u, File.Width >> Level);
+        uint32_t LevelHeight = std::max(1u, File.Height >> Level);
+        std::vector<uint8_t> Data(GetMipByteSize(File.Format, LevelWidth, LevelHeight));
+
+#ifdef VULKANRENDERER_BASISU
+        if (File.bTranscode)
+        {
+            basist::transcoder_texture_format TranscodeFormat;
+            switch (File.Target)
+            {
+            case KtxTranscodeTarget::BC7:       TranscodeFormat = basist::transcoder_texture_format::cTFBC7_RGBA; break;
+            case KtxTranscodeTarget::ASTC4x4:   TranscodeFormat = basist::transcoder_texture_format::cTFASTC_4x4_RGBA; break;
+            case KtxTranscodeTarget::ETC2:      TranscodeFormat = basist::transcoder_texture_format::cTFETC2_RGBA; break;
+            default:                            TranscodeFormat = basist::transcoder_texture_format::cTFRGBA32; break;
+            }
+
+            // Output size is counted in blocks for compressed targets, pixels for RGBA32
+            FormatBlockInfo Block = GetFormatBlockInfo(File.Format);
+            uint32_t OutputUnits = static_cast<uint32_t>(Data.size() / Block.Bytes);
+
+            // Levels are transcoded from several job workers at once, each call needs its own transcoder state
+            basist::ktx2_transcoder_state State;
+            if (!File.Transcoder.transcode_image_level(Level, 0, 0, Data.data(), OutputUnits, TranscodeFormat, 0, 0, 0, -1, -1, &State))
+            {
+                throw std::runtime_error("Failed to transcode KTX2 level of " + File.FilePath);
+            }
+            return Data;
+        }
+#endif
+
+        const Ktx2Level& Index = File.Levels[Level];
+
+        std::ifstream Stream(File.FilePath, std::ios::binary);
+        if (!Stream.is_open()) throw std::runtime_error("Failed to open a file!");
+
+        std::vector<uint8_t> Stored(Index.ByteLength);
+        Stream.seekg(Index.ByteOffset);
+        Stream.read(reinterpret_cast<char*>(Stored.data()), Stored.size());
+        if (!Stream) throw std::runtime_error("Failed to read KTX2 level of " + File.FilePath);
+
+#ifdef VULKANRENDERER_BASISU
+        if (File.Supercompression == KTX2_SUPERCOMPRESSION_ZSTD)
+        {
+            size_t Decompressed = ZSTD_decompress(Data.data(), Data.size(), Stored.data(), Stored.size());
+            if (ZSTD_isError(Decompressed) || Decompressed != Data.size()) throw std::runtime_error("Failed to decompress KTX2 level of " + File.FilePath);
+            return Data;
+        }
+#endif
+
+        if (Stored.size() != Data.size()) throw std::runtime_error("KTX2 level has the wrong size in " + File.FilePath);
+        return Stored;
+    }
+}
+
+KtxTranscodeTarget ChooseKtxTranscodeTarget(VkPhysicalDevice PhysicalDevice)
+{
+    for (KtxTranscodeTarget Target : { KtxTranscodeTarget::BC7, KtxTranscodeTarget::ASTC4x4, KtxTranscodeTarget::ETC2 })
+    {
+        if (IsFormatSampleable(PhysicalDevice, GetTranscodeFormat(Target, false))) return Target;
+    }
+
+    return KtxTranscodeTarget::RGBA8;
+}
+
+TextureSource LoadKtxTextureSource(const std::string& FilePath, VkPhysicalDevice PhysicalDevice, KtxTranscodeTarget Target)
+{
+    std::ifstream Stream(FilePath, std::ios::binary);
+    if (!Stream.is_open()) throw std::runtime_error("Failed to open a file!");
+
+    // -- HEADER --
+    std::array<uint8_t, 12> Identifier;
+    Ktx2Header Header;
+    Stream.read(reinterpret_cast<char*>(Identifier.data()), Identifier.size());
+    Stream.read(reinterpret_cast<char*>(&Header), sizeof(Header));
+    if (!Stream || Identifier != KTX2_IDENTIFIER) throw std::runtime_error("Not a KTX2 file: " + FilePath);
+
+    if (Header.PixelHeight == 0 || Header.PixelDepth > 1 || Header.LayerCount > 1 || Header.FaceCount != 1)
+    {
+        throw std::runtime_error("Only 2D KTX2 textures are supported: " + FilePath);
+    }
+
+    auto File = std::make_shared<KtxFile>();
+    File->FilePath = FilePath;
+    File->Width = Header.PixelWidth;
+    File->Height = Header.PixelHeight;
+    File->Supercompression = Header.SupercompressionScheme;
+    File->Target = Target;
+
+    // -- LEVEL INDEX --
+    File->Levels.resize(std::max(1u, Header.LevelCount));
+    Stream.read(reinterpret_cast<char*>(File->Levels.data()), File->Levels.size() * sizeof(Ktx2Level));
+    if (!Stream) throw std::runtime_error("Truncated KTX2 level index: " + FilePath);
+
+    // -- FORMAT --
+    // VK_FORMAT_UNDEFINED means a universal texture, whose Data Format Descriptor says which kind
+    File->bTranscode = Header.VkFormat == VK_FORMAT_UNDEFINED;
+    if (File->bTranscode)
+    {
+        std::array<uint8_t, 16> Dfd = {};
+        Stream.seekg(Header.DfdByteOffset);
+        Stream.read(reinterpret_cast<char*>(Dfd.data()), Dfd.size());
+        if (!Stream) throw std::runtime_error("Truncated KTX2 data format descriptor: " + FilePath);
+
+        // Total size, block header (8 bytes), then colour model, primaries and transfer function
+        uint8_t ColourModel = Dfd[12];
+        bool bSrgb = Dfd[14] == KHR_DF_TRANSFER_SRGB;
+        if (ColourModel != KHR_DF_MODEL_UASTC && ColourModel != KHR_DF_MODEL_ETC1S) throw std::runtime_error("Unknown KTX2 universal format: " + FilePath);
+
+        File->Format = GetTranscodeFormat(Target, bSrgb);
+
+#ifdef VULKANRENDERER_BASISU
+        static std::once_flag TranscoderInitialised;
+        std::call_once(TranscoderInitialised, [] { basist::basisu_transcoder_init(); });
+
+        Stream.seekg(0, std::ios::end);
+        File->FileData.resize(static_cast<size_t>(Stream.tellg()));
+        Stream.seekg(0);
+        Stream.read(reinterpret_cast<char*>(File->FileData.data()), File->FileData.size());
+
+        if (!File->Transcoder.init(File->FileData.data(), static_cast<uint32_t>(File->FileData.size())) || !File->Transcoder.start_transcoding())
+        {
+            throw std::runtime_error("Failed to start transcoding " + FilePath);
+        }
+#else
+        throw std::runtime_error("KTX2 file needs Basis Universal transcoding, build with VULKANRENDERER_BASISU: " + FilePath);
+#endif
+    }
+    else
+    {
+        // Already in a GPU format, levels go straight to the staging buffer
+        File->Format = static_cast<VkFormat>(Header.VkFormat);
+        GetFormatBlockInfo(File->Format);                                   // Throws for formats we can't size
+
+        if (!IsFormatSampleable(PhysicalDevice, File->Format)) throw std::runtime_error("Device can't sample the format of " + FilePath);
+
+#ifdef VULKANRENDERER_BASISU
+        bool bSupercompressionSupported = File->Supercompression == KTX2_SUPERCOMPRESSION_NONE || File->Supercompression == KTX2_SUPERCOMPRESSION_ZSTD;
+#else
+        bool bSupercompressionSupported = File->Supercompression == KTX2_SUPERCOMPRESSION_NONE;
+#endif
+        if (!bSupercompressionSupported) throw std::runtime_error("Unsupported KTX2 supercompression in " + FilePath);
+    }
+
+    TextureSource Source = {};
+    Source.Format = File->Format;
+    Source.Width = File->Width;
+    Source.Height = File->Height;
+    Source.MipLevels = static_cast<uint32_t>(File->Levels.size());
+    Source.LoadMip = [File](uint32_t MipLevel)
+    {
+        return LoadKtxLevel(*File, MipLevel);
+    };
+
+    return Source;
+}
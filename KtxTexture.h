@@ -0,0 +1,33 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Utilities.h"
+#include "TextureStreamer.h"
+
+// Universal (UASTC / ETC1S) KTX2 textures need the Basis Universal transcoder.
+// Build with VULKANRENDERER_BASISU defined and ExternalLib/basisu/transcoder on the include path to enable it;
+// without it only KTX2 files already in a GPU format (BCn, ASTC, ETC2, uncompressed) can be loaded
+//#define VULKANRENDERER_BASISU
+
+// Compressed format family universal textures are transcoded to, best first
+enum class KtxTranscodeTarget
+{
+    BC7,                // Desktop GPUs
+    ASTC4x4,            // Most mobile GPUs
+    ETC2,               // Anything with ES 3.0 class hardware
+    RGBA8               // Uncompressed fallback, 4x the memory of the others
+};
+
+// Best transcode target the device can sample and filter
+KtxTranscodeTarget ChooseKtxTranscodeTarget(VkPhysicalDevice PhysicalDevice);
+
+// Opens a KTX2 file and describes it as a streamed texture. Only the header and level index are read here;
+// each mip level is read from disk (and transcoded if needed) when the streamer asks for it.
+// Throws if the file is not a 2D KTX2 texture in a format the device can sample
+TextureSource LoadKtxTextureSource(const std::string& FilePath, VkPhysicalDevice PhysicalDevice, KtxTranscodeTarget Target);
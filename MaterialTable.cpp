@@ -0,0 +1,88 @@
+#include "MaterialTable.h"
+
+#include <stdexcept>
+
+MaterialTable::MaterialTable()
+{
+}
+
+MaterialTable::~MaterialTable()
+{
+}
+
+void MaterialTable::Create(VkPhysicalDevice PhysicalDevice, VkDevice NewDevice, BindlessTable* Bindless, uint32_t MaxMaterials)
+{
+    Device = NewDevice;
+    Capacity = MaxMaterials;
+    Materials.resize(Capacity);
+
+    VkDeviceSize BufferSize = sizeof(MaterialData) * Capacity;
+
+    // Host visible so materials can be edited in place without a transfer
+    CreateBuffer(PhysicalDevice, Device, BufferSize,
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &Buffer, &BufferMemory, MemoryCategory::Storage);
+
+    void* Data;
+    VkResult Result = vkMapMemory(Device, BufferMemory, 0, BufferSize, 0, &Data);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to map Material buffer memory");
+    MappedMaterials = static_cast<MaterialData*>(Data);
+
+    // Shaders expect the material buffer at a fixed bindless slot
+    uint32_t BufferSlot = Bindless->AddStorageBuffer(Buffer, 0, BufferSize);
+    if (BufferSlot != MATERIAL_BUFFER_SLOT) throw std::runtime_error("Material buffer must be the first bindless storage buffer");
+}
+
+void MaterialTable::Destroy()
+{
+    vkUnmapMemory(Device, BufferMemory);
+    vkDestroyBuffer(Device, Buffer, nullptr);
+    FreeDeviceMemory(Device, BufferMemory);
+}
+
+uint32_t MaterialTable::AddMaterial(const MaterialData& Material)
+{
+    uint32_t MaterialId;
+    if (!FreeIds.empty())
+    {
+        MaterialId = FreeIds.back();
+        FreeIds.pop_back();
+    }
+    else
+    {
+        if (NextUnused >= Capacity) throw std::runtime_error("Material table is full");
+        MaterialId = NextUnused++;
+    }
+
+    UpdateMaterial(MaterialId, Material);
+    return MaterialId;
+}
+
+void MaterialTable::UpdateMaterial(uint32_t MaterialId, const MaterialData& Material)
+{
+    Materials[MaterialId] = Material;
+    MappedMaterials[MaterialId] = Material;
+}
+
+void MaterialTable::RemoveMaterial(uint32_t MaterialId)
+{
+    FreeIds.push_back(MaterialId);
+}
+
+const MaterialData& MaterialTable::GetMaterial(uint32_t MaterialId) const
+{
+    return Materials[MaterialId];
+}
+
+void MaterialTable::ReplaceTextureSlot(uint32_t OldSlot, uint32_t NewSlot)
+{
+    for (uint32_t MaterialId = 0; MaterialId < NextUnused; MaterialId++)
+    {
+        if (Materials[MaterialId].AlbedoTexture == OldSlot)
+        {
+            Materials[MaterialId].AlbedoTexture = NewSlot;
+            MappedMaterials[MaterialId].AlbedoTexture = NewSlot;
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "Utilities.h"
+#include "BindlessTable.h"
+
+// Bindless buffer slot shaders read materials from (MATERIAL_BUFFER_SLOT in shader.frag)
+const uint32_t MATERIAL_BUFFER_SLOT = 0;
+
+// GPU side material, std430 layout (matches Material in shader.frag)
+struct MaterialData
+{
+    glm::vec4 BaseColour = glm::vec4(1.0f);                 // Multiplied with vertex colour (and albedo texture if any)
+    uint32_t AlbedoTexture = INVALID_BINDLESS_SLOT;         // Bindless texture slot, or INVALID_BINDLESS_SLOT for none
+    uint32_t Padding[3] = {};
+};
+
+// Every material lives in one persistently mapped storage buffer registered in the bindless table.
+// Draws only carry a material id, which shaders use to index the buffer
+class MaterialTable
+{
+public:
+    MaterialTable();
+    ~MaterialTable();
+
+    void Create(VkPhysicalDevice PhysicalDevice, VkDevice Device, BindlessTable* Bindless, uint32_t MaxMaterials);
+    void Destroy();
+
+    uint32_t AddMaterial(const MaterialData& Material);
+    void UpdateMaterial(uint32_t MaterialId, const MaterialData& Material);
+    void RemoveMaterial(uint32_t MaterialId);               // Caller must make sure no frame in flight still draws with it
+    const MaterialData& GetMaterial(uint32_t MaterialId) const;
+
+    void ReplaceTextureSlot(uint32_t OldSlot, uint32_t NewSlot);   // Point every material using OldSlot at NewSlot
+
+private:
+    VkDevice Device = VK_NULL_HANDLE;
+    VkBuffer Buffer = VK_NULL_HANDLE;
+    VkDeviceMemory BufferMemory = VK_NULL_HANDLE;
+    MaterialData* MappedMaterials = nullptr;
+    std::vector<MaterialData> Materials;                    // CPU copy, so lookups never read back from mapped memory
+
+    uint32_t Capacity = 0;
+    uint32_t NextUnused = 0;
+    std::vector<uint32_t> FreeIds;
+};
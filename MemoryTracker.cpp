@@ -0,0 +1,233 @@
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+    struct TrackedAllocation
+    {
+        MemoryCategory Category;
+        VkDeviceSize RequestedSize;
+        VkDeviceSize AllocatedSize;
+        uint32_t MemoryTypeIndex;
+    };
+
+    std::mutex TrackerMutex;
+    VkPhysicalDevice TrackedPhysicalDevice = VK_NULL_HANDLE;
+    bool bUseMemoryBudget = false;
+    std::unordered_map<VkDeviceMemory, TrackedAllocation> Allocations;
+    MemorySnapshot Current;                             // Kept up to date as allocations come and go
+
+    uint32_t ReportInterval = 0;
+    std::string ReportPath;
+
+    const char* const CATEGORY_NAMES[] = { "MeshVertex", "MeshIndex", "Staging", "Uniform", "Storage", "Texture", "RenderTarget" };
+    static_assert(sizeof(CATEGORY_NAMES) / sizeof(CATEGORY_NAMES[0]) == static_cast<size_t>(MemoryCategory::Count), "Every memory category needs a name");
+
+    double ToMiB(VkDeviceSize Bytes)
+    {
+        return static_cast<double>(Bytes) / (1024.0 * 1024.0);
+    }
+}
+
+void MemoryTracker::Initialise(VkPhysicalDevice PhysicalDevice, bool bMemoryBudgetEnabled)
+{
+    std::lock_guard<std::mutex> Lock(TrackerMutex);
+    TrackedPhysicalDevice = PhysicalDevice;
+    bUseMemoryBudget = bMemoryBudgetEnabled;
+    Allocations.clear();
+
+    VkPhysicalDeviceMemoryProperties MemoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &MemoryProperties);
+
+    Current = {};
+    Current.Types.resize(MemoryProperties.memoryTypeCount);
+    for (uint32_t i = 0; i < MemoryProperties.memoryTypeCount; i++)
+    {
+        Current.Types[i].PropertyFlags = MemoryProperties.memoryTypes[i].propertyFlags;
+        Current.Types[i].HeapIndex = MemoryProperties.memoryTypes[i].heapIndex;
+    }
+    Current.Heaps.resize(MemoryProperties.memoryHeapCount);
+    for (uint32_t i = 0; i < MemoryProperties.memoryHeapCount; i++)
+    {
+        Current.Heaps[i].Size = MemoryProperties.memoryHeaps[i].size;
+        Current.Heaps[i].Flags = MemoryProperties.memoryHeaps[i].flags;
+    }
+}
+
+void MemoryTracker::TrackAllocation(VkDeviceMemory Memory, MemoryCategory Category, VkDeviceSize RequestedSize, VkDeviceSize AllocatedSize, uint32_t MemoryTypeIndex)
+{
+    std::lock_guard<std::mutex> Lock(TrackerMutex);
+    if (MemoryTypeIndex >= Current.Types.size()) return;            // Not initialised for this device
+
+    Allocations[Memory] = { Category, RequestedSize, AllocatedSize, MemoryTypeIndex };
+
+    MemoryCategoryStats& Stats = Current.Categories[static_cast<size_t>(Category)];
+    Stats.Allocations++;
+    Stats.AllocatedBytes += AllocatedSize;
+    Stats.RequestedBytes += RequestedSize;
+    Stats.PeakAllocatedBytes = std::max(Stats.PeakAllocatedBytes, Stats.AllocatedBytes);
+    Stats.TotalAllocations++;
+
+    MemoryTypeStats& Type = Current.Types[MemoryTypeIndex];
+    Type.Allocations++;
+    Type.AllocatedBytes += AllocatedSize;
+    Current.Heaps[Type.HeapIndex].TrackedBytes += AllocatedSize;
+}
+
+void MemoryTracker::TrackFree(VkDeviceMemory Memory)
+{
+    std::lock_guard<std::mutex> Lock(TrackerMutex);
+    auto Found = Allocations.find(Memory);
+    if (Found == Allocations.end()) return;
+
+    const TrackedAllocation& Allocation = Found->second;
+    MemoryCategoryStats& Stats = Current.Categories[static_cast<size_t>(Allocation.Category)];
+    Stats.Allocations--;
+    Stats.AllocatedBytes -= Allocation.AllocatedSize;
+    Stats.RequestedBytes -= Allocation.RequestedSize;
+    Stats.TotalFrees++;
+
+    MemoryTypeStats& Type = Current.Types[Allocation.MemoryTypeIndex];
+    Type.Allocations--;
+    Type.AllocatedBytes -= Allocation.AllocatedSize;
+    Current.Heaps[Type.HeapIndex].TrackedBytes -= Allocation.AllocatedSize;
+
+    Allocations.erase(Found);
+}
+
+void MemoryTracker::BeginFrame()
+{
+    MemorySnapshot Snapshot;
+    bool bReport = false;
+    std::string JsonPath;
+    {
+        std::lock_guard<std::mutex> Lock(TrackerMutex);
+        Current.Frame++;
+
+        if (bUseMemoryBudget)
+        {
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT MemoryBudget = {};
+            MemoryBudget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+            VkPhysicalDeviceMemoryProperties2 MemoryProperties = {};
+            MemoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            MemoryProperties.pNext = &MemoryBudget;
+            vkGetPhysicalDeviceMemoryProperties2(TrackedPhysicalDevice, &MemoryProperties);
+
+            for (size_t Heap = 0; Heap < Current.Heaps.size(); Heap++)
+            {
+                Current.Heaps[Heap].Budget = MemoryBudget.heapBudget[Heap];
+                Current.Heaps[Heap].Usage = MemoryBudget.heapUsage[Heap];
+            }
+        }
+
+        bReport = ReportInterval > 0 && Current.Frame % ReportInterval == 0;
+        if (bReport)
+        {
+            Snapshot = Current;
+            JsonPath = ReportPath;
+        }
+    }
+
+    // Outside the lock, writing the file is slow
+    if (!bReport) return;
+    Print(Snapshot);
+    if (!JsonPath.empty())
+    {
+        std::ofstream File(JsonPath, std::ios::trunc);
+        File << ToJson(Snapshot);
+    }
+}
+
+void MemoryTracker::SetReport(uint32_t IntervalFrames, const std::string& JsonPath)
+{
+    std::lock_guard<std::mutex> Lock(TrackerMutex);
+    ReportInterval = IntervalFrames;
+    ReportPath = JsonPath;
+}
+
+MemorySnapshot MemoryTracker::GetSnapshot()
+{
+    std::lock_guard<std::mutex> Lock(TrackerMutex);
+    return Current;
+}
+
+std::string MemoryTracker::ToJson(const MemorySnapshot& Snapshot)
+{
+    std::ostringstream Json;
+    Json << "{\n  \"frame\": " << Snapshot.Frame << ",\n  \"categories\": {";
+    for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); i++)
+    {
+        const MemoryCategoryStats& Stats = Snapshot.Categories[i];
+        Json << (i ? ",\n" : "\n") << "    \"" << CATEGORY_NAMES[i] << "\": { \"allocations\": " << Stats.Allocations
+             << ", \"allocatedBytes\": " << Stats.AllocatedBytes << ", \"requestedBytes\": " << Stats.RequestedBytes
+             << ", \"wasteBytes\": " << Stats.AllocatedBytes - Stats.RequestedBytes << ", \"peakAllocatedBytes\": " << Stats.PeakAllocatedBytes
+             << ", \"totalAllocations\": " << Stats.TotalAllocations << ", \"totalFrees\": " << Stats.TotalFrees << " }";
+    }
+    Json << "\n  },\n  \"memoryTypes\": [";
+    for (size_t i = 0; i < Snapshot.Types.size(); i++)
+    {
+        const MemoryTypeStats& Type = Snapshot.Types[i];
+        Json << (i ? ",\n" : "\n") << "    { \"index\": " << i << ", \"propertyFlags\": " << Type.PropertyFlags << ", \"heap\": " << Type.HeapIndex
+             << ", \"allocations\": " << Type.Allocations << ", \"allocatedBytes\": " << Type.AllocatedBytes << " }";
+    }
+    Json << "\n  ],\n  \"heaps\": [";
+    for (size_t i = 0; i < Snapshot.Heaps.size(); i++)
+    {
+        const MemoryHeapStats& Heap = Snapshot.Heaps[i];
+        Json << (i ? ",\n" : "\n") << "    { \"index\": " << i << ", \"deviceLocal\": " << ((Heap.Flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false")
+             << ", \"size\": " << Heap.Size << ", \"trackedBytes\": " << Heap.TrackedBytes << ", \"budget\": " << Heap.Budget
+             << ", \"usage\": " << Heap.Usage << " }";
+    }
+    Json << "\n  ]\n}\n";
+    return Json.str();
+}
+
+void MemoryTracker::Print(const MemorySnapshot& Snapshot)
+{
+    std::ostringstream Text;
+    Text.setf(std::ios::fixed);
+    Text.precision(2);
+
+    Text << "GPU memory, frame " << Snapshot.Frame << ":\n";
+    for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); i++)
+    {
+        const MemoryCategoryStats& Stats = Snapshot.Categories[i];
+        if (Stats.TotalAllocations == 0) continue;
+        Text << "  " << CATEGORY_NAMES[i] << ": " << Stats.Allocations << " allocations, " << ToMiB(Stats.AllocatedBytes) << " MiB ("
+             << ToMiB(Stats.AllocatedBytes - Stats.RequestedBytes) << " MiB waste), peak " << ToMiB(Stats.PeakAllocatedBytes) << " MiB, "
+             << Stats.TotalAllocations << " allocated / " << Stats.TotalFrees << " freed overall\n";
+    }
+    for (size_t i = 0; i < Snapshot.Heaps.size(); i++)
+    {
+        const MemoryHeapStats& Heap = Snapshot.Heaps[i];
+        Text << "  Heap " << i << ((Heap.Flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "") << ": "
+             << ToMiB(Heap.TrackedBytes) << " MiB tracked";
+        if (Heap.Budget > 0) Text << ", " << ToMiB(Heap.Usage) << " of " << ToMiB(Heap.Budget) << " MiB budget used";
+        Text << ", " << ToMiB(Heap.Size) << " MiB heap\n";
+    }
+    std::cout << Text.str();
+}
+
+void MemoryTracker::ReportLeaks()
+{
+    MemorySnapshot Snapshot = GetSnapshot();
+    for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); i++)
+    {
+        const MemoryCategoryStats& Stats = Snapshot.Categories[i];
+        if (Stats.Allocations == 0) continue;
+        std::cout << "GPU memory leak: " << Stats.Allocations << " " << CATEGORY_NAMES[i] << " allocations ("
+                  << Stats.AllocatedBytes << " bytes) still allocated" << std::endl;
+    }
+}
+
+const char* MemoryTracker::GetCategoryName(MemoryCategory Category)
+{
+    return CATEGORY_NAMES[static_cast<size_t>(Category)];
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// What an allocation holds, every vkAllocateMemory is tagged with one
+enum class MemoryCategory : uint32_t
+{
+    MeshVertex,
+    MeshIndex,
+    Staging,                                            // Host visible upload buffers, freed once the copy is done
+    Uniform,
+    Storage,                                            // Material table, mip generation scratch
+    Texture,
+    RenderTarget,                                       // Render graph transient attachments
+    Count
+};
+
+struct MemoryCategoryStats
+{
+    uint32_t Allocations = 0;                           // Live
+    VkDeviceSize AllocatedBytes = 0;                    // Live, as allocated (the resource's memory requirement)
+    VkDeviceSize RequestedBytes = 0;                    // Live, as asked for. The difference is alignment and padding waste
+    VkDeviceSize PeakAllocatedBytes = 0;
+    uint64_t TotalAllocations = 0;                      // Lifetime. Allocations that keep growing with frees lagging behind are a leak
+    uint64_t TotalFrees = 0;
+};
+
+struct MemoryTypeStats
+{
+    VkMemoryPropertyFlags PropertyFlags = 0;
+    uint32_t HeapIndex = 0;
+    uint32_t Allocations = 0;                           // Live
+    VkDeviceSize AllocatedBytes = 0;
+};
+
+struct MemoryHeapStats
+{
+    VkDeviceSize Size = 0;
+    VkMemoryHeapFlags Flags = 0;
+    VkDeviceSize TrackedBytes = 0;                      // Allocated by the renderer
+    VkDeviceSize Budget = 0;                            // From VK_EXT_memory_budget, 0 without it
+    VkDeviceSize Usage = 0;                             // Whole process as the driver sees it, 0 without VK_EXT_memory_budget
+};
+
+struct MemorySnapshot
+{
+    uint64_t Frame = 0;
+    MemoryCategoryStats Categories[static_cast<size_t>(MemoryCategory::Count)];
+    std::vector<MemoryTypeStats> Types;
+    std::vector<MemoryHeapStats> Heaps;
+};
+
+// Process wide record of device memory: every allocation by category and memory type, and each heap's budget and
+// usage (VK_EXT_memory_budget, queried once a frame). Thread safe, allocations happen on startup workers and the
+// render thread alike. Optionally prints a summary and writes it as JSON every few frames, and reports what is still
+// allocated when the device is destroyed
+class MemoryTracker
+{
+public:
+    // Once per device, before anything is allocated
+    static void Initialise(VkPhysicalDevice PhysicalDevice, bool bMemoryBudgetEnabled);
+
+    static void TrackAllocation(VkDeviceMemory Memory, MemoryCategory Category, VkDeviceSize RequestedSize, VkDeviceSize AllocatedSize, uint32_t MemoryTypeIndex);
+    static void TrackFree(VkDeviceMemory Memory);
+
+    // Refreshes the heap budgets, then reports if a report is due
+    static void BeginFrame();
+
+    // Print (and write JsonPath, if not empty) every IntervalFrames frames, 0 disables
+    static void SetReport(uint32_t IntervalFrames, const std::string& JsonPath = "");
+
+    static MemorySnapshot GetSnapshot();
+    static std::string ToJson(const MemorySnapshot& Snapshot);
+    static void Print(const MemorySnapshot& Snapshot);
+    static void ReportLeaks();                          // Call once everything should have been freed
+
+    static const char* GetCategoryName(MemoryCategory Category);
+};
@@ -1,6 +1,8 @@
 
 #include "Mesh.h"
 
+#include "TransformKernels.h"
+
 Mesh::~Mesh()
 {
 
@@ -19,38 +21,52 @@ Mesh::Mesh(VkPhysicalDevice NewPhysicalDevice, VkDevice NewDevice, VkQueue Trans
     PhysicalDevice = NewPhysicalDevice;
     Device = NewDevice;
 
+    // Positions only live on the GPU after the upload, bound them now
+    Bounds = ComputeVertexBounds(Vertices->data(), Vertices->size());
+    BoundingSphere = ComputeBoundingSphere(Vertices->data(), Vertices->size(), Bounds);
+
     CreateVertexBuffer(TransferQueue, TransferCommandPool, Vertices);
     CreateIndexBuffer(TransferQueue, TransferCommandPool, Indices);
 }
 void Mesh::DestroyMeshBuffers()
 {
     vkDestroyBuffer(Device, VertexBuffer, nullptr);
-    vkFreeMemory(Device, VertexBufferMemory, nullptr);
+    FreeDeviceMemory(Device, VertexBufferMemory);
 
     vkDestroyBuffer(Device, IndexBuffer, nullptr);
-    vkFreeMemory(Device, IndexBufferMemory, nullptr);
+    FreeDeviceMemory(Device, IndexBufferMemory);
 }
 
-int Mesh::GetVertexCount()
+int Mesh::GetVertexCount() const
 {
     return VertexCount;
 }
 
-VkBuffer Mesh::GetVertexBuffer()
+VkBuffer Mesh::GetVertexBuffer() const
 {
     return VertexBuffer;
 }
 
-int Mesh::GetIndexCount()
+int Mesh::GetIndexCount() const
 {
     return IndexCount;
 }
 
-VkBuffer Mesh::GetIndexBuffer()
+VkBuffer Mesh::GetIndexBuffer() const
 {
     return IndexBuffer;
 }
 
+const BoundingBox& Mesh::GetBounds() const
+{
+    return Bounds;
+}
+
+const glm::vec4& Mesh::GetBoundingSphere() const
+{
+    return BoundingSphere;
+}
+
 void Mesh::CreateVertexBuffer(VkQueue TransferQueue, VkCommandPool TransferCommandPool, std::vector<Vertex>* Vertices)
 {
     VkDeviceSize BufferSize = sizeof(Vertex) * Vertices->size();
@@ -63,7 +79,7 @@ void Mesh::CreateVertexBuffer(VkQueue TransferQueue, VkCommandPool TransferComma
     CreateBuffer(PhysicalDevice, Device, BufferSize,
                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 &StagingBuffer, &StagingBufferMemory);
+                 &StagingBuffer, &StagingBufferMemory, MemoryCategory::Staging);
 
     // MAP MEMORY TO BUFFER
     void* data;                                                                       // 1. Create pointer to a point in normal memory
@@ -75,15 +91,16 @@ void Mesh::CreateVertexBuffer(VkQueue TransferQueue, VkCommandPool TransferComma
     CreateBuffer(PhysicalDevice, Device, BufferSize,
                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,                   // Local to device, only visible to the GPU. Allows it to me optimized for GPU access
-                 &VertexBuffer, &VertexBufferMemory);
+                 &VertexBuffer, &VertexBufferMemory, MemoryCategory::MeshVertex);
 
     // Copy staging buffer to vertex buffer on gpu
-    CopyBuffer(Device, TransferQueue, TransferCommandPool, StagingBuffer, VertexBuffer, BufferSize);
+    CopyBuffer(Device, TransferQueue, TransferCommandPool, StagingBuffer, VertexBuffer, BufferSize,
+               VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR);
 
 
     // Clean up tempory staging buffer;
     vkDestroyBuffer(Device, StagingBuffer, nullptr);
-    vkFreeMemory(Device, StagingBufferMemory, nullptr);
+    FreeDeviceMemory(Device, StagingBufferMemory);
 }
 
 void Mesh::CreateIndexBuffer(VkQueue TransferQueue, VkCommandPool TransferCommandPool, std::vector<uint32_t>* Indices)
@@ -97,7 +114,7 @@ void Mesh::CreateIndexBuffer(VkQueue TransferQueue, VkCommandPool TransferComman
     CreateBuffer(PhysicalDevice, Device, BufferSize,
                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 &StagingBuffer, &StagingBufferMemory);
+                 &StagingBuffer, &StagingBufferMemory, MemoryCategory::Staging);
 
     // Map Memory to index buffer
     void* data;
@@ -109,14 +126,15 @@ void Mesh::CreateIndexBuffer(VkQueue TransferQueue, VkCommandPool TransferComman
     CreateBuffer(PhysicalDevice, Device, BufferSize,
                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                 &IndexBuffer, &IndexBufferMemory);
+                 &IndexBuffer, &IndexBufferMemory, MemoryCategory::MeshIndex);
 
     //Copy from staging buffer to GPU access buffer
-    CopyBuffer(Device, TransferQueue, TransferCommandPool, StagingBuffer, IndexBuffer, BufferSize);
+    CopyBuffer(Device, TransferQueue, TransferCommandPool, StagingBuffer, IndexBuffer, BufferSize,
+               VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT_KHR, VK_ACCESS_2_INDEX_READ_BIT_KHR);
 
     //Destroy and realease staging buffer resources
     vkDestroyBuffer(Device, StagingBuffer, nullptr);
-    vkFreeMemory(Device, StagingBufferMemory, nullptr);
+    FreeDeviceMemory(Device, StagingBufferMemory);
 }
 
 
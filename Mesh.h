@@ -16,11 +16,15 @@ public:
     Mesh(VkPhysicalDevice NewPhysicalDevice, VkDevice NewDevice, VkQueue TransferQueue, VkCommandPool TransferCommandPool, std::vector<Vertex>* Vertices, std::vector<uint32_t>* Indices);
     void DestroyMeshBuffers();
 
-    int GetVertexCount();
-    VkBuffer GetVertexBuffer();
+    int GetVertexCount() const;
+    VkBuffer GetVertexBuffer() const;
 
-    int GetIndexCount();
-    VkBuffer GetIndexBuffer();
+    int GetIndexCount() const;
+    VkBuffer GetIndexBuffer() const;
+
+    // Object space bounds of the vertex positions, kept on the CPU for culling, picking and LOD selection
+    const BoundingBox& GetBounds() const;
+    const glm::vec4& GetBoundingSphere() const;       // xyz centre, w radius
 
 private:
     int VertexCount;
@@ -31,6 +35,9 @@ private:
     VkBuffer IndexBuffer;
     VkDeviceMemory IndexBufferMemory;
 
+    BoundingBox Bounds;
+    glm::vec4 BoundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, std::numeric_limits<float>::max());
+
     VkPhysicalDevice PhysicalDevice;
     VkDevice Device;
 
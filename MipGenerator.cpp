@@ -0,0 +1,410 @@
+#include "MipGenerator.h"
+#include "ShaderReflection.h"
+#include "EmbeddedShaders.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+// Level 6 of the largest image the compute path takes (4096 >> 6), as vec4s
+const VkDeviceSize LEVEL6_REGION_SIZE = 64 * 64 * 4 * sizeof(float);
+const uint32_t DOWNSAMPLE_BLOCK_SIZE = 64;              // Level 0 texels covered by one work group, per axis
+
+MipGenerator::MipGenerator()
+{
+}
+
+MipGenerator::~MipGenerator()
+{
+}
+
+void MipGenerator::Create(VkPhysicalDevice NewPhysicalDevice, VkDevice NewDevice, PipelineLayoutCache* NewLayoutCache, bool bComputeSupported)
+{
+    PhysicalDevice = NewPhysicalDevice;
+    Device = NewDevice;
+    LayoutCache = NewLayoutCache;
+    bComputeEnabled = bComputeSupported;
+
+    if (bComputeEnabled) CreateComputePipeline();
+}
+
+void MipGenerator::Destroy()
+{
+    for (auto& Resources : Pending)
+    {
+        vkWaitForFences(Device, 1, &Resources.Fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+    CollectGarbage();
+
+    if (!bComputeEnabled) return;
+
+    vkDestroyBuffer(Device, Level6Buffer, nullptr);
+    FreeDeviceMemory(Device, Level6BufferMemory);
+    vkDestroyBuffer(Device, CounterBuffer, nullptr);
+    FreeDeviceMemory(Device, CounterBufferMemory);
+    vkDestroySampler(Device, Sampler, nullptr);
+    vkDestroyPipeline(Device, Pipeline, nullptr);
+}
+
+MipGenerationPath MipGenerator::GetPath(VkFormat Format, uint32_t Width, uint32_t Height) const
+{
+    VkFormatProperties FormatProperties;
+    vkGetPhysicalDeviceFormatProperties(PhysicalDevice, Format, &FormatProperties);
+    VkFormatFeatureFlags Features = FormatProperties.optimalTilingFeatures;
+
+    VkFormatFeatureFlags BlitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((Features & BlitFeatures) == BlitFeatures) return MipGenerationPath::Blit;
+
+    VkFormatFeatureFlags ComputeFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+    if (bComputeEnabled && (Features & ComputeFeatures) == ComputeFeatures && std::max(Width, Height) <= (1u << MAX_COMPUTE_MIPS))
+    {
+        return MipGenerationPath::Compute;
+    }
+
+    return MipGenerationPath::None;
+}
+
+VkImageUsageFlags MipGenerator::GetRequiredUsage(MipGenerationPath Path) const
+{
+    switch (Path)
+    {
+    case MipGenerationPath::Blit:       return VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    case MipGenerationPath::Compute:    return VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    default:                            return 0;
+    }
+}
+
+void MipGenerator::Record(VkCommandBuffer CommandBuffer, const std::vector<MipChainImage>& Images, VkFence CompletionFence)
+{
+    std::vector<const MipChainImage*> BlitImages;
+    std::vector<const MipChainImage*> ComputeImages;
+
+    for (const auto& Image : Images)
+    {
+        switch (GetPath(Image.Format, Image.Width, Image.Height))
+        {
+        case MipGenerationPath::Blit:       BlitImages.push_back(&Image); break;
+        case MipGenerationPath::Compute:    ComputeImages.push_back(&Image); break;
+        default:                            throw std::runtime_error("Can't generate mips for this image format");
+        }
+    }
+
+    if (!BlitImages.empty()) RecordBlits(CommandBuffer, BlitImages);
+    if (!ComputeImages.empty()) RecordCompute(CommandBuffer, ComputeImages, CompletionFence);
+}
+
+void MipGenerator::CollectGarbage()
+{
+    for (size_t i = 0; i < Pending.size();)
+    {
+        if (vkGetFenceStatus(Device, Pending[i].Fence) == VK_SUCCESS)
+        {
+            for (auto ImageView : Pending[i].ImageViews)
+            {
+                vkDestroyImageView(Device, ImageView, nullptr);
+            }
+            vkDestroyDescriptorPool(Device, Pending[i].DescriptorPool, nullptr);
+
+            Pending[i] = Pending.back();
+            Pending.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void MipGenerator::CreateComputePipeline()
+{
+    auto ComputeShaderCode = GetEmbeddedShader(DOWNSAMPLE_COMP_SPIRV);
+
+    // -- LAYOUTS --
+    // Bindings (source, MAX_COMPUTE_MIPS storage levels, counters, level 6) come from downsample.comp itself
+    ShaderReflection Reflection;
+    Reflection.AddStage(ComputeShaderCode);
+
+    std::vector<VkPushConstantRange> PushRanges = Reflection.GetPushConstantRanges();
+    if (PushRanges.size() != 1 || PushRanges[0].size != ParamsPushConstant.GetRange().size) throw std::runtime_error("Downsample shader push constants don't match DownsampleParams");
+
+    DescriptorSetLayout = LayoutCache->GetDescriptorSetLayout(Reflection.GetSetBindings(0));
+    PipelineLayout = LayoutCache->GetPipelineLayout({ DescriptorSetLayout }, PushRanges);
+
+    // -- PIPELINE --
+    VkShaderModuleCreateInfo ShaderModuleCreateInfo = {};
+    ShaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    ShaderModuleCreateInfo.codeSize = ComputeShaderCode.size();
+    ShaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(ComputeShaderCode.data());
+
+    VkShaderModule ComputeShaderModule;
+    VkResult Result = vkCreateShaderModule(Device, &ShaderModuleCreateInfo, nullptr, &ComputeShaderModule);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to Create ShaderModule!");
+
+    VkComputePipelineCreateInfo PipelineCreateInfo = {};
+    PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    PipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    PipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    PipelineCreateInfo.stage.module = ComputeShaderModule;
+    PipelineCreateInfo.stage.pName = "main";
+    PipelineCreateInfo.layout = PipelineLayout;
+
+    Result = vkCreateComputePipelines(Device, VK_NULL_HANDLE, 1, &PipelineCreateInfo, nullptr, &Pipeline);
+    vkDestroyShaderModule(Device, ComputeShaderModule, nullptr);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create Mip Generator Pipeline");
+
+    // -- SAMPLER --
+    // Level 0 is only read with texelFetch, the compute path is for formats without linear filtering
+    VkSamplerCreateInfo SamplerCreateInfo = {};
+    SamplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    SamplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+    SamplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+    SamplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    SamplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    SamplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    SamplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+
+    Result = vkCreateSampler(Device, &SamplerCreateInfo, nullptr, &Sampler);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create Mip Generator Sampler");
+
+    // -- BUFFERS --
+    // Counters start at zero and the shader puts them back to zero when it's done with them
+    VkDeviceSize CounterBufferSize = MAX_COMPUTE_MIP_IMAGES * sizeof(uint32_t);
+    CreateBuffer(PhysicalDevice, Device, CounterBufferSize,
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &CounterBuffer, &CounterBufferMemory, MemoryCategory::Storage);
+
+    void* Data;
+    vkMapMemory(Device, CounterBufferMemory, 0, CounterBufferSize, 0, &Data);
+    memset(Data, 0, static_cast<size_t>(CounterBufferSize));
+    vkUnmapMemory(Device, CounterBufferMemory);
+
+    CreateBuffer(PhysicalDevice, Device, MAX_COMPUTE_MIP_IMAGES * LEVEL6_REGION_SIZE,
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 &Level6Buffer, &Level6BufferMemory, MemoryCategory::Storage);
+}
+
+void MipGenerator::RecordBlits(VkCommandBuffer CommandBuffer, const std::vector<const MipChainImage*>& Images)
+{
+    uint32_t MaxLevels = 0;
+    for (const auto* Image : Images)
+    {
+        MaxLevels = std::max(MaxLevels, Image->MipLevels);
+    }
+
+    // Level 0 was copied in, every later level is written by the blit before it
+    const VkPipelineStageFlags2KHR WriteStages = VK_PIPELINE_STAGE_2_COPY_BIT_KHR | VK_PIPELINE_STAGE_2_BLIT_BIT_KHR;
+    BarrierBatch Barriers;
+
+    // Level by level across every image, so each level costs one barrier call however many images there are
+    for (uint32_t Level = 1; Level < MaxLevels; Level++)
+    {
+        // Previous level was just written, make it the blit source
+        for (const auto* Image : Images)
+        {
+            if (Level >= Image->MipLevels) continue;
+
+            Barriers.AddImageBarrier(Image->Image, { VK_IMAGE_ASPECT_COLOR_BIT, Level - 1, 1, 0, 1 },
+                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                     WriteStages, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_BLIT_BIT_KHR, VK_ACCESS_2_TRANSFER_READ_BIT_KHR);
+        }
+        Barriers.Flush(CommandBuffer, "Mip blit level");
+
+        for (const auto* Image : Images)
+        {
+            if (Level >= Image->MipLevels) continue;
+
+            int32_t SourceWidth = static_cast<int32_t>(std::max(1u, Image->Width >> (Level - 1)));
+            int32_t SourceHeight = static_cast<int32_t>(std::max(1u, Image->Height >> (Level - 1)));
+
+            VkImageBlit Blit = {};
+            Blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, Level - 1, 0, 1 };
+            Blit.srcOffsets[1] = { SourceWidth, SourceHeight, 1 };
+            Blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, Level, 0, 1 };
+            Blit.dstOffsets[1] = { std::max(1, SourceWidth / 2), std::max(1, SourceHeight / 2), 1 };
+
+            vkCmdBlitImage(CommandBuffer,
+                           Image->Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           Image->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1, &Blit, VK_FILTER_LINEAR);
+        }
+    }
+
+    // Everything to SHADER_READ_ONLY: the blit sources (only read since, so no memory to make available),
+    // then each image's last level (still a blit destination)
+    for (const auto* Image : Images)
+    {
+        if (Image->MipLevels > 1)
+        {
+            Barriers.AddImageBarrier(Image->Image, { VK_IMAGE_ASPECT_COLOR_BIT, 0, Image->MipLevels - 1, 0, 1 },
+                                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                     VK_PIPELINE_STAGE_2_BLIT_BIT_KHR, VK_ACCESS_2_NONE_KHR, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR);
+        }
+
+        Barriers.AddImageBarrier(Image->Image, { VK_IMAGE_ASPECT_COLOR_BIT, Image->MipLevels - 1, 1, 0, 1 },
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 WriteStages, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR);
+    }
+    Barriers.Flush(CommandBuffer, "Mip blit done");
+}
+
+void MipGenerator::RecordCompute(VkCommandBuffer CommandBuffer, const std::vector<const MipChainImage*>& Images, VkFence CompletionFence)
+{
+    if (Images.size() > MAX_COMPUTE_MIP_IMAGES) throw std::runtime_error("Too many images for one compute mip batch");
+
+    uint32_t ImageCount = static_cast<uint32_t>(Images.size());
+
+    // -- DESCRIPTORS --
+    // Pool and views live until CompletionFence signals
+    PendingResources Resources = {};
+    Resources.Fence = CompletionFence;
+
+    std::array<VkDescriptorPoolSize, 3> PoolSizes = {};
+    PoolSizes[0] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, ImageCount };
+    PoolSizes[1] = { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, ImageCount * MAX_COMPUTE_MIPS };
+    PoolSizes[2] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, ImageCount * 2 };
+
+    VkDescriptorPoolCreateInfo PoolCreateInfo = {};
+    PoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    PoolCreateInfo.maxSets = ImageCount;
+    PoolCreateInfo.poolSizeCount = static_cast<uint32_t>(PoolSizes.size());
+    PoolCreateInfo.pPoolSizes = PoolSizes.data();
+
+    VkResult Result = vkCreateDescriptorPool(Device, &PoolCreateInfo, nullptr, &Resources.DescriptorPool);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create Mip Generator Descriptor Pool");
+
+    std::vector<VkDescriptorSetLayout> SetLayouts(ImageCount, DescriptorSetLayout);
+    std::vector<VkDescriptorSet> DescriptorSets(ImageCount);
+
+    VkDescriptorSetAllocateInfo SetAllocateInfo = {};
+    SetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    SetAllocateInfo.descriptorPool = Resources.DescriptorPool;
+    SetAllocateInfo.descriptorSetCount = ImageCount;
+    SetAllocateInfo.pSetLayouts = SetLayouts.data();
+
+    Result = vkAllocateDescriptorSets(Device, &SetAllocateInfo, DescriptorSets.data());
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to allocate Mip Generator Descriptor Sets");
+
+    for (uint32_t i = 0; i < ImageCount; i++)
+    {
+        const MipChainImage& Image = *Images[i];
+
+        VkDescriptorImageInfo SourceInfo = {};
+        SourceInfo.sampler = Sampler;
+        SourceInfo.imageView = CreateLevelView(Image.Image, Image.Format, 0);
+        SourceInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        Resources.ImageViews.push_back(SourceInfo.imageView);
+
+        // Unused entries repeat the last level, the shader never writes past MipCount
+        std::array<VkDescriptorImageInfo, MAX_COMPUTE_MIPS> MipInfos = {};
+        for (uint32_t Level = 1; Level <= MAX_COMPUTE_MIPS; Level++)
+        {
+            if (Level < Image.MipLevels)
+            {
+                Resources.ImageViews.push_back(CreateLevelView(Image.Image, Image.Format, Level));
+            }
+            MipInfos[Level - 1].imageView = Resources.ImageViews.back();
+            MipInfos[Level - 1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        VkDescriptorBufferInfo CounterInfo = { CounterBuffer, 0, VK_WHOLE_SIZE };
+        VkDescriptorBufferInfo Level6Info = { Level6Buffer, i * LEVEL6_REGION_SIZE, LEVEL6_REGION_SIZE };
+
+        std::array<VkWriteDescriptorSet, 4> SetWrites = {};
+        for (uint32_t Binding = 0; Binding < SetWrites.size(); Binding++)
+        {
+            SetWrites[Binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            SetWrites[Binding].dstSet = DescriptorSets[i];
+            SetWrites[Binding].dstBinding = Binding;
+            SetWrites[Binding].descriptorCount = 1;
+            SetWrites[Binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+        SetWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        SetWrites[0].pImageInfo = &SourceInfo;
+        SetWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        SetWrites[1].descriptorCount = MAX_COMPUTE_MIPS;
+        SetWrites[1].pImageInfo = MipInfos.data();
+        SetWrites[2].pBufferInfo = &CounterInfo;
+        SetWrites[3].pBufferInfo = &Level6Info;
+
+        vkUpdateDescriptorSets(Device, static_cast<uint32_t>(SetWrites.size()), SetWrites.data(), 0, nullptr);
+    }
+
+    Pending.push_back(Resources);
+
+    // -- BARRIERS BEFORE --
+    // Level 0 is read, the rest written. The buffer barriers order the shared counter and level 6 buffers after earlier batches
+    BarrierBatch Barriers;
+    for (const auto* Image : Images)
+    {
+        Barriers.AddImageBarrier(Image->Image, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR);
+
+        if (Image->MipLevels > 1)
+        {
+            Barriers.AddImageBarrier(Image->Image, { VK_IMAGE_ASPECT_COLOR_BIT, 1, Image->MipLevels - 1, 0, 1 },
+                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+                                     VK_PIPELINE_STAGE_2_NONE_KHR, VK_ACCESS_2_NONE_KHR, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR);
+        }
+    }
+
+    const VkAccessFlags2KHR StorageAccess = VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR;
+    Barriers.AddBufferBarrier(CounterBuffer, 0, VK_WHOLE_SIZE,
+                              VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, StorageAccess);
+    Barriers.AddBufferBarrier(Level6Buffer, 0, VK_WHOLE_SIZE,
+                              VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, StorageAccess);
+    Barriers.Flush(CommandBuffer, "Mip compute");
+
+    // -- DISPATCH --
+    // One dispatch per image covers its whole chain
+    vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline);
+    for (uint32_t i = 0; i < ImageCount; i++)
+    {
+        const MipChainImage& Image = *Images[i];
+        uint32_t GroupsX = (Image.Width + DOWNSAMPLE_BLOCK_SIZE - 1) / DOWNSAMPLE_BLOCK_SIZE;
+        uint32_t GroupsY = (Image.Height + DOWNSAMPLE_BLOCK_SIZE - 1) / DOWNSAMPLE_BLOCK_SIZE;
+
+        DownsampleParams Params = {};
+        Params.MipCount = Image.MipLevels - 1;
+        Params.WorkGroupCount = GroupsX * GroupsY;
+        Params.CounterIndex = i;
+
+        vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, PipelineLayout, 0, 1, &DescriptorSets[i], 0, nullptr);
+        ParamsPushConstant.Push(CommandBuffer, PipelineLayout, Params);
+        vkCmdDispatch(CommandBuffer, GroupsX, GroupsY, 1);
+    }
+
+    // -- BARRIERS AFTER --
+    for (const auto* Image : Images)
+    {
+        if (Image->MipLevels <= 1) continue;
+
+        Barriers.AddImageBarrier(Image->Image, { VK_IMAGE_ASPECT_COLOR_BIT, 1, Image->MipLevels - 1, 0, 1 },
+                                 VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR);
+    }
+    Barriers.Flush(CommandBuffer, "Mip compute done");
+}
+
+VkImageView MipGenerator::CreateLevelView(VkImage Image, VkFormat Format, uint32_t Level)
+{
+    VkImageViewCreateInfo ImageViewCreateInfo = {};
+    ImageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    ImageViewCreateInfo.image = Image;
+    ImageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    ImageViewCreateInfo.format = Format;
+    ImageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ImageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ImageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ImageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ImageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, Level, 1, 0, 1 };     // Just the one level
+
+    VkImageView ImageView;
+    VkResult Result = vkCreateImageView(Device, &ImageViewCreateInfo, nullptr, &ImageView);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create Mip Level ImageView");
+
+    return ImageView;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "Utilities.h"
+#include "PushConstants.h"
+#include "PipelineLayoutCache.h"
+
+const uint32_t MAX_COMPUTE_MIPS = 12;                   // Levels the compute downsampler writes after level 0 (MAX_MIPS in downsample.comp)
+const uint32_t MAX_COMPUTE_MIP_IMAGES = 32;             // Images one batch can send down the compute path
+
+// An image whose level 0 is filled and whose other levels should be generated from it
+struct MipChainImage
+{
+    VkImage Image;
+    VkFormat Format;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t MipLevels;
+};
+
+enum class MipGenerationPath
+{
+    Blit,           // vkCmdBlitImage level by level, for formats with linear filtering
+    Compute,        // One downsample.comp dispatch per image, for formats that can only be stored to
+    None            // Format can't have its mips generated on this device
+};
+
+// Fills the mip chains of many images in one command buffer.
+// The blit path walks all images level by level, with one barrier batch per level instead of one per image.
+// The compute path reduces a whole chain in a single dispatch (FidelityFX SPD style).
+class MipGenerator
+{
+public:
+    MipGenerator();
+    ~MipGenerator();
+
+    void Create(VkPhysicalDevice PhysicalDevice, VkDevice Device, PipelineLayoutCache* LayoutCache, bool bComputeSupported);
+    void Destroy();
+
+    MipGenerationPath GetPath(VkFormat Format, uint32_t Width, uint32_t Height) const;
+    VkImageUsageFlags GetRequiredUsage(MipGenerationPath Path) const;       // Usage flags images on Path must be created with
+
+    // Every level of every image must be in TRANSFER_DST_OPTIMAL, and every level ends in SHADER_READ_ONLY_OPTIMAL.
+    // CompletionFence must be signalled by the submit containing CommandBuffer
+    void Record(VkCommandBuffer CommandBuffer, const std::vector<MipChainImage>& Images, VkFence CompletionFence);
+    void CollectGarbage();                                                  // Free compute resources of batches whose fence has signalled
+
+private:
+    struct DownsampleParams
+    {
+        uint32_t MipCount;                                  // Levels to write after level 0
+        uint32_t WorkGroupCount;
+        uint32_t CounterIndex;                              // Atomic counter (and level 6 region) of this image
+    };
+
+    // Descriptors and views used by a batch in flight
+    struct PendingResources
+    {
+        VkFence Fence;
+        VkDescriptorPool DescriptorPool;
+        std::vector<VkImageView> ImageViews;
+    };
+
+    VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice Device = VK_NULL_HANDLE;
+    bool bComputeEnabled = false;
+
+    PipelineLayoutCache* LayoutCache = nullptr;
+    VkDescriptorSetLayout DescriptorSetLayout = VK_NULL_HANDLE;            // Both owned by LayoutCache
+    VkPipelineLayout PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline Pipeline = VK_NULL_HANDLE;
+    VkSampler Sampler = VK_NULL_HANDLE;
+    PushConstantBlock<DownsampleParams> ParamsPushConstant = PushConstantBlock<DownsampleParams>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    // Shared by every compute batch, each image of a batch uses its own counter and level 6 region
+    VkBuffer CounterBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory CounterBufferMemory = VK_NULL_HANDLE;
+    VkBuffer Level6Buffer = VK_NULL_HANDLE;
+    VkDeviceMemory Level6BufferMemory = VK_NULL_HANDLE;
+
+    std::vector<PendingResources> Pending;
+
+    void CreateComputePipeline();
+    void RecordBlits(VkCommandBuffer CommandBuffer, const std::vector<const MipChainImage*>& Images);
+    void RecordCompute(VkCommandBuffer CommandBuffer, const std::vector<const MipChainImage*>& Images, VkFence CompletionFence);
+    VkImageView CreateLevelView(VkImage Image, VkFormat Format, uint32_t Level);
+};
@@ -0,0 +1,144 @@
+#include "PipelineLayoutCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    // FNV-1a, folded one 64 bit value at a time
+    const uint64_t HASH_OFFSET_BASIS = 14695981039346656037ull;
+    const uint64_t HASH_PRIME = 1099511628211ull;
+
+    void HashCombine(uint64_t& Hash, uint64_t Value)
+    {
+        Hash ^= Value;
+        Hash *= HASH_PRIME;
+    }
+}
+
+PipelineLayoutCache::PipelineLayoutCache()
+{
+}
+
+PipelineLayoutCache::~PipelineLayoutCache()
+{
+}
+
+void PipelineLayoutCache::Create(VkDevice NewDevice)
+{
+    Device = NewDevice;
+}
+
+void PipelineLayoutCache::Destroy()
+{
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+
+    for (auto& Entry : PipelineLayouts)
+    {
+        vkDestroyPipelineLayout(Device, Entry.second, nullptr);
+    }
+    for (auto& Entry : DescriptorSetLayouts)
+    {
+        vkDestroyDescriptorSetLayout(Device, Entry.second, nullptr);
+    }
+    PipelineLayouts.clear();
+    DescriptorSetLayouts.clear();
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& Bindings)
+{
+    DescriptorSetLayoutKey Key = { Bindings };
+    std::sort(Key.Bindings.begin(), Key.Bindings.end(), [](const VkDescriptorSetLayoutBinding& A, const VkDescriptorSetLayoutBinding& B) { return A.binding < B.binding; });
+
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+
+    auto Existing = DescriptorSetLayouts.find(Key);
+    if (Existing != DescriptorSetLayouts.end()) return Existing->second;
+
+    VkDescriptorSetLayoutCreateInfo LayoutCreateInfo = {};
+    LayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    LayoutCreateInfo.bindingCount = static_cast<uint32_t>(Key.Bindings.size());
+    LayoutCreateInfo.pBindings = Key.Bindings.data();
+
+    VkDescriptorSetLayout Layout;
+    VkResult Result = vkCreateDescriptorSetLayout(Device, &LayoutCreateInfo, nullptr, &Layout);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create a Descriptor Set Layout");
+
+    DescriptorSetLayouts.emplace(std::move(Key), Layout);
+    return Layout;
+}
+
+VkPipelineLayout PipelineLayoutCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& SetLayouts, const std::vector<VkPushConstantRange>& PushConstantRanges)
+{
+    PipelineLayoutKey Key = { SetLayouts, PushConstantRanges };
+
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+
+    auto Existing = PipelineLayouts.find(Key);
+    if (Existing != PipelineLayouts.end()) return Existing->second;
+
+    VkPipelineLayoutCreateInfo LayoutCreateInfo = {};
+    LayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    LayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(Key.SetLayouts.size());
+    LayoutCreateInfo.pSetLayouts = Key.SetLayouts.data();
+    LayoutCreateInfo.pushConstantRangeCount = static_cast<uint32_t>(Key.PushConstantRanges.size());
+    LayoutCreateInfo.pPushConstantRanges = Key.PushConstantRanges.data();
+
+    VkPipelineLayout Layout;
+    VkResult Result = vkCreatePipelineLayout(Device, &LayoutCreateInfo, nullptr, &Layout);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create a Pipeline Layout");
+
+    PipelineLayouts.emplace(std::move(Key), Layout);
+    return Layout;
+}
+
+bool PipelineLayoutCache::DescriptorSetLayoutKey::operator==(const DescriptorSetLayoutKey& Other) const
+{
+    return std::equal(Bindings.begin(), Bindings.end(), Other.Bindings.begin(), Other.Bindings.end(),
+                      [](const VkDescriptorSetLayoutBinding& A, const VkDescriptorSetLayoutBinding& B)
+                      {
+                          return A.binding == B.binding && A.descriptorType == B.descriptorType && A.descriptorCount == B.descriptorCount
+                                 && A.stageFlags == B.stageFlags && A.pImmutableSamplers == B.pImmutableSamplers;
+                      });
+}
+
+bool PipelineLayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& Other) const
+{
+    return SetLayouts == Other.SetLayouts
+           && std::equal(PushConstantRanges.begin(), PushConstantRanges.end(), Other.PushConstantRanges.begin(), Other.PushConstantRanges.end(),
+                         [](const VkPushConstantRange& A, const VkPushConstantRange& B)
+                         {
+                             return A.stageFlags == B.stageFlags && A.offset == B.offset && A.size == B.size;
+                         });
+}
+
+size_t PipelineLayoutCache::KeyHash::operator()(const DescriptorSetLayoutKey& Key) const
+{
+    uint64_t Hash = HASH_OFFSET_BASIS;
+    for (const VkDescriptorSetLayoutBinding& Binding : Key.Bindings)
+    {
+        HashCombine(Hash, Binding.binding);
+        HashCombine(Hash, Binding.descriptorType);
+        HashCombine(Hash, Binding.descriptorCount);
+        HashCombine(Hash, Binding.stageFlags);
+        HashCombine(Hash, reinterpret_cast<uint64_t>(Binding.pImmutableSamplers));
+    }
+    return static_cast<size_t>(Hash);
+}
+
+size_t PipelineLayoutCache::KeyHash::operator()(const PipelineLayoutKey& Key) const
+{
+    // Set layouts are deduplicated by the cache, so their handles identify their content
+    uint64_t Hash = HASH_OFFSET_BASIS;
+    for (VkDescriptorSetLayout SetLayout : Key.SetLayouts)
+    {
+        HashCombine(Hash, reinterpret_cast<uint64_t>(SetLayout));
+    }
+    for (const VkPushConstantRange& Range : Key.PushConstantRanges)
+    {
+        HashCombine(Hash, Range.stageFlags);
+        HashCombine(Hash, Range.offset);
+        HashCombine(Hash, Range.size);
+    }
+    return static_cast<size_t>(Hash);
+}
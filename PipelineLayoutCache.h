@@ -0,0 +1,52 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+// Descriptor set layouts and pipeline layouts, hashed by content so pipelines asking for identical layouts
+// get the very same handles. Pipelines sharing a pipeline layout (or a prefix of compatible set layouts)
+// keep their bound descriptor sets across vkCmdBindPipeline, nothing has to be rebound between them.
+// The cache owns every layout it hands out; they live until Destroy. Safe to use from several threads
+class PipelineLayoutCache
+{
+public:
+    PipelineLayoutCache();
+    ~PipelineLayoutCache();
+
+    void Create(VkDevice Device);
+    void Destroy();
+
+    // Binding order doesn't matter, bindings are sorted before hashing
+    VkDescriptorSetLayout GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& Bindings);
+    VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& SetLayouts, const std::vector<VkPushConstantRange>& PushConstantRanges);
+
+private:
+    struct DescriptorSetLayoutKey
+    {
+        std::vector<VkDescriptorSetLayoutBinding> Bindings;
+        bool operator==(const DescriptorSetLayoutKey& Other) const;
+    };
+
+    struct PipelineLayoutKey
+    {
+        std::vector<VkDescriptorSetLayout> SetLayouts;
+        std::vector<VkPushConstantRange> PushConstantRanges;
+        bool operator==(const PipelineLayoutKey& Other) const;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const DescriptorSetLayoutKey& Key) const;
+        size_t operator()(const PipelineLayoutKey& Key) const;
+    };
+
+    VkDevice Device = VK_NULL_HANDLE;
+    std::mutex CacheMutex;
+    std::unordered_map<DescriptorSetLayoutKey, VkDescriptorSetLayout, KeyHash> DescriptorSetLayouts;
+    std::unordered_map<PipelineLayoutKey, VkPipelineLayout, KeyHash> PipelineLayouts;
+};
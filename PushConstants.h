@@ -0,0 +1,58 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+// Every device must support at least this many bytes of push constants (spec minimum of maxPushConstantsSize)
+const uint32_t GUARANTEED_MAX_PUSH_CONSTANTS_SIZE = 128;
+
+// Typed wrapper around a push constant range holding one T.
+// Sizes are checked at compile time against the guaranteed minimum, and at runtime against the actual device limit
+template<typename T>
+class PushConstantBlock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Push constant block must be trivially copyable");
+    static_assert(sizeof(T) % 4 == 0, "Push constant block size must be a multiple of 4");
+    static_assert(sizeof(T) <= GUARANTEED_MAX_PUSH_CONSTANTS_SIZE, "Push constant block is bigger than maxPushConstantsSize guarantees");
+
+public:
+    PushConstantBlock(VkShaderStageFlags NewStageFlags, uint32_t NewOffset = 0)
+        : StageFlags(NewStageFlags), Offset(NewOffset)
+    {
+    }
+
+    // Throw if the block doesn't fit in the device's push constant space
+    void CheckDeviceLimits(const VkPhysicalDeviceLimits& Limits) const
+    {
+        if (Offset % 4 != 0 || Offset + sizeof(T) > Limits.maxPushConstantsSize)
+        {
+            throw std::runtime_error("Push constant block of " + std::to_string(sizeof(T)) + " bytes doesn't fit in maxPushConstantsSize ("
+                                     + std::to_string(Limits.maxPushConstantsSize) + ")");
+        }
+    }
+
+    // Range to put in the VkPipelineLayoutCreateInfo
+    VkPushConstantRange GetRange() const
+    {
+        VkPushConstantRange Range = {};
+        Range.stageFlags = StageFlags;                          // Shader stages that can read the block
+        Range.offset = Offset;                                  // Where the block starts in push constant memory
+        Range.size = sizeof(T);                                 // Size of the block
+        return Range;
+    }
+
+    // Record the block's new value into the command buffer
+    void Push(VkCommandBuffer CommandBuffer, VkPipelineLayout Layout, const T& Data) const
+    {
+        vkCmdPushConstants(CommandBuffer, Layout, StageFlags, Offset, sizeof(T), &Data);
+    }
+
+private:
+    VkShaderStageFlags StageFlags;
+    uint32_t Offset;
+};
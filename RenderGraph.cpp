@@ -0,0 +1,743 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const VkAccessFlags2KHR WRITE_ACCESS_MASK = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR
+                                              | VK_ACCESS_2_SHADER_WRITE_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR | VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR;
+
+    bool IsAttachment(RenderGraphAccess Access)
+    {
+        return Access == RenderGraphAccess::ColourAttachment || Access == RenderGraphAccess::ColourResolve
+            || Access == RenderGraphAccess::DepthAttachment || Access == RenderGraphAccess::DepthReadOnly;
+    }
+
+    VkImageUsageFlags GetUsageFlags(RenderGraphAccess Access)
+    {
+        switch (Access)
+        {
+        case RenderGraphAccess::ColourAttachment:
+        case RenderGraphAccess::ColourResolve:      return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        case RenderGraphAccess::DepthAttachment:
+        case RenderGraphAccess::DepthReadOnly:      return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        case RenderGraphAccess::Sampled:            return VK_IMAGE_USAGE_SAMPLED_BIT;
+        default:                                    return VK_IMAGE_USAGE_STORAGE_BIT;
+        }
+    }
+
+    bool HasMemoryType(VkPhysicalDevice PhysicalDevice, uint32_t AllowedTypes, VkMemoryPropertyFlags Properties)
+    {
+        VkPhysicalDeviceMemoryProperties MemoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &MemoryProperties);
+
+        for (uint32_t i = 0; i < MemoryProperties.memoryTypeCount; i++)
+        {
+            if ((AllowedTypes & (1 << i)) && (MemoryProperties.memoryTypes[i].propertyFlags & Properties) == Properties) return true;
+        }
+        return false;
+    }
+}
+
+RenderGraph::RenderGraph()
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+}
+
+void RenderGraph::Create(VkPhysicalDevice NewPhysicalDevice, VkDevice NewDevice)
+{
+    PhysicalDevice = NewPhysicalDevice;
+    Device = NewDevice;
+}
+
+void RenderGraph::Destroy()
+{
+    for (PassNode& Pass : Passes)
+    {
+        for (VkFramebuffer Framebuffer : Pass.Framebuffers)
+        {
+            vkDestroyFramebuffer(Device, Framebuffer, nullptr);
+        }
+        if (Pass.RenderPass != VK_NULL_HANDLE) vkDestroyRenderPass(Device, Pass.RenderPass, nullptr);
+    }
+
+    for (ImageResource& Resource : Resources)
+    {
+        if (Resource.bImported) continue;
+
+        for (VkImageView ImageView : Resource.ImageViews)
+        {
+            vkDestroyImageView(Device, ImageView, nullptr);
+        }
+        for (VkImage Image : Resource.Images)
+        {
+            vkDestroyImage(Device, Image, nullptr);
+        }
+    }
+
+    for (MemoryBlock& Block : MemoryBlocks)
+    {
+        FreeDeviceMemory(Device, Block.Memory);
+    }
+
+    Resources.clear();
+    Passes.clear();
+    ExecutionOrder.clear();
+    MemoryBlocks.clear();
+    FinalBarriers.clear();
+    UnaliasedMemorySize = 0;
+}
+
+RenderGraphResource RenderGraph::ImportImage(const std::string& Name, const std::vector<VkImage>& Images, const std::vector<VkImageView>& ImageViews,
+                                             VkFormat Format, VkExtent2D Extent, VkPipelineStageFlags2KHR InitialStages, VkImageLayout FinalLayout)
+{
+    ImageResource Resource = {};
+    Resource.Name = Name;
+    Resource.Format = Format;
+    Resource.Extent = Extent;
+    Resource.AspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+    Resource.bImported = true;
+    Resource.InitialStages = InitialStages;
+    Resource.FinalLayout = FinalLayout;
+    Resource.Images = Images;
+    Resource.ImageViews = ImageViews;
+
+    Resources.push_back(Resource);
+    return static_cast<RenderGraphResource>(Resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::CreateTransientImage(const std::string& Name, VkFormat Format, VkExtent2D Extent, VkImageAspectFlags AspectFlags,
+                                                      VkSampleCountFlagBits Samples)
+{
+    ImageResource Resource = {};
+    Resource.Name = Name;
+    Resource.Format = Format;
+    Resource.Extent = Extent;
+    Resource.AspectFlags = AspectFlags;
+    Resource.Samples = Samples;
+    Resource.bImported = false;
+
+    Resources.push_back(Resource);
+    return static_cast<RenderGraphResource>(Resources.size() - 1);
+}
+
+RenderGraphPass RenderGraph::AddPass(const std::string& Name, RenderGraphPassType Type, std::function<void(VkCommandBuffer)> Record)
+{
+    PassNode Pass = {};
+    Pass.Name = Name;
+    Pass.Type = Type;
+    Pass.Record = Record;
+
+    Passes.push_back(Pass);
+    return static_cast<RenderGraphPass>(Passes.size() - 1);
+}
+
+void RenderGraph::SetSideEffects(RenderGraphPass Pass)
+{
+    Passes[Pass].bSideEffects = true;
+}
+
+void RenderGraph::UseImage(RenderGraphPass Pass, RenderGraphResource Resource, RenderGraphAccess Access, VkPipelineStageFlags2KHR Stages)
+{
+    if (IsAttachment(Access) && Passes[Pass].Type != RenderGraphPassType::Graphics) throw std::runtime_error("Only graphics passes can use attachments: " + Passes[Pass].Name);
+
+    ImageUse Use = {};
+    Use.Resource = Resource;
+    Use.Access = Access;
+    Use.Stages = Stages;
+    Passes[Pass].Uses.push_back(Use);
+}
+
+void RenderGraph::ClearImage(RenderGraphPass Pass, RenderGraphResource Resource, VkClearValue ClearValue)
+{
+    for (ImageUse& Use : Passes[Pass].Uses)
+    {
+        if (Use.Resource == Resource && IsAttachment(Use.Access))
+        {
+            Use.bClear = true;
+            Use.ClearValue = ClearValue;
+            return;
+        }
+    }
+
+    throw std::runtime_error("Pass must use an image as an attachment before clearing it: " + Passes[Pass].Name);
+}
+
+void RenderGraph::ResolveImage(RenderGraphPass Pass, RenderGraphResource Source, RenderGraphResource Destination)
+{
+    if (Resources[Source].Samples == VK_SAMPLE_COUNT_1_BIT || Resources[Destination].Samples != VK_SAMPLE_COUNT_1_BIT)
+    {
+        throw std::runtime_error("Resolve must go from a multisampled image to a single sampled one: " + Passes[Pass].Name);
+    }
+
+    UseImage(Pass, Destination, RenderGraphAccess::ColourResolve);
+    Passes[Pass].Uses.back().ResolveSource = Source;
+}
+
+void RenderGraph::SetSecondaryCommandBuffers(RenderGraphPass Pass, bool bEnabled)
+{
+    Passes[Pass].bSecondaryCommandBuffers = bEnabled;
+}
+
+void RenderGraph::SetPassInstrumentation(std::function<void(VkCommandBuffer, RenderGraphPass)> OnPassBegin,
+                                         std::function<void(VkCommandBuffer, RenderGraphPass)> OnPassEnd)
+{
+    PassBeginInstrumentation = std::move(OnPassBegin);
+    PassEndInstrumentation = std::move(OnPassEnd);
+}
+
+void RenderGraph::SetInheritedPipelineStatistics(VkQueryPipelineStatisticFlags Statistics)
+{
+    InheritedPipelineStatistics = Statistics;
+}
+
+void RenderGraph::Compile()
+{
+    CullPasses();
+    CreateTransientImages();
+    PlanBarriers();
+    CreateRenderPasses();
+}
+
+bool RenderGraph::IsPassActive(RenderGraphPass Pass) const
+{
+    return Passes[Pass].bActive;
+}
+
+bool RenderGraph::IsPassRecordedInSecondaries(RenderGraphPass Pass) const
+{
+    return Passes[Pass].bSecondaryCommandBuffers;
+}
+
+const std::string& RenderGraph::GetPassName(RenderGraphPass Pass) const
+{
+    return Passes[Pass].Name;
+}
+
+uint32_t RenderGraph::GetPassCount() const
+{
+    return static_cast<uint32_t>(Passes.size());
+}
+
+VkRenderPass RenderGraph::GetRenderPass(RenderGraphPass Pass) const
+{
+    return Passes[Pass].RenderPass;
+}
+
+VkImageView RenderGraph::GetImageView(RenderGraphResource Resource, uint32_t Variant) const
+{
+    const std::vector<VkImageView>& ImageViews = Resources[Resource].ImageViews;
+    return ImageViews.empty() ? VK_NULL_HANDLE : ImageViews[std::min<size_t>(Variant, ImageViews.size() - 1)];
+}
+
+VkDeviceSize RenderGraph::GetTransientMemorySize() const
+{
+    VkDeviceSize Size = 0;
+    for (const MemoryBlock& Block : MemoryBlocks)
+    {
+        Size += Block.Size;
+    }
+    return Size;
+}
+
+VkDeviceSize RenderGraph::GetUnaliasedTransientMemorySize() const
+{
+    return UnaliasedMemorySize;
+}
+
+void RenderGraph::Execute(VkCommandBuffer CommandBuffer, uint32_t Variant)
+{
+    ExecutingVariant = Variant;
+
+    for (uint32_t PassIndex : ExecutionOrder)
+    {
+        PassNode& Pass = Passes[PassIndex];
+
+        RecordBarriers(CommandBuffer, Pass.Barriers, Variant, Pass.Name.c_str());
+        if (PassBeginInstrumentation) PassBeginInstrumentation(CommandBuffer, PassIndex);
+
+        if (Pass.Type == RenderGraphPassType::Graphics)
+        {
+            VkRenderPassBeginInfo RenderPassBeginInfo = {};
+            RenderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            RenderPassBeginInfo.renderPass = Pass.RenderPass;
+            RenderPassBeginInfo.framebuffer = Pass.Framebuffers[std::min<size_t>(Variant, Pass.Framebuffers.size() - 1)];
+            RenderPassBeginInfo.renderArea.offset = { 0, 0 };
+            RenderPassBeginInfo.renderArea.extent = Pass.Extent;
+            RenderPassBeginInfo.clearValueCount = static_cast<uint32_t>(Pass.ClearValues.size());
+            RenderPassBeginInfo.pClearValues = Pass.ClearValues.data();
+
+            vkCmdBeginRenderPass(CommandBuffer, &RenderPassBeginInfo, Pass.bSecondaryCommandBuffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+            Pass.Record(CommandBuffer);
+            vkCmdEndRenderPass(CommandBuffer);
+        }
+        else
+        {
+            Pass.Record(CommandBuffer);
+        }
+
+        if (PassEndInstrumentation) PassEndInstrumentation(CommandBuffer, PassIndex);
+    }
+
+    RecordBarriers(CommandBuffer, FinalBarriers, Variant, "Final layouts");
+}
+
+VkCommandBufferInheritanceInfo RenderGraph::GetInheritanceInfo(RenderGraphPass Pass) const
+{
+    const PassNode& Node = Passes[Pass];
+
+    VkCommandBufferInheritanceInfo InheritanceInfo = {};
+    InheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    InheritanceInfo.renderPass = Node.RenderPass;                                   // Render pass the secondary buffer executes in
+    InheritanceInfo.subpass = 0;                                                    // Graph render passes have a single subpass
+    InheritanceInfo.framebuffer = Node.Framebuffers[std::min<size_t>(ExecutingVariant, Node.Framebuffers.size() - 1)];
+    InheritanceInfo.pipelineStatistics = InheritedPipelineStatistics;
+    return InheritanceInfo;
+}
+
+RenderGraph::AccessInfo RenderGraph::GetAccessInfo(RenderGraphAccess Access, VkPipelineStageFlags2KHR Stages)
+{
+    const VkPipelineStageFlags2KHR DepthTestStages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR;
+
+    switch (Access)
+    {
+    case RenderGraphAccess::ColourAttachment:
+        return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+                 VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR, true };
+    case RenderGraphAccess::ColourResolve:
+        return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR, true };
+    case RenderGraphAccess::DepthAttachment:
+        return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, DepthTestStages,
+                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR, true };
+    case RenderGraphAccess::DepthReadOnly:
+        return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, DepthTestStages, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR, false };
+    case RenderGraphAccess::Sampled:
+        return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, Stages != 0 ? Stages : VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR, false };
+    default:
+        return { VK_IMAGE_LAYOUT_GENERAL, Stages != 0 ? Stages : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR, true };
+    }
+}
+
+void RenderGraph::CullPasses()
+{
+    // Walk backwards from the outputs. A pass survives if it writes something a surviving pass (or the outside) still needs.
+    // A surviving pass that clears an image makes earlier writes to it dead; anything it reads or loads is needed before it
+    std::vector<bool> bNeeded(Resources.size(), false);
+    for (size_t i = 0; i < Resources.size(); i++)
+    {
+        bNeeded[i] = Resources[i].bImported;
+    }
+
+    for (size_t PassIndex = Passes.size(); PassIndex-- > 0;)
+    {
+        PassNode& Pass = Passes[PassIndex];
+
+        Pass.bActive = Pass.bSideEffects;
+        for (const ImageUse& Use : Pass.Uses)
+        {
+            if (GetAccessInfo(Use.Access, Use.Stages).bWrite && bNeeded[Use.Resource]) Pass.bActive = true;
+        }
+        if (!Pass.bActive) continue;
+
+        for (const ImageUse& Use : Pass.Uses)
+        {
+            if (Use.bClear) bNeeded[Use.Resource] = false;
+        }
+        for (const ImageUse& Use : Pass.Uses)
+        {
+            if (!Use.bClear) bNeeded[Use.Resource] = true;
+        }
+    }
+
+    ExecutionOrder.clear();
+    for (uint32_t PassIndex = 0; PassIndex < Passes.size(); PassIndex++)
+    {
+        if (Passes[PassIndex].bActive) ExecutionOrder.push_back(PassIndex);
+    }
+}
+
+void RenderGraph::CreateTransientImages()
+{
+    // -- LIFETIMES AND USAGE --
+    for (uint32_t Position = 0; Position < ExecutionOrder.size(); Position++)
+    {
+        for (const ImageUse& Use : Passes[ExecutionOrder[Position]].Uses)
+        {
+            ImageResource& Resource = Resources[Use.Resource];
+            Resource.FirstPass = std::min(Resource.FirstPass, Position);
+            Resource.LastPass = std::max(Resource.LastPass, Position);
+            Resource.Usage |= GetUsageFlags(Use.Access);
+        }
+    }
+
+    // Attachments of a single pass are never loaded or stored, their contents never have to leave the tile
+    const VkImageUsageFlags AttachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    for (ImageResource& Resource : Resources)
+    {
+        if (Resource.bImported || Resource.FirstPass == UINT32_MAX) continue;
+
+        Resource.bLazy = Resource.FirstPass == Resource.LastPass && (Resource.Usage & ~AttachmentUsage) == 0;
+        if (Resource.bLazy) Resource.Usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    }
+
+    // -- IMAGES --
+    std::vector<RenderGraphResource> Transients;
+    std::vector<VkMemoryRequirements> Requirements(Resources.size());
+    for (RenderGraphResource i = 0; i < Resources.size(); i++)
+    {
+        ImageResource& Resource = Resources[i];
+        if (Resource.bImported || Resource.FirstPass == UINT32_MAX) continue;      // Unused transients are never created
+
+        VkImageCreateInfo ImageCreateInfo = {};
+        ImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        ImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        ImageCreateInfo.extent = { Resource.Extent.width, Resource.Extent.height, 1 };
+        ImageCreateInfo.mipLevels = 1;
+        ImageCreateInfo.arrayLayers = 1;
+        ImageCreateInfo.format = Resource.Format;
+        ImageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        ImageCreateInfo.usage = Resource.Usage;
+        ImageCreateInfo.samples = Resource.Samples;
+        ImageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkImage Image;
+        VkResult Result = vkCreateImage(Device, &ImageCreateInfo, nullptr, &Image);
+        if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create a transient Image: " + Resource.Name);
+
+        Resource.Images.push_back(Image);
+        vkGetImageMemoryRequirements(Device, Image, &Requirements[i]);
+        UnaliasedMemorySize += Requirements[i].size;
+        Transients.push_back(i);
+    }
+
+    // -- ALIASING --
+    // Biggest first, each image goes into the first block it fits whose occupants are all dead before it starts or born after it ends
+    std::sort(Transients.begin(), Transients.end(), [&](RenderGraphResource A, RenderGraphResource B)
+    {
+        return Requirements[A].size > Requirements[B].size;
+    });
+
+    for (RenderGraphResource i : Transients)
+    {
+        ImageResource& Resource = Resources[i];
+
+        for (uint32_t BlockIndex = 0; BlockIndex < MemoryBlocks.size() && Resource.MemoryBlock == UINT32_MAX; BlockIndex++)
+        {
+            MemoryBlock& Block = MemoryBlocks[BlockIndex];
+            if ((Block.MemoryTypeBits & Requirements[i].memoryTypeBits) == 0 || Block.bLazy != Resource.bLazy) continue;
+
+            bool bOverlaps = false;
+            for (RenderGraphResource Occupant : Block.Occupants)
+            {
+                bOverlaps |= Resources[Occupant].FirstPass <= Resource.LastPass && Resource.FirstPass <= Resources[Occupant].LastPass;
+            }
+            if (bOverlaps) continue;
+
+            Resource.MemoryBlock = BlockIndex;
+        }
+
+        if (Resource.MemoryBlock == UINT32_MAX)
+        {
+            Resource.MemoryBlock = static_cast<uint32_t>(MemoryBlocks.size());
+            MemoryBlocks.push_back(MemoryBlock());
+            MemoryBlocks.back().bLazy = Resource.bLazy;
+        }
+
+        MemoryBlock& Block = MemoryBlocks[Resource.MemoryBlock];
+        Block.Size = std::max(Block.Size, Requirements[i].size);
+        Block.Alignment = std::max(Block.Alignment, Requirements[i].alignment);
+        Block.MemoryTypeBits &= Requirements[i].memoryTypeBits;
+        Block.Occupants.push_back(i);
+    }
+
+    // -- MEMORY --
+    for (MemoryBlock& Block : MemoryBlocks)
+    {
+        std::sort(Block.Occupants.begin(), Block.Occupants.end(), [&](RenderGraphResource A, RenderGraphResource B)
+        {
+            return Resources[A].FirstPass < Resources[B].FirstPass;
+        });
+
+        VkMemoryAllocateInfo MemoryAllocateInfo = {};
+        MemoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        MemoryAllocateInfo.allocationSize = Block.Size;
+        // Lazily allocated memory is only committed if the attachment spills out of tile memory. Desktop GPUs don't have it
+        VkMemoryPropertyFlags Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        if (Block.bLazy && HasMemoryType(PhysicalDevice, Block.MemoryTypeBits, Properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+        {
+            Properties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        }
+        MemoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(PhysicalDevice, Block.MemoryTypeBits, Properties);
+
+        VkResult Result = vkAllocateMemory(Device, &MemoryAllocateInfo, nullptr, &Block.Memory);
+        if (Result != VK_SUCCESS) throw std::runtime_error("Failed to allocate transient image memory");
+        MemoryTracker::TrackAllocation(Block.Memory, MemoryCategory::RenderTarget, Block.Size, Block.Size, MemoryAllocateInfo.memoryTypeIndex);
+
+        for (RenderGraphResource Occupant : Block.Occupants)
+        {
+            ImageResource& Resource = Resources[Occupant];
+            vkBindImageMemory(Device, Resource.Images[0], Block.Memory, 0);
+
+            VkImageViewCreateInfo ImageViewCreateInfo = {};
+            ImageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            ImageViewCreateInfo.image = Resource.Images[0];
+            ImageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            ImageViewCreateInfo.format = Resource.Format;
+            ImageViewCreateInfo.subresourceRange = { Resource.AspectFlags, 0, 1, 0, 1 };
+
+            VkImageView ImageView;
+            Result = vkCreateImageView(Device, &ImageViewCreateInfo, nullptr, &ImageView);
+            if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create a transient ImageView: " + Resource.Name);
+            Resource.ImageViews.push_back(ImageView);
+        }
+    }
+}
+
+void RenderGraph::PlanBarriers()
+{
+    // What has happened to each image so far: writes not yet waited on by everyone, and reads since the last write
+    struct ImageState
+    {
+        VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2KHR WriteStages = 0;
+        VkAccessFlags2KHR WriteAccess = 0;
+        VkPipelineStageFlags2KHR ReadStages = 0;
+        VkPipelineStageFlags2KHR VisibleStages = 0;          // Stages already ordered after the last write
+    };
+
+    // Last use of each image in the frame, to order the next frame (or the next alias of its memory) after it
+    std::vector<AccessInfo> LastAccess(Resources.size());
+    for (uint32_t PassIndex : ExecutionOrder)
+    {
+        for (const ImageUse& Use : Passes[PassIndex].Uses)
+        {
+            LastAccess[Use.Resource] = GetAccessInfo(Use.Access, Use.Stages);
+        }
+    }
+
+    std::vector<ImageState> States(Resources.size());
+    for (RenderGraphResource i = 0; i < Resources.size(); i++)
+    {
+        ImageResource& Resource = Resources[i];
+        if (Resource.bImported)
+        {
+            States[i].WriteStages = Resource.InitialStages;
+            continue;
+        }
+        if (Resource.MemoryBlock == UINT32_MAX) continue;
+
+        // Memory was last touched by the previous occupant of the block, or by the last one of the previous frame
+        const std::vector<RenderGraphResource>& Occupants = MemoryBlocks[Resource.MemoryBlock].Occupants;
+        size_t Position = std::find(Occupants.begin(), Occupants.end(), i) - Occupants.begin();
+        const AccessInfo& Previous = LastAccess[Occupants[Position == 0 ? Occupants.size() - 1 : Position - 1]];
+        if (Previous.bWrite)
+        {
+            States[i].WriteStages = Previous.Stages;
+            States[i].WriteAccess = Previous.Access & WRITE_ACCESS_MASK;
+        }
+        else
+        {
+            States[i].ReadStages = Previous.Stages;
+        }
+    }
+
+    // Each barrier keeps its own scope, an image written by the previous pass doesn't make an unrelated transition wait too
+    auto AddBarrier = [](std::vector<PlannedBarrier>& Barriers, RenderGraphResource Resource, VkPipelineStageFlags2KHR SrcStages, VkPipelineStageFlags2KHR DstStages,
+                         VkImageLayout OldLayout, VkImageLayout NewLayout, VkAccessFlags2KHR SrcAccess, VkAccessFlags2KHR DstAccess)
+    {
+        Barriers.push_back({ Resource, OldLayout, NewLayout, SrcStages, SrcAccess, DstStages, DstAccess });
+    };
+
+    for (uint32_t PassIndex : ExecutionOrder)
+    {
+        PassNode& Pass = Passes[PassIndex];
+
+        for (const ImageUse& Use : Pass.Uses)
+        {
+            AccessInfo Info = GetAccessInfo(Use.Access, Use.Stages);
+            ImageState& State = States[Use.Resource];
+            bool bTransition = State.Layout != Info.Layout;
+
+            if (bTransition || Info.bWrite)
+            {
+                // Layout changes and writes wait for every access since the last write. A first write with nothing before it needs nothing
+                VkPipelineStageFlags2KHR SrcStages = State.WriteStages | State.ReadStages;
+                if (bTransition || SrcStages != 0)
+                {
+                    VkImageLayout OldLayout = Use.bClear ? VK_IMAGE_LAYOUT_UNDEFINED : State.Layout;     // Cleared contents can be discarded
+                    AddBarrier(Pass.Barriers, Use.Resource, SrcStages, Info.Stages, OldLayout, Info.Layout, State.WriteAccess, Info.Access);
+                }
+
+                State.Layout = Info.Layout;
+                State.WriteStages = Info.Stages;
+                State.WriteAccess = Info.Access & WRITE_ACCESS_MASK;
+                State.ReadStages = Info.bWrite ? 0 : Info.Stages;
+                State.VisibleStages = Info.Stages;
+            }
+            else
+            {
+                // Read after read in the same layout is free, only new stages have to be made to wait for the last write
+                if ((Info.Stages & ~State.VisibleStages) != 0 && State.WriteStages != 0)
+                {
+                    AddBarrier(Pass.Barriers, Use.Resource, State.WriteStages, Info.Stages, State.Layout, State.Layout, State.WriteAccess, Info.Access);
+                }
+
+                State.ReadStages |= Info.Stages;
+                State.VisibleStages |= Info.Stages;
+            }
+        }
+    }
+
+    // Hand imported images back in the layout the outside expects
+    for (RenderGraphResource i = 0; i < Resources.size(); i++)
+    {
+        ImageResource& Resource = Resources[i];
+        if (!Resource.bImported || States[i].Layout == Resource.FinalLayout) continue;
+
+        AddBarrier(FinalBarriers, i, States[i].WriteStages | States[i].ReadStages, VK_PIPELINE_STAGE_2_NONE_KHR,
+                   States[i].Layout, Resource.FinalLayout, States[i].WriteAccess, 0);
+    }
+}
+
+void RenderGraph::CreateRenderPasses()
+{
+    for (uint32_t Position = 0; Position < ExecutionOrder.size(); Position++)
+    {
+        PassNode& Pass = Passes[ExecutionOrder[Position]];
+        if (Pass.Type != RenderGraphPassType::Graphics) continue;
+
+        // Colour attachments in declaration order, then resolve targets, then depth
+        std::vector<const ImageUse*> Attachments;
+        std::vector<const ImageUse*> ResolveUses;
+        const ImageUse* DepthUse = nullptr;
+        for (const ImageUse& Use : Pass.Uses)
+        {
+            if (Use.Access == RenderGraphAccess::ColourAttachment) Attachments.push_back(&Use);
+            if (Use.Access == RenderGraphAccess::ColourResolve) ResolveUses.push_back(&Use);
+            if (Use.Access == RenderGraphAccess::DepthAttachment || Use.Access == RenderGraphAccess::DepthReadOnly) DepthUse = &Use;
+        }
+        size_t ColourCount = Attachments.size();
+        Attachments.insert(Attachments.end(), ResolveUses.begin(), ResolveUses.end());
+        if (DepthUse != nullptr) Attachments.push_back(DepthUse);
+        if (Attachments.empty()) throw std::runtime_error("Graphics pass has no attachments: " + Pass.Name);
+
+        std::vector<VkAttachmentDescription> AttachmentDescriptions;
+        std::vector<VkAttachmentReference> ColourReferences;
+        std::vector<VkAttachmentReference> ResolveReferences(ColourCount, { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+        VkAttachmentReference DepthReference = {};
+        uint32_t PassVariants = 1;
+
+        for (const ImageUse* Use : Attachments)
+        {
+            const ImageResource& Resource = Resources[Use->Resource];
+            AccessInfo Info = GetAccessInfo(Use->Access, Use->Stages);
+
+            // Load only what an earlier pass touched, store only what a later pass (or the outside) reads.
+            // A resolve overwrites every pixel, so its target is never loaded
+            bool bWrittenBefore = Resource.FirstPass < Position && Use->Access != RenderGraphAccess::ColourResolve;
+            bool bReadAfter = Resource.bImported || Resource.LastPass > Position;
+            VkAttachmentLoadOp LoadOp = Use->bClear ? VK_ATTACHMENT_LOAD_OP_CLEAR : (bWrittenBefore ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+            VkAttachmentStoreOp StoreOp = bReadAfter ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+            // Layouts stay put inside the render pass, the graph's barriers do every transition
+            VkAttachmentDescription Description = {};
+            Description.format = Resource.Format;
+            Description.samples = Resource.Samples;
+            Description.loadOp = LoadOp;
+            Description.storeOp = StoreOp;
+            Description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            Description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            Description.initialLayout = Info.Layout;
+            Description.finalLayout = Info.Layout;
+
+            VkAttachmentReference Reference = {};
+            Reference.attachment = static_cast<uint32_t>(AttachmentDescriptions.size());
+            Reference.layout = Info.Layout;
+            if (Use == DepthUse)
+            {
+                DepthReference = Reference;
+            }
+            else if (Use->Access == RenderGraphAccess::ColourResolve)
+            {
+                // Goes in the slot of the colour attachment it resolves
+                bool bFound = false;
+                for (size_t i = 0; i < ColourCount; i++)
+                {
+                    if (Attachments[i]->Resource != Use->ResolveSource) continue;
+                    ResolveReferences[i] = Reference;
+                    bFound = true;
+                }
+                if (!bFound) throw std::runtime_error("Resolve source isn't a colour attachment of " + Pass.Name);
+            }
+            else
+            {
+                ColourReferences.push_back(Reference);
+            }
+
+            AttachmentDescriptions.push_back(Description);
+            Pass.ClearValues.push_back(Use->ClearValue);
+            PassVariants = std::max(PassVariants, static_cast<uint32_t>(Resource.ImageViews.size()));
+        }
+
+        VkSubpassDescription SubpassDescription = {};
+        SubpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        SubpassDescription.colorAttachmentCount = static_cast<uint32_t>(ColourReferences.size());
+        SubpassDescription.pColorAttachments = ColourReferences.data();
+        SubpassDescription.pResolveAttachments = ResolveUses.empty() ? nullptr : ResolveReferences.data();
+        SubpassDescription.pDepthStencilAttachment = DepthUse != nullptr ? &DepthReference : nullptr;
+
+        VkRenderPassCreateInfo RenderPassCreateInfo = {};
+        RenderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        RenderPassCreateInfo.attachmentCount = static_cast<uint32_t>(AttachmentDescriptions.size());
+        RenderPassCreateInfo.pAttachments = AttachmentDescriptions.data();
+        RenderPassCreateInfo.subpassCount = 1;
+        RenderPassCreateInfo.pSubpasses = &SubpassDescription;
+
+        VkResult Result = vkCreateRenderPass(Device, &RenderPassCreateInfo, nullptr, &Pass.RenderPass);
+        if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create RenderPass for " + Pass.Name);
+
+        // One framebuffer per variant of the imported attachments (e.g. per swapchain image)
+        Pass.Extent = Resources[Attachments[0]->Resource].Extent;
+        for (uint32_t Variant = 0; Variant < PassVariants; Variant++)
+        {
+            std::vector<VkImageView> ImageViews;
+            for (const ImageUse* Use : Attachments)
+            {
+                ImageViews.push_back(GetImageView(Use->Resource, Variant));
+            }
+
+            VkFramebufferCreateInfo FramebufferCreateInfo = {};
+            FramebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            FramebufferCreateInfo.renderPass = Pass.RenderPass;
+            FramebufferCreateInfo.attachmentCount = static_cast<uint32_t>(ImageViews.size());
+            FramebufferCreateInfo.pAttachments = ImageViews.data();
+            FramebufferCreateInfo.width = Pass.Extent.width;
+            FramebufferCreateInfo.height = Pass.Extent.height;
+            FramebufferCreateInfo.layers = 1;
+
+            VkFramebuffer Framebuffer;
+            Result = vkCreateFramebuffer(Device, &FramebufferCreateInfo, nullptr, &Framebuffer);
+            if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create Framebuffer for " + Pass.Name);
+            Pass.Framebuffers.push_back(Framebuffer);
+        }
+    }
+}
+
+void RenderGraph::RecordBarriers(VkCommandBuffer CommandBuffer, const std::vector<PlannedBarrier>& Barriers, uint32_t Variant, const char* Label)
+{
+    for (const PlannedBarrier& Planned : Barriers)
+    {
+        const ImageResource& Resource = Resources[Planned.Resource];
+        VkImage Image = Resource.Images[std::min<size_t>(Variant, Resource.Images.size() - 1)];
+
+        Batch.AddImageBarrier(Image, { Resource.AspectFlags, 0, 1, 0, 1 }, Planned.OldLayout, Planned.NewLayout,
+                              Planned.SrcStages, Planned.SrcAccess, Planned.DstStages, Planned.DstAccess);
+    }
+
+    Batch.Flush(CommandBuffer, Label);
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstdint>
+
+#include "Utilities.h"
+#include "Barriers.h"
+
+// Index of an image or pass inside a RenderGraph
+typedef uint32_t RenderGraphResource;
+typedef uint32_t RenderGraphPass;
+
+enum class RenderGraphPassType
+{
+    Graphics,           // Runs inside a render pass built from the attachments it declares
+    Compute             // Runs outside any render pass (compute dispatches, copies)
+};
+
+// How a pass touches an image. Decides the layout, stages and access masks of the barriers around it
+enum class RenderGraphAccess
+{
+    ColourAttachment,   // Written as a colour attachment
+    ColourResolve,      // Written by resolving a multisampled colour attachment at the end of the subpass (see ResolveImage)
+    DepthAttachment,    // Depth tested and written
+    DepthReadOnly,      // Depth tested only
+    Sampled,            // Read through a sampler
+    StorageWrite        // Written as a storage image
+};
+
+// Declarative description of a frame. Passes declare which images they read and write, then Compile:
+//  - culls passes whose results never reach an imported image (or a pass flagged with side effects)
+//  - works out the minimal barriers between passes: layout transitions, and memory dependencies only on hazards,
+//    with the exact stages and access masks of both sides for each image, batched into one barrier command per pass
+//  - creates transient images and aliases their memory when their lifetimes (first to last pass) don't overlap.
+//    Attachments that live within a single pass are never loaded or stored, so they get lazily allocated memory
+//    (where the device has it) and only ever exist in tile memory on tilers
+//  - builds a single subpass render pass and framebuffers per graphics pass, storing attachments only if read later
+// The graph is compiled once; Execute records the whole frame into a command buffer.
+class RenderGraph
+{
+public:
+    RenderGraph();
+    ~RenderGraph();
+
+    void Create(VkPhysicalDevice PhysicalDevice, VkDevice Device);
+    void Destroy();                                     // Destroys everything the graph created, imported images are left alone
+
+    // -- DECLARATION --
+    // Image owned outside the graph, with one image per variant (e.g. per swapchain image, picked in Execute).
+    // Contents are discarded at the start of the frame; InitialStages are the stages the image is made available in
+    // (the acquire semaphore's wait stage), FinalLayout the layout it is left in
+    RenderGraphResource ImportImage(const std::string& Name, const std::vector<VkImage>& Images, const std::vector<VkImageView>& ImageViews,
+                                    VkFormat Format, VkExtent2D Extent, VkPipelineStageFlags2KHR InitialStages, VkImageLayout FinalLayout);
+    // Image only alive during the frame, created by Compile in memory shared with other transients
+    RenderGraphResource CreateTransientImage(const std::string& Name, VkFormat Format, VkExtent2D Extent, VkImageAspectFlags AspectFlags,
+                                             VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT);
+
+    RenderGraphPass AddPass(const std::string& Name, RenderGraphPassType Type, std::function<void(VkCommandBuffer)> Record);
+    void SetSideEffects(RenderGraphPass Pass);          // Never cull this pass
+
+    void UseImage(RenderGraphPass Pass, RenderGraphResource Resource, RenderGraphAccess Access, VkPipelineStageFlags2KHR Stages = 0);   // Stages only for Sampled/StorageWrite
+    void ClearImage(RenderGraphPass Pass, RenderGraphResource Resource, VkClearValue ClearValue);  // Attachment is cleared on load instead of loaded
+    // Resolve the pass's multisampled colour attachment Source into the single sampled Destination, inside the subpass
+    void ResolveImage(RenderGraphPass Pass, RenderGraphResource Source, RenderGraphResource Destination);
+    // Graphics pass whose render pass is begun for secondary command buffers: Record may only vkCmdExecuteCommands
+    // buffers recorded with GetInheritanceInfo. Can be switched between frames
+    void SetSecondaryCommandBuffers(RenderGraphPass Pass, bool bEnabled);
+    // Recorded around every pass (outside its render pass, after its barriers), e.g. timestamps and queries
+    void SetPassInstrumentation(std::function<void(VkCommandBuffer, RenderGraphPass)> OnPassBegin,
+                                std::function<void(VkCommandBuffer, RenderGraphPass)> OnPassEnd);
+    // Pipeline statistics a query active in the primary buffer counts while secondary buffers execute (inheritedQueries)
+    void SetInheritedPipelineStatistics(VkQueryPipelineStatisticFlags Statistics);
+
+    // -- COMPILATION --
+    void Compile();
+
+    bool IsPassActive(RenderGraphPass Pass) const;
+    bool IsPassRecordedInSecondaries(RenderGraphPass Pass) const;
+    const std::string& GetPassName(RenderGraphPass Pass) const;
+    uint32_t GetPassCount() const;
+    VkRenderPass GetRenderPass(RenderGraphPass Pass) const;     // For pipeline creation, VK_NULL_HANDLE for culled or compute passes
+    VkImageView GetImageView(RenderGraphResource Resource, uint32_t Variant = 0) const;
+    VkDeviceSize GetTransientMemorySize() const;                // Device memory used by transients after aliasing
+    VkDeviceSize GetUnaliasedTransientMemorySize() const;       // What the transients would use with memory each
+
+    // -- EXECUTION --
+    void Execute(VkCommandBuffer CommandBuffer, uint32_t Variant);
+    VkCommandBufferInheritanceInfo GetInheritanceInfo(RenderGraphPass Pass) const;    // Only while Execute records Pass
+
+private:
+    // Layout, stages and access of one kind of use
+    struct AccessInfo
+    {
+        VkImageLayout Layout;
+        VkPipelineStageFlags2KHR Stages;
+        VkAccessFlags2KHR Access;
+        bool bWrite;
+    };
+
+    struct ImageResource
+    {
+        std::string Name;
+        VkFormat Format;
+        VkExtent2D Extent;
+        VkImageAspectFlags AspectFlags;
+        VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+        bool bImported;
+
+        // Imported state
+        VkPipelineStageFlags2KHR InitialStages = 0;
+        VkImageLayout FinalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        std::vector<VkImage> Images;                    // One per variant (imported) or one (transient)
+        std::vector<VkImageView> ImageViews;
+
+        // Transient allocation
+        VkImageUsageFlags Usage = 0;
+        uint32_t MemoryBlock = UINT32_MAX;
+        uint32_t FirstPass = UINT32_MAX;                // Lifetime in execution order, over active passes only
+        uint32_t LastPass = 0;
+        bool bLazy = false;                             // Attachment of a single pass, backed by lazily allocated memory
+    };
+
+    struct ImageUse
+    {
+        RenderGraphResource Resource;
+        RenderGraphAccess Access;
+        VkPipelineStageFlags2KHR Stages;
+        RenderGraphResource ResolveSource = UINT32_MAX; // ColourResolve only
+        bool bClear = false;
+        VkClearValue ClearValue = {};
+    };
+
+    // Barrier worked out by Compile, the image handle is filled in per variant when executing
+    struct PlannedBarrier
+    {
+        RenderGraphResource Resource;
+        VkImageLayout OldLayout;
+        VkImageLayout NewLayout;
+        VkPipelineStageFlags2KHR SrcStages;
+        VkAccessFlags2KHR SrcAccess;
+        VkPipelineStageFlags2KHR DstStages;
+        VkAccessFlags2KHR DstAccess;
+    };
+
+    struct PassNode
+    {
+        std::string Name;
+        RenderGraphPassType Type;
+        std::function<void(VkCommandBuffer)> Record;
+        std::vector<ImageUse> Uses;
+        bool bSideEffects = false;
+        bool bActive = false;
+        bool bSecondaryCommandBuffers = false;
+
+        std::vector<PlannedBarrier> Barriers;           // Recorded before the pass
+        VkRenderPass RenderPass = VK_NULL_HANDLE;
+        std::vector<VkFramebuffer> Framebuffers;        // One per variant
+        std::vector<VkClearValue> ClearValues;          // One per attachment
+        VkExtent2D Extent = {};
+    };
+
+    // Device memory shared by transient images whose lifetimes don't overlap
+    struct MemoryBlock
+    {
+        VkDeviceSize Size = 0;
+        VkDeviceSize Alignment = 1;
+        uint32_t MemoryTypeBits = UINT32_MAX;
+        bool bLazy = false;                             // Only holds lazy images
+        std::vector<RenderGraphResource> Occupants;     // In order of first use
+        VkDeviceMemory Memory = VK_NULL_HANDLE;
+    };
+
+    VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice Device = VK_NULL_HANDLE;
+
+    std::vector<ImageResource> Resources;
+    std::vector<PassNode> Passes;
+    std::vector<uint32_t> ExecutionOrder;               // Active passes
+    std::vector<MemoryBlock> MemoryBlocks;
+    std::vector<PlannedBarrier> FinalBarriers;          // Imported images into their final layout
+    BarrierBatch Batch;                                 // Reused to record the planned barriers
+    VkDeviceSize UnaliasedMemorySize = 0;
+    uint32_t ExecutingVariant = 0;                      // Variant of the frame Execute is recording
+    std::function<void(VkCommandBuffer, RenderGraphPass)> PassBeginInstrumentation;
+    std::function<void(VkCommandBuffer, RenderGraphPass)> PassEndInstrumentation;
+    VkQueryPipelineStatisticFlags InheritedPipelineStatistics = 0;
+
+    static AccessInfo GetAccessInfo(RenderGraphAccess Access, VkPipelineStageFlags2KHR Stages);
+
+    void CullPasses();
+    void CreateTransientImages();
+    void PlanBarriers();
+    void CreateRenderPasses();
+    void RecordBarriers(VkCommandBuffer CommandBuffer, const std::vector<PlannedBarrier>& Barriers, uint32_t Variant, const char* Label);
+};
@@ -0,0 +1,154 @@
+#include "RenderObjectList.h"
+
+#include <stdexcept>
+
+RenderObjectList::RenderObjectList()
+{
+}
+
+RenderObjectList::~RenderObjectList()
+{
+}
+
+RenderObjectHandle RenderObjectList::Add(const Mesh& NewMesh, const glm::mat4& Transform, uint32_t MaterialId)
+{
+    // Reuse a released slot if there is one, otherwise grow the slot table
+    uint32_t Slot;
+    if (!FreeSlots.empty())
+    {
+        Slot = FreeSlots.back();
+        FreeSlots.pop_back();
+    }
+    else
+    {
+        Slot = static_cast<uint32_t>(SlotToDense.size());
+        SlotToDense.push_back(0);
+        SlotGenerations.push_back(0);
+    }
+
+    // New object always goes to the end of the dense arrays
+    uint32_t DenseIndex = static_cast<uint32_t>(VertexBuffers.size());
+    SlotToDense[Slot] = DenseIndex;
+
+    VertexBuffers.push_back(NewMesh.GetVertexBuffer());
+    IndexBuffers.push_back(NewMesh.GetIndexBuffer());
+    VertexCounts.push_back(static_cast<uint32_t>(NewMesh.GetVertexCount()));
+    IndexCounts.push_back(static_cast<uint32_t>(NewMesh.GetIndexCount()));
+    Bounds.push_back(NewMesh.GetBounds());
+    BoundingSpheres.push_back(NewMesh.GetBoundingSphere());
+    Transforms.push_back(Transform);
+    MaterialIds.push_back(MaterialId);
+    Meshes.push_back(NewMesh);
+    DenseToSlot.push_back(Slot);
+
+    RenderObjectHandle Handle = {};
+    Handle.Index = Slot;
+    Handle.Generation = SlotGenerations[Slot];
+    return Handle;
+}
+
+void RenderObjectList::Remove(RenderObjectHandle Handle)
+{
+    uint32_t DenseIndex = GetDenseIndex(Handle);
+    uint32_t LastIndex = static_cast<uint32_t>(VertexBuffers.size()) - 1;
+
+    Meshes[DenseIndex].DestroyMeshBuffers();
+
+    // Move last object into the hole so the arrays stay packed
+    if (DenseIndex != LastIndex)
+    {
+        VertexBuffers[DenseIndex] = VertexBuffers[LastIndex];
+        IndexBuffers[DenseIndex] = IndexBuffers[LastIndex];
+        VertexCounts[DenseIndex] = VertexCounts[LastIndex];
+        IndexCounts[DenseIndex] = IndexCounts[LastIndex];
+        Bounds[DenseIndex] = Bounds[LastIndex];
+        BoundingSpheres[DenseIndex] = BoundingSpheres[LastIndex];
+        Transforms[DenseIndex] = Transforms[LastIndex];
+        MaterialIds[DenseIndex] = MaterialIds[LastIndex];
+        Meshes[DenseIndex] = Meshes[LastIndex];
+
+        // Point the moved object's slot at its new position
+        uint32_t MovedSlot = DenseToSlot[LastIndex];
+        DenseToSlot[DenseIndex] = MovedSlot;
+        SlotToDense[MovedSlot] = DenseIndex;
+    }
+
+    VertexBuffers.pop_back();
+    IndexBuffers.pop_back();
+    VertexCounts.pop_back();
+    IndexCounts.pop_back();
+    Bounds.pop_back();
+    BoundingSpheres.pop_back();
+    Transforms.pop_back();
+    MaterialIds.pop_back();
+    Meshes.pop_back();
+    DenseToSlot.pop_back();
+
+    // Invalidate every handle still pointing at this slot, then release it
+    SlotGenerations[Handle.Index]++;
+    FreeSlots.push_back(Handle.Index);
+}
+
+void RenderObjectList::Clear()
+{
+    for (auto& ObjectMesh : Meshes)
+    {
+        ObjectMesh.DestroyMeshBuffers();
+    }
+
+    VertexBuffers.clear();
+    IndexBuffers.clear();
+    VertexCounts.clear();
+    IndexCounts.clear();
+    Bounds.clear();
+    BoundingSpheres.clear();
+    Transforms.clear();
+    MaterialIds.clear();
+    Meshes.clear();
+    DenseToSlot.clear();
+
+    // Bump every generation so no old handle survives the clear
+    FreeSlots.clear();
+    for (uint32_t Slot = 0; Slot < SlotGenerations.size(); Slot++)
+    {
+        SlotGenerations[Slot]++;
+        FreeSlots.push_back(Slot);
+    }
+}
+
+bool RenderObjectList::IsValid(RenderObjectHandle Handle) const
+{
+    return Handle.Index < SlotGenerations.size() && SlotGenerations[Handle.Index] == Handle.Generation;
+}
+
+size_t RenderObjectList::Size() const
+{
+    return VertexBuffers.size();
+}
+
+void RenderObjectList::SetTransform(RenderObjectHandle Handle, const glm::mat4& Transform)
+{
+    Transforms[GetDenseIndex(Handle)] = Transform;
+}
+
+void RenderObjectList::SetMaterialId(RenderObjectHandle Handle, uint32_t MaterialId)
+{
+    MaterialIds[GetDenseIndex(Handle)] = MaterialId;
+}
+
+void RenderObjectList::SetBounds(RenderObjectHandle Handle, const BoundingBox& NewBounds)
+{
+    Bounds[GetDenseIndex(Handle)] = NewBounds;
+}
+
+void RenderObjectList::SetBoundingSphere(RenderObjectHandle Handle, const glm::vec4& Sphere)
+{
+    BoundingSpheres[GetDenseIndex(Handle)] = Sphere;
+}
+
+uint32_t RenderObjectList::GetDenseIndex(RenderObjectHandle Handle) const
+{
+    if (!IsValid(Handle)) throw std::runtime_error("Invalid or stale RenderObjectHandle");
+
+    return SlotToDense[Handle.Index];
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "Utilities.h"
+#include "Mesh.h"
+
+// Handle to an object inside a RenderObjectList. Index selects a slot, Generation is bumped every time
+// the slot is released so stale handles to removed objects can be detected
+struct RenderObjectHandle
+{
+    uint32_t Index = UINT32_MAX;
+    uint32_t Generation = 0;
+};
+
+// Structure-of-arrays storage for every object the renderer draws.
+// Each attribute lives in its own dense array, so loops that only need (for example) bounds or index counts
+// walk contiguous memory instead of striding through whole Mesh objects.
+// Objects are kept packed: removing one moves the last object into its place (swap-remove)
+class RenderObjectList
+{
+public:
+    RenderObjectList();
+    ~RenderObjectList();
+
+    RenderObjectHandle Add(const Mesh& NewMesh, const glm::mat4& Transform = glm::mat4(1.0f), uint32_t MaterialId = 0);
+    void Remove(RenderObjectHandle Handle);               // Caller must make sure the GPU is done with the object's buffers
+    void Clear();                                         // Destroys the buffers of every object
+    bool IsValid(RenderObjectHandle Handle) const;
+
+    size_t Size() const;
+
+    void SetTransform(RenderObjectHandle Handle, const glm::mat4& Transform);
+    void SetMaterialId(RenderObjectHandle Handle, uint32_t MaterialId);
+    void SetBounds(RenderObjectHandle Handle, const BoundingBox& Bounds);             // Objects start with their mesh's bounds
+    void SetBoundingSphere(RenderObjectHandle Handle, const glm::vec4& Sphere);
+
+    // Dense arrays, all indexed the same way (0 .. Size() - 1). Order changes whenever an object is removed
+    const std::vector<VkBuffer>& GetVertexBuffers() const { return VertexBuffers; }
+    const std::vector<VkBuffer>& GetIndexBuffers() const { return IndexBuffers; }
+    const std::vector<uint32_t>& GetVertexCounts() const { return VertexCounts; }
+    const std::vector<uint32_t>& GetIndexCounts() const { return IndexCounts; }
+    const std::vector<BoundingBox>& GetBounds() const { return Bounds; }
+    const std::vector<glm::vec4>& GetBoundingSpheres() const { return BoundingSpheres; }
+    const std::vector<glm::mat4>& GetTransforms() const { return Transforms; }
+    const std::vector<uint32_t>& GetMaterialIds() const { return MaterialIds; }
+
+private:
+    // -- DENSE (HOT) DATA --
+    std::vector<VkBuffer> VertexBuffers;
+    std::vector<VkBuffer> IndexBuffers;
+    std::vector<uint32_t> VertexCounts;
+    std::vector<uint32_t> IndexCounts;
+    std::vector<BoundingBox> Bounds;                      // Object space
+    std::vector<glm::vec4> BoundingSpheres;               // Object space, xyz centre, w radius
+    std::vector<glm::mat4> Transforms;
+    std::vector<uint32_t> MaterialIds;
+
+    // -- DENSE (COLD) DATA --
+    std::vector<Mesh> Meshes;                             // Owns the device memory, only touched on add/remove/cleanup
+    std::vector<uint32_t> DenseToSlot;                    // Which slot points at each dense element
+
+    // -- SLOTS --
+    std::vector<uint32_t> SlotToDense;                    // Dense index for each slot
+    std::vector<uint32_t> SlotGenerations;                // Current generation for each slot
+    std::vector<uint32_t> FreeSlots;                      // Released slots ready to be reused
+
+    uint32_t GetDenseIndex(RenderObjectHandle Handle) const;
+};
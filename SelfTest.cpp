@@ -0,0 +1,238 @@
+#include "SelfTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GLM/gtc/matrix_transform.hpp"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include "TransformKernels.h"
+
+namespace
+{
+    // Not multiples of 8 or 16 (so every SIMD path has a tail), the last one past CULL_PARALLEL_THRESHOLD
+    const size_t CULL_TEST_COUNTS[] = { 1, 7, 9, 15, 17, 31, 33, 1001, 20011 };
+    const uint32_t CULL_TEST_SEED = 1234;
+
+    // Volumes closer than this to a plane may land on either side depending on FMA contraction, in the perspective test
+    const float CULL_TEST_TOLERANCE = 1e-4f;
+
+    struct TestVolumes
+    {
+        std::vector<BoundingBox> Boxes;
+        std::vector<glm::vec4> Spheres;
+    };
+
+    // Same planes as FrustumCuller::SetFrustum, in double so the test can tell how close a volume is to one
+    void GetFrustumPlanes(const glm::mat4& ViewProjection, glm::dvec4 Planes[6])
+    {
+        glm::dmat4 Transposed = glm::transpose(glm::dmat4(ViewProjection));
+        glm::dvec4 Equations[6] = { Transposed[3] + Transposed[0], Transposed[3] - Transposed[0], Transposed[3] + Transposed[1],
+                                    Transposed[3] - Transposed[1], Transposed[2], Transposed[3] - Transposed[2] };
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            Planes[p] = Equations[p] / glm::length(glm::dvec3(Equations[p]));
+        }
+    }
+
+    // Smallest distance (centre distance plus reach) of a volume to any plane, negative when it is outside one
+    double GetPlaneMargin(const glm::dvec4 Planes[6], glm::dvec3 Centre, glm::dvec3 Extent, bool bSphere)
+    {
+        double Margin = std::numeric_limits<double>::max();
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            glm::dvec3 Normal = glm::dvec3(Planes[p]);
+            double Reach = bSphere ? Extent.x : glm::dot(glm::abs(Normal), Extent);
+            Margin = std::min(Margin, glm::dot(Normal, Centre) + Planes[p].w + Reach);
+        }
+        return Margin;
+    }
+
+    // Orthographic frustum over x, y in [-8, 8] and z in [-16, 0]: its planes have unit axis normals and integer distances,
+    // so with quarter unit volumes every path computes exactly the same distances and volumes can touch a plane exactly
+    const glm::mat4 EXACT_FRUSTUM = glm::orthoRH_ZO(-8.0f, 8.0f, -8.0f, 8.0f, 0.0f, 16.0f);
+
+    TestVolumes MakeExactVolumes(size_t Count, std::mt19937& Random)
+    {
+        std::uniform_int_distribution<int> Quarter(-80, 80);                   // Centres in [-20, 20]
+        std::uniform_int_distribution<int> Size(0, 16);                        // Extents in [0, 4]
+        std::uniform_int_distribution<int> Kind(0, 3);
+        std::uniform_int_distribution<int> Axis(0, 5);
+
+        // Plane each axis/side pair touches from outside: -x at -8, +x at 8, -y at -8, +y at 8, far (-z) at -16, near (+z) at 0
+        const float TOUCH_COORDINATES[6] = { -8.0f, 8.0f, -8.0f, 8.0f, -16.0f, 0.0f };
+
+        TestVolumes Volumes;
+        for (size_t i = 0; i < Count; i++)
+        {
+            glm::vec3 Centre = glm::vec3(Quarter(Random), Quarter(Random), Quarter(Random) - 40) * 0.25f;
+            glm::vec3 Extent = glm::vec3(Size(Random), Size(Random), Size(Random)) * 0.25f;
+
+            switch (Kind(Random))
+            {
+            case 0:
+                // Touching a plane from outside, on the boundary of being culled
+            {
+                int Side = Axis(Random);
+                float Direction = Side % 2 ? 1.0f : -1.0f;
+                Centre[Side / 2] = TOUCH_COORDINATES[Side] + Direction * Extent[Side / 2];
+                Extent = glm::vec3(Extent[Side / 2]);                          // Cube, so the sphere of the same radius touches too
+                break;
+            }
+            case 1:
+                // Just past a plane, must always be culled
+            {
+                int Side = Axis(Random);
+                float Direction = Side % 2 ? 1.0f : -1.0f;
+                Centre[Side / 2] = TOUCH_COORDINATES[Side] + Direction * (Extent[Side / 2] + 0.25f);
+                Extent = glm::vec3(Extent[Side / 2]);
+                break;
+            }
+            default:
+                break;
+            }
+
+            BoundingBox Box;
+            Box.Min = Centre - Extent;
+            Box.Max = Centre + Extent;
+            if (i % 97 == 3) Box = BoundingBox();                              // No bounds, never culled
+            Volumes.Boxes.push_back(Box);
+            Volumes.Spheres.push_back(glm::vec4(Centre, Extent.x));
+        }
+        return Volumes;
+    }
+
+    TestVolumes MakeRandomVolumes(size_t Count, std::mt19937& Random)
+    {
+        std::uniform_real_distribution<float> Position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> Size(0.0f, 5.0f);
+
+        TestVolumes Volumes;
+        for (size_t i = 0; i < Count; i++)
+        {
+            glm::vec3 Centre = glm::vec3(Position(Random), Position(Random), Position(Random));
+            glm::vec3 Extent = glm::vec3(Size(Random), Size(Random), Size(Random));
+
+            BoundingBox Box;
+            Box.Min = Centre - Extent;
+            Box.Max = Centre + Extent;
+            Volumes.Boxes.push_back(Box);
+            Volumes.Spheres.push_back(glm::vec4(Centre, Extent.x));
+        }
+        return Volumes;
+    }
+
+    // Every volume one path keeps and the other doesn't must be within the tolerance of a plane (none at all when bExact)
+    bool CompareCullResults(const std::vector<uint32_t>& Reference, const std::vector<uint32_t>& Result, const TestVolumes& Volumes,
+                            bool bSpheres, const glm::dvec4 Planes[6], bool bExact, std::string& Failure)
+    {
+        std::vector<bool> InReference(Volumes.Boxes.size(), false);
+        std::vector<bool> InResult(Volumes.Boxes.size(), false);
+        for (size_t i = 0; i < Reference.size(); i++)
+        {
+            if (i > 0 && Reference[i] <= Reference[i - 1]) Failure = "reference indices not ascending";
+            InReference[Reference[i]] = true;
+        }
+        for (size_t i = 0; i < Result.size(); i++)
+        {
+            if (i > 0 && Result[i] <= Result[i - 1])
+            {
+                Failure = "indices not ascending";
+                return false;
+            }
+            InResult[Result[i]] = true;
+        }
+
+        for (size_t i = 0; i < InReference.size(); i++)
+        {
+            if (InReference[i] == InResult[i]) continue;
+
+            const BoundingBox& Box = Volumes.Boxes[i];
+            glm::dvec3 Centre = bSpheres ? glm::dvec3(Volumes.Spheres[i]) : glm::dvec3(Box.Min + Box.Max) * 0.5;
+            glm::dvec3 Extent = bSpheres ? glm::dvec3(Volumes.Spheres[i].w) : glm::dvec3(Box.Max - Box.Min) * 0.5;
+            if (!bExact && std::abs(GetPlaneMargin(Planes, Centre, Extent, bSpheres)) <= CULL_TEST_TOLERANCE) continue;
+
+            Failure = "volume " + std::to_string(i) + (InReference[i] ? " culled, scalar keeps it" : " kept, scalar culls it");
+            return false;
+        }
+        return Failure.empty();
+    }
+
+    // FrustumCuller::Cull at every supported SIMD level (and split across workers) against the scalar path
+    uint32_t TestFrustumCuller(JobSystem& Jobs)
+    {
+        uint32_t Failures = 0;
+        std::mt19937 Random(CULL_TEST_SEED);
+
+        glm::mat4 Projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 1.5f, 0.1f, 150.0f);
+        glm::mat4 View = glm::lookAt(glm::vec3(3.0f, 2.0f, 1.0f), glm::vec3(20.0f, -5.0f, 30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        const glm::mat4 PERSPECTIVE_FRUSTUM = Projection * View;
+
+        for (bool bExact : { true, false })
+        {
+            const glm::mat4& ViewProjection = bExact ? EXACT_FRUSTUM : PERSPECTIVE_FRUSTUM;
+            glm::dvec4 Planes[6];
+            GetFrustumPlanes(ViewProjection, Planes);
+
+            for (size_t Count : CULL_TEST_COUNTS)
+            {
+                TestVolumes Volumes = bExact ? MakeExactVolumes(Count, Random) : MakeRandomVolumes(Count, Random);
+
+                for (bool bSpheres : { false, true })
+                {
+                    FrustumCuller Culler;
+                    Culler.SetFrustum(ViewProjection);
+                    if (bSpheres) Culler.SetSpheres(Volumes.Spheres.data(), Count);
+                    else Culler.SetBoxes(Volumes.Boxes.data(), Count);
+
+                    std::vector<uint32_t> Reference;
+                    SetSimdLevel(SimdLevel::Scalar);
+                    Culler.Cull(Reference);
+
+                    for (SimdLevel Level : { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2, SimdLevel::Avx512 })
+                    {
+                        if (Level > GetSupportedSimdLevel()) continue;
+                        SetSimdLevel(Level);
+
+                        for (bool bParallel : { false, true })
+                        {
+                            std::vector<uint32_t> Visible;
+                            Culler.Cull(Visible, bParallel ? &Jobs : nullptr);
+
+                            std::string Failure;
+                            if (CompareCullResults(Reference, Visible, Volumes, bSpheres, Planes, bExact, Failure)) continue;
+
+                            std::cout << "FAILED FrustumCuller " << (bExact ? "exact" : "perspective") << " " << (bSpheres ? "spheres" : "boxes")
+                                      << " x" << Count << " " << GetSimdLevelName(Level) << (bParallel ? " parallel" : "") << ": " << Failure << std::endl;
+                            Failures++;
+                        }
+                    }
+                }
+            }
+        }
+        return Failures;
+    }
+}
+
+int RunSelfTests()
+{
+    // At least two workers, so the parallel cull path runs even on single core machines
+    JobSystem Jobs;
+    Jobs.Create(std::max(2u, std::thread::hardware_concurrency()));
+    SimdLevel StartLevel = GetSimdLevel();
+
+    std::cout << "Self test, SIMD paths up to " << GetSimdLevelName(GetSupportedSimdLevel()) << ", " << Jobs.GetWorkerCount() << " workers" << std::endl;
+    uint32_t Failures = TestFrustumCuller(Jobs);
+    std::cout << "FrustumCuller: " << (Failures == 0 ? "passed" : std::to_string(Failures) + " failures") << std::endl;
+
+    SetSimdLevel(StartLevel);
+    Jobs.Destroy();
+    return Failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
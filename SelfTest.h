@@ -0,0 +1,6 @@
+#pragma once
+
+// Checks of the CPU kernels that don't need a window or a device, run with the --self-test argument.
+// Every SIMD path the machine supports is compared against the scalar one. Prints each failure, returns
+// EXIT_SUCCESS when everything matched
+int RunSelfTests();
@@ -0,0 +1,476 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    const uint32_t SPIRV_MAGIC = 0x07230203;
+    const uint32_t SPIRV_HEADER_WORDS = 5;                  // Magic, version, generator, id bound, schema
+
+    // Opcodes the reflection needs (SPIR-V specification, section 3.32)
+    const uint32_t SPIRV_OP_ENTRY_POINT = 15;
+    const uint32_t SPIRV_OP_TYPE_BOOL = 20;
+    const uint32_t SPIRV_OP_TYPE_INT = 21;
+    const uint32_t SPIRV_OP_TYPE_FLOAT = 22;
+    const uint32_t SPIRV_OP_TYPE_VECTOR = 23;
+    const uint32_t SPIRV_OP_TYPE_MATRIX = 24;
+    const uint32_t SPIRV_OP_TYPE_IMAGE = 25;
+    const uint32_t SPIRV_OP_TYPE_SAMPLER = 26;
+    const uint32_t SPIRV_OP_TYPE_SAMPLED_IMAGE = 27;
+    const uint32_t SPIRV_OP_TYPE_ARRAY = 28;
+    const uint32_t SPIRV_OP_TYPE_RUNTIME_ARRAY = 29;
+    const uint32_t SPIRV_OP_TYPE_STRUCT = 30;
+    const uint32_t SPIRV_OP_TYPE_POINTER = 32;
+    const uint32_t SPIRV_OP_CONSTANT = 43;
+    const uint32_t SPIRV_OP_SPEC_CONSTANT = 50;
+    const uint32_t SPIRV_OP_VARIABLE = 59;
+    const uint32_t SPIRV_OP_DECORATE = 71;
+    const uint32_t SPIRV_OP_MEMBER_DECORATE = 72;
+
+    // Decorations
+    const uint32_t SPIRV_DECORATION_BUFFER_BLOCK = 3;
+    const uint32_t SPIRV_DECORATION_ARRAY_STRIDE = 6;
+    const uint32_t SPIRV_DECORATION_MATRIX_STRIDE = 7;
+    const uint32_t SPIRV_DECORATION_LOCATION = 30;
+    const uint32_t SPIRV_DECORATION_BINDING = 33;
+    const uint32_t SPIRV_DECORATION_DESCRIPTOR_SET = 34;
+    const uint32_t SPIRV_DECORATION_OFFSET = 35;
+
+    // Storage classes
+    const uint32_t SPIRV_STORAGE_UNIFORM_CONSTANT = 0;
+    const uint32_t SPIRV_STORAGE_INPUT = 1;
+    const uint32_t SPIRV_STORAGE_UNIFORM = 2;
+    const uint32_t SPIRV_STORAGE_PUSH_CONSTANT = 9;
+    const uint32_t SPIRV_STORAGE_STORAGE_BUFFER = 12;
+
+    // Image dimensions
+    const uint32_t SPIRV_DIM_BUFFER = 5;
+    const uint32_t SPIRV_DIM_SUBPASS_DATA = 6;
+
+    const uint32_t NOT_DECORATED = UINT32_MAX;
+
+    // Everything known about one result id once the module has been walked
+    struct SpirvId
+    {
+        uint32_t Opcode = 0;
+        std::vector<uint32_t> Operands;                     // Words after the result id (types), or [type, storage class] (variables)
+        uint32_t ConstantValue = 0;                         // Low word of OpConstant / default of OpSpecConstant
+
+        uint32_t Set = NOT_DECORATED;
+        uint32_t Binding = NOT_DECORATED;
+        uint32_t Location = NOT_DECORATED;
+        uint32_t ArrayStride = 0;
+        bool bBufferBlock = false;
+        std::vector<uint32_t> MemberOffsets;                // Structs only
+        std::vector<uint32_t> MemberMatrixStrides;
+    };
+
+    class SpirvModule
+    {
+    public:
+        SpirvModule(const std::vector<char>& Code)
+        {
+            if (Code.size() % 4 != 0 || Code.size() < SPIRV_HEADER_WORDS * 4) throw std::runtime_error("Failed to reflect shader: not a SPIR-V module");
+
+            std::vector<uint32_t> Words(Code.size() / 4);
+            std::memcpy(Words.data(), Code.data(), Code.size());
+            if (Words[0] != SPIRV_MAGIC) throw std::runtime_error("Failed to reflect shader: not a SPIR-V module");
+
+            Ids.resize(Words[3]);
+
+            for (size_t i = SPIRV_HEADER_WORDS; i < Words.size();)
+            {
+                uint32_t WordCount = Words[i] >> 16;
+                uint32_t Opcode = Words[i] & 0xFFFF;
+                if (WordCount == 0 || i + WordCount > Words.size()) throw std::runtime_error("Failed to reflect shader: truncated instruction");
+
+                const uint32_t* Instruction = &Words[i];
+                ReadInstruction(Opcode, Instruction, WordCount);
+                i += WordCount;
+            }
+
+            if (!bHasEntryPoint) throw std::runtime_error("Failed to reflect shader: no entry point");
+        }
+
+        VkShaderStageFlagBits Stage = VK_SHADER_STAGE_VERTEX_BIT;
+        std::vector<SpirvId> Ids;
+        std::vector<uint32_t> Variables;
+
+        const SpirvId& Get(uint32_t Id) const
+        {
+            if (Id >= Ids.size()) throw std::runtime_error("Failed to reflect shader: id out of bounds");
+            return Ids[Id];
+        }
+
+        // Bytes a value of Type takes in a buffer laid out with explicit offsets and strides
+        uint32_t GetTypeSize(uint32_t Type, uint32_t MatrixStride = 0) const
+        {
+            const SpirvId& Id = Get(Type);
+            switch (Id.Opcode)
+            {
+            case SPIRV_OP_TYPE_BOOL:
+                return 4;
+            case SPIRV_OP_TYPE_INT:
+            case SPIRV_OP_TYPE_FLOAT:
+                return Id.Operands[0] / 8;
+            case SPIRV_OP_TYPE_VECTOR:
+                return Id.Operands[1] * GetTypeSize(Id.Operands[0]);
+            case SPIRV_OP_TYPE_MATRIX:
+                return Id.Operands[1] * (MatrixStride != 0 ? MatrixStride : GetTypeSize(Id.Operands[0]));
+            case SPIRV_OP_TYPE_ARRAY:
+            {
+                uint32_t Stride = Id.ArrayStride != 0 ? Id.ArrayStride : GetTypeSize(Id.Operands[0]);
+                return Get(Id.Operands[1]).ConstantValue * Stride;
+            }
+            case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+                return 0;
+            case SPIRV_OP_TYPE_STRUCT:
+            {
+                // Members can be declared out of offset order, the struct ends where its furthest member does
+                uint32_t Size = 0;
+                for (size_t m = 0; m < Id.Operands.size(); m++)
+                {
+                    uint32_t Offset = m < Id.MemberOffsets.size() ? Id.MemberOffsets[m] : 0;
+                    uint32_t Stride = m < Id.MemberMatrixStrides.size() ? Id.MemberMatrixStrides[m] : 0;
+                    Size = std::max(Size, Offset + GetTypeSize(Id.Operands[m], Stride));
+                }
+                return Size;
+            }
+            default:
+                throw std::runtime_error("Failed to reflect shader: type without a size");
+            }
+        }
+
+    private:
+        bool bHasEntryPoint = false;
+
+        SpirvId& GetMutable(uint32_t Id)
+        {
+            if (Id >= Ids.size()) throw std::runtime_error("Failed to reflect shader: id out of bounds");
+            return Ids[Id];
+        }
+
+        void ReadInstruction(uint32_t Opcode, const uint32_t* Instruction, uint32_t WordCount)
+        {
+            switch (Opcode)
+            {
+            case SPIRV_OP_ENTRY_POINT:
+                // Only the first entry point is reflected, glslang emits one per module
+                if (!bHasEntryPoint) Stage = GetStage(Instruction[1]);
+                bHasEntryPoint = true;
+                break;
+
+            case SPIRV_OP_TYPE_BOOL:
+            case SPIRV_OP_TYPE_INT:
+            case SPIRV_OP_TYPE_FLOAT:
+            case SPIRV_OP_TYPE_VECTOR:
+            case SPIRV_OP_TYPE_MATRIX:
+            case SPIRV_OP_TYPE_IMAGE:
+            case SPIRV_OP_TYPE_SAMPLER:
+            case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+            case SPIRV_OP_TYPE_ARRAY:
+            case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+            case SPIRV_OP_TYPE_STRUCT:
+            case SPIRV_OP_TYPE_POINTER:
+            {
+                SpirvId& Id = GetMutable(Instruction[1]);
+                Id.Opcode = Opcode;
+                Id.Operands.assign(Instruction + 2, Instruction + WordCount);
+                break;
+            }
+
+            case SPIRV_OP_CONSTANT:
+            case SPIRV_OP_SPEC_CONSTANT:
+            {
+                SpirvId& Id = GetMutable(Instruction[2]);
+                Id.Opcode = Opcode;
+                Id.ConstantValue = WordCount > 3 ? Instruction[3] : 0;
+                break;
+            }
+
+            case SPIRV_OP_VARIABLE:
+            {
+                SpirvId& Id = GetMutable(Instruction[2]);
+                Id.Opcode = Opcode;
+                Id.Operands = { Instruction[1], Instruction[3] };
+                Variables.push_back(Instruction[2]);
+                break;
+            }
+
+            case SPIRV_OP_DECORATE:
+            {
+                SpirvId& Id = GetMutable(Instruction[1]);
+                uint32_t Value = WordCount > 3 ? Instruction[3] : 0;
+                switch (Instruction[2])
+                {
+                case SPIRV_DECORATION_BUFFER_BLOCK: Id.bBufferBlock = true; break;
+                case SPIRV_DECORATION_ARRAY_STRIDE: Id.ArrayStride = Value; break;
+                case SPIRV_DECORATION_LOCATION: Id.Location = Value; break;
+                case SPIRV_DECORATION_BINDING: Id.Binding = Value; break;
+                case SPIRV_DECORATION_DESCRIPTOR_SET: Id.Set = Value; break;
+                }
+                break;
+            }
+
+            case SPIRV_OP_MEMBER_DECORATE:
+            {
+                SpirvId& Id = GetMutable(Instruction[1]);
+                uint32_t Member = Instruction[2];
+                uint32_t Value = WordCount > 4 ? Instruction[4] : 0;
+                if (Instruction[3] == SPIRV_DECORATION_OFFSET)
+                {
+                    if (Id.MemberOffsets.size() <= Member) Id.MemberOffsets.resize(Member + 1, 0);
+                    Id.MemberOffsets[Member] = Value;
+                }
+                else if (Instruction[3] == SPIRV_DECORATION_MATRIX_STRIDE)
+                {
+                    if (Id.MemberMatrixStrides.size() <= Member) Id.MemberMatrixStrides.resize(Member + 1, 0);
+                    Id.MemberMatrixStrides[Member] = Value;
+                }
+                break;
+            }
+            }
+        }
+
+        static VkShaderStageFlagBits GetStage(uint32_t ExecutionModel)
+        {
+            switch (ExecutionModel)
+            {
+            case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+            case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+            case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+            case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+            case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+            default: throw std::runtime_error("Failed to reflect shader: unsupported execution model");
+            }
+        }
+    };
+
+    // Descriptor type of a resource variable whose arrays have been stripped down to Type
+    VkDescriptorType GetDescriptorType(const SpirvModule& Module, uint32_t StorageClass, uint32_t Type)
+    {
+        const SpirvId& Id = Module.Get(Type);
+
+        if (StorageClass == SPIRV_STORAGE_STORAGE_BUFFER) return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        if (StorageClass == SPIRV_STORAGE_UNIFORM) return Id.bBufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+        switch (Id.Opcode)
+        {
+        case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case SPIRV_OP_TYPE_SAMPLER:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case SPIRV_OP_TYPE_IMAGE:
+        {
+            uint32_t Dim = Id.Operands[1];
+            bool bStorage = Id.Operands[5] == 2;            // Sampled operand: 1 sampled, 2 read/write
+            if (Dim == SPIRV_DIM_BUFFER) return bStorage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            if (Dim == SPIRV_DIM_SUBPASS_DATA) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            return bStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        default:
+            throw std::runtime_error("Failed to reflect shader: unsupported descriptor type");
+        }
+    }
+
+    VkFormat GetVertexFormat(const SpirvModule& Module, uint32_t Type, uint32_t& Size)
+    {
+        const SpirvId& Id = Module.Get(Type);
+        uint32_t ComponentCount = 1;
+        const SpirvId* Component = &Id;
+        if (Id.Opcode == SPIRV_OP_TYPE_VECTOR)
+        {
+            ComponentCount = Id.Operands[1];
+            Component = &Module.Get(Id.Operands[0]);
+        }
+
+        if ((Component->Opcode != SPIRV_OP_TYPE_FLOAT && Component->Opcode != SPIRV_OP_TYPE_INT) || Component->Operands[0] != 32 || ComponentCount > 4)
+        {
+            throw std::runtime_error("Failed to reflect shader: unsupported vertex input type");
+        }
+
+        static const VkFormat FloatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+        static const VkFormat IntFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+        static const VkFormat UintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+        Size = 4 * ComponentCount;
+        if (Component->Opcode == SPIRV_OP_TYPE_FLOAT) return FloatFormats[ComponentCount - 1];
+        return Component->Operands[1] != 0 ? IntFormats[ComponentCount - 1] : UintFormats[ComponentCount - 1];
+    }
+}
+
+ShaderReflection::ShaderReflection()
+{
+}
+
+ShaderReflection::~ShaderReflection()
+{
+}
+
+void ShaderReflection::AddStage(const std::vector<char>& Code)
+{
+    SpirvModule Module(Code);
+
+    struct VertexInput
+    {
+        uint32_t Location;
+        uint32_t Type;
+    };
+    std::vector<VertexInput> VertexInputs;
+
+    for (uint32_t VariableId : Module.Variables)
+    {
+        const SpirvId& Variable = Module.Get(VariableId);
+        uint32_t StorageClass = Variable.Operands[1];
+        const SpirvId& Pointer = Module.Get(Variable.Operands[0]);
+        uint32_t Type = Pointer.Operands[1];                // OpTypePointer: storage class, pointee
+
+        // -- PUSH CONSTANTS --
+        if (StorageClass == SPIRV_STORAGE_PUSH_CONSTANT)
+        {
+            const SpirvId& Block = Module.Get(Type);
+            uint32_t Begin = Block.MemberOffsets.empty() ? 0 : *std::min_element(Block.MemberOffsets.begin(), Block.MemberOffsets.end());
+            uint32_t End = Module.GetTypeSize(Type);
+
+            if (PushConstantRange.stageFlags == 0)
+            {
+                PushConstantRange.offset = Begin;
+                PushConstantRange.size = End - Begin;
+            }
+            else
+            {
+                uint32_t MergedEnd = std::max(PushConstantRange.offset + PushConstantRange.size, End);
+                PushConstantRange.offset = std::min(PushConstantRange.offset, Begin);
+                PushConstantRange.size = MergedEnd - PushConstantRange.offset;
+            }
+            PushConstantRange.stageFlags |= Module.Stage;
+            continue;
+        }
+
+        // -- VERTEX INPUTS --
+        // Built-ins (gl_VertexIndex...) have no location and don't come from a vertex buffer
+        if (StorageClass == SPIRV_STORAGE_INPUT)
+        {
+            if (Module.Stage == VK_SHADER_STAGE_VERTEX_BIT && Variable.Location != NOT_DECORATED) VertexInputs.push_back({ Variable.Location, Type });
+            continue;
+        }
+
+        // -- DESCRIPTORS --
+        if (StorageClass != SPIRV_STORAGE_UNIFORM_CONSTANT && StorageClass != SPIRV_STORAGE_UNIFORM && StorageClass != SPIRV_STORAGE_STORAGE_BUFFER) continue;
+        if (Variable.Set == NOT_DECORATED || Variable.Binding == NOT_DECORATED) continue;
+
+        // Arrays of resources become the descriptor count, a runtime array is sized by the layout
+        uint32_t DescriptorCount = 1;
+        while (Module.Get(Type).Opcode == SPIRV_OP_TYPE_ARRAY || Module.Get(Type).Opcode == SPIRV_OP_TYPE_RUNTIME_ARRAY)
+        {
+            const SpirvId& Array = Module.Get(Type);
+            DescriptorCount = Array.Opcode == SPIRV_OP_TYPE_ARRAY ? DescriptorCount * Module.Get(Array.Operands[1]).ConstantValue : 0;
+            Type = Array.Operands[0];
+        }
+
+        VkDescriptorSetLayoutBinding Binding = {};
+        Binding.binding = Variable.Binding;
+        Binding.descriptorType = GetDescriptorType(Module, StorageClass, Type);
+        Binding.descriptorCount = DescriptorCount;
+        Binding.stageFlags = Module.Stage;
+
+        auto& SetBindings = Sets[Variable.Set];
+        auto Existing = SetBindings.find(Binding.binding);
+        if (Existing == SetBindings.end())
+        {
+            SetBindings[Binding.binding] = Binding;
+            continue;
+        }
+
+        // Same binding seen from another stage
+        if (Existing->second.descriptorType != Binding.descriptorType)
+        {
+            throw std::runtime_error("Failed to reflect shader: stages disagree on the type of set " + std::to_string(Variable.Set)
+                                     + " binding " + std::to_string(Binding.binding));
+        }
+        Existing->second.descriptorCount = std::max(Existing->second.descriptorCount, Binding.descriptorCount);
+        Existing->second.stageFlags |= Binding.stageFlags;
+    }
+
+    if (Module.Stage != VK_SHADER_STAGE_VERTEX_BIT) return;
+
+    // One interleaved stream, attributes in location order with no padding between them
+    std::sort(VertexInputs.begin(), VertexInputs.end(), [](const VertexInput& A, const VertexInput& B) { return A.Location < B.Location; });
+
+    VertexAttributes.clear();
+    VertexStride = 0;
+    for (const VertexInput& Input : VertexInputs)
+    {
+        uint32_t Size;
+        VkVertexInputAttributeDescription Attribute = {};
+        Attribute.binding = 0;
+        Attribute.location = Input.Location;
+        Attribute.format = GetVertexFormat(Module, Input.Type, Size);
+        Attribute.offset = VertexStride;
+
+        VertexAttributes.push_back(Attribute);
+        VertexStride += Size;
+    }
+}
+
+void ShaderReflection::MakeUniformBuffersDynamic(uint32_t Set)
+{
+    auto SetBindings = Sets.find(Set);
+    if (SetBindings == Sets.end()) return;
+
+    for (auto& Binding : SetBindings->second)
+    {
+        if (Binding.second.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) Binding.second.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    }
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::GetSetBindings(uint32_t Set) const
+{
+    std::vector<VkDescriptorSetLayoutBinding> Bindings;
+
+    auto SetBindings = Sets.find(Set);
+    if (SetBindings == Sets.end()) return Bindings;
+
+    for (const auto& Binding : SetBindings->second)
+    {
+        Bindings.push_back(Binding.second);
+    }
+    return Bindings;
+}
+
+std::vector<VkPushConstantRange> ShaderReflection::GetPushConstantRanges() const
+{
+    if (PushConstantRange.stageFlags == 0) return {};
+    return { PushConstantRange };
+}
+
+const std::vector<VkVertexInputAttributeDescription>& ShaderReflection::GetVertexAttributes() const
+{
+    return VertexAttributes;
+}
+
+uint32_t ShaderReflection::GetVertexStride() const
+{
+    return VertexStride;
+}
+
+void ShaderReflection::CheckSetLayout(uint32_t Set, const std::vector<VkDescriptorSetLayoutBinding>& Layout) const
+{
+    for (const VkDescriptorSetLayoutBinding& Used : GetSetBindings(Set))
+    {
+        auto Provided = std::find_if(Layout.begin(), Layout.end(), [&Used](const VkDescriptorSetLayoutBinding& Binding) { return Binding.binding == Used.binding; });
+
+        bool bCompatible = Provided != Layout.end()
+                           && Provided->descriptorType == Used.descriptorType
+                           && Provided->descriptorCount >= std::max(Used.descriptorCount, 1u)
+                           && (Used.stageFlags & ~Provided->stageFlags) == 0;
+        if (!bCompatible)
+        {
+            throw std::runtime_error("Shader set " + std::to_string(Set) + " binding " + std::to_string(Used.binding) + " doesn't match the descriptor set layout");
+        }
+    }
+}
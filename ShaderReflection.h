@@ -0,0 +1,40 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <map>
+#include <vector>
+#include <cstdint>
+
+// Interface of a pipeline's shader stages, read straight from their SPIR-V: descriptor bindings per set,
+// the push constant range and (for the vertex stage) the input attributes. Stages are added one by one and
+// merged, bindings used by several stages get all of their stage flags.
+// Runtime sized arrays (bindless) are reported with descriptorCount 0, the layout they go into sets the size
+class ShaderReflection
+{
+public:
+    ShaderReflection();
+    ~ShaderReflection();
+
+    void AddStage(const std::vector<char>& Code);           // Stage is taken from the module's entry point
+
+    // Shaders can't tell a dynamic uniform buffer from a plain one, the renderer picks per set
+    void MakeUniformBuffersDynamic(uint32_t Set);
+
+    std::vector<VkDescriptorSetLayoutBinding> GetSetBindings(uint32_t Set) const;     // Sorted by binding, empty if the set isn't used
+    std::vector<VkPushConstantRange> GetPushConstantRanges() const;                  // Empty if no stage uses push constants
+
+    // Vertex inputs as one interleaved binding, attributes packed in location order
+    const std::vector<VkVertexInputAttributeDescription>& GetVertexAttributes() const;
+    uint32_t GetVertexStride() const;
+
+    // Throw unless every binding the shaders use in Set exists in Layout with the same type, enough descriptors and the stages
+    void CheckSetLayout(uint32_t Set, const std::vector<VkDescriptorSetLayoutBinding>& Layout) const;
+
+private:
+    std::map<uint32_t, std::map<uint32_t, VkDescriptorSetLayoutBinding>> Sets;        // Set -> binding -> description
+    VkPushConstantRange PushConstantRange = {};
+    std::vector<VkVertexInputAttributeDescription> VertexAttributes;
+    uint32_t VertexStride = 0;
+};
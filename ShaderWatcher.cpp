@@ -0,0 +1,169 @@
+#include "ShaderWatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <shaderc/shaderc.hpp>
+
+namespace
+{
+    const std::chrono::milliseconds SHADER_POLL_INTERVAL = std::chrono::milliseconds(250);
+
+    // Stage from the file extension (or a bare ".vert"), the same convention glslangValidator uses
+    bool GetShaderKind(const std::string& SourceName, shaderc_shader_kind& Kind)
+    {
+        std::string Extension = SourceName[0] == '.' ? SourceName : std::filesystem::path(SourceName).extension().string();
+        if (Extension == ".vert") { Kind = shaderc_glsl_vertex_shader; return true; }
+        if (Extension == ".frag") { Kind = shaderc_glsl_fragment_shader; return true; }
+        if (Extension == ".comp") { Kind = shaderc_glsl_compute_shader; return true; }
+        return false;
+    }
+
+    std::filesystem::file_time_type GetWriteTime(const std::filesystem::path& Path)
+    {
+        std::error_code Error;
+        std::filesystem::file_time_type WriteTime = std::filesystem::last_write_time(Path, Error);
+        return Error ? std::filesystem::file_time_type() : WriteTime;          // Missing (mid save) counts as unchanged until it's back
+    }
+}
+
+ShaderWatcher::ShaderWatcher()
+{
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    Stop();
+}
+
+void ShaderWatcher::Start(const std::string& NewDirectory, const std::vector<std::string>& Extensions,
+                          std::function<void(const std::vector<CompiledShader>&)> NewOnCompiled)
+{
+    Stop();
+
+    Directory = NewDirectory;
+    OnCompiled = NewOnCompiled;
+    bStopRequested = false;
+
+    std::error_code Error;
+    if (!std::filesystem::is_directory(Directory, Error))
+    {
+        std::cout << "Shader hot reload disabled, shader directory " << Directory << " doesn't exist" << std::endl;
+        return;
+    }
+
+    for (const std::string& Extension : Extensions)
+    {
+        shaderc_shader_kind Kind;
+        if (!GetShaderKind(Extension, Kind)) throw std::runtime_error("Unknown shader stage for " + Extension);
+    }
+
+    // Every source with a watched extension, sorted so the order doesn't depend on the file system
+    std::vector<std::string> SourceNames;
+    for (const std::filesystem::directory_entry& Entry : std::filesystem::directory_iterator(Directory, Error))
+    {
+        std::string Extension = Entry.path().extension().string();
+        if (Entry.is_regular_file(Error) && std::find(Extensions.begin(), Extensions.end(), Extension) != Extensions.end())
+        {
+            SourceNames.push_back(Entry.path().filename().string());
+        }
+    }
+    std::sort(SourceNames.begin(), SourceNames.end());
+
+    if (SourceNames.empty())
+    {
+        std::cout << "Shader hot reload disabled, no shader sources in " << Directory << std::endl;
+        return;
+    }
+
+    // Current sources are what the embedded SPIR-V was built from, only later edits trigger a compile
+    Sources.clear();
+    for (const std::string& Name : SourceNames)
+    {
+        Sources.push_back({ Name, GetWriteTime(Directory + Name), {} });
+    }
+
+    Thread = std::thread(&ShaderWatcher::Watch, this);
+}
+
+void ShaderWatcher::Stop()
+{
+    if (!Thread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> Lock(StopMutex);
+        bStopRequested = true;
+    }
+    StopCondition.notify_all();
+    Thread.join();
+}
+
+void ShaderWatcher::Watch()
+{
+    std::unique_lock<std::mutex> Lock(StopMutex);
+    while (!StopCondition.wait_for(Lock, SHADER_POLL_INTERVAL, [this]() { return bStopRequested; }))
+    {
+        Lock.unlock();
+
+        bool bChanged = false;
+        bool bAllCompiled = true;
+        for (WatchedSource& Source : Sources)
+        {
+            std::filesystem::file_time_type WriteTime = GetWriteTime(Directory + Source.Name);
+            if (WriteTime == Source.LastWriteTime) continue;
+
+            Source.LastWriteTime = WriteTime;
+            bChanged |= Compile(Source);
+        }
+
+        // Consumers rebuild from every stage, so sources untouched since startup are compiled the first time too
+        if (bChanged)
+        {
+            std::vector<CompiledShader> Compiled;
+            for (WatchedSource& Source : Sources)
+            {
+                if (Source.Code.empty() && !Compile(Source)) bAllCompiled = false;
+                Compiled.push_back({ Source.Name, Source.Code });
+            }
+
+            if (bAllCompiled) OnCompiled(Compiled);
+        }
+
+        Lock.lock();
+    }
+}
+
+bool ShaderWatcher::Compile(WatchedSource& Source)
+{
+    shaderc_shader_kind Kind;
+    GetShaderKind(Source.Name, Kind);
+
+    std::ifstream File(Directory + Source.Name);
+    if (!File.is_open()) return false;
+
+    std::stringstream Text;
+    Text << File.rdbuf();
+
+    shaderc::Compiler Compiler;
+    shaderc::CompileOptions Options;
+    Options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+    Options.SetOptimizationLevel(shaderc_optimization_level_performance);
+
+    shaderc::SpvCompilationResult Result = Compiler.CompileGlslToSpv(Text.str(), Kind, Source.Name.c_str(), Options);
+    if (Result.GetCompilationStatus() != shaderc_compilation_status_success)
+    {
+        std::cout << "Shader reload failed, keeping the previous version of " << Source.Name << ":\n" << Result.GetErrorMessage() << std::endl;
+        return false;
+    }
+
+    const char* Begin = reinterpret_cast<const char*>(Result.cbegin());
+    const char* End = reinterpret_cast<const char*>(Result.cend());
+    Source.Code.assign(Begin, End);
+
+    std::cout << "Shader reloaded: " << Source.Name << std::endl;
+    return true;
+}
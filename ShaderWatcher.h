@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// SPIR-V of one watched shader source, as last compiled successfully
+struct CompiledShader
+{
+    std::string SourceName;                 // e.g. "shader.vert"
+    std::vector<char> Code;                 // Same layout GetEmbeddedShader gives
+};
+
+// Watches GLSL sources on a background thread and recompiles them in-process with shaderc when they change.
+// Every file in the directory with one of the given extensions is watched; write times are polled, since the
+// project is Windows only and std::filesystem has no change notifications.
+// Nothing is written back, the next build embeds the edited sources (CompileShaders target).
+// OnCompiled runs on the watcher thread with the latest good code of every watched source, so expensive
+// follow-up work (pipeline creation) stays off the render thread; a source that fails to compile keeps
+// its previous code and the error is printed
+class ShaderWatcher
+{
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    // Warns and watches nothing when Directory doesn't exist, e.g. a binary run away from its project
+    void Start(const std::string& Directory, const std::vector<std::string>& Extensions,
+               std::function<void(const std::vector<CompiledShader>&)> OnCompiled);
+    void Stop();                            // Joins the thread, OnCompiled is never called after it returns
+
+private:
+    struct WatchedSource
+    {
+        std::string Name;
+        std::filesystem::file_time_type LastWriteTime;
+        std::vector<char> Code;
+    };
+
+    std::string Directory;
+    std::vector<WatchedSource> Sources;
+    std::function<void(const std::vector<CompiledShader>&)> OnCompiled;
+
+    std::thread Thread;
+    std::mutex StopMutex;
+    std::condition_variable StopCondition;
+    bool bStopRequested = false;
+
+    void Watch();
+    bool Compile(WatchedSource& Source);
+};
@@ -1,9 +1,37 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 inColour;
+layout(location = 1) in vec2 inTex;
+layout(location = 2) flat in uint inMaterialId;
+
+// Matches MaterialData in MaterialTable.h (std430)
+struct Material {
+	vec4 baseColour;
+	uint albedoTexture;
+	uint padding0;
+	uint padding1;
+	uint padding2;
+};
+
+const uint INVALID_SLOT = 0xFFFFFFFF;		// INVALID_BINDLESS_SLOT
+const uint MATERIAL_BUFFER_SLOT = 0;
+
+// Bindless resources (set 1), indexed by slot instead of bound per draw
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+layout(set = 1, binding = 1) readonly buffer MaterialBuffer {
+	Material materials[];
+} buffers[];
 
 layout(location = 0) out vec4 outColour; 	// Final output colour (must also have location
 
 void main() {
-	outColour = vec4(inColour, 1.0);
+	Material material = buffers[MATERIAL_BUFFER_SLOT].materials[inMaterialId];
+
+	vec4 colour = vec4(inColour, 1.0) * material.baseColour;
+	if (material.albedoTexture != INVALID_SLOT) {
+		colour *= texture(textures[nonuniformEXT(material.albedoTexture)], inTex);
+	}
+
+	outColour = colour;
 }
\ No newline at end of file
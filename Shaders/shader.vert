@@ -2,10 +2,37 @@
 
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 col;
+layout(location = 2) in vec2 tex;
+
+layout(set = 0, binding = 0) uniform UboViewProjection {
+	mat4 projection;
+	mat4 view;
+} uboViewProjection;
+
+layout(set = 0, binding = 1) uniform UboModel {
+	mat4 model;
+	uint materialId;
+} uboModel;
+
+layout(push_constant) uniform PushModel {
+	mat4 model;
+	uint materialId;
+} pushModel;
+
+// Set by the renderer: read the model and material from push constants (true) or from the dynamic uniform (false)
+layout(constant_id = 0) const bool USE_PUSH_MODEL = true;
 
 layout(location = 0) out vec3 fragCol;
+layout(location = 1) out vec2 fragTex;
+layout(location = 2) flat out uint fragMaterialId;
+
+// Depth pre-pass and colour pass run this shader separately and compare with EQUAL, so positions must match bit for bit
+invariant gl_Position;
 
 void main() {
-	gl_Position = vec4(pos, 1.0);
+	mat4 model = USE_PUSH_MODEL ? pushModel.model : uboModel.model;
+	gl_Position = uboViewProjection.projection * uboViewProjection.view * model * vec4(pos, 1.0);
 	fragCol = col;
+	fragTex = tex;
+	fragMaterialId = USE_PUSH_MODEL ? pushModel.materialId : uboModel.materialId;
 }
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "StartupScheduler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+StartupScheduler::StartupScheduler()
+{
+}
+
+StartupScheduler::~StartupScheduler()
+{
+}
+
+void StartupScheduler::Begin(JobSystem* NewJobs)
+{
+    Jobs = NewJobs;
+    StartTime = std::chrono::steady_clock::now();
+    Timeline.clear();
+    Deferred.clear();
+}
+
+void StartupScheduler::RunStage(const std::vector<Phase>& Phases)
+{
+    // One chunk per phase, the calling thread takes the first (so put the critical path there)
+    Jobs->ParallelFor(Phases.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t i = Begin; i < End; i++)
+        {
+            RunTimed(Phases[i]);
+        }
+    });
+}
+
+void StartupScheduler::Defer(const char* Name, std::function<void()> Function)
+{
+    Deferred.push_back({ Name, std::move(Function) });
+}
+
+bool StartupScheduler::HasDeferredWork() const
+{
+    return !Deferred.empty();
+}
+
+void StartupScheduler::RunDeferredWork()
+{
+    // Moved out first, deferred work may defer more
+    std::vector<Phase> Work;
+    Work.swap(Deferred);
+    for (const Phase& DeferredPhase : Work)
+    {
+        RunTimed(DeferredPhase);
+    }
+}
+
+void StartupScheduler::Mark(const char* Event)
+{
+    double Now = GetElapsedMs();
+    std::lock_guard<std::mutex> Lock(TimelineMutex);
+    Timeline.push_back({ Event, Now, Now, UINT32_MAX });
+}
+
+void StartupScheduler::Print() const
+{
+    std::vector<TimelineEntry> Sorted;
+    {
+        std::lock_guard<std::mutex> Lock(TimelineMutex);
+        Sorted = Timeline;
+    }
+    std::stable_sort(Sorted.begin(), Sorted.end(), [](const TimelineEntry& A, const TimelineEntry& B) { return A.BeginMs < B.BeginMs; });
+
+    std::cout << "Startup timeline (ms):" << std::endl;
+    for (const TimelineEntry& Entry : Sorted)
+    {
+        std::cout << std::fixed << std::setprecision(1) << std::setw(9) << Entry.BeginMs << " - " << std::setw(9) << Entry.EndMs << "  ";
+        if (Entry.Worker == UINT32_MAX) std::cout << "          ";
+        else std::cout << "worker " << std::setw(2) << Entry.Worker << "  ";
+        std::cout << Entry.Name << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+double StartupScheduler::GetElapsedMs() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+}
+
+void StartupScheduler::RunTimed(const Phase& TimedPhase)
+{
+    double BeginMs = GetElapsedMs();
+    TimedPhase.Function();
+    double EndMs = GetElapsedMs();
+
+    std::lock_guard<std::mutex> Lock(TimelineMutex);
+    Timeline.push_back({ TimedPhase.Name, BeginMs, EndMs, Jobs->GetWorkerIndex() });
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "JobSystem.h"
+
+// Runs renderer startup in stages. The phases of a stage don't depend on each other and run concurrently on the job
+// system, a stage only starts once the previous one has finished. Work the first frame doesn't need is deferred and
+// run after the first present. Every phase is timed, Print shows the whole timeline
+class StartupScheduler
+{
+public:
+    StartupScheduler();
+    ~StartupScheduler();
+
+    struct Phase
+    {
+        const char* Name;
+        std::function<void()> Function;
+    };
+
+    void Begin(JobSystem* NewJobs);                         // Timeline starts here
+
+    // Returns once every phase is done. The first exception thrown by a phase is rethrown here
+    void RunStage(const std::vector<Phase>& Phases);
+
+    void Defer(const char* Name, std::function<void()> Function);
+    bool HasDeferredWork() const;
+    void RunDeferredWork();                                 // On the calling thread, in the order deferred
+
+    void Mark(const char* Event);                           // Instant on the timeline, e.g. the first present
+    void Print() const;
+
+private:
+    struct TimelineEntry
+    {
+        std::string Name;
+        double BeginMs;
+        double EndMs;
+        uint32_t Worker;                                    // UINT32_MAX outside the job system
+    };
+
+    JobSystem* Jobs = nullptr;
+    std::chrono::steady_clock::time_point StartTime;
+    std::vector<Phase> Deferred;
+
+    mutable std::mutex TimelineMutex;                       // Phases of a stage finish on different workers
+    std::vector<TimelineEntry> Timeline;
+
+    double GetElapsedMs() const;
+    void RunTimed(const Phase& TimedPhase);
+};
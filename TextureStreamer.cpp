@@ -0,0 +1,691 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+TextureStreamer::TextureStreamer()
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+}
+
+void TextureStreamer::Create(VkPhysicalDevice NewPhysicalDevice, VkDevice NewDevice, VkQueue NewQueue, uint32_t QueueFamilyIndex,
+                             BindlessTable* NewBindless, MipGenerator* NewMipGeneration, JobSystem* NewJobs, VkDeviceSize BudgetBytes, bool bMemoryBudgetSupported)
+{
+    PhysicalDevice = NewPhysicalDevice;
+    Device = NewDevice;
+    Queue = NewQueue;
+    Bindless = NewBindless;
+    MipGeneration = NewMipGeneration;
+    Jobs = NewJobs;
+    Budget = BudgetBytes;
+    bUseMemoryBudget = bMemoryBudgetSupported;
+
+    // Own pool, so upload command buffers can be freed individually when their fence signals
+    VkCommandPoolCreateInfo CommandPoolCreateInfo = {};
+    CommandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    CommandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    CommandPoolCreateInfo.queueFamilyIndex = QueueFamilyIndex;
+
+    VkResult Result = vkCreateCommandPool(Device, &CommandPoolCreateInfo, nullptr, &CommandPool);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create Texture Streaming CommandPool");
+
+    // One trilinear sampler for every streamed texture. No LOD clamp, the view decides which mips exist
+    VkSamplerCreateInfo SamplerCreateInfo = {};
+    SamplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    SamplerCreateInfo.magFilter = VK_FILTER_LINEAR;                             // How to render when image is magnified on screen
+    SamplerCreateInfo.minFilter = VK_FILTER_LINEAR;                             // How to render when image is minified on screen
+    SamplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;            // How to handle texture wrap in U (x) direction
+    SamplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;            // How to handle texture wrap in V (y) direction
+    SamplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;            // How to handle texture wrap in W (z) direction
+    SamplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;           // Border beyond texture (only works for border clamp)
+    SamplerCreateInfo.unnormalizedCoordinates = VK_FALSE;                       // Whether coords should be normalized (between 0 and 1)
+    SamplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;               // Mipmap interpolation mode
+    SamplerCreateInfo.mipLodBias = 0.0f;                                        // Level of Details bias for mip level
+    SamplerCreateInfo.minLod = 0.0f;                                            // Minimum Level of Detail to pick mip level
+    SamplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;                               // Maximum Level of Detail to pick mip level
+    SamplerCreateInfo.anisotropyEnable = VK_FALSE;
+
+    Result = vkCreateSampler(Device, &SamplerCreateInfo, nullptr, &Sampler);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create Texture Streaming Sampler");
+
+    CreatePlaceholder();
+}
+
+void TextureStreamer::Destroy()
+{
+    // Let pending uploads finish before freeing anything they touch
+    for (auto& Batch : Batches)
+    {
+        vkWaitForFences(Device, 1, &Batch.Fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        vkDestroyFence(Device, Batch.Fence, nullptr);
+    }
+    Batches.clear();
+
+    for (auto& Pending : Transitions)
+    {
+        vkDestroyBuffer(Device, Pending.StagingBuffer, nullptr);
+        FreeDeviceMemory(Device, Pending.StagingBufferMemory);
+        vkDestroyImage(Device, Pending.Image, nullptr);
+        FreeDeviceMemory(Device, Pending.ImageMemory);
+    }
+    Transitions.clear();
+
+    for (auto& Retired : RetiredImages)
+    {
+        vkDestroyImageView(Device, Retired.ImageView, nullptr);
+        vkDestroyImage(Device, Retired.Image, nullptr);
+        FreeDeviceMemory(Device, Retired.ImageMemory);
+    }
+    RetiredImages.clear();
+
+    for (auto& Texture : Textures)
+    {
+        if (Texture.Image == VK_NULL_HANDLE) continue;
+        vkDestroyImageView(Device, Texture.ImageView, nullptr);
+        vkDestroyImage(Device, Texture.Image, nullptr);
+        FreeDeviceMemory(Device, Texture.ImageMemory);
+    }
+    Textures.clear();
+    SlotToTexture.clear();
+
+    vkDestroyImageView(Device, PlaceholderView, nullptr);
+    vkDestroyImage(Device, PlaceholderImage, nullptr);
+    FreeDeviceMemory(Device, PlaceholderMemory);
+
+    vkDestroySampler(Device, Sampler, nullptr);
+    vkDestroyCommandPool(Device, CommandPool, nullptr);
+}
+
+uint32_t TextureStreamer::AddTexture(const TextureSource& Source)
+{
+    StreamedTexture Texture = {};
+    Texture.Source = Source;
+    Texture.ImageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    // Generated chains need level 0 to exist, so they are loaded whole and never stream
+    if (Source.bGenerateMips)
+    {
+        MipGenerationPath Path = MipGeneration->GetPath(Source.Format, Source.Width, Source.Height);
+        if (Path == MipGenerationPath::None)
+        {
+            // No way to build the chain on this device, fall back to level 0 alone
+            Texture.Source.MipLevels = 1;
+            Texture.Source.bGenerateMips = false;
+        }
+        Texture.ImageUsage |= MipGeneration->GetRequiredUsage(Path);
+    }
+
+    // Tail starts at the first level that fits in STREAMING_MIP_TAIL_SIZE
+    Texture.TailMip = 0;
+    while (!Source.bGenerateMips && Texture.TailMip + 1 < Source.MipLevels
+           && std::max(Source.Width >> Texture.TailMip, Source.Height >> Texture.TailMip) > STREAMING_MIP_TAIL_SIZE)
+    {
+        Texture.TailMip++;
+    }
+
+    // Nothing resident yet, Update will load the tail first
+    Texture.ResidentMip = Texture.Source.MipLevels;
+    Texture.DesiredMip = Texture.TailMip;
+    Texture.LastUsedFrame = FrameNumber;
+
+    // Show the placeholder until the tail arrives
+    Texture.BindlessSlot = Bindless->AddTexture(PlaceholderView, Sampler);
+
+    SlotToTexture[Texture.BindlessSlot] = static_cast<uint32_t>(Textures.size());
+    Textures.push_back(Texture);
+
+    return Texture.BindlessSlot;
+}
+
+void TextureStreamer::RequestResolution(uint32_t BindlessSlot, float ScreenPixels)
+{
+    auto Found = SlotToTexture.find(BindlessSlot);
+    if (Found == SlotToTexture.end()) return;
+
+    StreamedTexture& Texture = Textures[Found->second];
+    Texture.LastUsedFrame = FrameNumber;
+
+    // Finest level with no more texels than pixels covered on screen
+    float TextureSize = (float)std::max(Texture.Source.Width, Texture.Source.Height);
+    float Level = std::floor(std::log2(TextureSize / std::max(ScreenPixels, 1.0f)));
+    uint32_t WantedMip = (uint32_t)std::clamp(Level, 0.0f, (float)(Texture.Source.MipLevels - 1));
+
+    // First request of a frame replaces the old wish, later ones can only ask for more detail
+    if (Texture.DesiredFrame != FrameNumber)
+    {
+        Texture.DesiredMip = WantedMip;
+        Texture.DesiredFrame = FrameNumber;
+    }
+    else
+    {
+        Texture.DesiredMip = std::min(Texture.DesiredMip, WantedMip);
+    }
+}
+
+std::vector<TextureSlotChange> TextureStreamer::Update()
+{
+    FrameNumber++;
+    std::vector<TextureSlotChange> SlotChanges;
+
+    // -- FINISHED TRANSITIONS --
+    // Poll, never wait, so a slow upload only delays the texture and not the frame
+    for (size_t b = 0; b < Batches.size();)
+    {
+        if (vkGetFenceStatus(Device, Batches[b].Fence) != VK_SUCCESS)
+        {
+            b++;
+            continue;
+        }
+
+        for (size_t i = 0; i < Transitions.size();)
+        {
+            if (Transitions[i].Fence == Batches[b].Fence)
+            {
+                FinishTransition(Transitions[i], SlotChanges);
+                Transitions[i] = Transitions.back();
+                Transitions.pop_back();
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        vkDestroyFence(Device, Batches[b].Fence, nullptr);
+        vkFreeCommandBuffers(Device, CommandPool, 1, &Batches[b].CommandBuffer);
+        Batches[b] = Batches.back();
+        Batches.pop_back();
+    }
+    MipGeneration->CollectGarbage();
+
+    // -- RETIRED IMAGES --
+    // After MAX_FRAME_DRAWS frames no frame in flight can reference them any more
+    for (size_t i = 0; i < RetiredImages.size();)
+    {
+        if (RetiredImages[i].RetireFrame + MAX_FRAME_DRAWS <= FrameNumber)
+        {
+            vkDestroyImageView(Device, RetiredImages[i].ImageView, nullptr);
+            vkDestroyImage(Device, RetiredImages[i].Image, nullptr);
+            FreeDeviceMemory(Device, RetiredImages[i].ImageMemory);
+            RetiredImages[i] = RetiredImages.back();
+            RetiredImages.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // -- NEW TRANSITIONS --
+    // Textures missing detail the screen asked for, most recently used and furthest behind first
+    std::vector<uint32_t> Candidates;
+    for (uint32_t i = 0; i < Textures.size(); i++)
+    {
+        const StreamedTexture& Texture = Textures[i];
+        if (Texture.bTransitionInFlight || Texture.DesiredMip >= Texture.ResidentMip) continue;
+
+        // Tails always load, finer levels only for textures still being asked for
+        bool bNeedsTail = Texture.ResidentMip > Texture.TailMip;
+        if (!bNeedsTail && Texture.DesiredFrame + STREAMING_EVICTION_GRACE_FRAMES <= FrameNumber) continue;
+
+        Candidates.push_back(i);
+    }
+
+    std::sort(Candidates.begin(), Candidates.end(), [this](uint32_t A, uint32_t B)
+    {
+        const StreamedTexture& TextureA = Textures[A];
+        const StreamedTexture& TextureB = Textures[B];
+        if (TextureA.LastUsedFrame != TextureB.LastUsedFrame) return TextureA.LastUsedFrame > TextureB.LastUsedFrame;
+        return TextureA.ResidentMip - TextureA.DesiredMip > TextureB.ResidentMip - TextureB.DesiredMip;
+    });
+
+    uint32_t TransitionsStarted = 0;
+    VkDeviceSize BytesUploaded = 0;
+    VkDeviceSize EffectiveBudget = GetEffectiveBudget();
+
+    for (uint32_t TextureIndex : Candidates)
+    {
+        if (TransitionsStarted >= STREAMING_MAX_TRANSITIONS_PER_FRAME) break;
+
+        StreamedTexture& Texture = Textures[TextureIndex];
+
+        // Load the whole tail in one go, then refine one level at a time so detail arrives progressively
+        uint32_t NewMip = Texture.ResidentMip > Texture.TailMip ? Texture.TailMip : Texture.ResidentMip - 1;
+        bool bLoadingTail = NewMip == Texture.TailMip;
+
+        VkDeviceSize UploadBytes = 0;
+        for (uint32_t Mip = NewMip; Mip < (Texture.Source.bGenerateMips ? 1 : Texture.ResidentMip); Mip++)
+        {
+            UploadBytes += GetMipByteSize(Texture.Source.Format, std::max(1u, Texture.Source.Width >> Mip), std::max(1u, Texture.Source.Height >> Mip));
+        }
+        if (TransitionsStarted > 0 && BytesUploaded + UploadBytes > STREAMING_MAX_UPLOAD_BYTES_PER_FRAME) break;
+
+        // The new image lives next to the old one until the swap. Tails are always allowed in
+        VkDeviceSize NewSize = EstimateImageSize(Texture, NewMip);
+        if (!bLoadingTail && ResidentBytes + NewSize > EffectiveBudget)
+        {
+            // Start freeing memory, this texture retries once the evictions have landed
+            EvictForSpace(ResidentBytes + NewSize - EffectiveBudget, TextureIndex);
+            break;
+        }
+
+        StartTransition(TextureIndex, NewMip);
+        TransitionsStarted++;
+        BytesUploaded += UploadBytes;
+    }
+
+    // Everything started this frame goes to the GPU in one submit
+    SubmitBatch();
+    bTransitionsStarted = TransitionsStarted > 0;
+
+    return SlotChanges;
+}
+
+bool TextureStreamer::IsBusy() const
+{
+    // Uploads to finish, images to free, or more candidates behind the ones just started
+    return !Batches.empty() || !RetiredImages.empty() || bTransitionsStarted;
+}
+
+void TextureStreamer::SetBudget(VkDeviceSize BudgetBytes)
+{
+    Budget = BudgetBytes;
+}
+
+VkDeviceSize TextureStreamer::GetResidentBytes() const
+{
+    return ResidentBytes;
+}
+
+VkDeviceSize TextureStreamer::GetEffectiveBudget() const
+{
+    if (!bUseMemoryBudget) return Budget;
+
+    // Ask the driver how much device local memory is still free for us (shared with other apps and our own buffers)
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT MemoryBudget = {};
+    MemoryBudget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 MemoryProperties = {};
+    MemoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    MemoryProperties.pNext = &MemoryBudget;
+    vkGetPhysicalDeviceMemoryProperties2(PhysicalDevice, &MemoryProperties);
+
+    VkDeviceSize Headroom = 0;
+    for (uint32_t Heap = 0; Heap < MemoryProperties.memoryProperties.memoryHeapCount; Heap++)
+    {
+        if (!(MemoryProperties.memoryProperties.memoryHeaps[Heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+
+        if (MemoryBudget.heapBudget[Heap] > MemoryBudget.heapUsage[Heap])
+        {
+            Headroom += MemoryBudget.heapBudget[Heap] - MemoryBudget.heapUsage[Heap];
+        }
+    }
+
+    // Keep 10% of the headroom spare for everything else
+    return std::min(Budget, ResidentBytes + Headroom - Headroom / 10);
+}
+
+VkDeviceSize TextureStreamer::EstimateImageSize(const StreamedTexture& Texture, uint32_t FirstMip) const
+{
+    VkDeviceSize Size = 0;
+    for (uint32_t Mip = FirstMip; Mip < Texture.Source.MipLevels; Mip++)
+    {
+        Size += GetMipByteSize(Texture.Source.Format, std::max(1u, Texture.Source.Width >> Mip), std::max(1u, Texture.Source.Height >> Mip));
+    }
+    return Size;
+}
+
+bool TextureStreamer::EvictForSpace(VkDeviceSize NeededBytes, uint32_t RequestingTexture)
+{
+    // Least recently used first
+    std::vector<uint32_t> Victims;
+    for (uint32_t i = 0; i < Textures.size(); i++)
+    {
+        const StreamedTexture& Texture = Textures[i];
+        if (i == RequestingTexture || Texture.bTransitionInFlight) continue;
+        if (Texture.ResidentMip >= Texture.TailMip) continue;                                       // Only the tail left, nothing to drop
+        if (Texture.LastUsedFrame + STREAMING_EVICTION_GRACE_FRAMES > FrameNumber) continue;        // Still on screen
+
+        Victims.push_back(i);
+    }
+
+    std::sort(Victims.begin(), Victims.end(), [this](uint32_t A, uint32_t B)
+    {
+        return Textures[A].LastUsedFrame < Textures[B].LastUsedFrame;
+    });
+
+    // Drop victims back to their tail until enough will be freed
+    VkDeviceSize FreedBytes = 0;
+    for (uint32_t Victim : Victims)
+    {
+        if (FreedBytes >= NeededBytes) break;
+
+        StreamedTexture& Texture = Textures[Victim];
+        FreedBytes += Texture.MemorySize - EstimateImageSize(Texture, Texture.TailMip);
+        Texture.DesiredMip = Texture.TailMip;
+        StartTransition(Victim, Texture.TailMip);
+    }
+
+    return FreedBytes >= NeededBytes;
+}
+
+void TextureStreamer::StartTransition(uint32_t TextureIndex, uint32_t NewResidentMip)
+{
+    StreamedTexture& Texture = Textures[TextureIndex];
+    const TextureSource& Source = Texture.Source;
+
+    Transition NewTransition = {};
+    NewTransition.TextureIndex = TextureIndex;
+    NewTransition.NewResidentMip = NewResidentMip;
+
+    // -- NEW IMAGE --
+    // Holds levels [NewResidentMip, MipLevels), so its level 0 is source level NewResidentMip
+    uint32_t NewLevels = Source.MipLevels - NewResidentMip;
+    NewTransition.Image = CreateImage(PhysicalDevice, Device,
+                                      std::max(1u, Source.Width >> NewResidentMip), std::max(1u, Source.Height >> NewResidentMip), NewLevels,
+                                      Source.Format, VK_IMAGE_TILING_OPTIMAL, Texture.ImageUsage,
+                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &NewTransition.ImageMemory,
+                                      MemoryCategory::Texture, EstimateImageSize(Texture, NewResidentMip));
+
+    VkMemoryRequirements MemoryRequirements;
+    vkGetImageMemoryRequirements(Device, NewTransition.Image, &MemoryRequirements);
+    NewTransition.MemorySize = MemoryRequirements.size;
+    ResidentBytes += NewTransition.MemorySize;
+
+    // -- STAGING --
+    // Levels finer than what's resident come from the source (only level 0 when the rest is generated)
+    uint32_t LastLoadedMip = Source.bGenerateMips ? 1 : std::min(Texture.ResidentMip, Source.MipLevels);
+    std::vector<VkBufferImageCopy> UploadRegions;
+    std::vector<std::vector<uint8_t>> MipData(std::max(NewResidentMip, LastLoadedMip) - NewResidentMip);
+    VkDeviceSize StagingSize = 0;
+
+    // Reading and decoding levels is the slow part, each level is a job of its own
+    auto LoadMips = [&](size_t First, size_t Last)
+    {
+        for (size_t i = First; i < Last; i++)
+        {
+            MipData[i] = Source.LoadMip(NewResidentMip + static_cast<uint32_t>(i));
+        }
+    };
+    if (Jobs) Jobs->ParallelFor(MipData.size(), 1, LoadMips);
+    else LoadMips(0, MipData.size());
+
+    for (uint32_t Mip = NewResidentMip; Mip < LastLoadedMip; Mip++)
+    {
+        uint32_t MipWidth = std::max(1u, Source.Width >> Mip);
+        uint32_t MipHeight = std::max(1u, Source.Height >> Mip);
+
+        const std::vector<uint8_t>& Level = MipData[Mip - NewResidentMip];
+        if (Level.size() != GetMipByteSize(Source.Format, MipWidth, MipHeight)) throw std::runtime_error("Texture source returned a mip of the wrong size");
+
+        VkBufferImageCopy Region = {};
+        Region.bufferOffset = StagingSize;                                      // Offset into data
+        Region.bufferRowLength = 0;                                             // Row length of data to calculate data spacing (0 = tightly packed)
+        Region.bufferImageHeight = 0;                                           // Image height to calculate data spacing
+        Region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;         // Which aspect of image to copy
+        Region.imageSubresource.mipLevel = Mip - NewResidentMip;                // Mipmap level to copy
+        Region.imageSubresource.baseArrayLayer = 0;                             // Starting array layer (if array)
+        Region.imageSubresource.layerCount = 1;                                 // Number of layers to copy starting at baseArrayLayer
+        Region.imageOffset = { 0, 0, 0 };                                       // Offset into image (as opposed to raw data in bufferOffset)
+        Region.imageExtent = { MipWidth, MipHeight, 1 };                        // Size of region to copy as (x, y, z) values
+        UploadRegions.push_back(Region);
+
+        // Keep every level 16 byte aligned, enough for any texel block size
+        StagingSize += (Level.size() + 15) & ~VkDeviceSize(15);
+    }
+
+    if (StagingSize > 0)
+    {
+        CreateBuffer(PhysicalDevice, Device, StagingSize,
+                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                     &NewTransition.StagingBuffer, &NewTransition.StagingBufferMemory, MemoryCategory::Staging);
+
+        void* Data;
+        vkMapMemory(Device, NewTransition.StagingBufferMemory, 0, StagingSize, 0, &Data);
+        for (size_t i = 0; i < MipData.size(); i++)
+        {
+            memcpy(static_cast<uint8_t*>(Data) + UploadRegions[i].bufferOffset, MipData[i].data(), MipData[i].size());
+        }
+        vkUnmapMemory(Device, NewTransition.StagingBufferMemory);
+    }
+
+    // Levels already resident are copied image to image on the GPU
+    std::vector<VkImageCopy> CopyRegions;
+    bool bCopyFromOld = Texture.Image != VK_NULL_HANDLE;
+    uint32_t FirstCopiedMip = std::max(NewResidentMip, Texture.ResidentMip);
+    uint32_t OldLevels = Source.MipLevels - Texture.ResidentMip;
+
+    if (bCopyFromOld)
+    {
+        for (uint32_t Mip = FirstCopiedMip; Mip < Source.MipLevels; Mip++)
+        {
+            uint32_t MipWidth = std::max(1u, Source.Width >> Mip);
+            uint32_t MipHeight = std::max(1u, Source.Height >> Mip);
+
+            VkImageCopy Region = {};
+            Region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, Mip - Texture.ResidentMip, 0, 1 };
+            Region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, Mip - NewResidentMip, 0, 1 };
+            Region.extent = { MipWidth, MipHeight, 1 };
+            CopyRegions.push_back(Region);
+        }
+    }
+
+    // -- RECORD --
+    VkCommandBuffer CommandBuffer = GetBatchCommandBuffer();
+    NewTransition.Fence = CurrentBatch.Fence;
+
+    // New image: UNDEFINED -> TRANSFER_DST, waiting on nothing. Old image: SHADER_READ_ONLY -> TRANSFER_SRC,
+    // after frames already submitted are done sampling it
+    VkImageSubresourceRange NewRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, NewLevels, 0, 1 };
+    VkImageSubresourceRange OldRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, OldLevels, 0, 1 };
+
+    BarrierBatch Barriers;
+    Barriers.AddImageBarrier(NewTransition.Image, NewRange, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             VK_PIPELINE_STAGE_2_NONE_KHR, VK_ACCESS_2_NONE_KHR, VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR);
+    if (bCopyFromOld)
+    {
+        Barriers.AddImageBarrier(Texture.Image, OldRange, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                 VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_NONE_KHR, VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_TRANSFER_READ_BIT_KHR);
+    }
+    Barriers.Flush(CommandBuffer, "Texture stream in");
+
+    if (!UploadRegions.empty())
+    {
+        vkCmdCopyBufferToImage(CommandBuffer, NewTransition.StagingBuffer, NewTransition.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               static_cast<uint32_t>(UploadRegions.size()), UploadRegions.data());
+    }
+    if (!CopyRegions.empty())
+    {
+        vkCmdCopyImage(CommandBuffer, Texture.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       NewTransition.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       static_cast<uint32_t>(CopyRegions.size()), CopyRegions.data());
+    }
+
+    // Both images back to SHADER_READ_ONLY (the old one is still sampled until the swap).
+    // A generated chain stays in TRANSFER_DST, the mip generator moves it once the whole batch is recorded
+    bool bNewImageDone = !Source.bGenerateMips;
+    if (Source.bGenerateMips)
+    {
+        PendingMipChains.push_back({ NewTransition.Image, Source.Format, Source.Width, Source.Height, Source.MipLevels });
+    }
+
+    if (bNewImageDone)
+    {
+        Barriers.AddImageBarrier(NewTransition.Image, NewRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR);
+    }
+    if (bCopyFromOld)
+    {
+        Barriers.AddImageBarrier(Texture.Image, OldRange, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_NONE_KHR, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR);
+    }
+    Barriers.Flush(CommandBuffer, "Texture stream in done");
+
+    Texture.bTransitionInFlight = true;
+    Transitions.push_back(NewTransition);
+}
+
+void TextureStreamer::FinishTransition(Transition& Finished, std::vector<TextureSlotChange>& SlotChanges)
+{
+    StreamedTexture& Texture = Textures[Finished.TextureIndex];
+
+    // Old image may still be sampled by frames in flight, destroy it later
+    if (Texture.Image != VK_NULL_HANDLE)
+    {
+        RetiredImages.push_back({ Texture.Image, Texture.ImageMemory, Texture.ImageView, FrameNumber });
+        ResidentBytes -= Texture.MemorySize;
+    }
+
+    Texture.Image = Finished.Image;
+    Texture.ImageMemory = Finished.ImageMemory;
+    Texture.MemorySize = Finished.MemorySize;
+    Texture.ImageView = CreateView(Texture.Image, Texture.Source.Format, Texture.Source.MipLevels - Finished.NewResidentMip);
+    Texture.ResidentMip = Finished.NewResidentMip;
+    Texture.bTransitionInFlight = false;
+
+    // A slot can't be rewritten while frames in flight read it, so move the texture to a fresh slot and retire the old one
+    uint32_t NewSlot = Bindless->AddTexture(Texture.ImageView, Sampler);
+    Bindless->RemoveTexture(Texture.BindlessSlot);
+    SlotChanges.push_back({ Texture.BindlessSlot, NewSlot });
+
+    SlotToTexture.erase(Texture.BindlessSlot);
+    SlotToTexture[NewSlot] = Finished.TextureIndex;
+    Texture.BindlessSlot = NewSlot;
+
+    // Upload resources (the batch's command buffer and fence are freed with the batch)
+    if (Finished.StagingBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(Device, Finished.StagingBuffer, nullptr);
+        FreeDeviceMemory(Device, Finished.StagingBufferMemory);
+    }
+}
+
+VkCommandBuffer TextureStreamer::GetBatchCommandBuffer()
+{
+    if (CurrentBatch.CommandBuffer != VK_NULL_HANDLE) return CurrentBatch.CommandBuffer;
+
+    VkCommandBufferAllocateInfo AllocateInfo = {};
+    AllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    AllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    AllocateInfo.commandPool = CommandPool;
+    AllocateInfo.commandBufferCount = 1;
+    vkAllocateCommandBuffers(Device, &AllocateInfo, &CurrentBatch.CommandBuffer);
+
+    VkCommandBufferBeginInfo BeginInfo = {};
+    BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(CurrentBatch.CommandBuffer, &BeginInfo);
+
+    VkFenceCreateInfo FenceCreateInfo = {};
+    FenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    vkCreateFence(Device, &FenceCreateInfo, nullptr, &CurrentBatch.Fence);
+
+    return CurrentBatch.CommandBuffer;
+}
+
+void TextureStreamer::SubmitBatch()
+{
+    if (CurrentBatch.CommandBuffer == VK_NULL_HANDLE) return;
+
+    // Generate every new chain of the batch together, so barriers are shared level by level
+    if (!PendingMipChains.empty())
+    {
+        MipGeneration->Record(CurrentBatch.CommandBuffer, PendingMipChains, CurrentBatch.Fence);
+        PendingMipChains.clear();
+    }
+
+    vkEndCommandBuffer(CurrentBatch.CommandBuffer);
+
+    VkSubmitInfo SubmitInfo = {};
+    SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    SubmitInfo.commandBufferCount = 1;
+    SubmitInfo.pCommandBuffers = &CurrentBatch.CommandBuffer;
+
+    VkResult Result = vkQueueSubmit(Queue, 1, &SubmitInfo, CurrentBatch.Fence);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to submit Texture Streaming upload");
+
+    Batches.push_back(CurrentBatch);
+    CurrentBatch = {};
+}
+
+VkImageView TextureStreamer::CreateView(VkImage Image, VkFormat Format, uint32_t MipLevels)
+{
+    VkImageViewCreateInfo ImageViewCreateInfo = {};
+    ImageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    ImageViewCreateInfo.image = Image;
+    ImageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    ImageViewCreateInfo.format = Format;
+    ImageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ImageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ImageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ImageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ImageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, MipLevels, 0, 1 };    // Every resident level
+
+    VkImageView ImageView;
+    VkResult Result = vkCreateImageView(Device, &ImageViewCreateInfo, nullptr, &ImageView);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create Streamed Texture ImageView");
+
+    return ImageView;
+}
+
+void TextureStreamer::CreatePlaceholder()
+{
+    PlaceholderImage = CreateImage(PhysicalDevice, Device, 1, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+                                   VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &PlaceholderMemory, MemoryCategory::Texture);
+    PlaceholderView = CreateView(PlaceholderImage, VK_FORMAT_R8G8B8A8_UNORM, 1);
+
+    // A cleared white texel is all it needs, done once at startup so waiting is fine
+    VkCommandBufferAllocateInfo AllocateInfo = {};
+    AllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    AllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    AllocateInfo.commandPool = CommandPool;
+    AllocateInfo.commandBufferCount = 1;
+
+    VkCommandBuffer CommandBuffer;
+    vkAllocateCommandBuffers(Device, &AllocateInfo, &CommandBuffer);
+
+    VkCommandBufferBeginInfo BeginInfo = {};
+    BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(CommandBuffer, &BeginInfo);
+
+    VkImageSubresourceRange Range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    BarrierBatch Barriers;
+    Barriers.AddImageBarrier(PlaceholderImage, Range, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             VK_PIPELINE_STAGE_2_NONE_KHR, VK_ACCESS_2_NONE_KHR, VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR);
+    Barriers.Flush(CommandBuffer, "Placeholder clear");
+
+    VkClearColorValue White = { { 1.0f, 1.0f, 1.0f, 1.0f } };
+    vkCmdClearColorImage(CommandBuffer, PlaceholderImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &White, 1, &Range);
+
+    Barriers.AddImageBarrier(PlaceholderImage, Range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                             VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR);
+    Barriers.Flush(CommandBuffer, "Placeholder ready");
+
+    vkEndCommandBuffer(CommandBuffer);
+
+    VkSubmitInfo SubmitInfo = {};
+    SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    SubmitInfo.commandBufferCount = 1;
+    SubmitInfo.pCommandBuffers = &CommandBuffer;
+
+    VkFenceCreateInfo FenceCreateInfo = {};
+    FenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence Fence;
+    if (vkCreateFence(Device, &FenceCreateInfo, nullptr, &Fence) != VK_SUCCESS) throw std::runtime_error("Failed to create placeholder texture Fence");
+
+    vkQueueSubmit(Queue, 1, &SubmitInfo, Fence);
+    vkWaitForFences(Device, 1, &Fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    vkDestroyFence(Device, Fence, nullptr);
+
+    vkFreeCommandBuffers(Device, CommandPool, 1, &CommandBuffer);
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Utilities.h"
+#include "BindlessTable.h"
+#include "MipGenerator.h"
+#include "JobSystem.h"
+
+const uint32_t STREAMING_MIP_TAIL_SIZE = 64;                                // Levels this size and smaller are always resident
+const uint32_t STREAMING_MAX_TRANSITIONS_PER_FRAME = 4;                     // Residency changes started per frame
+const VkDeviceSize STREAMING_MAX_UPLOAD_BYTES_PER_FRAME = 16 * 1024 * 1024; // Texel data read from sources per frame
+const uint64_t STREAMING_EVICTION_GRACE_FRAMES = 60;                        // Textures used this recently are never evicted
+const VkDeviceSize DEFAULT_TEXTURE_STREAMING_BUDGET = 256 * 1024 * 1024;
+
+// Where a streamed texture's texels come from. LoadMip is only called for levels that are about to become resident
+struct TextureSource
+{
+    VkFormat Format;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t MipLevels;
+    std::function<std::vector<uint8_t>(uint32_t MipLevel)> LoadMip;     // Tightly packed texel data of one level, called for several levels at once from job workers
+    bool bGenerateMips = false;                                         // LoadMip only provides level 0, the rest is generated on the GPU
+};
+
+// A bindless slot changed because a texture's image was replaced (materials pointing at OldSlot must use NewSlot)
+struct TextureSlotChange
+{
+    uint32_t OldSlot;
+    uint32_t NewSlot;
+};
+
+// Keeps textures partially resident: only the small mip tail is loaded at first, and higher mips are streamed in
+// when something on screen needs them. Resident memory is kept under a budget (the configured one, further limited by
+// VK_EXT_memory_budget when available) by dropping mips from the least recently used textures.
+// Changing residency builds a new image with the wanted mips (copying the ones already on the GPU), and swaps it in
+// once its upload fence signals, so frames never wait on streaming
+class TextureStreamer
+{
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    void Create(VkPhysicalDevice PhysicalDevice, VkDevice Device, VkQueue Queue, uint32_t QueueFamilyIndex,
+                BindlessTable* Bindless, MipGenerator* MipGeneration, JobSystem* Jobs, VkDeviceSize BudgetBytes, bool bMemoryBudgetSupported);
+    void Destroy();
+
+    uint32_t AddTexture(const TextureSource& Source);                       // Returns the texture's bindless slot (placeholder until the tail is loaded)
+
+    void RequestResolution(uint32_t BindlessSlot, float ScreenPixels);      // Texture is drawn about ScreenPixels wide this frame
+    std::vector<TextureSlotChange> Update();                               // Once per frame, after the frame's fence has been waited on
+
+    bool IsBusy() const;                                                    // Work left that only progresses when Update is called again
+
+    void SetBudget(VkDeviceSize BudgetBytes);
+    VkDeviceSize GetResidentBytes() const;
+
+private:
+    struct StreamedTexture
+    {
+        TextureSource Source;
+        uint32_t BindlessSlot;
+
+        VkImage Image = VK_NULL_HANDLE;
+        VkDeviceMemory ImageMemory = VK_NULL_HANDLE;
+        VkImageView ImageView = VK_NULL_HANDLE;
+        VkDeviceSize MemorySize = 0;
+        VkImageUsageFlags ImageUsage;
+
+        uint32_t TailMip;                   // Finest level that is always kept resident
+        uint32_t ResidentMip;               // Finest level currently on the GPU (== MipLevels when nothing is loaded)
+        uint32_t DesiredMip;                // Finest level the screen asked for
+        uint64_t DesiredFrame = 0;          // Frame DesiredMip was last updated
+        uint64_t LastUsedFrame = 0;
+        bool bTransitionInFlight = false;
+    };
+
+    // A residency change waiting on the GPU
+    struct Transition
+    {
+        uint32_t TextureIndex;
+        uint32_t NewResidentMip;
+        VkImage Image;
+        VkDeviceMemory ImageMemory;
+        VkDeviceSize MemorySize;
+        VkBuffer StagingBuffer;
+        VkDeviceMemory StagingBufferMemory;
+        VkFence Fence;                      // Fence of the batch it was recorded in
+    };
+
+    // Every transition started in one Update, recorded and submitted together
+    struct UploadBatch
+    {
+        VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+        VkFence Fence = VK_NULL_HANDLE;
+    };
+
+    // Resources that may still be used by frames in flight
+    struct RetiredImage
+    {
+        VkImage Image;
+        VkDeviceMemory ImageMemory;
+        VkImageView ImageView;
+        uint64_t RetireFrame;
+    };
+
+    VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice Device = VK_NULL_HANDLE;
+    VkQueue Queue = VK_NULL_HANDLE;
+    VkCommandPool CommandPool = VK_NULL_HANDLE;
+    VkSampler Sampler = VK_NULL_HANDLE;
+    BindlessTable* Bindless = nullptr;
+    MipGenerator* MipGeneration = nullptr;
+    JobSystem* Jobs = nullptr;                  // Decodes the levels of a transition in parallel
+
+    // 1x1 white image every texture shows until its tail is resident
+    VkImage PlaceholderImage = VK_NULL_HANDLE;
+    VkDeviceMemory PlaceholderMemory = VK_NULL_HANDLE;
+    VkImageView PlaceholderView = VK_NULL_HANDLE;
+
+    std::vector<StreamedTexture> Textures;
+    std::unordered_map<uint32_t, uint32_t> SlotToTexture;
+    std::vector<Transition> Transitions;
+    UploadBatch CurrentBatch;                   // Being recorded, submitted at the end of Update
+    std::vector<UploadBatch> Batches;           // Submitted, waiting on their fence
+    std::vector<MipChainImage> PendingMipChains;
+    std::vector<RetiredImage> RetiredImages;
+
+    VkDeviceSize Budget = 0;
+    VkDeviceSize ResidentBytes = 0;         // Memory of every texture image (including ones being built)
+    bool bUseMemoryBudget = false;
+    uint64_t FrameNumber = 0;
+    bool bTransitionsStarted = false;       // Last Update started transitions (more may be waiting on the per frame limits)
+
+    VkDeviceSize GetEffectiveBudget() const;
+    VkDeviceSize EstimateImageSize(const StreamedTexture& Texture, uint32_t FirstMip) const;
+    bool EvictForSpace(VkDeviceSize NeededBytes, uint32_t RequestingTexture);
+    void StartTransition(uint32_t TextureIndex, uint32_t NewResidentMip);
+    void FinishTransition(Transition& Finished, std::vector<TextureSlotChange>& SlotChanges);
+    VkCommandBuffer GetBatchCommandBuffer();
+    void SubmitBatch();
+    VkImageView CreateView(VkImage Image, VkFormat Format, uint32_t MipLevels);
+    void CreatePlaceholder();
+};
@@ -0,0 +1,9 @@
+REM Compress every PNG into a KTX2 with a full mip chain, as BC7 the default build uploads directly.
+REM Encoded as UASTC first, then transcoded offline; builds with VULKANRENDERER_BASISU can load the UASTC files
+REM (keep them with --zcmp 18 added for Zstd) and transcode to whatever the device supports instead
+for %%f in (*.png) do (
+    "C:/Program Files/KTX-Software/bin/toktx.exe" --t2 --encode uastc --uastc_quality 2 --uastc_rdo_l 1.0 --genmipmap %%~nf.uastc.ktx2 %%f
+    "C:/Program Files/KTX-Software/bin/ktx.exe" transcode --target bc7 %%~nf.uastc.ktx2 %%~nf.ktx2
+    del %%~nf.uastc.ktx2
+)
+pause
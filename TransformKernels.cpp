@@ -0,0 +1,862 @@
+#include "TransformKernels.h"
+
+#include <immintrin.h>
+#include <cmath>
+#include <limits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// MSVC compiles any intrinsic anywhere, GCC and Clang need each function to say which instruction set it uses
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KERNEL_TARGET(InstructionSets)
+#else
+#define KERNEL_TARGET(InstructionSets) __attribute__((target(InstructionSets)))
+#endif
+
+namespace
+{
+    // -- DETECTION --
+    void GetCpuid(int Leaf, int SubLeaf, int Registers[4])
+    {
+#ifdef _MSC_VER
+        __cpuidex(Registers, Leaf, SubLeaf);
+#else
+        __cpuid_count(Leaf, SubLeaf, Registers[0], Registers[1], Registers[2], Registers[3]);
+#endif
+    }
+
+    // Register state the OS saves on context switches, wide registers are only usable if it saves them
+    uint64_t GetEnabledRegisterState()
+    {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        uint32_t Low, High;
+        __asm__("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+        return (static_cast<uint64_t>(High) << 32) | Low;
+#endif
+    }
+
+    SimdLevel DetectSimdLevel()
+    {
+        int Registers[4];
+        GetCpuid(0, 0, Registers);
+        int MaxLeaf = Registers[0];
+
+        GetCpuid(1, 0, Registers);
+        bool bSse41 = (Registers[2] & (1 << 19)) != 0;
+        bool bOsSavesState = (Registers[2] & (1 << 27)) != 0;
+        bool bAvx = (Registers[2] & (1 << 28)) != 0;
+        bool bFma = (Registers[2] & (1 << 12)) != 0;
+        if (!bSse41) return SimdLevel::Scalar;
+        if (!bOsSavesState || !bAvx || !bFma || MaxLeaf < 7) return SimdLevel::Sse41;
+
+        uint64_t RegisterState = GetEnabledRegisterState();
+        if ((RegisterState & 0x6) != 0x6) return SimdLevel::Sse41;                   // XMM and YMM
+
+        GetCpuid(7, 0, Registers);
+        bool bAvx2 = (Registers[1] & (1 << 5)) != 0;
+        bool bAvx512 = (Registers[1] & (1 << 16)) != 0;
+        if (!bAvx2) return SimdLevel::Sse41;
+        if (!bAvx512 || (RegisterState & 0xE6) != 0xE6) return SimdLevel::Avx2;       // Plus opmask and ZMM
+
+        return SimdLevel::Avx512;
+    }
+
+    const float SPHERE_RADIUS_PADDING = 1.0001f;        // Bounding spheres grow by this factor to stay conservative
+
+    const SimdLevel SupportedLevel = DetectSimdLevel();
+    SimdLevel ActiveLevel = SupportedLevel;
+
+    bool HasBounds(const BoundingBox& Bounds)
+    {
+        return Bounds.Min.x != -std::numeric_limits<float>::max();
+    }
+
+    // -- SCALAR --
+    void MultiplyMatricesScalar(const glm::mat4& Left, const glm::mat4* Right, glm::mat4* Out, size_t Count)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            Out[i] = Left * Right[i];
+        }
+    }
+
+    void MultiplyMatrixArraysScalar(const glm::mat4* Left, const glm::mat4* Right, glm::mat4* Out, size_t Count)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            Out[i] = Left[i] * Right[i];
+        }
+    }
+
+    void TransformBoundingBoxesScalar(const glm::mat4* Transforms, const BoundingBox* Bounds, BoundingBox* Out, size_t Count)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            if (!HasBounds(Bounds[i]))
+            {
+                Out[i] = Bounds[i];
+                continue;
+            }
+
+            glm::vec3 Centre = (Bounds[i].Min + Bounds[i].Max) * 0.5f;
+            glm::vec3 Extent = (Bounds[i].Max - Bounds[i].Min) * 0.5f;
+
+            glm::vec3 NewCentre = glm::vec3(Transforms[i] * glm::vec4(Centre, 1.0f));
+            glm::mat3 AbsoluteRotation = glm::mat3(glm::abs(glm::vec3(Transforms[i][0])), glm::abs(glm::vec3(Transforms[i][1])), glm::abs(glm::vec3(Transforms[i][2])));
+            glm::vec3 NewExtent = AbsoluteRotation * Extent;
+
+            Out[i].Min = NewCentre - NewExtent;
+            Out[i].Max = NewCentre + NewExtent;
+        }
+    }
+
+    void ComputeNormalMatricesScalar(const glm::mat4* Transforms, glm::mat3* Out, size_t Count)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            Out[i] = glm::transpose(glm::inverse(glm::mat3(Transforms[i])));
+        }
+    }
+
+    // Vertex positions are the first 3 floats of each 8 float vertex. The SIMD kernels load 4 floats from there,
+    // the 4th (colour red) stays inside the vertex and is ignored
+    void ComputeVertexBoundsScalar(const Vertex* Vertices, size_t Count, BoundingBox& Out)
+    {
+        glm::vec3 Min = Vertices[0].pos;
+        glm::vec3 Max = Vertices[0].pos;
+        for (size_t i = 1; i < Count; i++)
+        {
+            Min = glm::min(Min, Vertices[i].pos);
+            Max = glm::max(Max, Vertices[i].pos);
+        }
+
+        Out.Min = Min;
+        Out.Max = Max;
+    }
+
+    // Index of the vertex farthest from Point, with its squared distance
+    size_t FindFarthestVertexScalar(const Vertex* Vertices, size_t Count, const glm::vec3& Point, float& DistanceSquared)
+    {
+        size_t Farthest = 0;
+        DistanceSquared = -1.0f;
+        for (size_t i = 0; i < Count; i++)
+        {
+            glm::vec3 Offset = Vertices[i].pos - Point;
+            float Candidate = glm::dot(Offset, Offset);
+            if (Candidate > DistanceSquared)
+            {
+                DistanceSquared = Candidate;
+                Farthest = i;
+            }
+        }
+        return Farthest;
+    }
+
+    // Ritter's growth step: every vertex outside the sphere moves the centre towards it just enough to hold it
+    // and the far side of the old sphere. Order dependent, so the SIMD versions only test for outside vertices
+    void GrowSphereScalar(const Vertex* Vertices, size_t Count, glm::vec3& Centre, float& Radius)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            glm::vec3 Offset = Vertices[i].pos - Centre;
+            float DistanceSquared = glm::dot(Offset, Offset);
+            if (DistanceSquared <= Radius * Radius) continue;
+
+            float Distance = std::sqrt(DistanceSquared);
+            float NewRadius = (Radius + Distance) * 0.5f;
+            Centre += Offset * ((NewRadius - Radius) / Distance);
+            Radius = NewRadius;
+        }
+    }
+
+    // -- SSE4.1 --
+    template<int Lane>
+    __m128 Broadcast(__m128 Value)
+    {
+        return _mm_shuffle_ps(Value, Value, _MM_SHUFFLE(Lane, Lane, Lane, Lane));
+    }
+
+    // One column of Left * Right, from the matching column of Right
+    __m128 MultiplyColumn(__m128 Left0, __m128 Left1, __m128 Left2, __m128 Left3, __m128 RightColumn)
+    {
+        __m128 Result = _mm_mul_ps(Left0, Broadcast<0>(RightColumn));
+        Result = _mm_add_ps(Result, _mm_mul_ps(Left1, Broadcast<1>(RightColumn)));
+        Result = _mm_add_ps(Result, _mm_mul_ps(Left2, Broadcast<2>(RightColumn)));
+        Result = _mm_add_ps(Result, _mm_mul_ps(Left3, Broadcast<3>(RightColumn)));
+        return Result;
+    }
+
+    KERNEL_TARGET("sse4.1")
+    void MultiplyMatricesSse41(const glm::mat4& Left, const glm::mat4* Right, glm::mat4* Out, size_t Count)
+    {
+        const float* L = &Left[0][0];
+        __m128 Left0 = _mm_loadu_ps(L);
+        __m128 Left1 = _mm_loadu_ps(L + 4);
+        __m128 Left2 = _mm_loadu_ps(L + 8);
+        __m128 Left3 = _mm_loadu_ps(L + 12);
+
+        for (size_t i = 0; i < Count; i++)
+        {
+            const float* R = &Right[i][0][0];
+            float* O = &Out[i][0][0];
+            for (int Column = 0; Column < 4; Column++)
+            {
+                _mm_storeu_ps(O + 4 * Column, MultiplyColumn(Left0, Left1, Left2, Left3, _mm_loadu_ps(R + 4 * Column)));
+            }
+        }
+    }
+
+    KERNEL_TARGET("sse4.1")
+    void MultiplyMatrixArraysSse41(const glm::mat4* Left, const glm::mat4* Right, glm::mat4* Out, size_t Count)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            const float* L = &Left[i][0][0];
+            const float* R = &Right[i][0][0];
+            float* O = &Out[i][0][0];
+
+            __m128 Left0 = _mm_loadu_ps(L);
+            __m128 Left1 = _mm_loadu_ps(L + 4);
+            __m128 Left2 = _mm_loadu_ps(L + 8);
+            __m128 Left3 = _mm_loadu_ps(L + 12);
+            for (int Column = 0; Column < 4; Column++)
+            {
+                _mm_storeu_ps(O + 4 * Column, MultiplyColumn(Left0, Left1, Left2, Left3, _mm_loadu_ps(R + 4 * Column)));
+            }
+        }
+    }
+
+    // A BoundingBox is 6 packed floats. Read as two overlapping vec4s so nothing past the box is touched
+    void LoadBox(const BoundingBox& Bounds, __m128& Min, __m128& Max)
+    {
+        const float* B = &Bounds.Min.x;
+        Min = _mm_loadu_ps(B);                                                      // Min.xyz, Max.x
+        Max = _mm_loadu_ps(B + 2);                                                  // Min.z, Max.xyz
+        Max = _mm_shuffle_ps(Max, Max, _MM_SHUFFLE(3, 3, 2, 1));
+    }
+
+    KERNEL_TARGET("sse4.1")
+    void StoreBox(BoundingBox& Bounds, __m128 Min, __m128 Max)
+    {
+        // Both stores write Min.z and Max.x, with the same values
+        float* B = &Bounds.Min.x;
+        _mm_storeu_ps(B, _mm_blend_ps(Min, Broadcast<0>(Max), 0x8));
+        _mm_storeu_ps(B + 2, _mm_blend_ps(_mm_shuffle_ps(Max, Max, _MM_SHUFFLE(2, 1, 0, 0)), Broadcast<2>(Min), 0x1));
+    }
+
+    KERNEL_TARGET("sse4.1")
+    void TransformBoxSse41(const glm::mat4& Transform, const BoundingBox& Bounds, BoundingBox& Out)
+    {
+        const __m128 Half = _mm_set1_ps(0.5f);
+        const __m128 AbsoluteMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+        __m128 Min, Max;
+        LoadBox(Bounds, Min, Max);
+        __m128 Centre = _mm_mul_ps(_mm_add_ps(Min, Max), Half);
+        __m128 Extent = _mm_mul_ps(_mm_sub_ps(Max, Min), Half);
+
+        const float* M = &Transform[0][0];
+        __m128 Column0 = _mm_loadu_ps(M);
+        __m128 Column1 = _mm_loadu_ps(M + 4);
+        __m128 Column2 = _mm_loadu_ps(M + 8);
+        __m128 Column3 = _mm_loadu_ps(M + 12);
+
+        __m128 NewCentre = _mm_add_ps(Column3, _mm_mul_ps(Column0, Broadcast<0>(Centre)));
+        NewCentre = _mm_add_ps(NewCentre, _mm_mul_ps(Column1, Broadcast<1>(Centre)));
+        NewCentre = _mm_add_ps(NewCentre, _mm_mul_ps(Column2, Broadcast<2>(Centre)));
+
+        __m128 NewExtent = _mm_mul_ps(_mm_and_ps(Column0, AbsoluteMask), Broadcast<0>(Extent));
+        NewExtent = _mm_add_ps(NewExtent, _mm_mul_ps(_mm_and_ps(Column1, AbsoluteMask), Broadcast<1>(Extent)));
+        NewExtent = _mm_add_ps(NewExtent, _mm_mul_ps(_mm_and_ps(Column2, AbsoluteMask), Broadcast<2>(Extent)));
+
+        StoreBox(Out, _mm_sub_ps(NewCentre, NewExtent), _mm_add_ps(NewCentre, NewExtent));
+    }
+
+    KERNEL_TARGET("sse4.1")
+    void TransformBoundingBoxesSse41(const glm::mat4* Transforms, const BoundingBox* Bounds, BoundingBox* Out, size_t Count)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            if (HasBounds(Bounds[i])) TransformBoxSse41(Transforms[i], Bounds[i], Out[i]);
+            else Out[i] = Bounds[i];
+        }
+    }
+
+    __m128 Cross(__m128 A, __m128 B)
+    {
+        __m128 AYzx = _mm_shuffle_ps(A, A, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 BYzx = _mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 AZxy = _mm_shuffle_ps(A, A, _MM_SHUFFLE(3, 1, 0, 2));
+        __m128 BZxy = _mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 1, 0, 2));
+        return _mm_sub_ps(_mm_mul_ps(AYzx, BZxy), _mm_mul_ps(AZxy, BYzx));
+    }
+
+    // mat3 columns are 3 floats apart: the first two are written as vec4s the next column overwrites, the last one exactly
+    void StoreMat3(float* O, __m128 Column0, __m128 Column1, __m128 Column2)
+    {
+        _mm_storeu_ps(O, Column0);
+        _mm_storeu_ps(O + 3, Column1);
+        _mm_storel_pi(reinterpret_cast<__m64*>(O + 6), Column2);
+        _mm_store_ss(O + 8, Broadcast<2>(Column2));
+    }
+
+    // Columns a, b, c of the 3x3 give inverse transpose columns (b x c, c x a, a x b) / det
+    KERNEL_TARGET("sse4.1")
+    void ComputeNormalMatricesSse41(const glm::mat4* Transforms, glm::mat3* Out, size_t Count)
+    {
+        const __m128 One = _mm_set1_ps(1.0f);
+        for (size_t i = 0; i < Count; i++)
+        {
+            const float* M = &Transforms[i][0][0];
+            __m128 A = _mm_loadu_ps(M);
+            __m128 B = _mm_loadu_ps(M + 4);
+            __m128 C = _mm_loadu_ps(M + 8);
+
+            __m128 BC = Cross(B, C);
+            __m128 CA = Cross(C, A);
+            __m128 AB = Cross(A, B);
+            __m128 InverseDeterminant = _mm_div_ps(One, _mm_dp_ps(A, BC, 0x7F));
+
+            StoreMat3(&Out[i][0][0], _mm_mul_ps(BC, InverseDeterminant), _mm_mul_ps(CA, InverseDeterminant), _mm_mul_ps(AB, InverseDeterminant));
+        }
+    }
+
+    KERNEL_TARGET("sse4.1")
+    void ComputeVertexBoundsSse41(const Vertex* Vertices, size_t Count, BoundingBox& Out)
+    {
+        // Two accumulator pairs, so consecutive min/max don't wait on each other
+        __m128 Min0 = _mm_loadu_ps(&Vertices[0].pos.x);
+        __m128 Max0 = Min0;
+        __m128 Min1 = Min0;
+        __m128 Max1 = Min0;
+
+        size_t i = 1;
+        for (; i + 2 <= Count; i += 2)
+        {
+            __m128 Position0 = _mm_loadu_ps(&Vertices[i].pos.x);
+            __m128 Position1 = _mm_loadu_ps(&Vertices[i + 1].pos.x);
+            Min0 = _mm_min_ps(Min0, Position0);
+            Max0 = _mm_max_ps(Max0, Position0);
+            Min1 = _mm_min_ps(Min1, Position1);
+            Max1 = _mm_max_ps(Max1, Position1);
+        }
+        if (i < Count)
+        {
+            __m128 Position = _mm_loadu_ps(&Vertices[i].pos.x);
+            Min0 = _mm_min_ps(Min0, Position);
+            Max0 = _mm_max_ps(Max0, Position);
+        }
+
+        StoreBox(Out, _mm_min_ps(Min0, Min1), _mm_max_ps(Max0, Max1));
+    }
+
+    // Positions of 4 vertices as one register per component
+    KERNEL_TARGET("sse4.1")
+    void LoadPositions(const Vertex* Vertices, __m128& X, __m128& Y, __m128& Z)
+    {
+        __m128 Row0 = _mm_loadu_ps(&Vertices[0].pos.x);
+        __m128 Row1 = _mm_loadu_ps(&Vertices[1].pos.x);
+        __m128 Row2 = _mm_loadu_ps(&Vertices[2].pos.x);
+        __m128 Row3 = _mm_loadu_ps(&Vertices[3].pos.x);
+        _MM_TRANSPOSE4_PS(Row0, Row1, Row2, Row3);
+        X = Row0;
+        Y = Row1;
+        Z = Row2;
+    }
+
+    KERNEL_TARGET("sse4.1")
+    __m128 DistanceSquared4(const Vertex* Vertices, __m128 CentreX, __m128 CentreY, __m128 CentreZ)
+    {
+        __m128 X, Y, Z;
+        LoadPositions(Vertices, X, Y, Z);
+        X = _mm_sub_ps(X, CentreX);
+        Y = _mm_sub_ps(Y, CentreY);
+        Z = _mm_sub_ps(Z, CentreZ);
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y)), _mm_mul_ps(Z, Z));
+    }
+
+    // Best distance per lane while looping, the lanes are compared once at the end
+    KERNEL_TARGET("sse4.1")
+    size_t FindFarthestVertexSse41(const Vertex* Vertices, size_t Count, const glm::vec3& Point, float& DistanceSquared)
+    {
+        __m128 PointX = _mm_set1_ps(Point.x);
+        __m128 PointY = _mm_set1_ps(Point.y);
+        __m128 PointZ = _mm_set1_ps(Point.z);
+        __m128 Best = _mm_set1_ps(-1.0f);
+        __m128i BestIndex = _mm_setzero_si128();
+        __m128i Index = _mm_setr_epi32(0, 1, 2, 3);
+        const __m128i Step = _mm_set1_epi32(4);
+
+        size_t i = 0;
+        for (; i + 4 <= Count; i += 4)
+        {
+            __m128 Candidate = DistanceSquared4(Vertices + i, PointX, PointY, PointZ);
+            __m128 bFarther = _mm_cmpgt_ps(Candidate, Best);
+            Best = _mm_blendv_ps(Best, Candidate, bFarther);
+            BestIndex = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(BestIndex), _mm_castsi128_ps(Index), bFarther));
+            Index = _mm_add_epi32(Index, Step);
+        }
+
+        float Distances[4];
+        int32_t Indices[4];
+        _mm_storeu_ps(Distances, Best);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Indices), BestIndex);
+
+        size_t Farthest = FindFarthestVertexScalar(Vertices + i, Count - i, Point, DistanceSquared) + i;
+        for (int Lane = 0; Lane < 4; Lane++)
+        {
+            if (Distances[Lane] > DistanceSquared)
+            {
+                DistanceSquared = Distances[Lane];
+                Farthest = static_cast<size_t>(Indices[Lane]);
+            }
+        }
+        return Farthest;
+    }
+
+    // Most vertices are already inside, test 4 at a time and only grow (in order) inside blocks that stick out
+    KERNEL_TARGET("sse4.1")
+    void GrowSphereSse41(const Vertex* Vertices, size_t Count, glm::vec3& Centre, float& Radius)
+    {
+        size_t i = 0;
+        for (; i + 4 <= Count; i += 4)
+        {
+            __m128 Candidate = DistanceSquared4(Vertices + i, _mm_set1_ps(Centre.x), _mm_set1_ps(Centre.y), _mm_set1_ps(Centre.z));
+            if (_mm_movemask_ps(_mm_cmpgt_ps(Candidate, _mm_set1_ps(Radius * Radius))) != 0)
+            {
+                GrowSphereScalar(Vertices + i, 4, Centre, Radius);
+            }
+        }
+
+        GrowSphereScalar(Vertices + i, Count - i, Centre, Radius);
+    }
+
+    // -- AVX2 --
+    // Lanes of the two 128 bit halves of the AVX2 kernels belong to different columns or objects, so every
+    // shuffle stays inside a half (vpermilps)
+    KERNEL_TARGET("avx2,fma")
+    __m256 MultiplyColumnPair(__m256 Left0, __m256 Left1, __m256 Left2, __m256 Left3, __m256 RightColumns)
+    {
+        __m256 Result = _mm256_mul_ps(Left0, _mm256_permute_ps(RightColumns, 0x00));
+        Result = _mm256_fmadd_ps(Left1, _mm256_permute_ps(RightColumns, 0x55), Result);
+        Result = _mm256_fmadd_ps(Left2, _mm256_permute_ps(RightColumns, 0xAA), Result);
+        Result = _mm256_fmadd_ps(Left3, _mm256_permute_ps(RightColumns, 0xFF), Result);
+        return Result;
+    }
+
+    KERNEL_TARGET("avx2,fma")
+    void MultiplyMatricesAvx2(const glm::mat4& Left, const glm::mat4* Right, glm::mat4* Out, size_t Count)
+    {
+        // Each column of Left in both halves, so two columns of the result come out of every product
+        const float* L = &Left[0][0];
+        __m256 Left0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(L));
+        __m256 Left1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(L + 4));
+        __m256 Left2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(L + 8));
+        __m256 Left3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(L + 12));
+
+        for (size_t i = 0; i < Count; i++)
+        {
+            const float* R = &Right[i][0][0];
+            float* O = &Out[i][0][0];
+            _mm256_storeu_ps(O, MultiplyColumnPair(Left0, Left1, Left2, Left3, _mm256_loadu_ps(R)));
+            _mm256_storeu_ps(O + 8, MultiplyColumnPair(Left0, Left1, Left2, Left3, _mm256_loadu_ps(R + 8)));
+        }
+    }
+
+    KERNEL_TARGET("avx2,fma")
+    void MultiplyMatrixArraysAvx2(const glm::mat4* Left, const glm::mat4* Right, glm::mat4* Out, size_t Count)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            const float* L = &Left[i][0][0];
+            const float* R = &Right[i][0][0];
+            float* O = &Out[i][0][0];
+
+            __m256 Left0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(L));
+            __m256 Left1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(L + 4));
+            __m256 Left2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(L + 8));
+            __m256 Left3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(L + 12));
+            _mm256_storeu_ps(O, MultiplyColumnPair(Left0, Left1, Left2, Left3, _mm256_loadu_ps(R)));
+            _mm256_storeu_ps(O + 8, MultiplyColumnPair(Left0, Left1, Left2, Left3, _mm256_loadu_ps(R + 8)));
+        }
+    }
+
+    KERNEL_TARGET("avx2,fma")
+    __m256 LoadPair(const float* Low, const float* High)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(Low)), _mm_loadu_ps(High), 1);
+    }
+
+    KERNEL_TARGET("avx2,fma")
+    __m256 CombinePair(__m128 Low, __m128 High)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(Low), High, 1);
+    }
+
+    // Two boxes at a time, one per half
+    KERNEL_TARGET("avx2,fma")
+    void TransformBoundingBoxesAvx2(const glm::mat4* Transforms, const BoundingBox* Bounds, BoundingBox* Out, size_t Count)
+    {
+        const __m256 Half = _mm256_set1_ps(0.5f);
+        const __m256 AbsoluteMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+
+        size_t i = 0;
+        for (; i + 2 <= Count; i += 2)
+        {
+            if (!HasBounds(Bounds[i]) || !HasBounds(Bounds[i + 1]))
+            {
+                TransformBoundingBoxesSse41(Transforms + i, Bounds + i, Out + i, 2);
+                continue;
+            }
+
+            __m128 Min0, Max0, Min1, Max1;
+            LoadBox(Bounds[i], Min0, Max0);
+            LoadBox(Bounds[i + 1], Min1, Max1);
+            __m256 Min = CombinePair(Min0, Min1);
+            __m256 Max = CombinePair(Max0, Max1);
+            __m256 Centre = _mm256_mul_ps(_mm256_add_ps(Min, Max), Half);
+            __m256 Extent = _mm256_mul_ps(_mm256_sub_ps(Max, Min), Half);
+
+            const float* M0 = &Transforms[i][0][0];
+            const float* M1 = &Transforms[i + 1][0][0];
+            __m256 Column0 = LoadPair(M0, M1);
+            __m256 Column1 = LoadPair(M0 + 4, M1 + 4);
+            __m256 Column2 = LoadPair(M0 + 8, M1 + 8);
+            __m256 Column3 = LoadPair(M0 + 12, M1 + 12);
+
+            __m256 NewCentre = _mm256_fmadd_ps(Column0, _mm256_permute_ps(Centre, 0x00), Column3);
+            NewCentre = _mm256_fmadd_ps(Column1, _mm256_permute_ps(Centre, 0x55), NewCentre);
+            NewCentre = _mm256_fmadd_ps(Column2, _mm256_permute_ps(Centre, 0xAA), NewCentre);
+
+            __m256 NewExtent = _mm256_mul_ps(_mm256_and_ps(Column0, AbsoluteMask), _mm256_permute_ps(Extent, 0x00));
+            NewExtent = _mm256_fmadd_ps(_mm256_and_ps(Column1, AbsoluteMask), _mm256_permute_ps(Extent, 0x55), NewExtent);
+            NewExtent = _mm256_fmadd_ps(_mm256_and_ps(Column2, AbsoluteMask), _mm256_permute_ps(Extent, 0xAA), NewExtent);
+
+            __m256 NewMin = _mm256_sub_ps(NewCentre, NewExtent);
+            __m256 NewMax = _mm256_add_ps(NewCentre, NewExtent);
+            StoreBox(Out[i], _mm256_castps256_ps128(NewMin), _mm256_castps256_ps128(NewMax));
+            StoreBox(Out[i + 1], _mm256_extractf128_ps(NewMin, 1), _mm256_extractf128_ps(NewMax, 1));
+        }
+
+        TransformBoundingBoxesSse41(Transforms + i, Bounds + i, Out + i, Count - i);
+    }
+
+    KERNEL_TARGET("avx2,fma")
+    __m256 CrossPair(__m256 A, __m256 B)
+    {
+        __m256 AYzx = _mm256_permute_ps(A, _MM_SHUFFLE(3, 0, 2, 1));
+        __m256 BYzx = _mm256_permute_ps(B, _MM_SHUFFLE(3, 0, 2, 1));
+        __m256 AZxy = _mm256_permute_ps(A, _MM_SHUFFLE(3, 1, 0, 2));
+        __m256 BZxy = _mm256_permute_ps(B, _MM_SHUFFLE(3, 1, 0, 2));
+        return _mm256_fmsub_ps(AYzx, BZxy, _mm256_mul_ps(AZxy, BYzx));
+    }
+
+    // Two matrices at a time, one per half
+    KERNEL_TARGET("avx2,fma")
+    void ComputeNormalMatricesAvx2(const glm::mat4* Transforms, glm::mat3* Out, size_t Count)
+    {
+        const __m256 One = _mm256_set1_ps(1.0f);
+
+        size_t i = 0;
+        for (; i + 2 <= Count; i += 2)
+        {
+            const float* M0 = &Transforms[i][0][0];
+            const float* M1 = &Transforms[i + 1][0][0];
+            __m256 A = LoadPair(M0, M1);
+            __m256 B = LoadPair(M0 + 4, M1 + 4);
+            __m256 C = LoadPair(M0 + 8, M1 + 8);
+
+            __m256 BC = CrossPair(B, C);
+            __m256 CA = CrossPair(C, A);
+            __m256 AB = CrossPair(A, B);
+            __m256 InverseDeterminant = _mm256_div_ps(One, _mm256_dp_ps(A, BC, 0x7F));
+            BC = _mm256_mul_ps(BC, InverseDeterminant);
+            CA = _mm256_mul_ps(CA, InverseDeterminant);
+            AB = _mm256_mul_ps(AB, InverseDeterminant);
+
+            StoreMat3(&Out[i][0][0], _mm256_castps256_ps128(BC), _mm256_castps256_ps128(CA), _mm256_castps256_ps128(AB));
+            StoreMat3(&Out[i + 1][0][0], _mm256_extractf128_ps(BC, 1), _mm256_extractf128_ps(CA, 1), _mm256_extractf128_ps(AB, 1));
+        }
+
+        ComputeNormalMatricesSse41(Transforms + i, Out + i, Count - i);
+    }
+
+    // Two vertices at a time, one per half
+    KERNEL_TARGET("avx2,fma")
+    void ComputeVertexBoundsAvx2(const Vertex* Vertices, size_t Count, BoundingBox& Out)
+    {
+        __m256 Min0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&Vertices[0].pos.x));
+        __m256 Max0 = Min0;
+        __m256 Min1 = Min0;
+        __m256 Max1 = Min0;
+
+        size_t i = 0;
+        for (; i + 4 <= Count; i += 4)
+        {
+            __m256 Positions0 = LoadPair(&Vertices[i].pos.x, &Vertices[i + 1].pos.x);
+            __m256 Positions1 = LoadPair(&Vertices[i + 2].pos.x, &Vertices[i + 3].pos.x);
+            Min0 = _mm256_min_ps(Min0, Positions0);
+            Max0 = _mm256_max_ps(Max0, Positions0);
+            Min1 = _mm256_min_ps(Min1, Positions1);
+            Max1 = _mm256_max_ps(Max1, Positions1);
+        }
+
+        Min0 = _mm256_min_ps(Min0, Min1);
+        Max0 = _mm256_max_ps(Max0, Max1);
+        __m128 Min = _mm_min_ps(_mm256_castps256_ps128(Min0), _mm256_extractf128_ps(Min0, 1));
+        __m128 Max = _mm_max_ps(_mm256_castps256_ps128(Max0), _mm256_extractf128_ps(Max0, 1));
+
+        if (i < Count)
+        {
+            BoundingBox Rest;
+            ComputeVertexBoundsSse41(Vertices + i, Count - i, Rest);
+            __m128 RestMin, RestMax;
+            LoadBox(Rest, RestMin, RestMax);
+            Min = _mm_min_ps(Min, RestMin);
+            Max = _mm_max_ps(Max, RestMax);
+        }
+
+        StoreBox(Out, Min, Max);
+    }
+
+    // Squared distances of 8 vertices, two 4x4 transposes combined per component
+    KERNEL_TARGET("avx2,fma")
+    __m256 DistanceSquared8(const Vertex* Vertices, __m256 CentreX, __m256 CentreY, __m256 CentreZ)
+    {
+        __m128 LowX, LowY, LowZ, HighX, HighY, HighZ;
+        LoadPositions(Vertices, LowX, LowY, LowZ);
+        LoadPositions(Vertices + 4, HighX, HighY, HighZ);
+        __m256 X = _mm256_sub_ps(CombinePair(LowX, HighX), CentreX);
+        __m256 Y = _mm256_sub_ps(CombinePair(LowY, HighY), CentreY);
+        __m256 Z = _mm256_sub_ps(CombinePair(LowZ, HighZ), CentreZ);
+        return _mm256_fmadd_ps(Z, Z, _mm256_fmadd_ps(Y, Y, _mm256_mul_ps(X, X)));
+    }
+
+    KERNEL_TARGET("avx2,fma")
+    size_t FindFarthestVertexAvx2(const Vertex* Vertices, size_t Count, const glm::vec3& Point, float& DistanceSquared)
+    {
+        __m256 PointX = _mm256_set1_ps(Point.x);
+        __m256 PointY = _mm256_set1_ps(Point.y);
+        __m256 PointZ = _mm256_set1_ps(Point.z);
+        __m256 Best = _mm256_set1_ps(-1.0f);
+        __m256i BestIndex = _mm256_setzero_si256();
+        __m256i Index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i Step = _mm256_set1_epi32(8);
+
+        size_t i = 0;
+        for (; i + 8 <= Count; i += 8)
+        {
+            __m256 Candidate = DistanceSquared8(Vertices + i, PointX, PointY, PointZ);
+            __m256 bFarther = _mm256_cmp_ps(Candidate, Best, _CMP_GT_OQ);
+            Best = _mm256_blendv_ps(Best, Candidate, bFarther);
+            BestIndex = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(BestIndex), _mm256_castsi256_ps(Index), bFarther));
+            Index = _mm256_add_epi32(Index, Step);
+        }
+
+        float Distances[8];
+        int32_t Indices[8];
+        _mm256_storeu_ps(Distances, Best);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(Indices), BestIndex);
+
+        size_t Farthest = FindFarthestVertexSse41(Vertices + i, Count - i, Point, DistanceSquared) + i;
+        for (int Lane = 0; Lane < 8; Lane++)
+        {
+            if (Distances[Lane] > DistanceSquared)
+            {
+                DistanceSquared = Distances[Lane];
+                Farthest = static_cast<size_t>(Indices[Lane]);
+            }
+        }
+        return Farthest;
+    }
+
+    KERNEL_TARGET("avx2,fma")
+    void GrowSphereAvx2(const Vertex* Vertices, size_t Count, glm::vec3& Centre, float& Radius)
+    {
+        size_t i = 0;
+        for (; i + 8 <= Count; i += 8)
+        {
+            __m256 Candidate = DistanceSquared8(Vertices + i, _mm256_set1_ps(Centre.x), _mm256_set1_ps(Centre.y), _mm256_set1_ps(Centre.z));
+            if (_mm256_movemask_ps(_mm256_cmp_ps(Candidate, _mm256_set1_ps(Radius * Radius), _CMP_GT_OQ)) != 0)
+            {
+                GrowSphereScalar(Vertices + i, 8, Centre, Radius);
+            }
+        }
+
+        GrowSphereSse41(Vertices + i, Count - i, Centre, Radius);
+    }
+
+    // -- AVX-512 --
+    // A whole mat4 fits in one register, every column of the result comes out of the same four products
+    KERNEL_TARGET("avx512f")
+    __m512 MultiplyMatrix(__m512 Left0, __m512 Left1, __m512 Left2, __m512 Left3, __m512 Right)
+    {
+        __m512 Result = _mm512_mul_ps(Left0, _mm512_permute_ps(Right, 0x00));
+        Result = _mm512_fmadd_ps(Left1, _mm512_permute_ps(Right, 0x55), Result);
+        Result = _mm512_fmadd_ps(Left2, _mm512_permute_ps(Right, 0xAA), Result);
+        Result = _mm512_fmadd_ps(Left3, _mm512_permute_ps(Right, 0xFF), Result);
+        return Result;
+    }
+
+    KERNEL_TARGET("avx512f")
+    void MultiplyMatricesAvx512(const glm::mat4& Left, const glm::mat4* Right, glm::mat4* Out, size_t Count)
+    {
+        const float* L = &Left[0][0];
+        __m512 Left0 = _mm512_broadcast_f32x4(_mm_loadu_ps(L));
+        __m512 Left1 = _mm512_broadcast_f32x4(_mm_loadu_ps(L + 4));
+        __m512 Left2 = _mm512_broadcast_f32x4(_mm_loadu_ps(L + 8));
+        __m512 Left3 = _mm512_broadcast_f32x4(_mm_loadu_ps(L + 12));
+
+        for (size_t i = 0; i < Count; i++)
+        {
+            _mm512_storeu_ps(&Out[i][0][0], MultiplyMatrix(Left0, Left1, Left2, Left3, _mm512_loadu_ps(&Right[i][0][0])));
+        }
+    }
+
+    KERNEL_TARGET("avx512f")
+    void MultiplyMatrixArraysAvx512(const glm::mat4* Left, const glm::mat4* Right, glm::mat4* Out, size_t Count)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            const float* L = &Left[i][0][0];
+            __m512 Left0 = _mm512_broadcast_f32x4(_mm_loadu_ps(L));
+            __m512 Left1 = _mm512_broadcast_f32x4(_mm_loadu_ps(L + 4));
+            __m512 Left2 = _mm512_broadcast_f32x4(_mm_loadu_ps(L + 8));
+            __m512 Left3 = _mm512_broadcast_f32x4(_mm_loadu_ps(L + 12));
+            _mm512_storeu_ps(&Out[i][0][0], MultiplyMatrix(Left0, Left1, Left2, Left3, _mm512_loadu_ps(&Right[i][0][0])));
+        }
+    }
+}
+
+SimdLevel GetSupportedSimdLevel()
+{
+    return SupportedLevel;
+}
+
+SimdLevel GetSimdLevel()
+{
+    return ActiveLevel;
+}
+
+void SetSimdLevel(SimdLevel Level)
+{
+    ActiveLevel = Level < SupportedLevel ? Level : SupportedLevel;
+}
+
+const char* GetSimdLevelName(SimdLevel Level)
+{
+    switch (Level)
+    {
+    case SimdLevel::Sse41: return "SSE4.1";
+    case SimdLevel::Avx2: return "AVX2";
+    case SimdLevel::Avx512: return "AVX-512";
+    default: return "Scalar";
+    }
+}
+
+void MultiplyMatrices(const glm::mat4& Left, const glm::mat4* Right, glm::mat4* Out, size_t Count)
+{
+    switch (ActiveLevel)
+    {
+    case SimdLevel::Avx512: MultiplyMatricesAvx512(Left, Right, Out, Count); break;
+    case SimdLevel::Avx2: MultiplyMatricesAvx2(Left, Right, Out, Count); break;
+    case SimdLevel::Sse41: MultiplyMatricesSse41(Left, Right, Out, Count); break;
+    default: MultiplyMatricesScalar(Left, Right, Out, Count); break;
+    }
+}
+
+void MultiplyMatrixArrays(const glm::mat4* Left, const glm::mat4* Right, glm::mat4* Out, size_t Count)
+{
+    switch (ActiveLevel)
+    {
+    case SimdLevel::Avx512: MultiplyMatrixArraysAvx512(Left, Right, Out, Count); break;
+    case SimdLevel::Avx2: MultiplyMatrixArraysAvx2(Left, Right, Out, Count); break;
+    case SimdLevel::Sse41: MultiplyMatrixArraysSse41(Left, Right, Out, Count); break;
+    default: MultiplyMatrixArraysScalar(Left, Right, Out, Count); break;
+    }
+}
+
+void TransformBoundingBoxes(const glm::mat4* Transforms, const BoundingBox* Bounds, BoundingBox* Out, size_t Count)
+{
+    switch (ActiveLevel)
+    {
+    case SimdLevel::Avx512:
+    case SimdLevel::Avx2: TransformBoundingBoxesAvx2(Transforms, Bounds, Out, Count); break;
+    case SimdLevel::Sse41: TransformBoundingBoxesSse41(Transforms, Bounds, Out, Count); break;
+    default: TransformBoundingBoxesScalar(Transforms, Bounds, Out, Count); break;
+    }
+}
+
+void ComputeNormalMatrices(const glm::mat4* Transforms, glm::mat3* Out, size_t Count)
+{
+    switch (ActiveLevel)
+    {
+    case SimdLevel::Avx512:
+    case SimdLevel::Avx2: ComputeNormalMatricesAvx2(Transforms, Out, Count); break;
+    case SimdLevel::Sse41: ComputeNormalMatricesSse41(Transforms, Out, Count); break;
+    default: ComputeNormalMatricesScalar(Transforms, Out, Count); break;
+    }
+}
+
+BoundingBox ComputeVertexBounds(const Vertex* Vertices, size_t Count)
+{
+    BoundingBox Bounds;
+    if (Count == 0) return Bounds;
+
+    switch (ActiveLevel)
+    {
+    case SimdLevel::Avx512:
+    case SimdLevel::Avx2: ComputeVertexBoundsAvx2(Vertices, Count, Bounds); break;
+    case SimdLevel::Sse41: ComputeVertexBoundsSse41(Vertices, Count, Bounds); break;
+    default: ComputeVertexBoundsScalar(Vertices, Count, Bounds); break;
+    }
+    return Bounds;
+}
+
+glm::vec4 ComputeBoundingSphere(const Vertex* Vertices, size_t Count, const BoundingBox& Bounds)
+{
+    if (Count == 0) return glm::vec4(0.0f, 0.0f, 0.0f, std::numeric_limits<float>::max());
+
+    size_t (*FindFarthestVertex)(const Vertex*, size_t, const glm::vec3&, float&) = FindFarthestVertexScalar;
+    void (*GrowSphere)(const Vertex*, size_t, glm::vec3&, float&) = GrowSphereScalar;
+    switch (ActiveLevel)
+    {
+    case SimdLevel::Avx512:
+    case SimdLevel::Avx2:
+        FindFarthestVertex = FindFarthestVertexAvx2;
+        GrowSphere = GrowSphereAvx2;
+        break;
+    case SimdLevel::Sse41:
+        FindFarthestVertex = FindFarthestVertexSse41;
+        GrowSphere = GrowSphereSse41;
+        break;
+    default: break;
+    }
+
+    // Ritter: the two vertices farthest apart (approximately) give the first sphere, then grow it over every vertex
+    float DistanceSquared;
+    const glm::vec3& First = Vertices[FindFarthestVertex(Vertices, Count, Vertices[0].pos, DistanceSquared)].pos;
+    const glm::vec3& Second = Vertices[FindFarthestVertex(Vertices, Count, First, DistanceSquared)].pos;
+    glm::vec3 Centre = (First + Second) * 0.5f;
+    float Radius = std::sqrt(DistanceSquared) * 0.5f;
+    GrowSphere(Vertices, Count, Centre, Radius);
+
+    // Box shaped meshes are often held tighter by a sphere around the box centre
+    glm::vec3 BoxCentre = (Bounds.Min + Bounds.Max) * 0.5f;
+    FindFarthestVertex(Vertices, Count, BoxCentre, DistanceSquared);
+    float BoxRadius = std::sqrt(DistanceSquared);
+    if (BoxRadius < Radius)
+    {
+        Centre = BoxCentre;
+        Radius = BoxRadius;
+    }
+
+    // Rounding in the growth steps can leave the last vertices a hair outside, culling must stay conservative
+    return glm::vec4(Centre, Radius * SPHERE_RADIUS_PADDING);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Utilities.h"
+
+// Batched transform kernels over the dense arrays of a RenderObjectList (or any array of matrices/boxes/vertices).
+// Each kernel has a scalar GLM version and SIMD versions, picked once at startup from what the CPU and OS support:
+//   SSE4.1  : one object per 128 bit register
+//   AVX2    : two objects (or two matrix columns) per 256 bit register, with FMA
+//   AVX-512 : a whole mat4 per 512 bit register (matrix products), other kernels keep the AVX2 version
+// Inputs and outputs don't need any alignment. Outputs must not overlap inputs
+enum class SimdLevel
+{
+    Scalar,
+    Sse41,
+    Avx2,
+    Avx512
+};
+
+SimdLevel GetSupportedSimdLevel();                      // Best level this machine runs
+SimdLevel GetSimdLevel();                               // Level the kernels currently use
+void SetSimdLevel(SimdLevel Level);                     // Clamped to the supported level, to compare paths
+const char* GetSimdLevelName(SimdLevel Level);
+
+// Out[i] = Left * Right[i], e.g. view-projection times every model matrix
+void MultiplyMatrices(const glm::mat4& Left, const glm::mat4* Right, glm::mat4* Out, size_t Count);
+
+// Out[i] = Left[i] * Right[i]
+void MultiplyMatrixArrays(const glm::mat4* Left, const glm::mat4* Right, glm::mat4* Out, size_t Count);
+
+// Bounds[i] moved by the affine Transforms[i], as the box enclosing the moved box (Arvo's method).
+// Boxes without bounds (the BoundingBox default) are copied unchanged
+void TransformBoundingBoxes(const glm::mat4* Transforms, const BoundingBox* Bounds, BoundingBox* Out, size_t Count);
+
+// Inverse transpose of the upper 3x3 of every transform, for transforming normals
+void ComputeNormalMatrices(const glm::mat4* Transforms, glm::mat3* Out, size_t Count);
+
+// Box around the positions of Vertices. No vertices gives the BoundingBox default (no bounds)
+BoundingBox ComputeVertexBounds(const Vertex* Vertices, size_t Count);
+
+// Sphere around the positions of Vertices (xyz centre, w radius): Ritter's sphere, or the sphere around Bounds
+// (the vertex box) if that one is smaller. Within a few percent of the minimal sphere for typical meshes.
+// No vertices gives an infinite radius (no bounds)
+glm::vec4 ComputeBoundingSphere(const Vertex* Vertices, size_t Count, const BoundingBox& Bounds);
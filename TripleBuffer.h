@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Single producer, single consumer hand-off of the latest value. Of the three slots one is being written,
+// one is being read and one holds the newest complete value; publishing and taking each swap a slot with the
+// newest one in a single atomic exchange, so neither side ever blocks the other. A value published before the
+// consumer took the previous one replaces it: the consumer always gets the newest, never a queue of stale ones.
+// Slots are reused, so containers inside T keep their memory between values
+template<typename T>
+class TripleBuffer
+{
+public:
+    // -- PRODUCER --
+    T& GetWriteSlot() { return Slots[WriteIndex]; }
+
+    void Publish()
+    {
+        uint32_t Previous = Latest.exchange(WriteIndex | FRESH_BIT, std::memory_order_acq_rel);
+        WriteIndex = Previous & INDEX_MASK;
+        Latest.notify_one();
+    }
+
+    bool HasUnreadValue() const { return (Latest.load(std::memory_order_acquire) & FRESH_BIT) != 0; }
+
+    // -- CONSUMER --
+    // Newest published value, or nullptr if nothing was published since the last take
+    const T* Take()
+    {
+        if (!HasUnreadValue()) return nullptr;
+
+        uint32_t Previous = Latest.exchange(ReadIndex, std::memory_order_acq_rel);
+        ReadIndex = Previous & INDEX_MASK;
+        return &Slots[ReadIndex];
+    }
+
+    // Sleeps until a value is published if there is none yet
+    const T& WaitAndTake()
+    {
+        uint32_t Current = Latest.load(std::memory_order_acquire);
+        while (!(Current & FRESH_BIT))
+        {
+            Latest.wait(Current, std::memory_order_acquire);
+            Current = Latest.load(std::memory_order_acquire);
+        }
+        return *Take();
+    }
+
+private:
+    static const uint32_t INDEX_MASK = 3;
+    static const uint32_t FRESH_BIT = 4;                // Latest slot hasn't been taken yet
+
+    T Slots[3];
+    uint32_t WriteIndex = 0;                            // Producer only
+    uint32_t ReadIndex = 2;                             // Consumer only
+    std::atomic<uint32_t> Latest = 1;
+};
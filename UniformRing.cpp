@@ -0,0 +1,77 @@
+#include "UniformRing.h"
+#include "Utilities.h"
+
+#include <stdexcept>
+
+UniformRing::UniformRing()
+{
+}
+
+UniformRing::~UniformRing()
+{
+}
+
+void UniformRing::Create(VkPhysicalDevice PhysicalDevice, VkDevice NewDevice, VkDeviceSize FrameRegionSize, uint32_t NewFrameCount)
+{
+    Device = NewDevice;
+    FrameCount = NewFrameCount;
+
+    // Dynamic offsets must be a multiple of the device's minimum uniform offset alignment
+    VkPhysicalDeviceProperties DeviceProperties;
+    vkGetPhysicalDeviceProperties(PhysicalDevice, &DeviceProperties);
+    Alignment = DeviceProperties.limits.minUniformBufferOffsetAlignment;
+
+    // Round region size up so every region also starts aligned
+    RegionSize = (FrameRegionSize + Alignment - 1) & ~(Alignment - 1);
+
+    CreateBuffer(PhysicalDevice, Device, RegionSize * FrameCount,
+                 VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &Buffer, &BufferMemory, MemoryCategory::Uniform);
+
+    // Map once and keep it mapped for the lifetime of the ring
+    void* Data;
+    VkResult Result = vkMapMemory(Device, BufferMemory, 0, RegionSize * FrameCount, 0, &Data);
+    if (Result != VK_SUCCESS) throw std::runtime_error("Failed to map Uniform Ring memory");
+    MappedData = static_cast<uint8_t*>(Data);
+
+    RegionStart = 0;
+    Head = 0;
+}
+
+void UniformRing::Destroy()
+{
+    if (Buffer == VK_NULL_HANDLE) return;
+
+    vkUnmapMemory(Device, BufferMemory);
+    vkDestroyBuffer(Device, Buffer, nullptr);
+    FreeDeviceMemory(Device, BufferMemory);
+
+    Buffer = VK_NULL_HANDLE;
+    BufferMemory = VK_NULL_HANDLE;
+    MappedData = nullptr;
+}
+
+void UniformRing::BeginFrame(uint32_t FrameIndex)
+{
+    RegionStart = RegionSize * (FrameIndex % FrameCount);
+    Head = 0;
+}
+
+UniformAllocation UniformRing::Allocate(VkDeviceSize Size)
+{
+    VkDeviceSize AlignedSize = (Size + Alignment - 1) & ~(Alignment - 1);
+    if (Head + AlignedSize > RegionSize) throw std::runtime_error("Uniform Ring frame region is full");
+
+    UniformAllocation Allocation = {};
+    Allocation.Offset = static_cast<uint32_t>(RegionStart + Head);
+    Allocation.Data = MappedData + RegionStart + Head;
+
+    Head += AlignedSize;
+    return Allocation;
+}
+
+VkBuffer UniformRing::GetBuffer() const
+{
+    return Buffer;
+}
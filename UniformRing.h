@@ -0,0 +1,54 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <cstring>
+
+// Where a block of uniform data ended up inside the ring
+struct UniformAllocation
+{
+    uint32_t Offset;            // Offset from start of ring buffer (use as dynamic offset)
+    void* Data;                 // Mapped pointer to write the data to
+};
+
+// One persistently mapped uniform buffer split into a region per frame in flight.
+// Each frame bump-allocates from its own region, and the region is only rewound in BeginFrame,
+// after the fence of the frame that last used it has been waited on, so no allocation happens per draw
+class UniformRing
+{
+public:
+    UniformRing();
+    ~UniformRing();
+
+    void Create(VkPhysicalDevice PhysicalDevice, VkDevice Device, VkDeviceSize FrameRegionSize, uint32_t FrameCount);
+    void Destroy();
+
+    void BeginFrame(uint32_t FrameIndex);                   // Rewind FrameIndex's region, its fence must already be signalled
+    UniformAllocation Allocate(VkDeviceSize Size);
+
+    // Copy Data into the current frame's region and return its dynamic offset
+    template<typename T>
+    uint32_t Push(const T& Data)
+    {
+        UniformAllocation Allocation = Allocate(sizeof(T));
+        memcpy(Allocation.Data, &Data, sizeof(T));
+        return Allocation.Offset;
+    }
+
+    VkBuffer GetBuffer() const;
+
+private:
+    VkDevice Device = VK_NULL_HANDLE;
+    VkBuffer Buffer = VK_NULL_HANDLE;
+    VkDeviceMemory BufferMemory = VK_NULL_HANDLE;
+    uint8_t* MappedData = nullptr;
+
+    VkDeviceSize Alignment = 0;             // minUniformBufferOffsetAlignment of the device
+    VkDeviceSize RegionSize = 0;            // Size of each frame's region (multiple of Alignment)
+    uint32_t FrameCount = 0;
+
+    VkDeviceSize RegionStart = 0;           // Start of the current frame's region
+    VkDeviceSize Head = 0;                  // Next free byte in the current frame's region (relative to RegionStart)
+};
@@ -1,18 +1,44 @@
 #pragma once
 #include <vector>
+#include <string>
 #include <fstream>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include "GLM/glm.hpp"
 
+#include "Barriers.h"
+#include "MemoryTracker.h"
+
 const int MAX_FRAME_DRAWS = 2;
+const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 1024 * 1024;		// Bytes of uniform data each frame in flight can use
+const uint32_t MAX_BINDLESS_TEXTURES = 16384;					// Size of the bindless texture array (clamped to device limits)
+const uint32_t MAX_BINDLESS_BUFFERS = 1024;						// Size of the bindless storage buffer array (clamped to device limits)
+const uint32_t MAX_MATERIALS = 4096;
+const char* const CHECKER_TEXTURE_PATH = "Textures/checker.ktx2";	// Built by Textures/compress_textures.bat
+const char* const GPU_OVERRIDE_VARIABLE = "VULKAN_RENDERER_GPU";		// Environment variable forcing a GPU: enumeration index or part of the device name
+#ifdef SHADER_SOURCE_DIRECTORY
+const std::string SHADER_DIRECTORY = SHADER_SOURCE_DIRECTORY;		// GLSL sources watched by shader hot reload (the build embeds their SPIR-V), $(ProjectDir)Shaders/
+#else
+const std::string SHADER_DIRECTORY = "Shaders/";					// Built outside the project: relative to the working directory
+#endif
 
 
 const std::vector<const char*> DeviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+//Extensions that are enabled when the device has them, but aren't required
+const std::vector<const char*> OptionalDeviceExtensions = {
+	VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,		// Per heap budget/usage, used by texture streaming
+	VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME		// Per barrier stage masks and finer grained stages/access, used by every barrier
+};
+
 //Indices (locations) of Queue Families (if they exist at all)
 struct QueueFamilyIndices {
 	int GraphicsFamily = -1;					//Location of Graphics Queue Family
@@ -80,6 +106,14 @@ struct Vertex
 {
     glm::vec3 pos; // Vertex Position (x, y, z)
     glm::vec3 col; // Vertex Color (r, g, b)
+    glm::vec2 tex; // Texture Coords (u, v)
+};
+
+// Axis aligned bounding box. Defaults to an infinite box, so objects without computed bounds are never culled
+struct BoundingBox
+{
+    glm::vec3 Min = glm::vec3(-std::numeric_limits<float>::max());
+    glm::vec3 Max = glm::vec3(std::numeric_limits<float>::max());
 };
 
 static uint32_t FindMemoryTypeIndex(VkPhysicalDevice PhysicalDevice, uint32_t AllowedTypes, VkMemoryPropertyFlags Properties)
@@ -101,7 +135,8 @@ static uint32_t FindMemoryTypeIndex(VkPhysicalDevice PhysicalDevice, uint32_t Al
     throw std::runtime_error("Failed to find Memory Type Index");
 }
 
-static void CreateBuffer(VkPhysicalDevice PhysicalDevice, VkDevice Device, VkDeviceSize BufferSize, VkBufferUsageFlags BufferUsage, VkMemoryPropertyFlags BufferProperty, VkBuffer* Buffer, VkDeviceMemory* BufferMemory)
+static void CreateBuffer(VkPhysicalDevice PhysicalDevice, VkDevice Device, VkDeviceSize BufferSize, VkBufferUsageFlags BufferUsage, VkMemoryPropertyFlags BufferProperty, VkBuffer* Buffer, VkDeviceMemory* BufferMemory,
+                         MemoryCategory Category)
 {
     //CREATE BUFFER
     // Information to create a buffer (doesn't include assingning memory)
@@ -132,12 +167,156 @@ static void CreateBuffer(VkPhysicalDevice PhysicalDevice, VkDevice Device, VkDev
     // Allocate memory to VkDeviceMemory
     Result = vkAllocateMemory(Device, &MemoryAllocateInfo, nullptr, BufferMemory);
     if(Result != VK_SUCCESS) throw std::runtime_error("Failed to Allocate Vertex Buffer");
+    MemoryTracker::TrackAllocation(*BufferMemory, Category, BufferSize, MemoryRequirements.size, MemoryAllocateInfo.memoryTypeIndex);
 
     // Allocate memory to given vertex buffer
     vkBindBufferMemory(Device, *Buffer, *BufferMemory, 0);
 }
 
-static void CopyBuffer(VkDevice Device, VkQueue TransferQueue, VkCommandPool TransferCommandPool, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize BufferSize)
+static VkImage CreateImage(VkPhysicalDevice PhysicalDevice, VkDevice Device, uint32_t Width, uint32_t Height, uint32_t MipLevels, VkFormat Format, VkImageTiling Tiling,
+                          VkImageUsageFlags UseFlags, VkMemoryPropertyFlags PropFlags, VkDeviceMemory* ImageMemory,
+                          MemoryCategory Category, VkDeviceSize RequestedSize = 0)
+{
+    // CREATE IMAGE
+    // Image Creation Info
+    VkImageCreateInfo ImageCreateInfo = {};
+    ImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    ImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;                       // Type of image (1D, 2D, or 3D)
+    ImageCreateInfo.extent.width = Width;                               // Width of image extent
+    ImageCreateInfo.extent.height = Height;                             // Height of image extent
+    ImageCreateInfo.extent.depth = 1;                                   // Depth of image (just 1, no 3D aspect)
+    ImageCreateInfo.mipLevels = MipLevels;                              // Number of mipmap levels
+    ImageCreateInfo.arrayLayers = 1;                                    // Number of levels in image array
+    ImageCreateInfo.format = Format;                                    // Format type of image
+    ImageCreateInfo.tiling = Tiling;                                    // How image data should be "tiled" (arranged for optimal reading)
+    ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;          // Layout of image data on creation
+    ImageCreateInfo.usage = UseFlags;                                   // Bit flags defining what image will be used for
+    ImageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;                    // Number of samples for multi-sampling
+    ImageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;            // Whether image can be shared between queues
+
+    VkImage Image;
+    VkResult Result = vkCreateImage(Device, &ImageCreateInfo, nullptr, &Image);
+    if(Result != VK_SUCCESS) throw std::runtime_error("Failed to create an Image");
+
+    // CREATE MEMORY FOR IMAGE
+    // Get memory requirements for a type of image
+    VkMemoryRequirements MemoryRequirements;
+    vkGetImageMemoryRequirements(Device, Image, &MemoryRequirements);
+
+    // Allocate memory using image requirements and user defined properties
+    VkMemoryAllocateInfo MemoryAllocateInfo = {};
+    MemoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    MemoryAllocateInfo.allocationSize = MemoryRequirements.size;
+    MemoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(PhysicalDevice, MemoryRequirements.memoryTypeBits, PropFlags);
+
+    Result = vkAllocateMemory(Device, &MemoryAllocateInfo, nullptr, ImageMemory);
+    if(Result != VK_SUCCESS) throw std::runtime_error("Failed to allocate memory for Image");
+    // RequestedSize is the tightly packed texel size if the caller knows it, otherwise the whole requirement counts (no waste)
+    MemoryTracker::TrackAllocation(*ImageMemory, Category, RequestedSize > 0 ? RequestedSize : MemoryRequirements.size,
+                                   MemoryRequirements.size, MemoryAllocateInfo.memoryTypeIndex);
+
+    // Connect memory to image
+    vkBindImageMemory(Device, Image, *ImageMemory, 0);
+
+    return Image;
+}
+
+// vkFreeMemory, and forget the allocation in MemoryTracker
+static void FreeDeviceMemory(VkDevice Device, VkDeviceMemory Memory)
+{
+    MemoryTracker::TrackFree(Memory);
+    vkFreeMemory(Device, Memory, nullptr);
+}
+
+// Size of the smallest addressable block of a format: 1x1 texel for plain formats, 4x4 for block compressed ones
+struct FormatBlockInfo
+{
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t Bytes;
+};
+
+static FormatBlockInfo GetFormatBlockInfo(VkFormat Format)
+{
+    switch (Format)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+        return { 1, 1, 1 };
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SRGB:
+        return { 1, 1, 2 };
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return { 1, 1, 4 };
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return { 1, 1, 8 };
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return { 1, 1, 16 };
+
+    // Block compressed, sizes are per 4x4 block
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+        return { 4, 4, 8 };
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        return { 4, 4, 16 };
+    default:
+        throw std::runtime_error("Unsupported texture format");
+    }
+}
+
+// Bytes needed to store one mip level of Width x Height in Format
+static VkDeviceSize GetMipByteSize(VkFormat Format, uint32_t Width, uint32_t Height)
+{
+    FormatBlockInfo Block = GetFormatBlockInfo(Format);
+    VkDeviceSize BlocksWide = (Width + Block.Width - 1) / Block.Width;
+    VkDeviceSize BlocksHigh = (Height + Block.Height - 1) / Block.Height;
+    return BlocksWide * BlocksHigh * Block.Bytes;
+}
+
+// Number of mip levels in a full chain down to 1x1
+static uint32_t GetMipLevelCount(uint32_t Width, uint32_t Height)
+{
+    uint32_t Levels = 1;
+    uint32_t Size = std::max(Width, Height);
+    while (Size > 1)
+    {
+        Size >>= 1;
+        Levels++;
+    }
+    return Levels;
+}
+
+// DstStages/DstAccess: how dstBuffer is used afterwards, the copy is made visible to exactly that
+static void CopyBuffer(VkDevice Device, VkQueue TransferQueue, VkCommandPool TransferCommandPool, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize BufferSize,
+                       VkPipelineStageFlags2KHR DstStages, VkAccessFlags2KHR DstAccess)
 {
     // ALLOCATE COMMAND BUFFER
     //Command Buffer to hold transfer commands
@@ -172,6 +351,11 @@ static void CopyBuffer(VkDevice Device, VkQueue TransferQueue, VkCommandPool Tra
     //Cmd to copy src buffer to dst buffer
     vkCmdCopyBuffer(TransferCommandBuffer, srcBuffer, dstBuffer, 1, &BufferCopyRegion);
 
+    // Make the copy visible to the stages that read the buffer in later submissions
+    BarrierBatch Barriers;
+    Barriers.AddBufferBarrier(dstBuffer, 0, BufferSize, VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, DstStages, DstAccess);
+    Barriers.Flush(TransferCommandBuffer, "CopyBuffer");
+
     // End commands
     vkEndCommandBuffer(TransferCommandBuffer);
 
@@ -183,9 +367,17 @@ static void CopyBuffer(VkDevice Device, VkQueue TransferQueue, VkCommandPool Tra
     SubmitInfo.commandBufferCount = 1;
     SubmitInfo.pCommandBuffers = &TransferCommandBuffer;
 
-    // Submit transfer command to transfer queue and wait until it finishes
-    vkQueueSubmit(TransferQueue, 1, &SubmitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(TransferQueue);
+    // Submit transfer command and wait on its own fence (the staging buffer is freed right after),
+    // rather than for the whole queue to go idle
+    VkFenceCreateInfo FenceCreateInfo = {};
+    FenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence TransferFence;
+    if (vkCreateFence(Device, &FenceCreateInfo, nullptr, &TransferFence) != VK_SUCCESS) throw std::runtime_error("Failed to create a transfer Fence");
+
+    vkQueueSubmit(TransferQueue, 1, &SubmitInfo, TransferFence);
+    vkWaitForFences(Device, 1, &TransferFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    vkDestroyFence(Device, TransferFence, nullptr);
 
 
 
@@ -1,6 +1,47 @@
 #include "VulkanRenderer.h"
 #include "ValidationLayer.h"
 
+namespace
+{
+	// Physical device score weights. Device type dominates, so a discrete GPU always beats an integrated one
+	// (iGPUs often report a large shared "device local" heap), the rest only breaks ties within a type
+	const uint64_t SCORE_DISCRETE_GPU = 1ull << 40;
+	const uint64_t SCORE_INTEGRATED_GPU = 1ull << 39;
+	const uint64_t SCORE_VIRTUAL_GPU = 1ull << 38;
+	const uint64_t SCORE_OTHER_DEVICE = 1ull << 37;		// CPU implementations (lavapipe, SwiftShader) score 0 for type
+	const uint64_t SCORE_SHARED_QUEUE_FAMILY = 1ull << 36;	// Graphics and presentation on one family, no ownership transfers
+	const uint64_t SCORE_TIMESTAMPS = 1ull << 35;			// GPU timings available on the graphics queue
+	const uint64_t SCORE_OPTIONAL_EXTENSION = 1ull << 32;	// Per supported optional device extension
+	// Below that: MiB of the largest device local heap
+
+	const char* GetDeviceTypeName(VkPhysicalDeviceType Type)
+	{
+		switch (Type)
+		{
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+		case VK_PHYSICAL_DEVICE_TYPE_CPU: return "CPU";
+		default: return "other";
+		}
+	}
+
+	// Empty if the variable isn't set (getenv is deprecated under MSVC's SDL checks)
+	std::string ReadEnvironmentVariable(const char* Name)
+	{
+#ifdef _MSC_VER
+		char* Value = nullptr;
+		size_t Length = 0;
+		if (_dupenv_s(&Value, &Length, Name) != 0 || !Value) return "";
+		std::string Result = Value;
+		free(Value);
+		return Result;
+#else
+		const char* Value = std::getenv(Name);
+		return Value ? Value : "";
+#endif
+	}
+}
 
 VulkanRenderer::VulkanRenderer()
 {
@@ -15,61 +56,170 @@ int VulkanRenderer::Init(GLFWwindow* NewWindow)
 	Window = NewWindow;
 	try
 	{
+		Jobs.Create();											// This thread becomes worker 0
+		Startup.Begin(&Jobs);
+
+		//Everything else needs the device
+		Startup.RunStage({ { "Instance and surface", [this]() { CreateInstance(); CreateSurface(); } } });
+		Startup.RunStage({ { "Physical and logical device", [this]() { GetPhysicalDevice(); CreateLogicalDevice(); } } });
+
+		//Independent of each other. The swapchain and render passes are the longest chain, so the calling thread takes them.
+		//VkQueue needs external synchronisation, so everything submitting to the graphics queue before the first frame
+		//(mesh uploads, the streamer's placeholder clear) stays in the one phase
+		std::vector<Mesh> SceneMeshes;
+		std::vector<TextureSource> SceneTextures;
+		Startup.RunStage({
+			{ "Swapchain and render graph", [this]() { CreateSwapChain(); CreateRenderGraph(); } },
+			{ "Bindless resources and pipeline layout", [this]() { CreateBindlessResources(); CreateMipGeneration(); CreateGraphicsPipelineLayout(); } },
+			{ "Mesh upload and texture streaming", [this, &SceneMeshes]() { CreateCommandPool(); SceneMeshes = UploadSceneMeshes(); CreateTextureStreaming(); } },
+			{ "Texture sources", [this, &SceneTextures]() { SceneTextures = LoadSceneTextures(); } },
+		});
+
+		//Pipeline compilation (the slowest part) needs the render passes, the rest only what the stage above made
+		Startup.RunStage({
+			{ "Graphics pipelines", [this]() { CreateGraphicsPipeline(); } },
+			{ "Frame resources", [this]() { CreateCommandBuffer(); CreateUniformRing(); CreateDescriptorPool(); CreateDescriptorSets(); CreateSynchronisation(); CreateGpuCounters(); } },
+			{ "Scene", [this, &SceneMeshes, &SceneTextures]() { CreateScene(SceneMeshes, SceneTextures); } },
+		});
+
+		//Not needed for the first frame, Draw runs these once it has presented
+		if (bShaderHotReload) Startup.Defer("Shader hot reload", [this]() { StartShaderHotReload(); });
+	}
+	catch (const std::runtime_error& e)
+	{
+		std::cout << "ERROR: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
 
-		CreateInstance();
-		CreateSurface();
-		GetPhysicalDevice();
-		CreateLogicalDevice();
-		CreateSwapChain();
-		CreateRenderPass();
-		CreateGraphicsPipeline();
-		CreateFramebuffers();
-		CreateCommandPool();
-        // Create a Mesh
-        // VertexData
-        std::vector<Vertex> MeshVertices = {
-                {.pos{-0.1, -0.4, 0.0},  .col{1.0, 0.0, 0.0}}, // V 0
-                {.pos{-0.1, 0.4, 0.0},   .col{0.0, 1.0, 0.0}}, // V 1
-                {.pos{-0.9, 0.4, 0.0},  .col{0.0, 0.0, 1.0}}, // V 2
-                {.pos{-0.9, -0.4, 0.0}, .col{1.0, 1.0, 0.0}}, // V 3
-        };
+	return 0;
+}
 
-        std::vector<Vertex> MeshVertices2 = {
-                {.pos{0.9, -0.4, 0.0},  .col{1.0, 0.0, 0.0}}, // V 0
-                {.pos{0.9, 0.2, 0.0},   .col{0.0, 1.0, 0.0}}, // V 1
-                {.pos{0.1, 0.4, 0.0},  .col{0.0, 0.0, 1.0}}, // V 2
-                {.pos{0.1, -0.4, 0.0}, .col{1.0, 1.0, 0.0}}, // V 3
-        };
+std::vector<Mesh> VulkanRenderer::UploadSceneMeshes()
+{
+    // Create a Mesh
+    // VertexData
+    std::vector<Vertex> MeshVertices = {
+            {.pos{-0.1, -0.4, 0.0},  .col{1.0, 0.0, 0.0}, .tex{1.0, 1.0}}, // V 0
+            {.pos{-0.1, 0.4, 0.0},   .col{0.0, 1.0, 0.0}, .tex{1.0, 0.0}}, // V 1
+            {.pos{-0.9, 0.4, 0.0},  .col{0.0, 0.0, 1.0}, .tex{0.0, 0.0}}, // V 2
+            {.pos{-0.9, -0.4, 0.0}, .col{1.0, 1.0, 0.0}, .tex{0.0, 1.0}}, // V 3
+    };
 
-        //Index Data
-        std::vector<uint32_t> MeshIndices = {
-                0, 1, 2,
-                2, 3, 0
-        };
+    std::vector<Vertex> MeshVertices2 = {
+            {.pos{0.9, -0.4, 0.0},  .col{1.0, 0.0, 0.0}, .tex{1.0, 1.0}}, // V 0
+            {.pos{0.9, 0.2, 0.0},   .col{0.0, 1.0, 0.0}, .tex{1.0, 0.0}}, // V 1
+            {.pos{0.1, 0.4, 0.0},  .col{0.0, 0.0, 1.0}, .tex{0.0, 0.0}}, // V 2
+            {.pos{0.1, -0.4, 0.0}, .col{1.0, 1.0, 0.0}, .tex{0.0, 1.0}}, // V 3
+    };
+
+    //Index Data
+    std::vector<uint32_t> MeshIndices = {
+            0, 1, 2,
+            2, 3, 0
+    };
 
-        Mesh FirstMesh = Mesh(MainDevice.PhysicalDevice, MainDevice.LogicalDevice,
-                         GraphicsQueue, GraphicsCommandPool,
-                         &MeshVertices, &MeshIndices);
-        Mesh SecondMesh = Mesh(MainDevice.PhysicalDevice, MainDevice.LogicalDevice,
-            GraphicsQueue, GraphicsCommandPool,
-            &MeshVertices2, &MeshIndices);
+    std::vector<Mesh> Meshes;
+    Meshes.push_back(Mesh(MainDevice.PhysicalDevice, MainDevice.LogicalDevice,
+                     GraphicsQueue, GraphicsCommandPool,
+                     &MeshVertices, &MeshIndices));
+    Meshes.push_back(Mesh(MainDevice.PhysicalDevice, MainDevice.LogicalDevice,
+        GraphicsQueue, GraphicsCommandPool,
+        &MeshVertices2, &MeshIndices));
 
+    return Meshes;
+}
 
-        MeshList.push_back(FirstMesh);
-        MeshList.push_back(SecondMesh);
+std::vector<TextureSource> VulkanRenderer::LoadSceneTextures()
+{
+    // Streamed checkerboard, from the compressed KTX2 file when it has been built (Textures/compress_textures.bat),
+    // otherwise each mip is generated on request as if it were read from disk
+    TextureSource CheckerSource = {};
+    CheckerSource.Format = VK_FORMAT_R8G8B8A8_UNORM;
+    CheckerSource.Width = 1024;
+    CheckerSource.Height = 1024;
+    CheckerSource.MipLevels = GetMipLevelCount(CheckerSource.Width, CheckerSource.Height);
+    CheckerSource.LoadMip = [](uint32_t MipLevel)
+    {
+        uint32_t Size = std::max(1u, 1024u >> MipLevel);
+        uint32_t SquareSize = 64 >> MipLevel;                   // Squares smaller than a texel average out to grey
+        std::vector<uint8_t> Texels(Size * Size * 4);
+        for (uint32_t y = 0; y < Size; y++)
+        {
+            for (uint32_t x = 0; x < Size; x++)
+            {
+                uint8_t Value = SquareSize == 0 ? 160 : (((x / SquareSize) + (y / SquareSize)) % 2 ? 255 : 64);
+                uint8_t* Texel = &Texels[(y * Size + x) * 4];
+                Texel[0] = Value;
+                Texel[1] = Value;
+                Texel[2] = Value;
+                Texel[3] = 255;
+            }
+        }
+        return Texels;
+    };
 
-		CreateCommandBuffer();
-		RecordCommands();
-		CreateSynchronisation();
+    // A file this build or device can't use (e.g. UASTC without the transcoder) keeps the procedural checker
+    if (std::filesystem::exists(CHECKER_TEXTURE_PATH))
+    {
+        try
+        {
+            CheckerSource = LoadKtxTextureSource(CHECKER_TEXTURE_PATH, MainDevice.PhysicalDevice, TextureTranscodeTarget);
+        }
+        catch (const std::runtime_error& Error)
+        {
+            std::cout << "Texture load failed, using the procedural checker: " << Error.what() << std::endl;
+        }
+    }
 
-	}
-	catch (const std::runtime_error& e)
-	{
-		std::cout << "ERROR: " << e.what() << std::endl;
-		return EXIT_FAILURE;
-	}
+    // Stripes, only level 0 comes from the CPU and the GPU builds the rest of the chain
+    TextureSource StripeSource = {};
+    StripeSource.Format = VK_FORMAT_R8G8B8A8_UNORM;
+    StripeSource.Width = 512;
+    StripeSource.Height = 512;
+    StripeSource.MipLevels = GetMipLevelCount(StripeSource.Width, StripeSource.Height);
+    StripeSource.bGenerateMips = true;
+    StripeSource.LoadMip = [](uint32_t)
+    {
+        std::vector<uint8_t> Texels(512 * 512 * 4);
+        for (uint32_t y = 0; y < 512; y++)
+        {
+            for (uint32_t x = 0; x < 512; x++)
+            {
+                uint8_t Value = ((x + y) / 16) % 2 ? 255 : 96;
+                uint8_t* Texel = &Texels[(y * 512 + x) * 4];
+                Texel[0] = Value;
+                Texel[1] = Value;
+                Texel[2] = Value;
+                Texel[3] = 255;
+            }
+        }
+        return Texels;
+    };
 
-	return 0;
+    return { CheckerSource, StripeSource };
+}
+
+void VulkanRenderer::CreateScene(const std::vector<Mesh>& Meshes, const std::vector<TextureSource>& Textures)
+{
+    // Camera looking down -Z at the origin
+    ViewProjection.Projection = glm::perspective(glm::radians(45.0f), (float)SwapchainExtent.width / (float)SwapchainExtent.height, 0.1f, 100.0f);
+    ViewProjection.View = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // GLM was made for OpenGL, where Y is up. Vulkan's Y points down, so invert it
+    ViewProjection.Projection[1][1] *= -1;
+
+    // Material 0 is the default (white, checkerboard textured), give the second mesh a tinted one
+    MaterialData DefaultMaterial = {};
+    DefaultMaterial.AlbedoTexture = TextureStreaming.AddTexture(Textures[0]);
+    Materials.AddMaterial(DefaultMaterial);
+
+    MaterialData TintedMaterial = {};
+    TintedMaterial.BaseColour = glm::vec4(0.5f, 0.5f, 1.0f, 1.0f);
+    TintedMaterial.AlbedoTexture = TextureStreaming.AddTexture(Textures[1]);
+    uint32_t TintedMaterialId = Materials.AddMaterial(TintedMaterial);
+
+    RenderObjects.Add(Meshes[0]);
+    RenderObjects.Add(Meshes[1], glm::mat4(1.0f), TintedMaterialId);
 }
 
 void VulkanRenderer::Draw()
@@ -79,10 +229,30 @@ void VulkanRenderer::Draw()
     vkWaitForFences(MainDevice.LogicalDevice, 1, &DrawFences[CurrentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
     // Manually reset (close) fences
     vkResetFences(MainDevice.LogicalDevice, 1, &DrawFences[CurrentFrame]);
+    // The GPU is done with this frame's queries too, read back what it counted last time round
+    PassCounters.BeginFrame(CurrentFrame);
+    // Pipelines built from edited shaders since last frame take over from here
+    if (bShaderHotReload) SwapReloadedPipelines();
     // Get index of next image to be drawn to, and signal semaphore when ready to be drawn to
     uint32_t ImageIndex;
     vkAcquireNextImageKHR(MainDevice.LogicalDevice, Swapchain, std::numeric_limits<uint64_t>::max(), ImageAvailable[CurrentFrame], VK_NULL_HANDLE, &ImageIndex);
 
+    // -- RECORD COMMANDS --
+    // Fence above guarantees the GPU is done with this frame's command buffer and uniform region, so both can be reused
+    UniformBufferRing.BeginFrame(CurrentFrame);
+    BindlessResources.BeginFrame(CurrentFrame);
+    MemoryTracker::BeginFrame();
+
+    // Tell the streamer what's on screen, then move materials onto textures whose residency changed
+    UpdateObjectTransforms();
+    RequestTextureResolutions();
+    for (const TextureSlotChange& SlotChange : TextureStreaming.Update())
+    {
+        Materials.ReplaceTextureSlot(SlotChange.OldSlot, SlotChange.NewSlot);
+    }
+
+    RecordCommands(ImageIndex);
+    if (BarrierLogFrames > 0 && --BarrierLogFrames == 0) BarrierBatch::SetDebugLogging(false);
 
 
     // -- SUBMIT COMMAND BUFFER TO RENDER
@@ -96,7 +266,7 @@ void VulkanRenderer::Draw()
     };
     SubmitInfo.pWaitDstStageMask = WaitStages;                  // Stages to check semaphores at
     SubmitInfo.commandBufferCount = 1;                          // Number os command buffer to submit
-    SubmitInfo.pCommandBuffers = &CommandBuffers[ImageIndex];   // Command buffer to submit
+    SubmitInfo.pCommandBuffers = &CommandBuffers[CurrentFrame]; // Command buffer to submit
     SubmitInfo.signalSemaphoreCount = 1;                        // Number of semaphores to signal
     SubmitInfo.pSignalSemaphores = &RenderFinished[CurrentFrame];             // Semaphores to signal when command buffer finishes
 
@@ -119,17 +289,195 @@ void VulkanRenderer::Draw()
 
     //Get Next Frame (use % MAX_FRAME_DRAWS to keep value under MAX_FRAME_DRAWS)
     CurrentFrame = (CurrentFrame + 1) % MAX_FRAME_DRAWS;
+
+    if (!bStartupFinished) FinishStartup();
 };
 
+void VulkanRenderer::FinishStartup()
+{
+    // Work Init deferred runs now the first frame is on screen, then the whole timeline is printed
+    Startup.Mark("First present");
+    Startup.RunDeferredWork();
+    Startup.Print();
+    bStartupFinished = true;
+}
+
+void VulkanRenderer::SetPerDrawDataPath(PerDrawDataPath NewPath)
+{
+    PerDrawPath = NewPath;
+}
+
+void VulkanRenderer::SetDepthPrePass(bool bEnabled)
+{
+    bDepthPrePass = bEnabled;
+}
+
+void VulkanRenderer::SetMsaaSamples(VkSampleCountFlagBits Samples)
+{
+    RequestedMsaaSamples = Samples;
+}
+
+void VulkanRenderer::SetShaderHotReload(bool bEnabled)
+{
+    bShaderHotReload = bEnabled;
+}
+
+void VulkanRenderer::SetPreferredDevice(const std::string& NameOrIndex)
+{
+    PreferredDevice = NameOrIndex;
+}
+
+void VulkanRenderer::SetMemoryReport(uint32_t IntervalFrames, const std::string& JsonPath)
+{
+    MemoryTracker::SetReport(IntervalFrames, JsonPath);
+}
+
+MemorySnapshot VulkanRenderer::GetMemorySnapshot() const
+{
+    return MemoryTracker::GetSnapshot();
+}
+
+void VulkanRenderer::SetGpuCounterMode(GpuCounterMode Mode)
+{
+    CounterMode = Mode;
+}
+
+GpuFrameCounters VulkanRenderer::GetLastGpuCounters() const
+{
+    return PassCounters.GetLastFrame();
+}
+
+void VulkanRenderer::LogBarriers(uint32_t FrameCount)
+{
+    BarrierLogFrames = FrameCount;
+    BarrierBatch::SetDebugLogging(FrameCount > 0);
+}
+
+const VulkanRenderer::DrawBindCounters& VulkanRenderer::GetLastFrameBindCounters() const
+{
+    return BindCounters;
+}
+
+void VulkanRenderer::StartRenderThread()
+{
+    bStopRendering = false;
+    RenderThread = std::thread(&VulkanRenderer::RenderLoop, this);
+}
+
+void VulkanRenderer::StopRenderThread()
+{
+    if (!RenderThread.joinable()) return;
+
+    // Wake the render thread with one last packet it won't draw
+    bStopRendering = true;
+    FramePackets.Publish();
+    RenderThread.join();
+
+    Jobs.AdoptCallingThread();
+}
+
+VulkanRenderer::FramePacket& VulkanRenderer::BeginFramePacket()
+{
+    return FramePackets.GetWriteSlot();
+}
+
+bool VulkanRenderer::SubmitFramePacket()
+{
+    bool bInvalidated = bFrameInvalidated.exchange(false);
+
+    if (bIdleMode)
+    {
+        // Nothing would look different, leave the render thread asleep
+        const FramePacket& Packet = FramePackets.GetWriteSlot();
+        if (!bInvalidated && IsSameFramePacket(Packet, LastSubmittedPacket)) return false;
+        LastSubmittedPacket = Packet;
+    }
+
+    FramePackets.Publish();
+    return true;
+}
+
+void VulkanRenderer::SetIdleMode(bool bEnabled)
+{
+    bIdleMode = bEnabled;
+}
+
+void VulkanRenderer::Invalidate()
+{
+    bFrameInvalidated = true;
+    glfwPostEmptyEvent();
+}
+
+bool VulkanRenderer::IsSameFramePacket(const FramePacket& A, const FramePacket& B)
+{
+    if (A.View != B.View || A.ObjectTransforms.size() != B.ObjectTransforms.size()) return false;
+
+    for (size_t i = 0; i < A.ObjectTransforms.size(); i++)
+    {
+        const auto& [HandleA, TransformA] = A.ObjectTransforms[i];
+        const auto& [HandleB, TransformB] = B.ObjectTransforms[i];
+        if (HandleA.Index != HandleB.Index || HandleA.Generation != HandleB.Generation || TransformA != TransformB) return false;
+    }
+    return true;
+}
+
+bool VulkanRenderer::IsFramePacketPending() const
+{
+    return FramePackets.HasUnreadValue();
+}
+
+void VulkanRenderer::RenderLoop()
+{
+    // Frame work waits on jobs (culling, sorting, recording) from this thread now
+    Jobs.AdoptCallingThread();
+
+    try
+    {
+        while (true)
+        {
+            const FramePacket& Packet = FramePackets.WaitAndTake();
+            if (bStopRendering) break;
+
+            ApplyFramePacket(Packet);
+            Draw();
+
+            // Streaming uploads and retired pipelines only progress frame by frame, keep drawing until they're done
+            if (bIdleMode && (TextureStreaming.IsBusy() || !RetiredPipelines.empty())) Invalidate();
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << "ERROR: " << e.what() << std::endl;
+        glfwSetWindowShouldClose(Window, GLFW_TRUE);                // Callable from any thread, ends the main loop
+    }
+}
+
+void VulkanRenderer::ApplyFramePacket(const FramePacket& Packet)
+{
+    ViewProjection.View = Packet.View;
+
+    for (const auto& [Handle, Transform] : Packet.ObjectTransforms)
+    {
+        if (RenderObjects.IsValid(Handle)) RenderObjects.SetTransform(Handle, Transform);
+    }
+}
+
 void VulkanRenderer::CleanUp()
 {
+    // No pipeline gets built after the watcher is stopped, so nothing below is in use on its thread
+    ShaderReload.Stop();
+
     // Wait until no actions being run on device before destroying
     vkDeviceWaitIdle(MainDevice.LogicalDevice);
 
-    for (size_t i = 0; i < MeshList.size(); i++)
-    {
-        MeshList[i].DestroyMeshBuffers();
-    }
+    RenderObjects.Clear();
+
+    vkDestroyDescriptorPool(MainDevice.LogicalDevice, DescriptorPool, nullptr);
+    UniformBufferRing.Destroy();
+    Materials.Destroy();
+    TextureStreaming.Destroy();
+    MipGeneration.Destroy();
+    BindlessResources.Destroy();
 
     for(size_t i=0; i < MAX_FRAME_DRAWS; i++)
     {
@@ -139,22 +487,33 @@ void VulkanRenderer::CleanUp()
     }
 
     vkDestroyCommandPool(MainDevice.LogicalDevice, GraphicsCommandPool, nullptr);
-    for(auto Framebuffer : SwapchainFramebuffers)
+    for (const RecordingPool& Pool : RecordingPools)
     {
-        vkDestroyFramebuffer(MainDevice.LogicalDevice, Framebuffer, nullptr);
+        vkDestroyCommandPool(MainDevice.LogicalDevice, Pool.CommandPool, nullptr);
     }
+    FrameGraph.Destroy();
+    for (const RetiredPipeline& Retired : RetiredPipelines)
+    {
+        vkDestroyPipeline(MainDevice.LogicalDevice, Retired.Pipeline, nullptr);
+    }
+    if (ReloadedGraphicsPipeline != VK_NULL_HANDLE) vkDestroyPipeline(MainDevice.LogicalDevice, ReloadedGraphicsPipeline, nullptr);
+    if (ReloadedDepthPrePassPipeline != VK_NULL_HANDLE) vkDestroyPipeline(MainDevice.LogicalDevice, ReloadedDepthPrePassPipeline, nullptr);
+
     vkDestroyPipeline(MainDevice.LogicalDevice, GraphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(MainDevice.LogicalDevice, PipelineLayout, nullptr);
-    vkDestroyRenderPass(MainDevice.LogicalDevice, RenderPass, nullptr);
+    if (DepthPrePassPipeline != VK_NULL_HANDLE) vkDestroyPipeline(MainDevice.LogicalDevice, DepthPrePassPipeline, nullptr);
+    LayoutCache.Destroy();
+    PassCounters.Destroy();
     for(auto Image : SwapchainImages)
     {
         vkDestroyImageView(MainDevice.LogicalDevice, Image.ImageView, nullptr);
     }
 	vkDestroySwapchainKHR(MainDevice.LogicalDevice, Swapchain, nullptr);
 	vkDestroySurfaceKHR(Instance, Surface, nullptr);
+	MemoryTracker::ReportLeaks();											//Everything allocated on the device should be freed by now
 	vkDestroyDevice(MainDevice.LogicalDevice, nullptr);
 	vkDestroyInstance(Instance, nullptr);
 
+    Jobs.Destroy();
 }
 
 void VulkanRenderer::CreateInstance()
@@ -242,22 +601,83 @@ void VulkanRenderer::CreateLogicalDevice()
 		QueueCreateInfoList.push_back(QueueCreateInfo);
 	}
 	//Physical Device Features the Logical Device will be using
-	VkPhysicalDeviceFeatures PhysicalDeviceFeatures = {};					//None will be used by now
+	VkPhysicalDeviceFeatures PhysicalDeviceFeatures = {};
+
+	//Block compressed texture formats, whichever the device has (KTX2 textures are loaded or transcoded into them)
+	VkPhysicalDeviceFeatures SupportedFeatures;
+	vkGetPhysicalDeviceFeatures(MainDevice.PhysicalDevice, &SupportedFeatures);
+	PhysicalDeviceFeatures.textureCompressionBC = SupportedFeatures.textureCompressionBC;
+	PhysicalDeviceFeatures.textureCompressionASTC_LDR = SupportedFeatures.textureCompressionASTC_LDR;
+	PhysicalDeviceFeatures.textureCompressionETC2 = SupportedFeatures.textureCompressionETC2;
+
+	//Compute mip generation writes any format through an array of storage images
+	PhysicalDeviceFeatures.shaderStorageImageWriteWithoutFormat = SupportedFeatures.shaderStorageImageWriteWithoutFormat;
+	PhysicalDeviceFeatures.shaderStorageImageArrayDynamicIndexing = SupportedFeatures.shaderStorageImageArrayDynamicIndexing;
+
+	//GPU counters: pipeline statistics, also while secondary command buffers execute inside a counted pass
+	PhysicalDeviceFeatures.pipelineStatisticsQuery = SupportedFeatures.pipelineStatisticsQuery;
+	PhysicalDeviceFeatures.inheritedQueries = SupportedFeatures.inheritedQueries;
+
+	// Descriptor indexing features needed by the bindless table (core in Vulkan 1.2)
+	VkPhysicalDeviceVulkan12Features Vulkan12Features = {};
+	Vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	Vulkan12Features.descriptorIndexing = VK_TRUE;
+	Vulkan12Features.runtimeDescriptorArray = VK_TRUE;									// Unsized arrays in shaders
+	Vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;							// Not every array element needs a descriptor
+	Vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;			// Write textures while the set is bound
+	Vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;			// Write buffers while the set is bound
+	Vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;				// Write unused slots while the GPU uses the set
+	Vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;				// Index textures with non uniform (per material) values
+	Vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+
+
+	// Required extensions, plus the optional ones this device has
+	EnabledDeviceExtensions = DeviceExtensions;
+
+	uint32_t ExtensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(MainDevice.PhysicalDevice, nullptr, &ExtensionCount, nullptr);
+	std::vector<VkExtensionProperties> Extensions(ExtensionCount);
+	vkEnumerateDeviceExtensionProperties(MainDevice.PhysicalDevice, nullptr, &ExtensionCount, Extensions.data());
+
+	for (const auto& OptionalExtension : OptionalDeviceExtensions)
+	{
+		for (const auto& Extension : Extensions)
+		{
+			if (strcmp(OptionalExtension, Extension.extensionName) == 0)
+			{
+				EnabledDeviceExtensions.push_back(OptionalExtension);
+				break;
+			}
+		}
+	}
+
+
+	// Per barrier stage/access scopes, when the driver has them
+	bool bSynchronization2 = IsDeviceExtensionEnabled(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+	VkPhysicalDeviceSynchronization2FeaturesKHR Synchronization2Features = {};
+	Synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+	Synchronization2Features.synchronization2 = VK_TRUE;
+	if (bSynchronization2) Vulkan12Features.pNext = &Synchronization2Features;
 
 
 	// Information to create logical device (sometimes called "Device")
 	VkDeviceCreateInfo DeviceCreateInfo = {};
 	DeviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	DeviceCreateInfo.pNext = &Vulkan12Features;														//Vulkan 1.2 Features the Logical Device will be using
 	DeviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(QueueCreateInfoList.size());		//Number of Queue Create Infos
 	DeviceCreateInfo.pQueueCreateInfos = QueueCreateInfoList.data();								//List of queue creat infos so device can create required queue
-	DeviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(DeviceExtensions.size());		//Number of Ligical Devices extensions
-	DeviceCreateInfo.ppEnabledExtensionNames = DeviceExtensions.data();												//List of Enabled Logical Device Extensions
+	DeviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(EnabledDeviceExtensions.size());	//Number of Ligical Devices extensions
+	DeviceCreateInfo.ppEnabledExtensionNames = EnabledDeviceExtensions.data();												//List of Enabled Logical Device Extensions
 	DeviceCreateInfo.pEnabledFeatures = &PhysicalDeviceFeatures;									//Physical Device Features the Logical Device will be using
 
 	//Create the logical device for the given physical device
 	VkResult Result = vkCreateDevice(MainDevice.PhysicalDevice, &DeviceCreateInfo, nullptr, &MainDevice.LogicalDevice);
 	if (Result != VK_SUCCESS) throw std::runtime_error("Failed to create a Logical Device");
 
+	BarrierBatch::Initialise(MainDevice.LogicalDevice, bSynchronization2, PhysicalDeviceFeatures);
+	MemoryTracker::Initialise(MainDevice.PhysicalDevice, IsDeviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME));
+	LayoutCache.Create(MainDevice.LogicalDevice);
+
 
 	//Queue are created at the same time as the device
 	//So we want handle to queue
@@ -375,15 +795,63 @@ void VulkanRenderer::GetPhysicalDevice()
 	std::vector<VkPhysicalDevice> PhysicalDevicesList(PhysicalDevicesCount);
 	vkEnumeratePhysicalDevices(Instance, &PhysicalDevicesCount, PhysicalDevicesList.data());
 
-	//Pick a Valid Device for our use
-	for (const auto& Device : PhysicalDevicesList)
+	//Override from the environment (e.g. CI forcing lavapipe) or the application, matched by index or name
+	std::string Override = ReadEnvironmentVariable(GPU_OVERRIDE_VARIABLE);
+	if (Override.empty()) Override = PreferredDevice;
+	bool bOverrideIsIndex = !Override.empty() && Override.size() < 10 && std::all_of(Override.begin(), Override.end(), [](char c) { return c >= '0' && c <= '9'; });
+
+	//Score every suitable device and log the ranking, so the choice on multi GPU machines can be audited
+	struct DeviceCandidate
+	{
+		VkPhysicalDevice Device;
+		uint32_t Index;
+		std::string Name;
+		uint64_t Score;
+		bool bSuitable;
+	};
+	std::vector<DeviceCandidate> Candidates;
+	for (uint32_t i = 0; i < PhysicalDevicesCount; i++)
 	{
-		if (CheckPhysicalDeviceSuitable(Device))
+		VkPhysicalDeviceProperties DeviceProperties;
+		vkGetPhysicalDeviceProperties(PhysicalDevicesList[i], &DeviceProperties);
+
+		bool bSuitable = CheckPhysicalDeviceSuitable(PhysicalDevicesList[i]);
+		Candidates.push_back({ PhysicalDevicesList[i], i, DeviceProperties.deviceName, bSuitable ? ScorePhysicalDevice(PhysicalDevicesList[i]) : 0, bSuitable });
+
+		std::cout << "GPU " << i << ": " << DeviceProperties.deviceName << " (" << GetDeviceTypeName(DeviceProperties.deviceType) << ")";
+		if (bSuitable) std::cout << ", score " << Candidates.back().Score << std::endl;
+		else std::cout << ", unsuitable" << std::endl;
+	}
+
+	std::stable_sort(Candidates.begin(), Candidates.end(), [](const DeviceCandidate& A, const DeviceCandidate& B)
+		{
+			return A.bSuitable != B.bSuitable ? A.bSuitable : A.Score > B.Score;
+		});
+	if (!Candidates[0].bSuitable) throw std::runtime_error("Failed to find a GPU suitable for the renderer!");
+
+	const DeviceCandidate* Chosen = &Candidates[0];
+	if (!Override.empty())
+	{
+		const DeviceCandidate* Match = nullptr;
+		for (const DeviceCandidate& Candidate : Candidates)
 		{
-			MainDevice.PhysicalDevice = Device;
-			break;
+			bool bMatches = bOverrideIsIndex ? Candidate.Index == static_cast<uint32_t>(std::stoul(Override)) : Candidate.Name.find(Override) != std::string::npos;
+			if (bMatches && Candidate.bSuitable)
+			{
+				Match = &Candidate;
+				break;
+			}
 		}
+
+		if (Match) Chosen = Match;
+		else std::cout << "GPU override \"" << Override << "\" matches no suitable device, using the best scored one" << std::endl;
 	}
+
+	MainDevice.PhysicalDevice = Chosen->Device;
+	std::cout << "Using GPU " << Chosen->Index << ": " << Chosen->Name << std::endl;
+
+	//Compressed format universal (KTX2) textures get transcoded to on this device
+	TextureTranscodeTarget = ChooseKtxTranscodeTarget(MainDevice.PhysicalDevice);
 }
 
 bool VulkanRenderer::CheckInstanceExtensionSupport(std::vector<const char*>* CheckExtensions)
@@ -419,6 +887,15 @@ bool VulkanRenderer::CheckInstanceExtensionSupport(std::vector<const char*>* Che
 	return true;
 }
 
+bool VulkanRenderer::IsDeviceExtensionEnabled(const char* ExtensionName)
+{
+	for (const auto& Extension : EnabledDeviceExtensions)
+	{
+		if (strcmp(Extension, ExtensionName) == 0) return true;
+	}
+	return false;
+}
+
 bool VulkanRenderer::CheckDeviceExtensionSupport(VkPhysicalDevice PhysicalDevice)
 {
 	//Get Device extension count
@@ -466,10 +943,33 @@ bool VulkanRenderer::CheckPhysicalDeviceSuitable(VkPhysicalDevice PhysicalDevice
 	vkGetPhysicalDeviceFeatures(PhysicalDevice, &DeviceFeatures);
 	*/
 
+	//Vulkan 1.2 feature structs may only be chained on devices that support 1.2, older ones are rejected before querying them
+	VkPhysicalDeviceProperties DeviceProperties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &DeviceProperties);
+	if (DeviceProperties.apiVersion < VK_API_VERSION_1_2) return false;
+
 	QueueFamilyIndices Indices = GetQueueFamilies(PhysicalDevice);
 
 	bool ExtensionsSupported = CheckDeviceExtensionSupport(PhysicalDevice);
 
+	//Bindless resources need descriptor indexing
+	VkPhysicalDeviceVulkan12Features Vulkan12Features = {};
+	Vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 DeviceFeatures = {};
+	DeviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	DeviceFeatures.pNext = &Vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(PhysicalDevice, &DeviceFeatures);
+
+	bool DescriptorIndexingSupported = Vulkan12Features.descriptorIndexing
+		&& Vulkan12Features.runtimeDescriptorArray
+		&& Vulkan12Features.descriptorBindingPartiallyBound
+		&& Vulkan12Features.descriptorBindingSampledImageUpdateAfterBind
+		&& Vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind
+		&& Vulkan12Features.descriptorBindingUpdateUnusedWhilePending
+		&& Vulkan12Features.shaderSampledImageArrayNonUniformIndexing
+		&& Vulkan12Features.shaderStorageBufferArrayNonUniformIndexing;
+
 	
 	bool SwapChainValid = false;
 
@@ -479,7 +979,62 @@ bool VulkanRenderer::CheckPhysicalDeviceSuitable(VkPhysicalDevice PhysicalDevice
 		SwapChainValid = !SwapChainDetail.Formats.empty() && !SwapChainDetail.PresentationModes.empty();
 	}
 
-	return Indices.IsValid() && ExtensionsSupported && SwapChainValid;
+	return Indices.IsValid() && ExtensionsSupported && SwapChainValid && DescriptorIndexingSupported;
+}
+
+uint64_t VulkanRenderer::ScorePhysicalDevice(VkPhysicalDevice PhysicalDevice)
+{
+	VkPhysicalDeviceProperties DeviceProperties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &DeviceProperties);
+
+	uint64_t Score = 0;
+	switch (DeviceProperties.deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: Score += SCORE_DISCRETE_GPU; break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: Score += SCORE_INTEGRATED_GPU; break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: Score += SCORE_VIRTUAL_GPU; break;
+	case VK_PHYSICAL_DEVICE_TYPE_OTHER: Score += SCORE_OTHER_DEVICE; break;
+	default: break;
+	}
+
+	//Queues: one family for graphics and presentation, and timestamps on it
+	QueueFamilyIndices Indices = GetQueueFamilies(PhysicalDevice);
+	if (Indices.GraphicsFamily == Indices.PresentationFamily) Score += SCORE_SHARED_QUEUE_FAMILY;
+
+	uint32_t QueueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> QueueFamilyList(QueueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount, QueueFamilyList.data());
+	if (DeviceProperties.limits.timestampComputeAndGraphics || QueueFamilyList[Indices.GraphicsFamily].timestampValidBits > 0) Score += SCORE_TIMESTAMPS;
+
+	//Optional features the renderer uses when present
+	uint32_t ExtensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &ExtensionCount, nullptr);
+	std::vector<VkExtensionProperties> Extensions(ExtensionCount);
+	vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &ExtensionCount, Extensions.data());
+	for (const auto& OptionalExtension : OptionalDeviceExtensions)
+	{
+		for (const auto& Extension : Extensions)
+		{
+			if (strcmp(OptionalExtension, Extension.extensionName) == 0)
+			{
+				Score += SCORE_OPTIONAL_EXTENSION;
+				break;
+			}
+		}
+	}
+
+	//Largest device local heap, what textures and meshes get streamed into
+	VkPhysicalDeviceMemoryProperties MemoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &MemoryProperties);
+	VkDeviceSize LargestHeap = 0;
+	for (uint32_t i = 0; i < MemoryProperties.memoryHeapCount; i++)
+	{
+		if (MemoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) LargestHeap = std::max(LargestHeap, MemoryProperties.memoryHeaps[i].size);
+	}
+	Score += std::min<uint64_t>(LargestHeap >> 20, SCORE_OPTIONAL_EXTENSION - 1);
+
+	return Score;
 }
 
 QueueFamilyIndices VulkanRenderer::GetQueueFamilies(VkPhysicalDevice PhysicalDevice)
@@ -625,7 +1180,39 @@ VkExtent2D VulkanRenderer::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& Surf
 	}
 }
 
-VkImageView VulkanRenderer::CreateImageView(VkImage Image, VkFormat Format, VkImageAspectFlags AspectFlags)
+VkFormat VulkanRenderer::ChooseSupportedFormat(const std::vector<VkFormat>& Formats, VkImageTiling Tiling, VkFormatFeatureFlags FeatureFlags)
+{
+    // Loop through options and find the first compatible one
+    for (VkFormat Format : Formats)
+    {
+        // Get properties for given format on this device
+        VkFormatProperties FormatProperties;
+        vkGetPhysicalDeviceFormatProperties(MainDevice.PhysicalDevice, Format, &FormatProperties);
+
+        // Depending on tiling choice, need to check for different bit flags
+        VkFormatFeatureFlags TilingFeatures = Tiling == VK_IMAGE_TILING_LINEAR ? FormatProperties.linearTilingFeatures : FormatProperties.optimalTilingFeatures;
+        if ((TilingFeatures & FeatureFlags) == FeatureFlags) return Format;
+    }
+
+    throw std::runtime_error("Failed to find a matching format!");
+}
+
+VkSampleCountFlagBits VulkanRenderer::ChooseSampleCount(VkSampleCountFlagBits Requested)
+{
+    // Colour and depth share the framebuffer, so the count has to work for both
+    VkPhysicalDeviceProperties DeviceProperties;
+    vkGetPhysicalDeviceProperties(MainDevice.PhysicalDevice, &DeviceProperties);
+    VkSampleCountFlags Supported = DeviceProperties.limits.framebufferColorSampleCounts & DeviceProperties.limits.framebufferDepthSampleCounts;
+
+    // Highest supported count not above the request, 1 is always supported
+    for (uint32_t Samples = Requested; Samples > VK_SAMPLE_COUNT_1_BIT; Samples >>= 1)
+    {
+        if (Supported & Samples) return static_cast<VkSampleCountFlagBits>(Samples);
+    }
+    return VK_SAMPLE_COUNT_1_BIT;
+}
+
+VkImageView VulkanRenderer::CreateImageView(VkImage Image, VkFormat Format, VkImageAspectFlags AspectFlags, uint32_t MipLevels)
 {
     VkImageViewCreateInfo ImageViewCreateInfo = {};
     ImageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -640,7 +1227,7 @@ VkImageView VulkanRenderer::CreateImageView(VkImage Image, VkFormat Format, VkIm
     // Subresouces allow the view to view only a part of an image
     ImageViewCreateInfo.subresourceRange.aspectMask = AspectFlags;                  // Which Aspect of image to view
     ImageViewCreateInfo.subresourceRange.baseMipLevel = 0;                          //Start mipmap level to view from
-    ImageViewCreateInfo.subresourceRange.levelCount = 1;                            // Number of mipmap levels to view
+    ImageViewCreateInfo.subresourceRange.levelCount = MipLevels;                    // Number of mipmap levels to view
     ImageViewCreateInfo.subresourceRange.baseArrayLayer = 0;                        // Start array level to view from
     ImageViewCreateInfo.subresourceRange.layerCount = 1;                            // Number of array levels to view
 
@@ -652,29 +1239,237 @@ VkImageView VulkanRenderer::CreateImageView(VkImage Image, VkFormat Format, VkIm
     return ImageView;
 }
 
+void VulkanRenderer::CreateBindlessResources()
+{
+    // One descriptor set for all textures and storage buffers, then the material buffer inside it
+    BindlessResources.Create(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, MAX_BINDLESS_TEXTURES, MAX_BINDLESS_BUFFERS);
+    Materials.Create(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, &BindlessResources, MAX_MATERIALS);
+}
+
+void VulkanRenderer::CreateMipGeneration()
+{
+    // Compute downsampling needs the storage image features CreateLogicalDevice enables when it can
+    VkPhysicalDeviceFeatures SupportedFeatures;
+    vkGetPhysicalDeviceFeatures(MainDevice.PhysicalDevice, &SupportedFeatures);
+    MipGeneration.Create(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, &LayoutCache,
+                         SupportedFeatures.shaderStorageImageWriteWithoutFormat && SupportedFeatures.shaderStorageImageArrayDynamicIndexing);
+}
+
+void VulkanRenderer::CreateTextureStreaming()
+{
+    // Streamed textures live in the bindless table, uploads go through the graphics queue
+    QueueFamilyIndices Indices = GetQueueFamilies(MainDevice.PhysicalDevice);
+    TextureStreaming.Create(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, GraphicsQueue, Indices.GraphicsFamily,
+                            &BindlessResources, &MipGeneration, &Jobs, DEFAULT_TEXTURE_STREAMING_BUDGET,
+                            IsDeviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME));
+}
+
+void VulkanRenderer::UpdateObjectTransforms()
+{
+    // Every object's model-view-projection in one batched pass, for texture streaming and draw sorting
+    const std::vector<glm::mat4>& Transforms = RenderObjects.GetTransforms();
+    glm::mat4 CameraViewProjection = ViewProjection.Projection * ViewProjection.View;
+    ModelViewProjections.resize(Transforms.size());
+    MultiplyMatrices(CameraViewProjection, Transforms.data(), ModelViewProjections.data(), Transforms.size());
+
+    // Bounds to world space, then only objects touching the frustum get draws
+    WorldBounds.resize(Transforms.size());
+    TransformBoundingBoxes(Transforms.data(), RenderObjects.GetBounds().data(), WorldBounds.data(), Transforms.size());
+
+    Culler.SetFrustum(CameraViewProjection);
+    Culler.SetBoxes(WorldBounds.data(), WorldBounds.size());
+    Culler.Cull(VisibleObjects, &Jobs);
+}
+
+void VulkanRenderer::RequestTextureResolutions()
+{
+    const std::vector<BoundingBox>& Bounds = RenderObjects.GetBounds();
+    const std::vector<uint32_t>& MaterialIds = RenderObjects.GetMaterialIds();
+
+    float ScreenSize = (float)std::max(SwapchainExtent.width, SwapchainExtent.height);
+
+    // Culled objects ask for nothing, so their textures age out and become the first eviction candidates
+    for (uint32_t i : VisibleObjects)
+    {
+        uint32_t AlbedoTexture = Materials.GetMaterial(MaterialIds[i]).AlbedoTexture;
+        if (AlbedoTexture == INVALID_BINDLESS_SLOT) continue;
+
+        // Size on screen from the projected bounds, objects without bounds (or crossing the camera) ask for full screen
+        float ScreenPixels = ScreenSize;
+        if (Bounds[i].Min.x != -std::numeric_limits<float>::max())
+        {
+            const glm::mat4& ModelViewProjection = ModelViewProjections[i];
+            glm::vec2 ScreenMin = glm::vec2(std::numeric_limits<float>::max());
+            glm::vec2 ScreenMax = glm::vec2(-std::numeric_limits<float>::max());
+            bool bBehindCamera = false;
+
+            for (uint32_t Corner = 0; Corner < 8; Corner++)
+            {
+                glm::vec4 Position = glm::vec4(Corner & 1 ? Bounds[i].Max.x : Bounds[i].Min.x,
+                                               Corner & 2 ? Bounds[i].Max.y : Bounds[i].Min.y,
+                                               Corner & 4 ? Bounds[i].Max.z : Bounds[i].Min.z, 1.0f);
+                glm::vec4 Clip = ModelViewProjection * Position;
+                if (Clip.w <= 0.0f)
+                {
+                    bBehindCamera = true;
+                    break;
+                }
+
+                glm::vec2 Ndc = glm::vec2(Clip) / Clip.w;
+                ScreenMin = glm::min(ScreenMin, Ndc);
+                ScreenMax = glm::max(ScreenMax, Ndc);
+            }
+
+            if (!bBehindCamera)
+            {
+                // NDC spans 2 units across the swapchain
+                ScreenPixels = std::max((ScreenMax.x - ScreenMin.x) * 0.5f * SwapchainExtent.width,
+                                        (ScreenMax.y - ScreenMin.y) * 0.5f * SwapchainExtent.height);
+            }
+        }
+
+        TextureStreaming.RequestResolution(AlbedoTexture, ScreenPixels);
+    }
+}
+
+void VulkanRenderer::BuildDrawList()
+{
+    const std::vector<VkBuffer>& VertexBuffers = RenderObjects.GetVertexBuffers();
+    const std::vector<BoundingBox>& Bounds = RenderObjects.GetBounds();
+    const std::vector<uint32_t>& MaterialIds = RenderObjects.GetMaterialIds();
+
+    DrawItems.clear();
+    DrawItems.reserve(VisibleObjects.size() * (bDepthPrePass ? 2 : 1));
+
+    for (uint32_t i : VisibleObjects)
+    {
+        // Distance along the view direction of the bounds centre, or of the object origin if it has no bounds
+        glm::vec3 Centre = glm::vec3(0.0f);
+        if (Bounds[i].Min.x != -std::numeric_limits<float>::max())
+        {
+            Centre = (Bounds[i].Min + Bounds[i].Max) * 0.5f;
+        }
+
+        // With a perspective projection clip w is the distance along the view direction (-Z in view space)
+        float Depth = (ModelViewProjections[i] * glm::vec4(Centre, 1.0f)).w;
+        uint32_t MeshId = HashDrawKeyMesh(reinterpret_cast<uint64_t>(VertexBuffers[i]));
+
+        // Pre-pass doesn't read materials, keep it purely front to back so it culls as much as it can
+        if (bDepthPrePass)
+        {
+            DrawItems.push_back({ MakeDrawSortKey(DRAW_PASS_DEPTH_PRE_PASS, DRAW_PIPELINE_DEPTH_PRE_PASS, 0, 0, Depth), i });
+        }
+
+        DrawItems.push_back({ MakeDrawSortKey(DRAW_PASS_OPAQUE, DRAW_PIPELINE_OPAQUE, MaterialIds[i], MeshId, Depth), i });
+    }
+
+    SortDrawItems(DrawItems, DrawItemScratch, &Jobs);
+}
+
+void VulkanRenderer::CreateGraphicsPipelineLayout()
+{
+    // SPIR-V code of shaders, embedded at build time
+    auto VertexShaderCode = GetEmbeddedShader(SHADER_VERT_SPIRV);
+    auto FragmentShaderCode = GetEmbeddedShader(SHADER_FRAG_SPIRV);
+
+    // -- PIPELINE LAYOUT --
+    // Set 0 and the push constants are built from what the shaders declare. Only needs the bindless table,
+    // so it's ready before the render passes the pipelines are compiled against
+    ShaderReflection Reflection;
+    Reflection.AddStage(VertexShaderCode);
+    Reflection.AddStage(FragmentShaderCode);
+    PipelineLayout = GetShaderPipelineLayout(Reflection, &DescriptorSetLayout);
+}
+
 void VulkanRenderer::CreateGraphicsPipeline()
 {
-    // Read in SPIV-V code of shaders
-    auto VertexShaderCode = ReadFile("E:/VulkanClassesLION/Shaders/vert.spv");
-    auto FragmentShaderCode = ReadFile("E:/VulkanClassesLION/Shaders/frag.spv");
+    BuildGraphicsPipelines(GetEmbeddedShader(SHADER_VERT_SPIRV), GetEmbeddedShader(SHADER_FRAG_SPIRV), &GraphicsPipeline, &DepthPrePassPipeline);
+}
+
+VkPipelineLayout VulkanRenderer::GetShaderPipelineLayout(const ShaderReflection& Reflection, VkDescriptorSetLayout* FrameSetLayout)
+{
+    // -- PUSH CONSTANTS --
+    // Make sure the per draw block fits on this device, and is the block the shaders declare
+    VkPhysicalDeviceProperties DeviceProperties;
+    vkGetPhysicalDeviceProperties(MainDevice.PhysicalDevice, &DeviceProperties);
+    ModelPushConstant.CheckDeviceLimits(DeviceProperties.limits);
+
+    VkPushConstantRange PushConstantRange = ModelPushConstant.GetRange();
+    std::vector<VkPushConstantRange> ShaderPushConstantRanges = Reflection.GetPushConstantRanges();
+    if (ShaderPushConstantRanges.size() != 1 || ShaderPushConstantRanges[0].offset != PushConstantRange.offset
+        || ShaderPushConstantRanges[0].size != PushConstantRange.size || ShaderPushConstantRanges[0].stageFlags != PushConstantRange.stageFlags)
+    {
+        throw std::runtime_error("Shader push constant block doesn't match PushModel");
+    }
+
+    // -- DESCRIPTOR SET LAYOUTS --
+    // Set 0: per frame uniforms. Shaders only say "uniform", they live in the ring so they're bound with dynamic offsets
+    ShaderReflection FrameReflection = Reflection;
+    FrameReflection.MakeUniformBuffersDynamic(0);
+    *FrameSetLayout = LayoutCache.GetDescriptorSetLayout(FrameReflection.GetSetBindings(0));
 
-    //Build Shader Modules to link to Graphics Pipeline
-    VkShaderModule VertexShaderModule = CreateShaderModule(VertexShaderCode);
-    VkShaderModule FragmentShaderModule = CreateShaderModule(FragmentShaderCode);
+    // Set 1: bindless resources, its layout is sized by the table rather than the shaders' unsized arrays
+    Reflection.CheckSetLayout(1, BindlessResources.GetLayoutBindings());
+
+    // Identical layouts come back as the same handle, so every pipeline built from these shaders shares the bound sets
+    return LayoutCache.GetPipelineLayout({ *FrameSetLayout, BindlessResources.GetDescriptorSetLayout() }, { PushConstantRange });
+}
+
+void VulkanRenderer::BuildGraphicsPipelines(const std::vector<char>& VertexShaderCode, const std::vector<char>& FragmentShaderCode,
+                                            VkPipeline* NewGraphicsPipeline, VkPipeline* NewDepthPrePassPipeline)
+{
+    // Reflect first, shaders that don't fit the renderer are rejected before anything is created
+    ShaderReflection Reflection;
+    Reflection.AddStage(VertexShaderCode);
+    Reflection.AddStage(FragmentShaderCode);
+
+    // Descriptor sets are allocated against the layout picked at Init, reloaded shaders have to keep it
+    VkDescriptorSetLayout FrameSetLayout;
+    if (GetShaderPipelineLayout(Reflection, &FrameSetLayout) != PipelineLayout) throw std::runtime_error("Shaders need a different pipeline layout than the one in use");
+    if (Reflection.GetVertexStride() != sizeof(Vertex)) throw std::runtime_error("Vertex shader inputs don't match the Vertex struct");
+
+    //Build Shader Modules to link to Graphics Pipeline. Only needed while the pipelines are created, so they are destroyed
+    //on every way out of here, including the throws below (destroying VK_NULL_HANDLE is a no-op)
+    struct ShaderModuleGuard
+    {
+        VkDevice Device;
+        VkShaderModule Module = VK_NULL_HANDLE;
+        ~ShaderModuleGuard() { vkDestroyShaderModule(Device, Module, nullptr); }
+    };
+    ShaderModuleGuard VertexShaderModule = { MainDevice.LogicalDevice };
+    ShaderModuleGuard FragmentShaderModule = { MainDevice.LogicalDevice };
+    VertexShaderModule.Module = CreateShaderModule(VertexShaderCode);
+    FragmentShaderModule.Module = CreateShaderModule(FragmentShaderCode);
 
     // -- SHADER STAGE CREATION INFORMATION --
     //Vertex Stage Creation Information
     VkPipelineShaderStageCreateInfo VertexShaderStageCreateInfo = {};
     VertexShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     VertexShaderStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;               // Shader stage name
-    VertexShaderStageCreateInfo.module = VertexShaderModule;                      // Shader module to be used by stage
+    VertexShaderStageCreateInfo.module = VertexShaderModule.Module;                      // Shader module to be used by stage
     VertexShaderStageCreateInfo.pName = "main";                                   // Entry point into the Shader
 
+    // Specialisation constant 0 picks where the vertex shader reads the model matrix from
+    VkBool32 bUsePushModel = PerDrawPath == PerDrawDataPath::PushConstant ? VK_TRUE : VK_FALSE;
+
+    VkSpecializationMapEntry SpecializationMapEntry = {};
+    SpecializationMapEntry.constantID = 0;                                        // constant_id in shader
+    SpecializationMapEntry.offset = 0;                                            // Offset of value in data
+    SpecializationMapEntry.size = sizeof(VkBool32);
+
+    VkSpecializationInfo SpecializationInfo = {};
+    SpecializationInfo.mapEntryCount = 1;
+    SpecializationInfo.pMapEntries = &SpecializationMapEntry;
+    SpecializationInfo.dataSize = sizeof(VkBool32);
+    SpecializationInfo.pData = &bUsePushModel;
+
+    VertexShaderStageCreateInfo.pSpecializationInfo = &SpecializationInfo;
+
     //Fragment Stage Creation Information
     VkPipelineShaderStageCreateInfo FragmentShaderStageCreateInfo = {};
     FragmentShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     FragmentShaderStageCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;               // Shader stage name
-    FragmentShaderStageCreateInfo.module = FragmentShaderModule;                      // Shader module to be used by stage
+    FragmentShaderStageCreateInfo.module = FragmentShaderModule.Module;                      // Shader module to be used by stage
     FragmentShaderStageCreateInfo.pName = "main";                                   // Entry point into the Shader
 
     //Put Shader stage creation indo in a array (required by the Pipeline creation)
@@ -691,24 +1486,8 @@ void VulkanRenderer::CreateGraphicsPipeline()
                                                                             // VK_VERTEX_INPUT_RATE_VERTEX :: Move on to the next vertex
                                                                             // VK_VERTEX_INPUT_RATE_INSTANCE : Move to a vertex for the next instance
 
-
-    std::array<VkVertexInputAttributeDescription, 2> VertexInputAttributeDescription;
-
-    // Position Attribute
-    VertexInputAttributeDescription[0] = {};
-    VertexInputAttributeDescription[0].binding = 0;                        // Which binding the data is at (should be the same as above)
-    VertexInputAttributeDescription[0].location = 0;                       // Location in shader where data will be read from
-    VertexInputAttributeDescription[0].format = VK_FORMAT_R32G32B32_SFLOAT;// Format the data will take (also helps define size of data)
-    VertexInputAttributeDescription[0].offset = offsetof(Vertex, pos);     // Where this attribute is defined in the data for a single vertex
-
-    // Color Attribute
-    VertexInputAttributeDescription[1] = {};
-    VertexInputAttributeDescription[1].binding = 0;                        // Which binding the data is at (should be the same as above)
-    VertexInputAttributeDescription[1].location = 1;                       // Location in shader where data will be read from
-    VertexInputAttributeDescription[1].format = VK_FORMAT_R32G32B32_SFLOAT;// Format the data will take (also helps define size of data)
-    VertexInputAttributeDescription[1].offset = offsetof(Vertex, col);     // Where this attribute is defined in the data for a single vertex
-
-
+    // Attributes (location, format, offset) come from the vertex shader's inputs, packed in location order like Vertex is
+    const std::vector<VkVertexInputAttributeDescription>& VertexInputAttributeDescription = Reflection.GetVertexAttributes();
 
     VkPipelineVertexInputStateCreateInfo VertexInputStateCreateInfo= {};
     VertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -767,14 +1546,14 @@ void VulkanRenderer::CreateGraphicsPipeline()
     RasterizationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;        // How to handle filling points betwenn vertices
     RasterizationStateCreateInfo.lineWidth = 1.0f;                          // How thick lines should be when drawn;
     RasterizationStateCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;          // Which faze of a tri to cull
-    RasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;       // Winding to determine which side is front
+    RasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE; // Winding to determine which side is front (counter clockwise since projection Y is inverted)
     RasterizationStateCreateInfo.depthBiasEnable = VK_FALSE;                // Whether to add depth bias to fragments (Good for stopping "Shadow Acne"
 
     // -- MULTISAMPLING --
     VkPipelineMultisampleStateCreateInfo MultisampleStateCreateInfo = {};
     MultisampleStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     MultisampleStateCreateInfo.sampleShadingEnable = VK_FALSE;                          // Enable multisample shading or not
-    MultisampleStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;            //Number os samples to use per fragment
+    MultisampleStateCreateInfo.rasterizationSamples = MsaaSamples;                      //Number os samples to use per fragment (matches the scene attachments)
 
 
     //-- BLENDING --
@@ -802,20 +1581,22 @@ void VulkanRenderer::CreateGraphicsPipeline()
     ColorBlendStateCreateInfo.pAttachments = &ColorBlendAttachmentState;
 
 
-    // -- PIPELINE LAYOUT (TODO: APPLY FUTURE DESCRIPTOR SET LAYOUTS) --
-    VkPipelineLayoutCreateInfo LayoutCreateInfo = {};
-    LayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    LayoutCreateInfo.setLayoutCount = 0;
-    LayoutCreateInfo.pSetLayouts = nullptr;
-    LayoutCreateInfo.pushConstantRangeCount = 0;
-    LayoutCreateInfo.pPushConstantRanges = nullptr;
-
-    //Create Pipeline Layout;
-    VkResult Result = vkCreatePipelineLayout(MainDevice.LogicalDevice, &LayoutCreateInfo, nullptr, &PipelineLayout);
-    if(Result != VK_SUCCESS) throw std::runtime_error("Failed to create PipelineLayout");
-
     // -- DEPTH STENCIL TESTING --
-    //TODO: SET UP DPTH STENCIL TESTING
+    VkPipelineDepthStencilStateCreateInfo DepthStencilStateCreateInfo = {};
+    DepthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    DepthStencilStateCreateInfo.depthTestEnable = VK_TRUE;                  // Enable checking depth to determine fragment write
+    DepthStencilStateCreateInfo.depthWriteEnable = VK_TRUE;                 // Enable writing to depth buffer (to replace old values)
+    DepthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;        // Comparison operation that allows an overwrite (is in front)
+    DepthStencilStateCreateInfo.depthBoundsTestEnable = VK_FALSE;           // Depth Bounds Test: Does the depth value exist between two bounds
+    DepthStencilStateCreateInfo.stencilTestEnable = VK_FALSE;               // Enable Stencil Test
+
+    // After a pre-pass the depth buffer already holds the nearest surface, so only the fragment that
+    // matches it is shaded. Same vertex shader in both passes (invariant gl_Position), so depths match exactly
+    if (bDepthPrePass)
+    {
+        DepthStencilStateCreateInfo.depthWriteEnable = VK_FALSE;
+        DepthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    }
 
 
     // -- GRAPHICS PIPELINE CREATION --
@@ -829,11 +1610,11 @@ void VulkanRenderer::CreateGraphicsPipeline()
     PipelineCreateInfo.pViewportState = &ViewportStateCreateInfo;
     PipelineCreateInfo.pRasterizationState = &RasterizationStateCreateInfo;
     PipelineCreateInfo.pMultisampleState = &MultisampleStateCreateInfo;
-    PipelineCreateInfo.pDepthStencilState = nullptr;
+    PipelineCreateInfo.pDepthStencilState = &DepthStencilStateCreateInfo;
     PipelineCreateInfo.pColorBlendState = &ColorBlendStateCreateInfo;
     PipelineCreateInfo.pDynamicState = nullptr;
     PipelineCreateInfo.layout = PipelineLayout;                         // Pipeline Layout pipeline should use
-    PipelineCreateInfo.renderPass = RenderPass;                         // Render pass description the pipeline is compatible with
+    PipelineCreateInfo.renderPass = FrameGraph.GetRenderPass(ScenePassNode);  // Render pass description the pipeline is compatible with
     PipelineCreateInfo.subpass = 0;                                     // Subpass of render pass to use with pipeline
 
     // Pipeline derivative: Can create multiple pipeline that derive from one another for optmisation
@@ -841,13 +1622,113 @@ void VulkanRenderer::CreateGraphicsPipeline()
     PipelineCreateInfo.basePipelineIndex = -1;                      // Or index to base in case of creating multiples
 
     // Create Grapgics Pipeline
-    Result = vkCreateGraphicsPipelines(MainDevice.LogicalDevice, VK_NULL_HANDLE, 1, &PipelineCreateInfo, nullptr, &GraphicsPipeline);
+    VkResult Result = vkCreateGraphicsPipelines(MainDevice.LogicalDevice, VK_NULL_HANDLE, 1, &PipelineCreateInfo, nullptr, NewGraphicsPipeline);
     if(Result != VK_SUCCESS) throw std::runtime_error("Failed to create Graphics Pipeline");
 
-    //Destroy Shadel Modules, no longer needed after Pipeline created
-    vkDestroyShaderModule(MainDevice.LogicalDevice, FragmentShaderModule, nullptr);
-    vkDestroyShaderModule(MainDevice.LogicalDevice, VertexShaderModule, nullptr);
+    // -- DEPTH PRE-PASS PIPELINE --
+    // Vertex stage only, writes depth and nothing else. Shares the layout so bound descriptors stay valid across passes
+    if (bDepthPrePass)
+    {
+        VkPipelineDepthStencilStateCreateInfo PrePassDepthStencilStateCreateInfo = DepthStencilStateCreateInfo;
+        PrePassDepthStencilStateCreateInfo.depthWriteEnable = VK_TRUE;
+        PrePassDepthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+
+        VkPipelineColorBlendStateCreateInfo PrePassColorBlendStateCreateInfo = ColorBlendStateCreateInfo;
+        PrePassColorBlendStateCreateInfo.attachmentCount = 0;              // Subpass has no colour attachments
+        PrePassColorBlendStateCreateInfo.pAttachments = nullptr;
+
+        PipelineCreateInfo.stageCount = 1;                                  // Vertex shader only
+        PipelineCreateInfo.pDepthStencilState = &PrePassDepthStencilStateCreateInfo;
+        PipelineCreateInfo.pColorBlendState = &PrePassColorBlendStateCreateInfo;
+        PipelineCreateInfo.renderPass = FrameGraph.GetRenderPass(DepthPrePassNode);
+
+        Result = vkCreateGraphicsPipelines(MainDevice.LogicalDevice, VK_NULL_HANDLE, 1, &PipelineCreateInfo, nullptr, NewDepthPrePassPipeline);
+        if(Result != VK_SUCCESS)
+        {
+            // Nothing is handed back on failure, the colour pipeline built above goes too
+            vkDestroyPipeline(MainDevice.LogicalDevice, *NewGraphicsPipeline, nullptr);
+            *NewGraphicsPipeline = VK_NULL_HANDLE;
+            throw std::runtime_error("Failed to create Depth Pre-Pass Pipeline");
+        }
+    }
+}
+
+void VulkanRenderer::StartShaderHotReload()
+{
+    // Runs on the watcher thread: pipeline creation is the slow part, and only needs the device, layout and render passes, none of which change after Init
+    auto OnCompiled = [this](const std::vector<CompiledShader>& Shaders)
+    {
+        // Every .vert/.frag in the directory is watched, the scene pipelines are built from the two the build embeds
+        auto FindShader = [&Shaders](const char* SourceName) -> const CompiledShader*
+        {
+            auto Found = std::find_if(Shaders.begin(), Shaders.end(), [SourceName](const CompiledShader& Shader) { return Shader.SourceName == SourceName; });
+            return Found != Shaders.end() ? &*Found : nullptr;
+        };
+        const CompiledShader* VertexShader = FindShader("shader.vert");
+        const CompiledShader* FragmentShader = FindShader("shader.frag");
+        if (VertexShader == nullptr || FragmentShader == nullptr)
+        {
+            std::cout << "Shader reload skipped, shader.vert and shader.frag are both needed" << std::endl;
+            return;
+        }
+
+        VkPipeline NewGraphicsPipeline = VK_NULL_HANDLE;
+        VkPipeline NewDepthPrePassPipeline = VK_NULL_HANDLE;
+        try
+        {
+            BuildGraphicsPipelines(VertexShader->Code, FragmentShader->Code, &NewGraphicsPipeline, &NewDepthPrePassPipeline);
+        }
+        catch (const std::runtime_error& Error)
+        {
+            std::cout << "Shader reload failed, keeping the current pipelines: " << Error.what() << std::endl;
+            return;
+        }
+
+        std::lock_guard<std::mutex> Lock(ReloadMutex);
+
+        // A build the render thread hasn't picked up yet was never used, it can go right away
+        if (ReloadedGraphicsPipeline != VK_NULL_HANDLE) vkDestroyPipeline(MainDevice.LogicalDevice, ReloadedGraphicsPipeline, nullptr);
+        if (ReloadedDepthPrePassPipeline != VK_NULL_HANDLE) vkDestroyPipeline(MainDevice.LogicalDevice, ReloadedDepthPrePassPipeline, nullptr);
+
+        ReloadedGraphicsPipeline = NewGraphicsPipeline;
+        ReloadedDepthPrePassPipeline = NewDepthPrePassPipeline;
+        Invalidate();                                               // Idle mode would never draw the new pipelines otherwise
+    };
+
+    ShaderReload.Start(SHADER_DIRECTORY, { ".vert", ".frag" }, OnCompiled);
+}
+
+void VulkanRenderer::SwapReloadedPipelines()
+{
+    // Old pipelines may still be bound by frames in flight, destroy them once each of those frames' fences has been waited on
+    for (size_t i = 0; i < RetiredPipelines.size();)
+    {
+        if (--RetiredPipelines[i].FramesLeft == 0)
+        {
+            vkDestroyPipeline(MainDevice.LogicalDevice, RetiredPipelines[i].Pipeline, nullptr);
+            RetiredPipelines[i] = RetiredPipelines.back();
+            RetiredPipelines.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // Never block the frame on a build in progress, pick it up next frame instead
+    std::unique_lock<std::mutex> Lock(ReloadMutex, std::try_to_lock);
+    if (!Lock.owns_lock() || ReloadedGraphicsPipeline == VK_NULL_HANDLE) return;
+
+    RetiredPipelines.push_back({ GraphicsPipeline, MAX_FRAME_DRAWS });
+    GraphicsPipeline = ReloadedGraphicsPipeline;
+    ReloadedGraphicsPipeline = VK_NULL_HANDLE;
 
+    if (DepthPrePassPipeline != VK_NULL_HANDLE)
+    {
+        RetiredPipelines.push_back({ DepthPrePassPipeline, MAX_FRAME_DRAWS });
+        DepthPrePassPipeline = ReloadedDepthPrePassPipeline;
+        ReloadedDepthPrePassPipeline = VK_NULL_HANDLE;
+    }
 }
 
 VkShaderModule VulkanRenderer::CreateShaderModule(const std::vector<char>& Code)
@@ -865,97 +1746,74 @@ VkShaderModule VulkanRenderer::CreateShaderModule(const std::vector<char>& Code)
     return ShaderModule;
 }
 
-void VulkanRenderer::CreateRenderPass()
-{
-    // Color attachment of render pass
-    VkAttachmentDescription ColorAttachment = {};
-    ColorAttachment.format = SwapchainImageFormat;                          // Format to use for attachment
-    ColorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;                        // Number of samples to write for multisamplig
-    ColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;                   // Describes what to do with attachment before rendering
-    ColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;                 // Describes what to do with attachment after rendering
-    ColorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;        // Describes what to do with stencils before rendering//
-    ColorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;      // Describes what to do with stencils after rendering
-
-    // Framebuffer data will be stored as an image, but images can be given different data layouts
-    // to give optimal use for certaion operation
-    ColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;              // Image data layout before render pass start
-    ColorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;          // Image data layout after render pass (to change to)
-
-    //Attatchment reference uses and attachment index that refers to index in the attachment list passed to RenderPassCreateInfo
-    VkAttachmentReference ColorAttachmentReference = {};
-    ColorAttachmentReference.attachment = 0;
-    ColorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    // Information about a particular subpass the render pass is using
-    VkSubpassDescription  SubpassDescription = {};
-    SubpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS; // Pipeline Type subpass is to be bound to;
-    SubpassDescription.colorAttachmentCount = 1;
-    SubpassDescription.pColorAttachments = &ColorAttachmentReference;
-
-    // Need to determine when layout transitions occur using subpass dependencies
-    std::array<VkSubpassDependency, 2> SubpassDependencies;
-
-    // Conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    // Transition must happen after...
-    SubpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-    SubpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-    SubpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-    // But must happen before...
-    SubpassDependencies[0].dstSubpass = 0;
-    SubpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    SubpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    SubpassDependencies[0].dependencyFlags = 0;
-
-
-    // Conversion from VK_IMAGE_LAYOUT_PRESENT_SRC_KHR to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    // Transition must happen after...
-    SubpassDependencies[1].srcSubpass = 0;
-    SubpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    SubpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    // But must happen before...
-    SubpassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-    SubpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-    SubpassDependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-    SubpassDependencies[1].dependencyFlags = 0;
-
-    VkRenderPassCreateInfo RenderPassCreateInfo = {};
-    RenderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    RenderPassCreateInfo.attachmentCount = 1;
-    RenderPassCreateInfo.pAttachments = &ColorAttachment;
-    RenderPassCreateInfo.subpassCount = 1;
-    RenderPassCreateInfo.pSubpasses = &SubpassDescription;
-    RenderPassCreateInfo.dependencyCount = static_cast<uint32_t>(SubpassDependencies.size());
-    RenderPassCreateInfo.pDependencies = SubpassDependencies.data();
-
-    VkResult Result = vkCreateRenderPass(MainDevice.LogicalDevice, &RenderPassCreateInfo, nullptr, &RenderPass);
-    if(Result != VK_SUCCESS) throw std::runtime_error("Failed to create RenderPass");
-
-}
-
-void VulkanRenderer::CreateFramebuffers()
-{
-    // Resize Framebuffer count to equal swapchain image count
-    SwapchainFramebuffers.resize(SwapchainImages.size());
-
-    // Create a framebuffer for each swap chain image
-    for(size_t i=0; i < SwapchainFramebuffers.size(); i++)
+void VulkanRenderer::CreateRenderGraph()
+{
+    FrameGraph.Create(MainDevice.PhysicalDevice, MainDevice.LogicalDevice);
+
+    // Depth only, no stencil is used. Smallest 32 bit float format first, packed stencil formats as fallbacks
+    DepthBufferFormat = ChooseSupportedFormat(
+        { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM },
+        VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+    // -- RESOURCES --
+    // Swapchain images come in when the acquire semaphore is waited on (colour output stage) and leave ready to present
+    std::vector<VkImage> Images;
+    std::vector<VkImageView> ImageViews;
+    for (const SwapchainImageHandle& SwapchainImage : SwapchainImages)
     {
-        std::array<VkImageView, 1> Attachments = {
-            SwapchainImages[i].ImageView
-        };
+        Images.push_back(SwapchainImage.Image);
+        ImageViews.push_back(SwapchainImage.ImageView);
+    }
+    RenderGraphResource Backbuffer = FrameGraph.ImportImage("Backbuffer", Images, ImageViews, SwapchainImageFormat, SwapchainExtent,
+                                                            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    // With MSAA the scene renders into a multisampled colour image resolved into the backbuffer at the end of the pass.
+    // Neither it nor the depth leave the pass (unless the pre-pass keeps depth), so on tilers they stay in tile memory
+    MsaaSamples = ChooseSampleCount(RequestedMsaaSamples);
+    RenderGraphResource Depth = FrameGraph.CreateTransientImage("Depth", DepthBufferFormat, SwapchainExtent, VK_IMAGE_ASPECT_DEPTH_BIT, MsaaSamples);
+    RenderGraphResource SceneColour = Backbuffer;
+    if (MsaaSamples != VK_SAMPLE_COUNT_1_BIT)
+    {
+        SceneColour = FrameGraph.CreateTransientImage("SceneColourMsaa", SwapchainImageFormat, SwapchainExtent, VK_IMAGE_ASPECT_COLOR_BIT, MsaaSamples);
+    }
+
+    VkClearValue ClearColour = {};
+    ClearColour.color = {0.6f, 0.65f, 0.4f, 1.0f};
+    VkClearValue ClearDepth = {};
+    ClearDepth.depthStencil.depth = 1.0f;                               // Far plane, anything drawn is in front of it
 
-        VkFramebufferCreateInfo FramebufferCreateInfo = {};
-        FramebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        FramebufferCreateInfo.renderPass = RenderPass;                                      // Render Pass layout the framebuffer will be used with
-        FramebufferCreateInfo.attachmentCount = static_cast<uint32_t>(Attachments.size());
-        FramebufferCreateInfo.pAttachments = Attachments.data();                            // List of attachments (1:1 with Render Pass
-        FramebufferCreateInfo.width = SwapchainExtent.width;                                // Framebuffer width
-        FramebufferCreateInfo.height = SwapchainExtent.height;                              // Framebuffer height
-        FramebufferCreateInfo.layers = 1;                                                   // Framebuffer layers
-
-        VkResult Result = vkCreateFramebuffer(MainDevice.LogicalDevice, &FramebufferCreateInfo, nullptr, &SwapchainFramebuffers[i]);
-        if(Result != VK_SUCCESS) throw std::runtime_error("Failed to create Framebuffer!");
+    // -- PASSES --
+    // Depth pre-pass: lays down depth first, so the scene pass shades only the visible fragment of each pixel
+    DepthPrePassNode = FrameGraph.AddPass("DepthPrePass", RenderGraphPassType::Graphics, [this](VkCommandBuffer CommandBuffer)
+    {
+        RecordDrawPass(CommandBuffer, DRAW_PASS_DEPTH_PRE_PASS, DepthPrePassNode);
+    });
+    if (bDepthPrePass)
+    {
+        FrameGraph.UseImage(DepthPrePassNode, Depth, RenderGraphAccess::DepthAttachment);
+        FrameGraph.ClearImage(DepthPrePassNode, Depth, ClearDepth);
+    }
+
+    ScenePassNode = FrameGraph.AddPass("Scene", RenderGraphPassType::Graphics, [this](VkCommandBuffer CommandBuffer)
+    {
+        RecordDrawPass(CommandBuffer, DRAW_PASS_OPAQUE, ScenePassNode);
+    });
+    FrameGraph.UseImage(ScenePassNode, SceneColour, RenderGraphAccess::ColourAttachment);
+    FrameGraph.ClearImage(ScenePassNode, SceneColour, ClearColour);
+    if (SceneColour != Backbuffer)
+    {
+        FrameGraph.ResolveImage(ScenePassNode, SceneColour, Backbuffer);
+    }
+    if (bDepthPrePass)
+    {
+        FrameGraph.UseImage(ScenePassNode, Depth, RenderGraphAccess::DepthReadOnly);
+    }
+    else
+    {
+        FrameGraph.UseImage(ScenePassNode, Depth, RenderGraphAccess::DepthAttachment);
+        FrameGraph.ClearImage(ScenePassNode, Depth, ClearDepth);
     }
+
+    FrameGraph.Compile();
 }
 
 void VulkanRenderer::CreateCommandPool()
@@ -964,6 +1822,7 @@ void VulkanRenderer::CreateCommandPool()
 
     VkCommandPoolCreateInfo CommandPoolCreateInfo = {};
     CommandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    CommandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;   // Command buffers are re-recorded every frame, so allow resetting them individually
     CommandPoolCreateInfo.queueFamilyIndex = QueueFamilyIndex.GraphicsFamily;       // Queue Family type that buffer from this command pool will use
 
     //Create a Graphics Queue Family Command Pool
@@ -971,12 +1830,21 @@ void VulkanRenderer::CreateCommandPool()
     VkResult Result = vkCreateCommandPool(MainDevice.LogicalDevice, &CommandPoolCreateInfo, nullptr, &GraphicsCommandPool);
     if(Result != VK_SUCCESS) throw std::runtime_error("Failed to create CommandPool");
 
+    // Pools for parallel recording are reset whole at the start of their frame, no need to reset buffers individually
+    CommandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    RecordingPools.resize(MAX_FRAME_DRAWS * Jobs.GetWorkerCount());
+    for (RecordingPool& Pool : RecordingPools)
+    {
+        Result = vkCreateCommandPool(MainDevice.LogicalDevice, &CommandPoolCreateInfo, nullptr, &Pool.CommandPool);
+        if(Result != VK_SUCCESS) throw std::runtime_error("Failed to create a Recording CommandPool");
+    }
+
 }
 
 void VulkanRenderer::CreateCommandBuffer()
 {
-    // Resize CommandBuffer count to have one for each framebuffer
-    CommandBuffers.resize(SwapchainFramebuffers.size());
+    // One command buffer per frame in flight, re-recorded each frame once its fence has signalled
+    CommandBuffers.resize(MAX_FRAME_DRAWS);
 
     VkCommandBufferAllocateInfo CommandBufferAllocateInfo = {};
     CommandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -990,67 +1858,394 @@ void VulkanRenderer::CreateCommandBuffer()
     if(Result != VK_SUCCESS) throw std::runtime_error("Failed to allocate command buffer");
 }
 
-void VulkanRenderer::RecordCommands()
+void VulkanRenderer::CreateGpuCounters()
+{
+    // Statistics need the features CreateLogicalDevice enables when the device has them
+    VkPhysicalDeviceFeatures SupportedFeatures;
+    vkGetPhysicalDeviceFeatures(MainDevice.PhysicalDevice, &SupportedFeatures);
+    QueueFamilyIndices Indices = GetQueueFamilies(MainDevice.PhysicalDevice);
+    PassCounters.Create(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, Indices.GraphicsFamily, MAX_FRAME_DRAWS, CounterMode,
+                        SupportedFeatures.pipelineStatisticsQuery, SupportedFeatures.inheritedQueries);
+
+    // Every pass of the graph is timed and counted, secondary buffers recorded inside one count towards it
+    FrameGraph.SetPassInstrumentation(
+        [this](VkCommandBuffer CommandBuffer, RenderGraphPass Pass)
+        {
+            PassCounters.BeginPass(CommandBuffer, Pass, FrameGraph.GetPassName(Pass), FrameGraph.IsPassRecordedInSecondaries(Pass));
+        },
+        [this](VkCommandBuffer CommandBuffer, RenderGraphPass Pass)
+        {
+            PassCounters.EndPass(CommandBuffer, Pass);
+        });
+    FrameGraph.SetInheritedPipelineStatistics(PassCounters.GetInheritedStatistics());
+}
+
+void VulkanRenderer::CreateUniformRing()
+{
+    // Single persistently mapped buffer holding a region for every frame in flight
+    UniformBufferRing.Create(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, UNIFORM_RING_FRAME_SIZE, MAX_FRAME_DRAWS);
+}
+
+void VulkanRenderer::CreateDescriptorPool()
+{
+    // Two dynamic uniform buffer descriptors per set, one set per frame in flight
+    VkDescriptorPoolSize PoolSize = {};
+    PoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    PoolSize.descriptorCount = 2 * MAX_FRAME_DRAWS;
+
+    VkDescriptorPoolCreateInfo PoolCreateInfo = {};
+    PoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    PoolCreateInfo.maxSets = MAX_FRAME_DRAWS;                                           // Maximum number of Descriptor Sets that can be created from pool
+    PoolCreateInfo.poolSizeCount = 1;                                                   // Amount of Pool Sizes being passed
+    PoolCreateInfo.pPoolSizes = &PoolSize;                                              // Pool Sizes to create pool with
+
+    VkResult Result = vkCreateDescriptorPool(MainDevice.LogicalDevice, &PoolCreateInfo, nullptr, &DescriptorPool);
+    if(Result != VK_SUCCESS) throw std::runtime_error("Failed to create Descriptor Pool");
+}
+
+void VulkanRenderer::CreateDescriptorSets()
+{
+    DescriptorSets.resize(MAX_FRAME_DRAWS);
+
+    // Every set uses the same layout
+    std::vector<VkDescriptorSetLayout> SetLayouts(MAX_FRAME_DRAWS, DescriptorSetLayout);
+
+    VkDescriptorSetAllocateInfo SetAllocateInfo = {};
+    SetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    SetAllocateInfo.descriptorPool = DescriptorPool;                                    // Pool to allocate Descriptor Set from
+    SetAllocateInfo.descriptorSetCount = MAX_FRAME_DRAWS;                               // Number of sets to allocate
+    SetAllocateInfo.pSetLayouts = SetLayouts.data();                                    // Layouts to use to allocate sets (1:1 relationship)
+
+    VkResult Result = vkAllocateDescriptorSets(MainDevice.LogicalDevice, &SetAllocateInfo, DescriptorSets.data());
+    if(Result != VK_SUCCESS) throw std::runtime_error("Failed to allocate Descriptor Sets");
+
+    // Point both bindings at the uniform ring, the dynamic offsets pick the actual data at bind time
+    for (size_t i = 0; i < DescriptorSets.size(); i++)
+    {
+        // View Projection Descriptor
+        VkDescriptorBufferInfo ViewProjectionBufferInfo = {};
+        ViewProjectionBufferInfo.buffer = UniformBufferRing.GetBuffer();                // Buffer to get data from
+        ViewProjectionBufferInfo.offset = 0;                                            // Position of start of data (dynamic offset is added on top)
+        ViewProjectionBufferInfo.range = sizeof(UboViewProjection);                     // Size of data
+
+        VkWriteDescriptorSet ViewProjectionSetWrite = {};
+        ViewProjectionSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        ViewProjectionSetWrite.dstSet = DescriptorSets[i];                              // Descriptor Set to update
+        ViewProjectionSetWrite.dstBinding = 0;                                          // Binding to update (matches with binding on layout/shader)
+        ViewProjectionSetWrite.dstArrayElement = 0;                                     // Index in array to update
+        ViewProjectionSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        ViewProjectionSetWrite.descriptorCount = 1;                                     // Amount to update
+        ViewProjectionSetWrite.pBufferInfo = &ViewProjectionBufferInfo;                 // Information about buffer data to bind
+
+        // Model Descriptor
+        VkDescriptorBufferInfo ModelBufferInfo = {};
+        ModelBufferInfo.buffer = UniformBufferRing.GetBuffer();
+        ModelBufferInfo.offset = 0;
+        ModelBufferInfo.range = sizeof(UboModel);
+
+        VkWriteDescriptorSet ModelSetWrite = {};
+        ModelSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        ModelSetWrite.dstSet = DescriptorSets[i];
+        ModelSetWrite.dstBinding = 1;
+        ModelSetWrite.dstArrayElement = 0;
+        ModelSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        ModelSetWrite.descriptorCount = 1;
+        ModelSetWrite.pBufferInfo = &ModelBufferInfo;
+
+        std::array<VkWriteDescriptorSet, 2> SetWrites = { ViewProjectionSetWrite, ModelSetWrite };
+
+        // Update the descriptor sets with new buffer/binding info
+        vkUpdateDescriptorSets(MainDevice.LogicalDevice, static_cast<uint32_t>(SetWrites.size()), SetWrites.data(), 0, nullptr);
+    }
+}
+
+void VulkanRenderer::RecordCommands(uint32_t ImageIndex)
 {
     // Information about how to begin each command buffer
     VkCommandBufferBeginInfo CommandBufferBeginInfo = {};
     CommandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    CommandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;        // Buffer can be resubmitted when it has already been submitted and is await execution
-
-    // Information about how to begin a render pass (only need for graphical app)
-    VkRenderPassBeginInfo RenderPassBeginInfo = {};
-    RenderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    RenderPassBeginInfo.renderPass = RenderPass;                        // Render Pass to begin
-    RenderPassBeginInfo.renderArea.offset = {0, 0};              // Start Point of render pass in pixels
-    RenderPassBeginInfo.renderArea.extent = SwapchainExtent;            // Size of region to run render pass on (starting at offset)
-    VkClearValue ClearValue[] = {
-            {0.6f, 0.65f, 0.4f, 1.0}
-    };
-    RenderPassBeginInfo.pClearValues = ClearValue;                      // List of clear values (TODO: Depth Attachment Clear Value)
-    RenderPassBeginInfo.clearValueCount = 1;                            //
+    CommandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;         // Buffer is re-recorded before every submit
+
+    VkCommandBuffer CommandBuffer = CommandBuffers[CurrentFrame];
+
+    // Secondary buffers recorded the last time this frame came round are done too
+    uint32_t WorkerCount = Jobs.GetWorkerCount();
+    for (uint32_t Worker = 0; Worker < WorkerCount; Worker++)
+    {
+        RecordingPool& Pool = RecordingPools[CurrentFrame * WorkerCount + Worker];
+        vkResetCommandPool(MainDevice.LogicalDevice, Pool.CommandPool, 0);
+        Pool.UsedCount = 0;
+    }
+
+    // Camera data is shared by every draw, so write it to the ring once per frame
+    FrameViewProjectionOffset = UniformBufferRing.Push(ViewProjection);
 
+    BuildDrawList();
 
+    auto DrawLoopStart = std::chrono::high_resolution_clock::now();
 
-    for(size_t i = 0; i < CommandBuffers.size(); i++)
+    // Model data is written to the ring once, the pre-pass and scene pass bind the same offsets
+    if (PerDrawPath == PerDrawDataPath::DynamicUniform)
     {
-        RenderPassBeginInfo.framebuffer = SwapchainFramebuffers[i];
-        // Start recording commands to command buffer!
-        VkResult Result = vkBeginCommandBuffer(CommandBuffers[i], &CommandBufferBeginInfo);
-        if(Result != VK_SUCCESS) throw std::runtime_error("Failed to start recording a Command Buffer!");
-            // Begin Render pass
-            vkCmdBeginRenderPass(CommandBuffers[i], &RenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        const std::vector<glm::mat4>& Transforms = RenderObjects.GetTransforms();
+        const std::vector<uint32_t>& MaterialIds = RenderObjects.GetMaterialIds();
+        ModelUniformOffsets.resize(RenderObjects.Size());
+        for (size_t j = 0; j < RenderObjects.Size(); j++)
+        {
+            UboModel Model = {};
+            Model.Model = Transforms[j];
+            Model.MaterialId = MaterialIds[j];
+            ModelUniformOffsets[j] = UniformBufferRing.Push(Model);
+        }
+    }
 
-                //Bind Pipeline to be used in render pass
-                vkCmdBindPipeline(CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, GraphicsPipeline);
+    BindCounters = DrawBindCounters();
 
+    // Passes with enough draws are recorded by the job workers into secondary command buffers
+    FrameGraph.SetSecondaryCommandBuffers(DepthPrePassNode, IsDrawPassRecordedInParallel(DRAW_PASS_DEPTH_PRE_PASS));
+    FrameGraph.SetSecondaryCommandBuffers(ScenePassNode, IsDrawPassRecordedInParallel(DRAW_PASS_OPAQUE));
 
-                for (size_t j = 0; j < MeshList.size(); j++)
-                {
-                    //Bind Vertex Buffer
-                    VkBuffer VertexBuffer[] = { MeshList[j].GetVertexBuffer() };            // Buffers to bind
-                    VkDeviceSize  Offsets[] = { 0 };                                      // Offsets into buffers being bound
-                    vkCmdBindVertexBuffers(CommandBuffers[i], 0, 1, VertexBuffer, Offsets); // Command to bind vertex buffer before drawing
+    // Start recording commands to command buffer!
+    VkResult Result = vkBeginCommandBuffer(CommandBuffer, &CommandBufferBeginInfo);
+    if(Result != VK_SUCCESS) throw std::runtime_error("Failed to start recording a Command Buffer!");
 
-                    // Bind Mesh index buffer, with 0 offset and using uint32 type
-                    vkCmdBindIndexBuffer(CommandBuffers[i], MeshList[j].GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        PassCounters.ResetQueries(CommandBuffer);
+        BindFrameDescriptorSets(CommandBuffer);
 
-                    //Execute Pipeline
-                    vkCmdDrawIndexed(CommandBuffers[i], MeshList[j].GetIndexCount(), 1, 0, 0, 0);
-                }
-                
+        // Every pass of the frame, with the barriers between them
+        FrameGraph.Execute(CommandBuffer, ImageIndex);
+
+    //Stop Recording to command buffer
+    Result = vkEndCommandBuffer(CommandBuffer);
+    if(Result != VK_SUCCESS) throw std::runtime_error("Failed to stop recording a Command Buffer!");
+
+    DrawTimings.RecordTime += std::chrono::high_resolution_clock::now() - DrawLoopStart;
+    DrawTimings.DrawCount += DrawItems.size();
+    DrawTimings.BindsIssued += BindCounters.PipelineBinds + BindCounters.VertexBufferBinds + BindCounters.IndexBufferBinds;
+    DrawTimings.BindsSkipped += BindCounters.PipelineBindsSkipped + BindCounters.VertexBufferBindsSkipped + BindCounters.IndexBufferBindsSkipped;
+
+    ReportDrawTimings();
+}
+
+void VulkanRenderer::BindFrameDescriptorSets(VkCommandBuffer CommandBuffer)
+{
+    // Bindless set holds every texture and material, bound once for the whole frame
+    // (every pipeline shares the layout, so sets stay bound across pipeline and render pass changes)
+    VkDescriptorSet BindlessSet = BindlessResources.GetDescriptorSet();
+    vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout,
+                            1, 1, &BindlessSet, 0, nullptr);
+
+    // With push constants the descriptor set only carries the camera, so bind it once (model offset unused)
+    if (PerDrawPath == PerDrawDataPath::PushConstant)
+    {
+        uint32_t DynamicOffsets[] = { FrameViewProjectionOffset, 0 };
+        vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout,
+                                0, 1, &DescriptorSets[CurrentFrame], 2, DynamicOffsets);
+    }
+}
+
+void VulkanRenderer::GetDrawPassRange(uint32_t DrawPass, const DrawItem** First, const DrawItem** Last) const
+{
+    // Draws are sorted by pass first, so this pass's draws are one contiguous run
+    auto PassFirst = std::partition_point(DrawItems.begin(), DrawItems.end(), [DrawPass](const DrawItem& Item) { return GetDrawKeyPass(Item.Key) < DrawPass; });
+    auto PassLast = std::partition_point(PassFirst, DrawItems.end(), [DrawPass](const DrawItem& Item) { return GetDrawKeyPass(Item.Key) == DrawPass; });
+    *First = DrawItems.data() + (PassFirst - DrawItems.begin());
+    *Last = DrawItems.data() + (PassLast - DrawItems.begin());
+}
+
+bool VulkanRenderer::IsDrawPassRecordedInParallel(uint32_t DrawPass) const
+{
+    const DrawItem* First;
+    const DrawItem* Last;
+    GetDrawPassRange(DrawPass, &First, &Last);
+    return Jobs.GetWorkerCount() > 1 && static_cast<size_t>(Last - First) >= PARALLEL_RECORD_MIN_DRAWS;
+}
+
+VkCommandBuffer VulkanRenderer::GetRecordingCommandBuffer(uint32_t WorkerIndex)
+{
+    // Only the worker itself touches its pool, so no locking
+    RecordingPool& Pool = RecordingPools[CurrentFrame * Jobs.GetWorkerCount() + WorkerIndex];
+    if (Pool.UsedCount == Pool.CommandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo CommandBufferAllocateInfo = {};
+        CommandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        CommandBufferAllocateInfo.commandPool = Pool.CommandPool;
+        CommandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;            // Executed from the frame's primary buffer
+        CommandBufferAllocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer NewCommandBuffer;
+        VkResult Result = vkAllocateCommandBuffers(MainDevice.LogicalDevice, &CommandBufferAllocateInfo, &NewCommandBuffer);
+        if(Result != VK_SUCCESS) throw std::runtime_error("Failed to allocate a secondary command buffer");
+        Pool.CommandBuffers.push_back(NewCommandBuffer);
+    }
+
+    return Pool.CommandBuffers[Pool.UsedCount++];
+}
+
+void VulkanRenderer::RecordDrawPass(VkCommandBuffer CommandBuffer, uint32_t DrawPass, RenderGraphPass Node)
+{
+    const DrawItem* First;
+    const DrawItem* Last;
+    GetDrawPassRange(DrawPass, &First, &Last);
+
+    if (!IsDrawPassRecordedInParallel(DrawPass))
+    {
+        RecordDraws(CommandBuffer, First, Last, BindCounters);
+        return;
+    }
 
+    // Split the sorted draws in contiguous runs, each recorded by a job into its own secondary buffer.
+    // Executing the buffers in run order keeps the draw order of the sort
+    size_t DrawCount = Last - First;
+    size_t RunCount = std::clamp<size_t>(DrawCount / RECORD_MIN_DRAWS_PER_JOB, 1, Jobs.GetWorkerCount() * JOB_CHUNKS_PER_WORKER);
+    std::vector<VkCommandBuffer> SecondaryBuffers(RunCount);
+    std::vector<DrawBindCounters> RunCounters(RunCount);
+
+    VkCommandBufferInheritanceInfo InheritanceInfo = FrameGraph.GetInheritanceInfo(Node);
+    VkCommandBufferBeginInfo SecondaryBeginInfo = {};
+    SecondaryBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    SecondaryBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;  // Entirely inside the pass's render pass
+    SecondaryBeginInfo.pInheritanceInfo = &InheritanceInfo;
+
+    Jobs.ParallelFor(RunCount, 1, [&](size_t FirstRun, size_t LastRun)
+    {
+        for (size_t Run = FirstRun; Run < LastRun; Run++)
+        {
+            VkCommandBuffer Secondary = GetRecordingCommandBuffer(Jobs.GetWorkerIndex());
 
+            VkResult Result = vkBeginCommandBuffer(Secondary, &SecondaryBeginInfo);
+            if(Result != VK_SUCCESS) throw std::runtime_error("Failed to start recording a secondary Command Buffer!");
 
-            // End Render Pass
-            vkCmdEndRenderPass(CommandBuffers[i]);
+            // Secondary buffers inherit no bound state from the primary
+            BindFrameDescriptorSets(Secondary);
+            RecordDraws(Secondary, First + DrawCount * Run / RunCount, First + DrawCount * (Run + 1) / RunCount, RunCounters[Run]);
 
-        //Stop Recording to command buffer
-        Result = vkEndCommandBuffer(CommandBuffers[i]);
-        if(Result != VK_SUCCESS) throw std::runtime_error("Failed to stop recording a Command Buffer!");
+            Result = vkEndCommandBuffer(Secondary);
+            if(Result != VK_SUCCESS) throw std::runtime_error("Failed to stop recording a secondary Command Buffer!");
 
+            SecondaryBuffers[Run] = Secondary;
+        }
+    });
+
+    vkCmdExecuteCommands(CommandBuffer, static_cast<uint32_t>(SecondaryBuffers.size()), SecondaryBuffers.data());
+
+    for (const DrawBindCounters& Counters : RunCounters)
+    {
+        BindCounters.PipelineBinds += Counters.PipelineBinds;
+        BindCounters.PipelineBindsSkipped += Counters.PipelineBindsSkipped;
+        BindCounters.VertexBufferBinds += Counters.VertexBufferBinds;
+        BindCounters.VertexBufferBindsSkipped += Counters.VertexBufferBindsSkipped;
+        BindCounters.IndexBufferBinds += Counters.IndexBufferBinds;
+        BindCounters.IndexBufferBindsSkipped += Counters.IndexBufferBindsSkipped;
     }
 }
 
+void VulkanRenderer::RecordDraws(VkCommandBuffer CommandBuffer, const DrawItem* First, const DrawItem* Last, DrawBindCounters& Counters)
+{
+    // Stream through the dense render object arrays, only touching what the draw needs
+    const std::vector<VkBuffer>& VertexBuffers = RenderObjects.GetVertexBuffers();
+    const std::vector<VkBuffer>& IndexBuffers = RenderObjects.GetIndexBuffers();
+    const std::vector<uint32_t>& IndexCounts = RenderObjects.GetIndexCounts();
+    const std::vector<glm::mat4>& Transforms = RenderObjects.GetTransforms();
+    const std::vector<uint32_t>& MaterialIds = RenderObjects.GetMaterialIds();
+
+    // Walk the sorted draws, only binding state that differs from what is already bound
+    std::array<VkPipeline, 2> DrawPipelines = { DepthPrePassPipeline, GraphicsPipeline };
+    std::array<RenderGraphPass, 2> DrawPassNodes = { DepthPrePassNode, ScenePassNode };
+    VkPipeline BoundPipeline = VK_NULL_HANDLE;
+    VkBuffer BoundVertexBuffer = VK_NULL_HANDLE;
+    VkBuffer BoundIndexBuffer = VK_NULL_HANDLE;
+
+    for (const DrawItem* Item = First; Item != Last; ++Item)
+    {
+        uint32_t j = Item->ObjectIndex;
+
+        //Bind Pipeline to be used in render pass
+        VkPipeline Pipeline = DrawPipelines[GetDrawKeyPipeline(Item->Key)];
+        if (Pipeline != BoundPipeline)
+        {
+            vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline);
+            BoundPipeline = Pipeline;
+            Counters.PipelineBinds++;
+        }
+        else Counters.PipelineBindsSkipped++;
+
+        //Bind Vertex Buffer
+        if (VertexBuffers[j] != BoundVertexBuffer)
+        {
+            VkBuffer VertexBuffer[] = { VertexBuffers[j] };                       // Buffers to bind
+            VkDeviceSize  Offsets[] = { 0 };                                      // Offsets into buffers being bound
+            vkCmdBindVertexBuffers(CommandBuffer, 0, 1, VertexBuffer, Offsets);   // Command to bind vertex buffer before drawing
+            BoundVertexBuffer = VertexBuffers[j];
+            Counters.VertexBufferBinds++;
+        }
+        else Counters.VertexBufferBindsSkipped++;
+
+        // Bind Mesh index buffer, with 0 offset and using uint32 type
+        if (IndexBuffers[j] != BoundIndexBuffer)
+        {
+            vkCmdBindIndexBuffer(CommandBuffer, IndexBuffers[j], 0, VK_INDEX_TYPE_UINT32);
+            BoundIndexBuffer = IndexBuffers[j];
+            Counters.IndexBufferBinds++;
+        }
+        else Counters.IndexBufferBindsSkipped++;
+
+        if (PerDrawPath == PerDrawDataPath::PushConstant)
+        {
+            // Push model data straight into the command buffer
+            PushModel Model = {};
+            Model.Model = Transforms[j];
+            Model.MaterialId = MaterialIds[j];
+            ModelPushConstant.Push(CommandBuffer, PipelineLayout, Model);
+        }
+        else
+        {
+            // Point the frame's descriptor set at this object's model data in the ring
+            uint32_t DynamicOffsets[] = { FrameViewProjectionOffset, ModelUniformOffsets[j] };   // One offset per dynamic binding, in binding order
+
+            vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout,
+                                    0, 1, &DescriptorSets[CurrentFrame], 2, DynamicOffsets);
+        }
+
+        //Execute Pipeline
+        uint32_t CounterQuery = PassCounters.BeginDraw(CommandBuffer, DrawPassNodes[GetDrawKeyPass(Item->Key)], j);
+        vkCmdDrawIndexed(CommandBuffer, IndexCounts[j], 1, 0, 0, 0);
+        PassCounters.EndDraw(CommandBuffer, CounterQuery);
+    }
+}
+
+void VulkanRenderer::ReportDrawTimings()
+{
+    // Print the average cost of recording one draw every 1000 frames, then start over
+    if (++DrawTimings.FrameCount < 1000) return;
+
+    if (DrawTimings.DrawCount > 0)
+    {
+        double NanosecondsPerDraw = (double)DrawTimings.RecordTime.count() / (double)DrawTimings.DrawCount;
+        std::cout << "Per draw CPU cost (" << (PerDrawPath == PerDrawDataPath::PushConstant ? "push constants" : "dynamic uniform")
+                  << "): " << NanosecondsPerDraw << " ns over " << DrawTimings.DrawCount << " draws" << std::endl;
+        std::cout << "Binds per frame: " << DrawTimings.BindsIssued / DrawTimings.FrameCount << " issued, "
+                  << DrawTimings.BindsSkipped / DrawTimings.FrameCount << " skipped as redundant" << std::endl;
+    }
+
+    // Latest GPU side of a frame, pass by pass
+    GpuFrameCounters Counters = PassCounters.GetLastFrame();
+    std::cout << "GPU frame " << Counters.FrameNumber << ": " << Counters.GpuMilliseconds << " ms" << std::endl;
+    for (const GpuPassCounters& Pass : Counters.Passes)
+    {
+        std::cout << "  " << Pass.Name << ": " << Pass.GpuMilliseconds << " ms";
+        if (Pass.bHasStatistics)
+        {
+            std::cout << ", " << Pass.Statistics.InputVertices << " vertices, " << Pass.Statistics.VertexInvocations << " vertex shader invocations, "
+                      << Pass.Statistics.InputPrimitives << " primitives (" << Pass.Statistics.ClippingPrimitives << " after clipping), "
+                      << Pass.Statistics.FragmentInvocations << " fragment shader invocations";
+        }
+        std::cout << std::endl;
+    }
+
+    DrawTimings = DrawRecordTimings();
+}
+
 void VulkanRenderer::CreateSynchronisation()
 {
     ImageAvailable.resize(MAX_FRAME_DRAWS);
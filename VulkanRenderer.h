@@ -5,6 +5,7 @@
 
 
 #include "Utilities.h"
+#include "GLM/gtc/matrix_transform.hpp"
 
 #include <stdexcept>
 #include <vector>
@@ -12,8 +13,34 @@
 #include <set>
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <utility>
 
 #include "Mesh.h"
+#include "RenderObjectList.h"
+#include "UniformRing.h"
+#include "PushConstants.h"
+#include "BindlessTable.h"
+#include "MaterialTable.h"
+#include "TextureStreamer.h"
+#include "KtxTexture.h"
+#include "DrawSortKey.h"
+#include "RenderGraph.h"
+#include "ShaderWatcher.h"
+#include "ShaderReflection.h"
+#include "PipelineLayoutCache.h"
+#include "EmbeddedShaders.h"
+#include "TransformKernels.h"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include "TripleBuffer.h"
+#include "StartupScheduler.h"
+#include "GpuCounters.h"
+
 class VulkanRenderer
 {
 public:
@@ -21,10 +48,67 @@ public:
 	~VulkanRenderer();
 
 
+	// Where per draw data (model matrix, material) is fed from
+	enum class PerDrawDataPath
+	{
+		PushConstant,			// vkCmdPushConstants per draw, no descriptor work (default)
+		DynamicUniform			// Written to the uniform ring and bound with a dynamic offset per draw
+	};
+
 	int Init(GLFWwindow* NewWindow);
 	void Draw();
 	void CleanUp();
 
+	void SetPerDrawDataPath(PerDrawDataPath NewPath);		// Must be called before Init, the shader variant is baked into the pipeline
+	void SetDepthPrePass(bool bEnabled);					// Must be called before Init, adds a depth only subpass to the render pass
+	void SetMsaaSamples(VkSampleCountFlagBits Samples);		// Must be called before Init, clamped to what the device supports (1 disables MSAA)
+	void SetShaderHotReload(bool bEnabled);				// Must be called before Init, recompiles edited shaders in the background and swaps pipelines between frames
+	void SetPreferredDevice(const std::string& NameOrIndex);	// Must be called before Init, GPU used if suitable instead of the best scored (GPU_OVERRIDE_VARIABLE wins over it)
+	void LogBarriers(uint32_t FrameCount);					// Print the stage/access scope of every barrier of the next FrameCount frames (called before Init, uploads are logged too)
+
+	// Binds the last recorded frame issued, and the ones skipped because the state was already bound
+	struct DrawBindCounters
+	{
+		uint32_t PipelineBinds = 0;
+		uint32_t PipelineBindsSkipped = 0;
+		uint32_t VertexBufferBinds = 0;
+		uint32_t VertexBufferBindsSkipped = 0;
+		uint32_t IndexBufferBinds = 0;
+		uint32_t IndexBufferBindsSkipped = 0;
+	};
+
+	const DrawBindCounters& GetLastFrameBindCounters() const;
+
+	// Device memory by category, memory type and heap (with VK_EXT_memory_budget's budget and usage, refreshed every frame).
+	// The report prints that every IntervalFrames frames and writes it to JsonPath (if not empty), 0 disables it
+	void SetMemoryReport(uint32_t IntervalFrames, const std::string& JsonPath = "");
+	MemorySnapshot GetMemorySnapshot() const;
+
+	// GPU time and pipeline statistics of every pass (and draw, in PerDraw mode), a few frames behind.
+	// Also printed with the draw timings
+	void SetGpuCounterMode(GpuCounterMode Mode);			// Must be called before Init, statistics need the pipelineStatisticsQuery feature
+	GpuFrameCounters GetLastGpuCounters() const;
+
+	// What the main thread's update hands the render thread for a frame. Packets the render thread didn't get to
+	// are replaced by newer ones, so each packet holds the full state of what it updates rather than changes
+	struct FramePacket
+	{
+		glm::mat4 View = glm::mat4(1.0f);
+		std::vector<std::pair<RenderObjectHandle, glm::mat4>> ObjectTransforms;	// Every object the update animates
+	};
+
+	// Draw moves to a render thread fed by frame packets, so a slow present or fence wait never holds up input
+	void StartRenderThread();								// After Init
+	void StopRenderThread();								// Before CleanUp
+	FramePacket& BeginFramePacket();						// Packet to fill for the next frame (main thread)
+	bool SubmitFramePacket();								// False if idle mode dropped it
+	bool IsFramePacketPending() const;						// Render thread hasn't picked up the last submitted packet yet
+
+	// Damage tracking: in idle mode a frame packet is only drawn if it differs from the last one drawn, or the frame
+	// was invalidated (input, resize, or renderer work such as texture streaming that needs more frames to finish)
+	void SetIdleMode(bool bEnabled);
+	void Invalidate();										// Any thread, wakes a main loop sleeping in glfwWaitEvents
+
 
 private:
 
@@ -33,32 +117,145 @@ private:
 
 
 	// Scene Objects
-	std::vector<Mesh> MeshList;
+	RenderObjectList RenderObjects;
+
+	// Scene Settings
+	struct UboViewProjection
+	{
+		glm::mat4 Projection;
+		glm::mat4 View;
+	} ViewProjection;
+
+	struct UboModel
+	{
+		glm::mat4 Model;
+		uint32_t MaterialId;
+	};
+
+	struct PushModel
+	{
+		glm::mat4 Model;
+		uint32_t MaterialId;
+	};
+
+	PerDrawDataPath PerDrawPath = PerDrawDataPath::PushConstant;
+	PushConstantBlock<PushModel> ModelPushConstant = PushConstantBlock<PushModel>(VK_SHADER_STAGE_VERTEX_BIT);
+
+	// CPU time spent recording draws, reported periodically to compare per draw data paths
+	struct DrawRecordTimings
+	{
+		std::chrono::nanoseconds RecordTime = std::chrono::nanoseconds(0);
+		uint64_t DrawCount = 0;
+		uint32_t FrameCount = 0;
+		uint64_t BindsIssued = 0;
+		uint64_t BindsSkipped = 0;
+	} DrawTimings;
+
+	GpuCounterMode CounterMode = GpuCounterMode::PerPass;
+	GpuCounters PassCounters;							// Timestamp and pipeline statistics queries around passes (and draws)
+
+	// Pass and pipeline fields of draw sort keys
+	static const uint32_t DRAW_PASS_DEPTH_PRE_PASS = 0;
+	static const uint32_t DRAW_PASS_OPAQUE = 1;
+	static const uint32_t DRAW_PIPELINE_DEPTH_PRE_PASS = 0;
+	static const uint32_t DRAW_PIPELINE_OPAQUE = 1;
+
+	// Draws are rebuilt and sorted by key every frame: pass, then pipeline, material and mesh, then front to back
+	bool bDepthPrePass = false;							// Lay down depth first, then shade only the visible fragment of each pixel
+	std::vector<DrawItem> DrawItems;					// Sorted draws of the frame being recorded
+	std::vector<DrawItem> DrawItemScratch;				// Radix sort ping-pong buffer, kept to avoid reallocating
+	DrawBindCounters BindCounters;
+	static const size_t PARALLEL_RECORD_MIN_DRAWS = 1024;	// Passes with fewer draws are recorded inline on the calling thread
+	static const size_t RECORD_MIN_DRAWS_PER_JOB = 128;		// Smallest run of draws recorded into one secondary command buffer
+	std::vector<uint32_t> ModelUniformOffsets;			// Ring offset of each render object's model data (dynamic uniform path)
+	std::vector<glm::mat4> ModelViewProjections;		// Per render object, rebuilt at the start of every frame
+	std::vector<BoundingBox> WorldBounds;				// Per render object, rebuilt at the start of every frame
+	std::vector<uint32_t> VisibleObjects;				// Render objects inside the camera frustum, ascending
+	FrustumCuller Culler;
+	JobSystem Jobs;										// Culling, sorting, recording and texture decoding run on its workers
+	uint32_t BarrierLogFrames = 0;						// Frames left to log barriers of
 
 	//Vulkan Components
 	/// - Main
 	VkInstance Instance;
 	DeviceHandles MainDevice;	
+	std::vector<const char*> EnabledDeviceExtensions;	// Required extensions plus the optional ones the device supports
 	VkSurfaceKHR Surface;
 	VkSwapchainKHR Swapchain;
 	VkQueue GraphicsQueue;
 	VkQueue PresentationQueue;
 	std::vector<SwapchainImageHandle> SwapchainImages;
-	std::vector<VkFramebuffer> SwapchainFramebuffers;
     std::vector<VkCommandBuffer> CommandBuffers;
     void CreateSynchronisation();
 
 	/// - Utility
 	VkFormat SwapchainImageFormat;
 	VkExtent2D SwapchainExtent;
+	VkFormat DepthBufferFormat;
+	VkSampleCountFlagBits RequestedMsaaSamples = VK_SAMPLE_COUNT_4_BIT;
+	VkSampleCountFlagBits MsaaSamples = VK_SAMPLE_COUNT_1_BIT;	// Samples of the scene attachments and pipelines
+
+	/// - Descriptors
+	VkDescriptorSetLayout DescriptorSetLayout;
+	VkDescriptorPool DescriptorPool;
+	std::vector<VkDescriptorSet> DescriptorSets;		// One per frame in flight
+	UniformRing UniformBufferRing;						// Per frame uniform data, bound with dynamic offsets
+	BindlessTable BindlessResources;					// Set 1: every texture and storage buffer, indexed from shaders
+	MaterialTable Materials;							// Materials, indexed by material id from shaders
+	MipGenerator MipGeneration;							// Builds mip chains of textures that only come with level 0
+	TextureStreamer TextureStreaming;					// Textures with mips streamed in on demand, under a memory budget
+	KtxTranscodeTarget TextureTranscodeTarget;			// Format universal KTX2 textures are transcoded to for this device
 
 	/// - Pipeline
 	VkPipeline GraphicsPipeline;
-	VkPipelineLayout PipelineLayout;
-	VkRenderPass RenderPass;
+	VkPipeline DepthPrePassPipeline = VK_NULL_HANDLE;	// Vertex only pipeline for the depth pre-pass subpass
+	VkPipelineLayout PipelineLayout;						// Owned by LayoutCache, as is DescriptorSetLayout
+	PipelineLayoutCache LayoutCache;					// Layouts derived from shader reflection, shared by every pipeline that matches
+
+	/// - Shader Hot Reload
+#ifdef NDEBUG
+	bool bShaderHotReload = false;
+#else
+	bool bShaderHotReload = true;
+#endif
+	ShaderWatcher ShaderReload;							// Recompiles shader.vert/frag on change, pipelines are built on its thread
+	std::mutex ReloadMutex;								// Guards the pending pipelines below
+	VkPipeline ReloadedGraphicsPipeline = VK_NULL_HANDLE;		// Built from reloaded shaders, swapped in at the start of the next frame
+	VkPipeline ReloadedDepthPrePassPipeline = VK_NULL_HANDLE;
+	struct RetiredPipeline
+	{
+		VkPipeline Pipeline;
+		uint32_t FramesLeft;							// Destroyed once every frame in flight that could use it has finished
+	};
+	std::vector<RetiredPipeline> RetiredPipelines;
+
+	/// - Render Thread
+	std::thread RenderThread;
+	std::atomic<bool> bStopRendering = false;
+	TripleBuffer<FramePacket> FramePackets;				// Latest packet from the main thread, lock-free
+	bool bIdleMode = false;
+	std::atomic<bool> bFrameInvalidated = true;			// First frame always draws
+	FramePacket LastSubmittedPacket;					// Main thread only, to tell whether a packet changes anything
+	static bool IsSameFramePacket(const FramePacket& A, const FramePacket& B);
+	void RenderLoop();
+	void ApplyFramePacket(const FramePacket& Packet);
+
+	/// - Frame Graph
+	RenderGraph FrameGraph;								// Every pass of the frame, with its barriers, render passes and transient images
+	RenderGraphPass DepthPrePassNode;
+	RenderGraphPass ScenePassNode;
+	uint32_t FrameViewProjectionOffset = 0;				// Camera data of the frame being recorded
 
 	/// - Pools
 	VkCommandPool GraphicsCommandPool;
+	// Secondary command buffers one job worker records draws into during one frame in flight (pools can't be shared between threads)
+	struct RecordingPool
+	{
+		VkCommandPool CommandPool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> CommandBuffers;	// Allocated so far, reused every time the frame comes round
+		uint32_t UsedCount = 0;
+	};
+	std::vector<RecordingPool> RecordingPools;			// MAX_FRAME_DRAWS * worker count, frame major
 
 	/// - Synchronisation
 	std::vector<VkSemaphore> ImageAvailable;
@@ -72,16 +269,47 @@ private:
 	void CreateLogicalDevice();
 	void CreateSurface();
 	void CreateSwapChain();
-	void CreateRenderPass();
+	void CreateRenderGraph();
+	void CreateBindlessResources();
+	void CreateMipGeneration();
+	void CreateTextureStreaming();
+	void CreateGraphicsPipelineLayout();
 	void CreateGraphicsPipeline();
-	void CreateFramebuffers();
+	void BuildGraphicsPipelines(const std::vector<char>& VertexShaderCode, const std::vector<char>& FragmentShaderCode,
+								VkPipeline* NewGraphicsPipeline, VkPipeline* NewDepthPrePassPipeline);
+	VkPipelineLayout GetShaderPipelineLayout(const ShaderReflection& Reflection, VkDescriptorSetLayout* FrameSetLayout);
+	void StartShaderHotReload();
+	void SwapReloadedPipelines();
 	void CreateCommandPool();
 	void CreateCommandBuffer();
+	void CreateUniformRing();
+	void CreateDescriptorPool();
+	void CreateDescriptorSets();
+	void CreateGpuCounters();
+
+	/// - Startup: Init's stages, and the scene they load
+	StartupScheduler Startup;
+	bool bStartupFinished = false;						// Deferred startup work has run, after the first present
+	std::vector<Mesh> UploadSceneMeshes();
+	std::vector<TextureSource> LoadSceneTextures();
+	void CreateScene(const std::vector<Mesh>& Meshes, const std::vector<TextureSource>& Textures);
+	void FinishStartup();
 
 	/// - Record Functions
-	void RecordCommands();
+	void RecordCommands(uint32_t ImageIndex);
+	void RecordDrawPass(VkCommandBuffer CommandBuffer, uint32_t DrawPass, RenderGraphPass Node);
+	void RecordDraws(VkCommandBuffer CommandBuffer, const DrawItem* First, const DrawItem* Last, DrawBindCounters& Counters);
+	void BindFrameDescriptorSets(VkCommandBuffer CommandBuffer);
+	void GetDrawPassRange(uint32_t DrawPass, const DrawItem** First, const DrawItem** Last) const;
+	bool IsDrawPassRecordedInParallel(uint32_t DrawPass) const;
+	VkCommandBuffer GetRecordingCommandBuffer(uint32_t WorkerIndex);
+	void ReportDrawTimings();
+	void UpdateObjectTransforms();
+	void RequestTextureResolutions();
+	void BuildDrawList();
 
 	/// - Get Functions
+	std::string PreferredDevice;						// Enumeration index or part of the device name, empty to pick by score
 	void GetPhysicalDevice();
 
 	/// - Support Functions
@@ -89,6 +317,8 @@ private:
 	bool CheckInstanceExtensionSupport(std::vector<const char*>* CheckExtensions);
 	bool CheckDeviceExtensionSupport(VkPhysicalDevice PhysicalDevice);
 	bool CheckPhysicalDeviceSuitable(VkPhysicalDevice PhysicalDevice);
+	uint64_t ScorePhysicalDevice(VkPhysicalDevice PhysicalDevice);		// Higher is better, only meaningful for suitable devices
+	bool IsDeviceExtensionEnabled(const char* ExtensionName);
 
 
 	//// -- Getter Functions
@@ -99,9 +329,11 @@ private:
 	VkSurfaceFormatKHR ChooseBestSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& Formats);
 	VkPresentModeKHR ChooseBestPresentationMode(const std::vector<VkPresentModeKHR>& PresentationModes);
 	VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& SurfaceCapabilities);
+	VkFormat ChooseSupportedFormat(const std::vector<VkFormat>& Formats, VkImageTiling Tiling, VkFormatFeatureFlags FeatureFlags);
+	VkSampleCountFlagBits ChooseSampleCount(VkSampleCountFlagBits Requested);
 
 	//// -- Create Functions
-	VkImageView CreateImageView(VkImage Image, VkFormat Format, VkImageAspectFlags AspectFlags);
+	VkImageView CreateImageView(VkImage Image, VkFormat Format, VkImageAspectFlags AspectFlags, uint32_t MipLevels = 1);
 	VkShaderModule CreateShaderModule (const std::vector<char>& Code);
 
 };
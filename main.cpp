@@ -2,16 +2,23 @@
 #include <GLFW/glfw3.h>
 
 
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <vector>
 
 
 #include "VulkanRenderer.h"
+#include "SelfTest.h"
+#include "Benchmarks.h"
 
 GLFWwindow * window;
 VulkanRenderer VulkanRender;
 
+//Only draw when something changed, sleeping in between (kiosk machines sit on a static scene for hours)
+bool bIdleMode = true;
+const double IDLE_WAIT_SECONDS = 0.25;					//Longest sleep between updates while idle
+
 void InitWindow(std::string wName = "Test Window", const int width = 800, const int height = 600)
 {
 	//Inicialize GLFW
@@ -22,28 +29,61 @@ void InitWindow(std::string wName = "Test Window", const int width = 800, const
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
 	window = glfwCreateWindow(width, height, wName.c_str(), nullptr, nullptr);
+
+	//Input, resizes and exposes all invalidate the frame
+	glfwSetKeyCallback(window, [](GLFWwindow*, int, int, int, int) { VulkanRender.Invalidate(); });
+	glfwSetCharCallback(window, [](GLFWwindow*, unsigned int) { VulkanRender.Invalidate(); });
+	glfwSetMouseButtonCallback(window, [](GLFWwindow*, int, int, int) { VulkanRender.Invalidate(); });
+	glfwSetCursorPosCallback(window, [](GLFWwindow*, double, double) { VulkanRender.Invalidate(); });
+	glfwSetScrollCallback(window, [](GLFWwindow*, double, double) { VulkanRender.Invalidate(); });
+	glfwSetFramebufferSizeCallback(window, [](GLFWwindow*, int, int) { VulkanRender.Invalidate(); });
+	glfwSetWindowRefreshCallback(window, [](GLFWwindow*) { VulkanRender.Invalidate(); });
+	glfwSetWindowFocusCallback(window, [](GLFWwindow*, int) { VulkanRender.Invalidate(); });
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	//Kernel checks and benchmarks only, no window or device needed
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--self-test") == 0) return RunSelfTests();
+		if (std::strcmp(argv[i], "--benchmark") == 0) return RunBenchmarks();
+	}
 
 	//Create Window
 	InitWindow();
 
 	//Create Vulkan Rederer Instance
+	VulkanRender.SetIdleMode(bIdleMode);
 	if (VulkanRender.Init(window) == EXIT_FAILURE) return EXIT_FAILURE;
 
+	//Render on a thread of its own, this one handles input and updates the scene
+	VulkanRender.StartRenderThread();
+
 	//Loop until Close
 
 	while (!glfwWindowShouldClose(window))
 	{
-		glfwPollEvents();
-		VulkanRender.Draw();
+		//Idle: sleep until an event (input, or Invalidate from any thread) instead of spinning
+		if (bIdleMode) glfwWaitEventsTimeout(IDLE_WAIT_SECONDS);
+		else glfwPollEvents();
+
+		//Update the next frame while the render thread submits the previous one
+		VulkanRenderer::FramePacket& Packet = VulkanRender.BeginFramePacket();
+		Packet.View = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		if (!VulkanRender.SubmitFramePacket()) continue;
+
+		//Keep handling input until the render thread picks the packet up, so updates run at most one frame ahead
+		while (VulkanRender.IsFramePacketPending() && !glfwWindowShouldClose(window))
+		{
+			glfwWaitEventsTimeout(0.001);
+		}
 	}
 	
 
 
 	//Clean and Destroy
+	VulkanRender.StopRenderThread();
 	VulkanRender.CleanUp();
 	glfwDestroyWindow(window);
 	glfwTerminate();